@@ -0,0 +1,1239 @@
+/**
+ * @file acctlog.c
+ * @brief Registro de cuentas en la flash: diario de solo agregado con nivelación de desgaste.
+ *
+ * Los sectores del diario forman un anillo. Cada sector empieza con un registro de
+ * cabecera con un número de secuencia creciente; el sector de mayor secuencia es el
+ * que se está escribiendo y el siguiente del anillo es el próximo en usarse.
+ *
+ * Un punto de control es la secuencia BEGIN, un registro por usuario y END. Se escribe
+ * de a `ACCTLOG_CHECKPOINT_BATCH` usuarios por llamada a `acctlog_service()`, mezclado
+ * con las actualizaciones normales: como cada registro guarda el estado completo del
+ * usuario, recorrer el diario desde el BEGIN del último punto de control completo deja
+ * la tabla al día. Los sectores anteriores a ese BEGIN quedan libres, así que cada
+ * sector se borra una vez por vuelta del anillo.
+ *
+ * Los registros nuevos se acumulan en una copia en RAM de la página actual (256 bytes)
+ * y se graban con `flash_safe_execute()`, que apaga las interrupciones y, en modo
+ * multinúcleo, detiene al otro núcleo mientras la flash no se puede leer. Grabar una
+ * página tarda cerca de 1 ms; borrar un sector, decenas de ms, por eso el borrado se
+ * hace por adelantado desde `acctlog_service()` y no al agregar un registro.
+ *
+ * Cada registro indica si obliga a grabar la página: los de usuario, de punto de
+ * control y de retiro sí; los de billete entregado esperan a uno de esos, a que se
+ * llene la página o a `ACCTLOG_GROUP_COMMIT_MS`. La intención de un retiro se graba
+ * antes de volver de `acctlog_withdraw_begin()`, antes de que arranque un motor.
+ *
+ * Los retiros abiertos se siguen en RAM con lo previsto y lo entregado por canal. Un
+ * punto de control copia el inventario y los retiros abiertos, así la reconstrucción
+ * desde su BEGIN los conoce aunque la intención haya quedado antes.
+ */
+
+#include "acctlog.h"
+#include "events.h"
+#include "iocore.h"
+#include "timewheel.h"
+#include "pico/stdlib.h"
+#include "pico/flash.h"
+#include "hardware/flash.h"
+
+/**
+ * @brief Marca de las cabeceras de sector ("MCL2"). Cambia cuando cambia el formato
+ * de los registros, para que un diario viejo se descarte en lugar de leerse mal.
+ */
+#define ACCTLOG_MAGIC 0x324C434Du
+
+/**
+ * @brief Desplazamiento del diario dentro de la flash: los últimos `ACCTLOG_SECTORS` sectores.
+ */
+#define ACCTLOG_OFFSET (PICO_FLASH_SIZE_BYTES - ACCTLOG_SECTORS * FLASH_SECTOR_SIZE)
+
+/**
+ * @brief Registros por sector; el primero es la cabecera.
+ */
+#define ACCTLOG_SLOTS (FLASH_SECTOR_SIZE / ACCTLOG_RECORD_SIZE)
+
+/**
+ * @brief Registros por página de la flash.
+ */
+#define ACCTLOG_PAGE_SLOTS (FLASH_PAGE_SIZE / ACCTLOG_RECORD_SIZE)
+
+/**
+ * @brief Tiempo máximo para detener al otro núcleo antes de tocar la flash, en milisegundos.
+ */
+#define ACCTLOG_FLASH_TIMEOUT_MS 100
+
+/**
+ * @brief Espera antes de volver a intentar un borrado o un paso del punto de control
+ * postergado porque había motores en marcha.
+ */
+#define ACCTLOG_DEFER_MS 50
+
+/**
+ * @brief Indica que no hay un sector vigente (diario vacío).
+ */
+#define ACCTLOG_NO_SECTOR 0xFFFF
+
+/**
+ * @brief Usuarios que puede distinguir un registro: la posición se guarda en 24 bits.
+ */
+#define ACCTLOG_MAX_USERS (1u << 24)
+
+/**
+ * @brief Tipos de registro.
+ */
+typedef enum {
+    RECORD_SECTOR = 0x01,           /**< Cabecera de sector */
+    RECORD_CHECKPOINT_BEGIN = 0x02, /**< Inicio de un punto de control */
+    RECORD_CHECKPOINT_END = 0x03,   /**< Fin de un punto de control */
+    RECORD_USER = 0x10,             /**< Estado completo de un usuario */
+    RECORD_INVENTORY = 0x11,        /**< Billetes disponibles de cada canal */
+    RECORD_WITHDRAW_INTENT = 0x20,  /**< Retiro por empezar: saldo final y billetes previstos */
+    RECORD_WITHDRAW_NOTE = 0x21,    /**< Billete entregado por un canal */
+    RECORD_WITHDRAW_COMMIT = 0x22,  /**< Retiro terminado, o cerrado al arrancar */
+    RECORD_WITHDRAW_OPEN = 0x23,    /**< Retiro abierto copiado a un punto de control */
+    RECORD_WITHDRAW_CANCEL = 0x24,  /**< Billetes que no se entregarán: vuelven al saldo y al inventario */
+    RECORD_ERASED = 0xFF            /**< Espacio borrado, sin registro */
+} AcctRecordType;
+
+/**
+ * @brief Registro del diario, tal como queda en la flash.
+ */
+typedef struct {
+    uint32_t crc;       /**< CRC-32 de los bytes que siguen */
+    uint8_t type;       /**< `AcctRecordType` */
+    uint8_t slot_high;  /**< Bits 16 a 23 de la posición del usuario; en 0 en los diarios viejos */
+    uint16_t slot_low;  /**< Bits 0 a 15 de la posición del usuario en la tabla */
+    union {
+        struct {
+            uint32_t magic;     /**< `ACCTLOG_MAGIC` */
+            uint32_t sequence;  /**< Número de secuencia del sector */
+        } sector;
+        struct {
+            uint32_t id;        /**< Número del punto de control */
+        } checkpoint;
+        struct {
+            money_t balance;                    /**< Saldo, en pesos */
+            char password[PASSWORD_LENGTH];     /**< Contraseña, sin terminador */
+            uint8_t failed_attempts;            /**< Intentos fallidos */
+            uint8_t is_blocked;                 /**< Usuario bloqueado */
+        } user;
+        struct {
+            uint16_t quantity[ACCTLOG_CHANNELS];    /**< Billetes de cada canal */
+        } inventory;
+        struct {
+            uint32_t id;                            /**< Número del retiro */
+            uint8_t notes[ACCTLOG_CHANNELS];        /**< Billetes previstos (o devueltos) por canal */
+            money_t balance;                        /**< Saldo del usuario después del retiro (o la devolución) */
+        } withdraw;
+        struct {
+            uint32_t id;                            /**< Número del retiro */
+            uint8_t planned[ACCTLOG_CHANNELS];      /**< Billetes previstos por canal */
+            uint8_t delivered[ACCTLOG_CHANNELS];    /**< Billetes ya registrados por canal */
+        } open;
+        struct {
+            uint32_t id;                            /**< Número del retiro; 0 si el billete salió de más */
+            uint8_t channel;                        /**< Canal que entregó el billete */
+        } note;
+        uint8_t raw[24];
+    };
+} AcctRecord;
+
+_Static_assert(sizeof(AcctRecord) == ACCTLOG_RECORD_SIZE, "AcctRecord debe medir ACCTLOG_RECORD_SIZE");
+_Static_assert(NUM_DENOMINATIONS <= ACCTLOG_CHANNELS, "El diario registra hasta ACCTLOG_CHANNELS denominaciones");
+_Static_assert(NUM_USERS <= ACCTLOG_MAX_USERS, "La posición del usuario no entra en un registro del diario");
+_Static_assert(FLASH_SECTOR_SIZE == 4096, "ACCTLOG_CHECKPOINT_SECTORS supone sectores de 4 KB");
+_Static_assert(ACCTLOG_CHECKPOINT_SECTORS + 1 < ACCTLOG_SECTORS / 2,
+               "Un punto de control tiene que entrar en la mitad libre del anillo");
+_Static_assert(ACCTLOG_SECTORS < ACCTLOG_NO_SECTOR, "Los sectores del diario se numeran en 16 bits");
+_Static_assert(ACCTLOG_OFFSET >= PICO_FLASH_SIZE_BYTES / 4,
+               "El diario no deja lugar para el programa en la flash: hay que reducir NUM_USERS");
+
+/**
+ * @brief Retiro con billetes por entregar.
+ */
+typedef struct {
+    uint32_t id;                            /**< Número del retiro, 0 si el lugar está libre */
+    uint32_t slot;                          /**< Posición del usuario en la tabla */
+    uint8_t planned[ACCTLOG_CHANNELS];      /**< Billetes previstos por canal */
+    uint8_t delivered[ACCTLOG_CHANNELS];    /**< Billetes registrados por canal */
+} OpenWithdrawal;
+
+/**
+ * @brief Tabla de usuarios que refleja el diario.
+ */
+static User *users_table = NULL;
+
+/**
+ * @brief Cantidad de usuarios de la tabla.
+ */
+static unsigned int users_count = 0;
+
+/**
+ * @brief Inventario de billetes que refleja el diario.
+ */
+static Denomination *notes_table = NULL;
+
+/**
+ * @brief Cantidad de denominaciones del inventario.
+ */
+static unsigned int notes_count = 0;
+
+/**
+ * @brief Retiros abiertos.
+ */
+static OpenWithdrawal open_withdrawals[ACCTLOG_OPEN_WITHDRAWALS];
+
+/**
+ * @brief Número del último retiro registrado.
+ */
+static uint32_t withdrawal_id = 0;
+
+/**
+ * @brief Sector que se está escribiendo.
+ */
+static uint16_t write_sector = 0;
+
+/**
+ * @brief Siguiente registro libre del sector que se está escribiendo.
+ */
+static uint16_t write_slot = ACCTLOG_SLOTS;
+
+/**
+ * @brief Número de secuencia del sector que se está escribiendo.
+ */
+static uint32_t write_sequence = 0;
+
+/**
+ * @brief Sector más antiguo con datos vigentes: el del BEGIN del último punto de control completo.
+ */
+static uint16_t live_sector = ACCTLOG_NO_SECTOR;
+
+/**
+ * @brief Indica si el siguiente sector del anillo ya está borrado.
+ */
+static bool next_erased = false;
+
+/**
+ * @brief Copia en RAM de la página que se está llenando.
+ */
+static AcctRecord page[ACCTLOG_PAGE_SLOTS];
+
+/**
+ * @brief Primer registro del sector que cae en `page`.
+ */
+static uint16_t page_first_slot = 0;
+
+/**
+ * @brief Indica si `page` tiene registros que todavía no están en la flash.
+ */
+static bool page_dirty = false;
+
+/**
+ * @brief Indica si `page` tiene registros que obligan a grabarla en el próximo
+ * `acctlog_service()`.
+ */
+static bool page_urgent = false;
+
+/**
+ * @brief Venció la demora de la grabación en grupo de `page`.
+ */
+static volatile bool group_commit_due = false;
+
+/**
+ * @brief Número del último punto de control empezado.
+ */
+static uint32_t checkpoint_id = 0;
+
+/**
+ * @brief Próximo usuario a copiar al punto de control en curso, -1 si no hay ninguno.
+ */
+static int checkpoint_cursor = -1;
+
+/**
+ * @brief Sector donde quedó el BEGIN del punto de control en curso.
+ */
+static uint16_t checkpoint_sector = 0;
+
+/**
+ * @brief Resumen de la reconstrucción al arrancar.
+ */
+static AcctLogStats stats;
+
+/**
+ * @brief Registros que no se pudieron guardar.
+ */
+static uint32_t dropped = 0;
+
+/**
+ * @brief Operaciones de flash fallidas desde el arranque.
+ */
+static uint32_t flash_errors = 0;
+
+/**
+ * @brief Operaciones de flash fallidas seguidas; vuelve a 0 con la primera que anda.
+ */
+static unsigned int flash_failures = 0;
+
+/**
+ * @brief Operación sobre la flash que se ejecuta con `flash_safe_execute()`.
+ */
+typedef struct {
+    uint32_t offset;        /**< Desplazamiento dentro de la flash */
+    const uint8_t *data;    /**< Datos a grabar, NULL para borrar */
+    size_t size;            /**< Bytes a grabar o borrar */
+} FlashOp;
+
+/**
+ * @brief Ejecuta una operación de flash; corre con las interrupciones apagadas.
+ *
+ * @param param `FlashOp` a ejecutar.
+ */
+static void flash_op(void *param) {
+    const FlashOp *op = (const FlashOp *)param;
+    if (op->data) {
+        flash_range_program(op->offset, op->data, op->size);
+    } else {
+        flash_range_erase(op->offset, op->size);
+    }
+}
+
+/**
+ * @brief Despierta al lazo principal para retomar el trabajo postergado del diario.
+ *
+ * @param user_data No se usa.
+ */
+static void wake_callback(void *user_data) {
+    events_post(EVENT_STORAGE);
+}
+
+/**
+ * @brief Temporizador del trabajo postergado mientras el dispensador está en marcha.
+ */
+static TimeWheelTimer defer_timer = TIMEWHEEL_TIMER(wake_callback, NULL);
+
+/**
+ * @brief Temporizador del reintento tras un fallo de la flash.
+ */
+static TimeWheelTimer retry_timer = TIMEWHEEL_TIMER(wake_callback, NULL);
+
+/**
+ * @brief Ejecuta una operación de flash y lleva la cuenta de los fallos seguidos.
+ *
+ * Tras un fallo, `acctlog_service()` no vuelve a tocar la flash hasta que vence
+ * `retry_timer`, con una espera que se duplica en cada fallo seguido hasta
+ * `ACCTLOG_RETRY_MAX_MS`.
+ *
+ * @param op Operación a ejecutar.
+ * @return false si el otro núcleo no se pudo detener a tiempo.
+ */
+static bool run_flash_op(FlashOp *op) {
+    if (flash_safe_execute(flash_op, op, ACCTLOG_FLASH_TIMEOUT_MS) == PICO_OK) {
+        flash_failures = 0;
+        return true;
+    }
+    flash_errors++;
+    flash_failures++;
+    uint32_t wait_ms = ACCTLOG_RETRY_MS;
+    for (unsigned int i = 1; i < flash_failures && wait_ms < ACCTLOG_RETRY_MAX_MS; i++) {
+        wait_ms *= 2;
+    }
+    timewheel_arm(&retry_timer, wait_ms < ACCTLOG_RETRY_MAX_MS ? wait_ms : ACCTLOG_RETRY_MAX_MS);
+    return false;
+}
+
+/**
+ * @brief Desplazamiento dentro de la flash de un registro del diario.
+ *
+ * @param sector Sector del anillo.
+ * @param slot Registro dentro del sector.
+ * @return Desplazamiento en bytes.
+ */
+static uint32_t record_offset(unsigned int sector, unsigned int slot) {
+    return ACCTLOG_OFFSET + sector * FLASH_SECTOR_SIZE + slot * ACCTLOG_RECORD_SIZE;
+}
+
+/**
+ * @brief Lee un registro directamente de la flash mapeada en memoria (XIP).
+ *
+ * @param sector Sector del anillo.
+ * @param slot Registro dentro del sector.
+ * @return Puntero al registro.
+ */
+static const AcctRecord *flash_record(unsigned int sector, unsigned int slot) {
+    return (const AcctRecord *)(XIP_BASE + record_offset(sector, slot));
+}
+
+/**
+ * @brief Devuelve la posición del usuario de un registro.
+ *
+ * @param record Registro.
+ * @return Posición en la tabla de usuarios.
+ */
+static uint32_t record_slot(const AcctRecord *record) {
+    return (uint32_t)record->slot_high << 16 | record->slot_low;
+}
+
+/**
+ * @brief Guarda en un registro la posición del usuario.
+ *
+ * @param record Registro.
+ * @param slot Posición en la tabla de usuarios, menor que `ACCTLOG_MAX_USERS`.
+ */
+static void set_record_slot(AcctRecord *record, uint32_t slot) {
+    record->slot_high = (uint8_t)(slot >> 16);
+    record->slot_low = (uint16_t)slot;
+}
+
+/**
+ * @brief Calcula el CRC-32 de un registro, sin contar el propio campo `crc`.
+ *
+ * Usa una tabla de 16 entradas (medio byte por paso) para no ocupar 1 KB de flash.
+ *
+ * @param record Registro.
+ * @return CRC-32 del registro.
+ */
+static uint32_t record_crc(const AcctRecord *record) {
+    static const uint32_t nibble_table[16] = {
+        0x00000000u, 0x1DB71064u, 0x3B6E20C8u, 0x26D930ACu,
+        0x76DC4190u, 0x6B6B51F4u, 0x4DB26158u, 0x5005713Cu,
+        0xEDB88320u, 0xF00F9344u, 0xD6D6A3E8u, 0xCB61B38Cu,
+        0x9B64C2B0u, 0x86D3D2D4u, 0xA00AE278u, 0xBDBDF21Cu
+    };
+    const uint8_t *bytes = (const uint8_t *)record + sizeof(record->crc);
+    uint32_t crc = 0xFFFFFFFFu;
+
+    for (unsigned int i = 0; i < ACCTLOG_RECORD_SIZE - sizeof(record->crc); i++) {
+        crc ^= bytes[i];
+        crc = (crc >> 4) ^ nibble_table[crc & 0x0F];
+        crc = (crc >> 4) ^ nibble_table[crc & 0x0F];
+    }
+    return ~crc;
+}
+
+/**
+ * @brief Indica si un registro leído de la flash es válido.
+ *
+ * @param record Registro.
+ * @return false si está borrado o quedó a medio grabar.
+ */
+static bool record_valid(const AcctRecord *record) {
+    return record->type != RECORD_ERASED && record->crc == record_crc(record);
+}
+
+/**
+ * @brief Indica si un sector está completamente borrado.
+ *
+ * @param sector Sector del anillo.
+ * @return true si todos sus bytes valen 0xFF.
+ */
+static bool sector_erased(unsigned int sector) {
+    const uint32_t *words = (const uint32_t *)(XIP_BASE + record_offset(sector, 0));
+    for (unsigned int i = 0; i < FLASH_SECTOR_SIZE / sizeof(uint32_t); i++) {
+        if (words[i] != 0xFFFFFFFFu) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Cantidad de sectores con datos vigentes, incluido el que se está escribiendo.
+ *
+ * @return Sectores en uso.
+ */
+static unsigned int used_sectors(void) {
+    if (live_sector == ACCTLOG_NO_SECTOR) {
+        return 1;
+    }
+    return (write_sector + ACCTLOG_SECTORS - live_sector) % ACCTLOG_SECTORS + 1;
+}
+
+/**
+ * @brief Siguiente sector del anillo después del que se está escribiendo.
+ *
+ * @return Índice del sector.
+ */
+static uint16_t next_sector(void) {
+    return (uint16_t)((write_sector + 1) % ACCTLOG_SECTORS);
+}
+
+/**
+ * @brief Borra el siguiente sector del anillo.
+ *
+ * @return false si el otro núcleo no se pudo detener a tiempo.
+ */
+static bool erase_next_sector(void) {
+    FlashOp op = {record_offset(next_sector(), 0), NULL, FLASH_SECTOR_SIZE};
+    next_erased = run_flash_op(&op);
+    return next_erased;
+}
+
+/**
+ * @brief Graba la página en RAM si tiene registros nuevos.
+ */
+static void program_page(void) {
+    if (!page_dirty) {
+        return;
+    }
+    FlashOp op = {record_offset(write_sector, page_first_slot), (const uint8_t *)page, FLASH_PAGE_SIZE};
+    if (run_flash_op(&op)) {
+        page_dirty = false;
+        page_urgent = false;
+    }
+}
+
+/**
+ * @brief Vence la demora de la grabación en grupo; despierta al lazo principal para
+ * que `acctlog_service()` grabe la página.
+ *
+ * @param user_data No se usa.
+ */
+static void group_commit_callback(void *user_data) {
+    group_commit_due = true;
+    events_post(EVENT_STORAGE);
+}
+
+/**
+ * @brief Temporizador de la grabación en grupo.
+ */
+static TimeWheelTimer group_commit_timer = TIMEWHEEL_TIMER(group_commit_callback, NULL);
+
+/**
+ * @brief Pone un registro en la página en RAM, en el siguiente espacio libre del sector.
+ *
+ * Si la página se llena, se graba de inmediato y se empieza una nueva.
+ *
+ * @param record Registro a agregar; se le calcula el CRC.
+ */
+static void place_record(AcctRecord *record) {
+    record->crc = record_crc(record);
+    page[write_slot - page_first_slot] = *record;
+    if (!page_dirty) {
+        group_commit_due = false;
+        if (record->type == RECORD_WITHDRAW_NOTE) {
+            timewheel_arm(&group_commit_timer, ACCTLOG_GROUP_COMMIT_MS);
+        }
+    }
+    if (record->type != RECORD_WITHDRAW_NOTE) {
+        page_urgent = true;     // Los billetes entregados esperan a la grabación en grupo
+    }
+    page_dirty = true;
+    write_slot++;
+
+    if (write_slot - page_first_slot == ACCTLOG_PAGE_SLOTS) {
+        program_page();
+        page_first_slot = write_slot;
+        memset(page, 0xFF, sizeof(page));
+    }
+}
+
+/**
+ * @brief Pasa al siguiente sector del anillo y escribe su cabecera.
+ *
+ * Si el sector no se borró por adelantado, se borra aquí.
+ *
+ * @return false si el diario está lleno.
+ */
+static bool open_next_sector(void) {
+    if (next_sector() == live_sector) {
+        return false;
+    }
+    if (!next_erased && !erase_next_sector()) {
+        return false;
+    }
+
+    write_sector = next_sector();
+    write_sequence++;
+    write_slot = 0;
+    page_first_slot = 0;
+    next_erased = false;
+    memset(page, 0xFF, sizeof(page));
+
+    AcctRecord header = {0};
+    header.type = RECORD_SECTOR;
+    header.sector.magic = ACCTLOG_MAGIC;
+    header.sector.sequence = write_sequence;
+    place_record(&header);
+    return true;
+}
+
+/**
+ * @brief Agrega un registro al diario, abriendo un sector nuevo si hace falta.
+ *
+ * @param record Registro a agregar.
+ * @return false si el diario está lleno y el registro se perdió.
+ */
+static bool append_record(AcctRecord *record) {
+    if (write_slot == ACCTLOG_SLOTS && !open_next_sector()) {
+        dropped++;
+        return false;
+    }
+    place_record(record);
+    return true;
+}
+
+/**
+ * @brief Agrega al diario el estado completo de un usuario.
+ *
+ * @param slot Posición del usuario en la tabla.
+ * @return false si el registro se perdió.
+ */
+static bool append_user(unsigned int slot) {
+    const User *user = &users_table[slot];
+    AcctRecord record = {0};
+
+    record.type = RECORD_USER;
+    set_record_slot(&record, slot);
+    record.user.balance = user->balance;
+    memcpy(record.user.password, user->password, PASSWORD_LENGTH);
+    record.user.failed_attempts = user->failed_attempts;
+    record.user.is_blocked = user->is_blocked;
+    return append_record(&record);
+}
+
+/**
+ * @brief Agrega un registro BEGIN o END de punto de control.
+ *
+ * @param type `RECORD_CHECKPOINT_BEGIN` o `RECORD_CHECKPOINT_END`.
+ * @return false si el registro se perdió.
+ */
+static bool append_checkpoint_mark(AcctRecordType type) {
+    AcctRecord record = {0};
+    record.type = (uint8_t)type;
+    record.checkpoint.id = checkpoint_id;
+    return append_record(&record);
+}
+
+/**
+ * @brief Agrega al diario el inventario completo de billetes.
+ *
+ * @return false si el registro se perdió.
+ */
+static bool append_inventory(void) {
+    AcctRecord record = {0};
+    record.type = RECORD_INVENTORY;
+    for (unsigned int i = 0; i < notes_count; i++) {
+        record.inventory.quantity[i] = (uint16_t)(notes_table[i].quantity > 0 ? notes_table[i].quantity : 0);
+    }
+    return append_record(&record);
+}
+
+/**
+ * @brief Agrega un registro de retiro con su número.
+ *
+ * @param type `RECORD_WITHDRAW_NOTE` o `RECORD_WITHDRAW_COMMIT`.
+ * @param id Número del retiro.
+ * @param channel Canal del billete (solo para `RECORD_WITHDRAW_NOTE`).
+ * @return false si el registro se perdió.
+ */
+static bool append_withdraw_mark(AcctRecordType type, uint32_t id, unsigned int channel) {
+    AcctRecord record = {0};
+    record.type = (uint8_t)type;
+    record.note.id = id;
+    record.note.channel = (uint8_t)channel;
+    return append_record(&record);
+}
+
+/**
+ * @brief Copia los retiros abiertos al diario, como parte de un punto de control.
+ *
+ * @return false si algún registro se perdió.
+ */
+static bool append_open_withdrawals(void) {
+    for (unsigned int i = 0; i < ACCTLOG_OPEN_WITHDRAWALS; i++) {
+        const OpenWithdrawal *open = &open_withdrawals[i];
+        if (open->id == 0) {
+            continue;
+        }
+        AcctRecord record = {0};
+        record.type = RECORD_WITHDRAW_OPEN;
+        set_record_slot(&record, open->slot);
+        record.open.id = open->id;
+        memcpy(record.open.planned, open->planned, ACCTLOG_CHANNELS);
+        memcpy(record.open.delivered, open->delivered, ACCTLOG_CHANNELS);
+        if (!append_record(&record)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Empieza un punto de control nuevo.
+ */
+static void checkpoint_begin(void) {
+    checkpoint_id++;
+    if (append_checkpoint_mark(RECORD_CHECKPOINT_BEGIN) && append_open_withdrawals()) {
+        checkpoint_sector = write_sector;
+        checkpoint_cursor = 0;
+    }
+}
+
+/**
+ * @brief Copia el siguiente grupo de usuarios al punto de control en curso y, al
+ * terminar, libera los sectores anteriores a su BEGIN.
+ */
+static void checkpoint_step(void) {
+    for (unsigned int i = 0; i < ACCTLOG_CHECKPOINT_BATCH && checkpoint_cursor < (int)users_count; i++) {
+        if (!append_user((unsigned int)checkpoint_cursor)) {
+            return;
+        }
+        checkpoint_cursor++;
+    }
+
+    if (checkpoint_cursor == (int)users_count && append_inventory() &&
+        append_checkpoint_mark(RECORD_CHECKPOINT_END)) {
+        live_sector = checkpoint_sector;
+        checkpoint_cursor = -1;
+    }
+}
+
+/**
+ * @brief Aplica un registro de usuario sobre la tabla.
+ *
+ * @param record Registro válido de tipo `RECORD_USER`.
+ */
+static void apply_user(const AcctRecord *record) {
+    uint32_t slot = record_slot(record);
+    if (slot >= users_count) {
+        return;
+    }
+    User *user = &users_table[slot];
+    user->balance = record->user.balance;
+    memcpy(user->password, record->user.password, PASSWORD_LENGTH);
+    user->password[PASSWORD_LENGTH] = '\0';
+    user->failed_attempts = record->user.failed_attempts;
+    user->is_blocked = record->user.is_blocked != 0;
+}
+
+/**
+ * @brief Busca un retiro abierto por su número.
+ *
+ * @param id Número del retiro.
+ * @return El retiro, o NULL si no está abierto.
+ */
+static OpenWithdrawal *find_open(uint32_t id) {
+    for (unsigned int i = 0; i < ACCTLOG_OPEN_WITHDRAWALS; i++) {
+        if (id != 0 && open_withdrawals[i].id == id) {
+            return &open_withdrawals[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Ocupa un lugar libre de la tabla de retiros abiertos.
+ *
+ * @param id Número del retiro.
+ * @param slot Posición del usuario.
+ * @return El lugar, o NULL si la tabla está llena.
+ */
+static OpenWithdrawal *add_open(uint32_t id, uint32_t slot) {
+    OpenWithdrawal *open = NULL;
+    for (unsigned int i = 0; i < ACCTLOG_OPEN_WITHDRAWALS && !open; i++) {
+        if (open_withdrawals[i].id == 0) {
+            open = &open_withdrawals[i];
+        }
+    }
+    if (open) {
+        memset(open, 0, sizeof(*open));
+        open->id = id;
+        open->slot = slot;
+        if (id > withdrawal_id) {
+            withdrawal_id = id;
+        }
+    }
+    return open;
+}
+
+/**
+ * @brief Indica si un retiro ya registró todos sus billetes.
+ *
+ * @param open Retiro abierto.
+ * @return true si no le quedan billetes por canal.
+ */
+static bool withdrawal_complete(const OpenWithdrawal *open) {
+    for (unsigned int c = 0; c < ACCTLOG_CHANNELS; c++) {
+        if (open->delivered[c] < open->planned[c]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Aplica un registro de la reconstrucción que no es de usuario ni de punto de control.
+ *
+ * La intención aplica el saldo final y descuenta del inventario todos los billetes
+ * previstos; la cancelación hace lo contrario con los billetes que no se entregarán. Un
+ * billete de más se descuenta del inventario; los demás billetes y el cierre solo
+ * actualizan la tabla de retiros abiertos.
+ *
+ * @param record Registro válido.
+ */
+static void apply_record(const AcctRecord *record) {
+    OpenWithdrawal *open;
+
+    switch (record->type) {
+    case RECORD_INVENTORY:
+        for (unsigned int i = 0; i < notes_count; i++) {
+            notes_table[i].quantity = record->inventory.quantity[i];
+        }
+        break;
+    case RECORD_WITHDRAW_INTENT:
+        if (record_slot(record) >= users_count ||
+            !(open = add_open(record->withdraw.id, record_slot(record)))) {
+            break;
+        }
+        memcpy(open->planned, record->withdraw.notes, ACCTLOG_CHANNELS);
+        users_table[open->slot].balance = record->withdraw.balance;
+        for (unsigned int i = 0; i < notes_count; i++) {
+            notes_table[i].quantity -= open->planned[i];
+        }
+        break;
+    case RECORD_WITHDRAW_OPEN:
+        // Solo lo conoce por el punto de control: el saldo y el inventario ya lo incluyen
+        if (record_slot(record) < users_count && !find_open(record->open.id) &&
+            (open = add_open(record->open.id, record_slot(record)))) {
+            memcpy(open->planned, record->open.planned, ACCTLOG_CHANNELS);
+            memcpy(open->delivered, record->open.delivered, ACCTLOG_CHANNELS);
+        }
+        break;
+    case RECORD_WITHDRAW_NOTE:
+        if (record->note.id == 0 && record->note.channel < notes_count) {
+            notes_table[record->note.channel].quantity--;
+        } else if ((open = find_open(record->note.id)) && record->note.channel < ACCTLOG_CHANNELS) {
+            open->delivered[record->note.channel]++;
+        }
+        break;
+    case RECORD_WITHDRAW_CANCEL:
+        if (!(open = find_open(record->withdraw.id))) {
+            break;
+        }
+        for (unsigned int c = 0; c < ACCTLOG_CHANNELS; c++) {
+            unsigned int refunded = record->withdraw.notes[c] < open->planned[c] ? record->withdraw.notes[c]
+                                                                                  : open->planned[c];
+            open->planned[c] -= (uint8_t)refunded;
+            if (c < notes_count) {
+                notes_table[c].quantity += (int)refunded;
+            }
+        }
+        users_table[open->slot].balance = record->withdraw.balance;
+        break;
+    case RECORD_WITHDRAW_COMMIT:
+        if ((open = find_open(record->note.id))) {
+            open->id = 0;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief Cierra los retiros que quedaron abiertos por un corte.
+ *
+ * Los billetes sin registro de entrega vuelven al inventario y su valor al saldo del
+ * usuario; se cuentan como en duda para que el operador revise las cajas. El resultado
+ * queda en el diario y se graba antes de seguir.
+ */
+static void recover_withdrawals(void) {
+    for (unsigned int i = 0; i < ACCTLOG_OPEN_WITHDRAWALS; i++) {
+        OpenWithdrawal *open = &open_withdrawals[i];
+        if (open->id == 0) {
+            continue;
+        }
+        User *user = &users_table[open->slot];
+        for (unsigned int c = 0; c < notes_count; c++) {
+            unsigned int missing = open->planned[c] > open->delivered[c] ? open->planned[c] - open->delivered[c] : 0;
+            notes_table[c].quantity += (int)missing;
+            money_add(user->balance, notes_table[c].amount * (money_t)missing, &user->balance);
+            stats.notes_in_doubt += missing;
+        }
+        append_user(open->slot);
+        append_withdraw_mark(RECORD_WITHDRAW_COMMIT, open->id, 0);
+        open->id = 0;
+        stats.recovered++;
+    }
+    if (stats.recovered > 0) {
+        append_inventory();
+        acctlog_sync();
+    }
+}
+
+/**
+ * @brief Crea un diario nuevo con un punto de control de la tabla actual.
+ *
+ * @param last_sector Sector de mayor secuencia encontrado, o `ACCTLOG_NO_SECTOR`.
+ */
+static void format_log(uint16_t last_sector) {
+    write_sector = (last_sector == ACCTLOG_NO_SECTOR) ? ACCTLOG_SECTORS - 1 : last_sector;
+    write_slot = ACCTLOG_SLOTS;
+    live_sector = ACCTLOG_NO_SECTOR;
+    next_erased = false;
+    page_dirty = false;
+
+    if (!open_next_sector()) {
+        return;
+    }
+    live_sector = write_sector;
+    checkpoint_begin();
+    for (unsigned int i = 0; checkpoint_cursor >= 0 && i <= users_count / ACCTLOG_CHECKPOINT_BATCH; i++) {
+        checkpoint_step();
+    }
+    acctlog_sync();
+    stats.formatted = true;
+    stats.sectors = 1;
+}
+
+/**
+ * @brief Carga el diario de la flash sobre la tabla de usuarios y el inventario.
+ *
+ * Primero ordena los sectores por secuencia y busca el último punto de control
+ * completo mirando solo los registros BEGIN/END; después aplica, en orden, los
+ * registros desde ese BEGIN hasta el final y cierra los retiros que quedaron abiertos.
+ *
+ * @param table Tabla de usuarios a reconstruir.
+ * @param count Cantidad de usuarios de la tabla.
+ * @param notes Inventario de billetes a reconstruir.
+ * @param channels Cantidad de denominaciones.
+ */
+void acctlog_init(User *table, unsigned int count, Denomination *notes, unsigned int channels) {
+    uint32_t start_us = time_us_32();
+    // Con muchos usuarios el anillo tiene miles de sectores: no van en la pila
+    static uint16_t order[ACCTLOG_SECTORS];
+    static uint32_t sequences[ACCTLOG_SECTORS];
+    unsigned int sector_count = 0;
+
+    users_table = table;
+    users_count = count;
+    notes_table = notes;
+    notes_count = channels < ACCTLOG_CHANNELS ? channels : ACCTLOG_CHANNELS;
+    memset(&stats, 0, sizeof(stats));
+    memset(page, 0xFF, sizeof(page));
+    memset(open_withdrawals, 0, sizeof(open_withdrawals));
+    withdrawal_id = 0;
+    checkpoint_id = 0;
+    checkpoint_cursor = -1;
+    page_dirty = false;
+    page_urgent = false;
+    flash_errors = 0;
+    flash_failures = 0;
+
+    // Sectores con cabecera válida, ordenados por secuencia
+    for (unsigned int s = 0; s < ACCTLOG_SECTORS; s++) {
+        const AcctRecord *header = flash_record(s, 0);
+        if (header->type != RECORD_SECTOR || header->sector.magic != ACCTLOG_MAGIC || !record_valid(header)) {
+            continue;
+        }
+        unsigned int i = sector_count++;
+        while (i > 0 && sequences[i - 1] > header->sector.sequence) {
+            order[i] = order[i - 1];
+            sequences[i] = sequences[i - 1];
+            i--;
+        }
+        order[i] = (uint16_t)s;
+        sequences[i] = header->sector.sequence;
+    }
+
+    // Último punto de control completo
+    int open_index = -1, complete_index = -1;
+    unsigned int open_slot = 0, complete_slot = 0;
+    uint32_t open_id = 0;
+    unsigned int last_slot = ACCTLOG_SLOTS;
+
+    for (unsigned int i = 0; i < sector_count; i++) {
+        unsigned int slot;
+        for (slot = 1; slot < ACCTLOG_SLOTS; slot++) {
+            const AcctRecord *record = flash_record(order[i], slot);
+            if (record->type == RECORD_ERASED) {
+                break;
+            }
+            if (record->type == RECORD_CHECKPOINT_BEGIN && record_valid(record)) {
+                open_index = (int)i;
+                open_slot = slot;
+                open_id = record->checkpoint.id;
+                if (open_id > checkpoint_id) {
+                    checkpoint_id = open_id;
+                }
+            } else if (record->type == RECORD_CHECKPOINT_END && open_index >= 0 &&
+                       record->checkpoint.id == open_id && record_valid(record)) {
+                complete_index = open_index;
+                complete_slot = open_slot;
+            }
+        }
+        last_slot = slot;
+    }
+
+    if (complete_index < 0) {
+        write_sequence = sector_count ? sequences[sector_count - 1] : 0;
+        format_log(sector_count ? order[sector_count - 1] : ACCTLOG_NO_SECTOR);
+        stats.replay_us = time_us_32() - start_us;
+        return;
+    }
+
+    // Reconstrucción desde el BEGIN del último punto de control completo
+    for (unsigned int i = (unsigned int)complete_index; i < sector_count; i++) {
+        for (unsigned int slot = (i == (unsigned int)complete_index) ? complete_slot + 1 : 1;
+             slot < ACCTLOG_SLOTS; slot++) {
+            const AcctRecord *record = flash_record(order[i], slot);
+            if (record->type == RECORD_ERASED) {
+                break;
+            }
+            if (!record_valid(record)) {
+                continue;
+            }
+            if (record->type == RECORD_USER) {
+                apply_user(record);
+            } else {
+                apply_record(record);
+            }
+            stats.records++;
+        }
+    }
+
+    // Punto de escritura: después del último registro del sector más nuevo
+    write_sector = order[sector_count - 1];
+    write_sequence = sequences[sector_count - 1];
+    write_slot = (uint16_t)last_slot;
+    live_sector = order[complete_index];
+    next_erased = next_sector() != live_sector && sector_erased(next_sector());
+    page_first_slot = (uint16_t)(write_slot - write_slot % ACCTLOG_PAGE_SLOTS);
+    if (write_slot < ACCTLOG_SLOTS) {
+        memcpy(page, flash_record(write_sector, page_first_slot), (write_slot - page_first_slot) * sizeof(AcctRecord));
+    }
+
+    recover_withdrawals();
+    stats.sectors = used_sectors();
+    stats.replay_us = time_us_32() - start_us;
+}
+
+/**
+ * @brief Agrega al diario el estado actual de un usuario.
+ *
+ * @param slot Posición del usuario en la tabla.
+ */
+void acctlog_update_user(unsigned int slot) {
+    if (users_table == NULL || slot >= users_count) {
+        return;
+    }
+    append_user(slot);
+}
+
+/**
+ * @brief Registra la intención de un retiro y la graba en la flash.
+ *
+ * @param slot Posición del usuario en la tabla.
+ * @param balance Saldo del usuario después del retiro.
+ * @param notes Billetes a entregar por cada canal.
+ * @return false si no se pudo registrar.
+ */
+bool acctlog_withdraw_begin(unsigned int slot, money_t balance, const unsigned int *notes) {
+    if (users_table == NULL || slot >= users_count) {
+        return false;
+    }
+    OpenWithdrawal *open = add_open(withdrawal_id + 1, slot);
+    if (!open) {
+        return false;
+    }
+
+    AcctRecord record = {0};
+    record.type = RECORD_WITHDRAW_INTENT;
+    set_record_slot(&record, slot);
+    record.withdraw.id = open->id;
+    record.withdraw.balance = balance;
+    for (unsigned int c = 0; c < notes_count; c++) {
+        open->planned[c] = (uint8_t)notes[c];
+        record.withdraw.notes[c] = (uint8_t)notes[c];
+    }
+    if (!append_record(&record)) {
+        open->id = 0;
+        return false;
+    }
+
+    // Escritura adelantada: la intención tiene que estar en la flash antes del primer motor
+    program_page();
+    if (page_dirty) {
+        // Queda en RAM para grabarse después; se anula con el saldo y el inventario sin cambios
+        append_withdraw_mark(RECORD_WITHDRAW_COMMIT, open->id, 0);
+        append_user(slot);
+        append_inventory();
+        open->id = 0;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Indica si el diario puede registrar un retiro ahora.
+ *
+ * @return false si no hay diario, la última operación de flash falló, no queda lugar
+ * para otro retiro abierto o el anillo está lleno.
+ */
+bool acctlog_withdraw_ready(void) {
+    if (users_table == NULL || flash_failures > 0) {
+        return false;
+    }
+    bool free_slot = false;
+    for (unsigned int i = 0; i < ACCTLOG_OPEN_WITHDRAWALS; i++) {
+        if (open_withdrawals[i].id == 0) {
+            free_slot = true;
+        }
+    }
+    return free_slot && (write_slot < ACCTLOG_SLOTS || next_sector() != live_sector);
+}
+
+/**
+ * @brief Registra un billete entregado y, si era el último de su retiro, el cierre.
+ *
+ * @param channel Canal que entregó el billete.
+ * @return false si ningún retiro esperaba ese billete.
+ */
+bool acctlog_withdraw_note(unsigned int channel) {
+    OpenWithdrawal *oldest = NULL;
+    for (unsigned int i = 0; i < ACCTLOG_OPEN_WITHDRAWALS; i++) {
+        OpenWithdrawal *open = &open_withdrawals[i];
+        if (open->id != 0 && channel < ACCTLOG_CHANNELS && open->delivered[channel] < open->planned[channel] &&
+            (oldest == NULL || open->id < oldest->id)) {
+            oldest = open;
+        }
+    }
+    if (oldest == NULL) {
+        // Salió pegado a otro: no se cobra, pero ya no está en la caja
+        if (notes_table != NULL && channel < notes_count) {
+            notes_table[channel].quantity--;
+            append_withdraw_mark(RECORD_WITHDRAW_NOTE, 0, channel);
+        }
+        return false;
+    }
+
+    oldest->delivered[channel]++;
+    append_withdraw_mark(RECORD_WITHDRAW_NOTE, oldest->id, channel);
+    if (withdrawal_complete(oldest)) {
+        append_withdraw_mark(RECORD_WITHDRAW_COMMIT, oldest->id, 0);
+        oldest->id = 0;
+    }
+    return true;
+}
+
+/**
+ * @brief Cancela los billetes que les faltan a los retiros abiertos por un canal.
+ *
+ * @param channel Canal que ya no va a entregar billetes.
+ * @return Billetes devueltos.
+ */
+unsigned int acctlog_withdraw_cancel(unsigned int channel) {
+    unsigned int total = 0;
+    if (users_table == NULL || channel >= notes_count) {
+        return 0;
+    }
+
+    for (unsigned int i = 0; i < ACCTLOG_OPEN_WITHDRAWALS; i++) {
+        OpenWithdrawal *open = &open_withdrawals[i];
+        if (open->id == 0 || open->delivered[channel] >= open->planned[channel]) {
+            continue;
+        }
+        unsigned int missing = open->planned[channel] - open->delivered[channel];
+        User *user = &users_table[open->slot];
+        open->planned[channel] = open->delivered[channel];
+        notes_table[channel].quantity += (int)missing;
+        money_add(user->balance, notes_table[channel].amount * (money_t)missing, &user->balance);
+        total += missing;
+
+        // Un solo registro con el saldo y los billetes devueltos: se aplica entero o no se aplica
+        AcctRecord record = {0};
+        record.type = RECORD_WITHDRAW_CANCEL;
+        set_record_slot(&record, open->slot);
+        record.withdraw.id = open->id;
+        record.withdraw.notes[channel] = (uint8_t)missing;
+        record.withdraw.balance = user->balance;
+        append_record(&record);
+        if (withdrawal_complete(open)) {
+            append_withdraw_mark(RECORD_WITHDRAW_COMMIT, open->id, 0);
+            open->id = 0;
+        }
+    }
+    return total;
+}
+
+/**
+ * @brief Avanza un paso del trabajo pendiente del diario.
+ *
+ * En orden de prioridad: copiar un grupo de usuarios al punto de control en curso,
+ * empezar un punto de control si más de la mitad del anillo está en uso, o borrar el
+ * siguiente sector. Al final graba la página en RAM si tiene registros que no pueden
+ * esperar o si los diferidos ya esperaron `ACCTLOG_GROUP_COMMIT_MS`.
+ *
+ * Con el LCD o los motores en marcha solo se graba la página: un borrado apaga las
+ * interrupciones por decenas de ms y las barreras medirían mal los billetes. El resto
+ * se retoma desde `defer_timer` y mientras tanto no se informa como pendiente. Lo
+ * mismo tras un fallo de la flash, hasta `retry_timer`: así no se reintenta en un
+ * lazo con las interrupciones apagadas ni se impide el reposo.
+ *
+ * @return true si queda trabajo pendiente; los registros diferidos no cuentan.
+ */
+bool acctlog_service(void) {
+    if (users_table == NULL || timewheel_armed(&retry_timer)) {
+        return false;
+    }
+
+    bool work = checkpoint_cursor >= 0 || used_sectors() > ACCTLOG_SECTORS / 2 ||
+                (!next_erased && next_sector() != live_sector);
+    if (work && iocore_busy()) {
+        if (!timewheel_armed(&defer_timer)) {
+            timewheel_arm(&defer_timer, ACCTLOG_DEFER_MS);
+        }
+        if (page_urgent || (page_dirty && group_commit_due)) {
+            program_page();
+        }
+        return false;
+    }
+
+    if (checkpoint_cursor >= 0) {
+        checkpoint_step();
+    } else if (used_sectors() > ACCTLOG_SECTORS / 2) {
+        checkpoint_begin();
+    } else if (!next_erased && next_sector() != live_sector) {
+        program_page();
+        erase_next_sector();
+    }
+    if (page_urgent || (page_dirty && group_commit_due)) {
+        program_page();
+    }
+
+    return page_urgent || checkpoint_cursor >= 0 || used_sectors() > ACCTLOG_SECTORS / 2 ||
+           (!next_erased && next_sector() != live_sector);
+}
+
+/**
+ * @brief Graba en la flash todos los registros que estén en RAM.
+ */
+void acctlog_sync(void) {
+    program_page();
+}
+
+/**
+ * @brief Devuelve el resumen de la reconstrucción hecha al arrancar.
+ *
+ * @return Puntero al resumen.
+ */
+const AcctLogStats *acctlog_get_stats(void) {
+    return &stats;
+}
+
+/**
+ * @brief Devuelve la cantidad de registros que no se pudieron guardar.
+ *
+ * @return Registros perdidos desde el arranque.
+ */
+uint32_t acctlog_dropped(void) {
+    return dropped;
+}
+
+/**
+ * @brief Devuelve la cantidad de operaciones de flash del diario que fallaron.
+ */
+uint32_t acctlog_flash_errors(void) {
+    return flash_errors;
+}
@@ -0,0 +1,216 @@
+/**
+ * @file acctlog.h
+ * @brief Registro de cuentas en la flash: diario de solo agregado con nivelación de desgaste.
+ *
+ * Cada cambio de un usuario (saldo, clave, intentos fallidos, bloqueo) se agrega como
+ * un registro de 32 bytes al final del diario, en los últimos sectores de la flash.
+ * Al arrancar se recorre el diario desde el último punto de control completo para
+ * reconstruir `users[]`. Los sectores se usan en anillo y los puntos de control se
+ * escriben de a poco en segundo plano, así los borrados son pocos y se reparten.
+ *
+ * Los retiros se registran por adelantado: antes de encender un motor queda en la
+ * flash la intención (usuario, saldo final y billetes por canal); después se agrega un
+ * registro por billete entregado y, al salir el último, el cierre. Si el cajero se
+ * apaga con un retiro abierto, al arrancar se le devuelve al usuario el valor de los
+ * billetes sin registro y vuelven al inventario, y se informa cuántos quedaron en duda.
+ * Si un canal se traba, los billetes que le faltaban se cancelan con un registro que
+ * devuelve su valor al saldo.
+ */
+#ifndef ACCTLOG_H
+#define ACCTLOG_H
+
+#include "tcl.h"
+
+/**
+ * @brief Tamaño de un registro del diario, en bytes.
+ */
+#define ACCTLOG_RECORD_SIZE 32
+
+/**
+ * @brief Registros de un punto de control: BEGIN, los retiros abiertos, uno por
+ * usuario, el inventario y END.
+ */
+#define ACCTLOG_CHECKPOINT_RECORDS (NUM_USERS + ACCTLOG_OPEN_WITHDRAWALS + 3)
+
+/**
+ * @brief Sectores que llena un punto de control; en cada sector de 4 KB entran 127
+ * registros después de la cabecera.
+ */
+#define ACCTLOG_CHECKPOINT_SECTORS \
+    ((ACCTLOG_CHECKPOINT_RECORDS + 4096 / ACCTLOG_RECORD_SIZE - 2) / (4096 / ACCTLOG_RECORD_SIZE - 1))
+
+/**
+ * @brief Sectores de 4 KB reservados para el diario, al final de la flash.
+ *
+ * Un punto de control empieza con más de la mitad del anillo en uso, así que tiene que
+ * entrar en la otra mitad junto con las actualizaciones que lleguen mientras se copia.
+ * Por eso el anillo mide al menos tres puntos de control: al terminar uno queda un
+ * sexto del anillo para actualizaciones antes del siguiente. Con pocos usuarios son 32.
+ */
+#define ACCTLOG_SECTORS (3 * ACCTLOG_CHECKPOINT_SECTORS > 32 ? 3 * ACCTLOG_CHECKPOINT_SECTORS : 32)
+
+/**
+ * @brief Usuarios que se copian al punto de control en cada llamada a `acctlog_service()`.
+ */
+#define ACCTLOG_CHECKPOINT_BATCH 8
+
+/**
+ * @brief Canales del dispensador que registra el diario.
+ */
+#define ACCTLOG_CHANNELS 4
+
+/**
+ * @brief Retiros que pueden estar entregando billetes a la vez.
+ */
+#define ACCTLOG_OPEN_WITHDRAWALS 4
+
+/**
+ * @brief Demora máxima de los registros de billete en RAM, en milisegundos.
+ *
+ * Los registros de billete no fuerzan una grabación: se graban junto con el siguiente
+ * registro que sí la fuerza, al llenarse la página o cuando vence esta demora (un
+ * temporizador publica `EVENT_STORAGE`). Así los billetes que salen juntos por
+ * varios canales comparten una página. Tiene que ser menor que `MOTOR_REST_MS`, así
+ * tras un corte queda en duda a lo sumo un billete por canal.
+ */
+#define ACCTLOG_GROUP_COMMIT_MS 100
+
+/**
+ * @brief Espera antes de reintentar tras el primer fallo de la flash, en
+ * milisegundos; se duplica con cada fallo seguido hasta `ACCTLOG_RETRY_MAX_MS`.
+ */
+#define ACCTLOG_RETRY_MS 100
+
+/**
+ * @brief Espera máxima entre reintentos de la flash, en milisegundos: mientras siga
+ * fallando, `acctlog_service()` la reintenta con esta espera.
+ */
+#define ACCTLOG_RETRY_MAX_MS 3200
+
+/**
+ * @brief Resumen de la última reconstrucción del diario al arrancar.
+ */
+typedef struct {
+    uint32_t records;       /**< Registros leídos */
+    uint32_t sectors;       /**< Sectores con datos vigentes */
+    uint32_t replay_us;     /**< Tiempo de la reconstrucción */
+    bool formatted;         /**< No había un diario válido y se creó uno nuevo */
+    uint32_t recovered;     /**< Retiros abiertos que se cerraron al arrancar */
+    uint32_t notes_in_doubt; /**< Billetes de esos retiros sin registro de entrega */
+} AcctLogStats;
+
+/**
+ * @brief Carga el diario de la flash sobre la tabla de usuarios y el inventario de billetes.
+ *
+ * Si no hay un punto de control completo, se conservan los valores de las tablas y se
+ * escribe uno nuevo. Los retiros que quedaron abiertos se cierran como se describe
+ * arriba. Se llama una sola vez al arrancar, antes de `build_user_index()`.
+ *
+ * @param table Tabla de usuarios a reconstruir.
+ * @param count Cantidad de usuarios de la tabla.
+ * @param notes Inventario de billetes a reconstruir.
+ * @param channels Cantidad de denominaciones (máximo `ACCTLOG_CHANNELS`).
+ */
+void acctlog_init(User *table, unsigned int count, Denomination *notes, unsigned int channels);
+
+/**
+ * @brief Agrega al diario el estado actual de un usuario.
+ *
+ * El registro queda en un buffer en RAM; se graba en la flash en el siguiente
+ * `acctlog_service()`, fuera del camino del retiro.
+ *
+ * @param slot Posición del usuario en la tabla.
+ */
+void acctlog_update_user(unsigned int slot);
+
+/**
+ * @brief Registra la intención de un retiro y la graba en la flash antes de volver.
+ *
+ * Se llama antes de encolar los billetes y de cambiar el saldo y el inventario en RAM.
+ *
+ * @param slot Posición del usuario en la tabla.
+ * @param balance Saldo del usuario después del retiro.
+ * @param notes Billetes a entregar por cada canal.
+ * @return false si el retiro no se puede registrar (diario lleno o demasiados retiros
+ * abiertos); en ese caso no se debe entregar nada.
+ */
+bool acctlog_withdraw_begin(unsigned int slot, money_t balance, const unsigned int *notes);
+
+/**
+ * @brief Indica si el diario puede registrar un retiro ahora: la flash anda, hay lugar
+ * para otro retiro abierto y el anillo no está lleno. No modifica nada.
+ *
+ * Un error de la flash al grabar la intención puede hacer fallar igual a
+ * `acctlog_withdraw_begin()`.
+ *
+ * @return false si `acctlog_withdraw_begin()` fallaría.
+ */
+bool acctlog_withdraw_ready(void);
+
+/**
+ * @brief Registra un billete entregado por un canal.
+ *
+ * El billete se asigna al retiro abierto más antiguo que tenga billetes pendientes en
+ * ese canal, que es el orden en que los entrega el dispensador. Con el último billete
+ * del retiro se agrega su cierre. Si ningún retiro lo esperaba (salió pegado a otro),
+ * solo se descuenta del inventario.
+ *
+ * @param channel Canal que entregó el billete.
+ * @return false si el billete salió de más.
+ */
+bool acctlog_withdraw_note(unsigned int channel);
+
+/**
+ * @brief Cancela los billetes pendientes de un canal que se trabó.
+ *
+ * A cada retiro abierto con billetes por entregar en ese canal se le devuelve su valor
+ * al saldo y los billetes vuelven al inventario; si no le quedan billetes en otros
+ * canales, se cierra. Actualiza `users[]` y el inventario en RAM.
+ *
+ * @param channel Canal del dispensador.
+ * @return Billetes devueltos.
+ */
+unsigned int acctlog_withdraw_cancel(unsigned int channel);
+
+/**
+ * @brief Avanza el trabajo pendiente del diario: grabar la página en RAM, copiar un
+ * grupo de usuarios al punto de control o borrar por adelantado el siguiente sector.
+ *
+ * Se llama desde el lazo principal cuando no hay eventos por atender.
+ *
+ * @return true si queda trabajo pendiente.
+ */
+bool acctlog_service(void);
+
+/**
+ * @brief Graba en la flash todos los registros que estén en RAM.
+ */
+void acctlog_sync(void);
+
+/**
+ * @brief Devuelve el resumen de la reconstrucción hecha al arrancar.
+ *
+ * @return Puntero al resumen.
+ */
+const AcctLogStats *acctlog_get_stats(void);
+
+/**
+ * @brief Devuelve la cantidad de registros que no se pudieron guardar porque el diario
+ * estaba lleno.
+ *
+ * @return Registros perdidos desde el arranque.
+ */
+uint32_t acctlog_dropped(void);
+
+/**
+ * @brief Devuelve la cantidad de borrados y grabaciones de la flash que fallaron.
+ *
+ * Tras un fallo el diario no acepta retiros y reintenta cada vez más espaciado, hasta
+ * una vez cada `ACCTLOG_RETRY_MAX_MS`; la primera operación que anda vuelve a
+ * aceptarlos.
+ *
+ * @return Fallos desde el arranque.
+ */
+uint32_t acctlog_flash_errors(void);
+
+#endif // ACCTLOG_H
@@ -0,0 +1,99 @@
+/**
+ * @file events.c
+ * @brief Implementación del despachador de eventos del lazo principal.
+ *
+ * Los eventos pendientes se guardan como bits. El acceso se protege con un spinlock
+ * de hardware, que también deshabilita interrupciones, así publicar es seguro desde
+ * interrupciones y desde cualquier núcleo. `__sev()` garantiza que un evento publicado
+ * justo antes de `__wfe()` no se pierda: la espera termina de inmediato.
+ */
+
+#include "events.h"
+#include "log.h"
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+
+/**
+ * @brief Eventos publicados que aún no se atienden.
+ */
+static volatile uint32_t pending_events = 0;
+
+/**
+ * @brief Spinlock que protege `pending_events`.
+ */
+static spin_lock_t *events_lock;
+
+/**
+ * @brief Latencias registradas de las teclas.
+ */
+static EventLatency key_latency = {0};
+
+/**
+ * @brief Inicializa el despachador reservando su spinlock.
+ */
+void events_init(void) {
+    events_lock = spin_lock_init(spin_lock_claim_unused(true));
+}
+
+/**
+ * @brief Publica eventos y despierta al núcleo que espera.
+ *
+ * @param events Combinación de `EventFlags`.
+ */
+void events_post(uint32_t events) {
+    uint32_t status = spin_lock_blocking(events_lock);
+    pending_events |= events;
+    spin_unlock(events_lock, status);
+    __sev();
+}
+
+/**
+ * @brief Saca los eventos pendientes sin esperar.
+ *
+ * @return Eventos publicados desde la llamada anterior.
+ */
+uint32_t events_take(void) {
+    uint32_t status = spin_lock_blocking(events_lock);
+    uint32_t events = pending_events;
+    pending_events = 0;
+    spin_unlock(events_lock, status);
+    return events;
+}
+
+/**
+ * @brief Duerme hasta que haya eventos pendientes y los devuelve.
+ *
+ * @return Eventos publicados desde la llamada anterior.
+ */
+uint32_t events_wait(void) {
+    while (true) {
+        uint32_t events = events_take();
+        if (events) {
+            return events;
+        }
+        __wfe();
+    }
+}
+
+/**
+ * @brief Registra la latencia de una tecla.
+ *
+ * @param latency_us Latencia medida en microsegundos.
+ */
+void events_record_latency(uint32_t latency_us) {
+    key_latency.count++;
+    key_latency.last_us = latency_us;
+    key_latency.total_us += latency_us;
+    if (latency_us > key_latency.max_us) {
+        key_latency.max_us = latency_us;
+    }
+}
+
+/**
+ * @brief Imprime el resumen de latencias de teclas.
+ */
+void events_print_latency(void) {
+    uint32_t average = key_latency.count ? (uint32_t)(key_latency.total_us / key_latency.count) : 0;
+    log_message(LOG_KEY_LATENCY, (uint32_t)key_latency.count, (uint32_t)key_latency.last_us, average,
+                (uint32_t)key_latency.max_us);
+}
@@ -0,0 +1,76 @@
+/**
+ * @file events.h
+ * @brief Despachador de eventos del lazo principal.
+ *
+ * Las interrupciones (teclado, alarmas, motores) publican eventos y despiertan al
+ * núcleo; el lazo principal duerme con `__wfe()` hasta que haya algo que atender.
+ */
+#ifndef EVENTS_H
+#define EVENTS_H
+
+#include <stdint.h>
+
+/**
+ * @brief Eventos que puede atender el lazo principal. Se combinan como bits.
+ */
+typedef enum {
+    EVENT_KEY     = 1u << 0,   /**< Hay teclas en la cola del teclado */
+    EVENT_TIMEOUT = 1u << 1,   /**< Venció el tiempo de ingreso de datos */
+    EVENT_STDIO   = 1u << 2,   /**< Llegaron caracteres por la consola USB */
+    EVENT_MOTOR_DONE = 1u << 3, /**< Un motor del dispensador terminó de sacar un billete */
+    EVENT_STORAGE = 1u << 4,   /**< El registro de cuentas tiene trabajo pendiente en la flash */
+    EVENT_IDLE    = 1u << 5,   /**< Venció la espera de inactividad; se puede entrar en reposo */
+    EVENT_WAKE    = 1u << 6    /**< Una tecla despertó al teclado del reposo */
+} EventFlags;
+
+/**
+ * @brief Resumen de la latencia entre la interrupción de una tecla y su procesamiento.
+ */
+typedef struct {
+    uint32_t count;      /**< Teclas medidas */
+    uint32_t last_us;    /**< Latencia de la última tecla */
+    uint32_t max_us;     /**< Latencia máxima observada */
+    uint64_t total_us;   /**< Suma de latencias, para el promedio */
+} EventLatency;
+
+/**
+ * @brief Inicializa el despachador. Se llama antes de habilitar cualquier fuente de eventos.
+ */
+void events_init(void);
+
+/**
+ * @brief Publica uno o varios eventos y despierta al núcleo que espera.
+ *
+ * Se puede llamar desde interrupciones.
+ *
+ * @param events Combinación de `EventFlags`.
+ */
+void events_post(uint32_t events);
+
+/**
+ * @brief Saca los eventos pendientes sin esperar.
+ *
+ * @return Combinación de `EventFlags` publicados desde la llamada anterior, 0 si no hay.
+ */
+uint32_t events_take(void);
+
+/**
+ * @brief Duerme hasta que haya eventos pendientes y los devuelve.
+ *
+ * @return Combinación de `EventFlags` publicados desde la llamada anterior.
+ */
+uint32_t events_wait(void);
+
+/**
+ * @brief Registra la latencia de una tecla, desde la interrupción hasta su procesamiento.
+ *
+ * @param latency_us Latencia medida en microsegundos.
+ */
+void events_record_latency(uint32_t latency_us);
+
+/**
+ * @brief Imprime por la consola USB el resumen de latencias de teclas.
+ */
+void events_print_latency(void);
+
+#endif // EVENTS_H
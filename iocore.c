@@ -0,0 +1,168 @@
+/**
+ * @file iocore.c
+ * @brief Atención de los periféricos lentos, en el núcleo 1 o en el núcleo 0.
+ *
+ * En modo multinúcleo hay una cola del SDK (`queue_t`, segura entre núcleos) de
+ * pedidos de control, que nunca descarta, y la cola de mensajes de registro de
+ * `log.c`, que descarta si se llena para que una consola USB trabada no frene al
+ * núcleo 0. El núcleo 1 atiende primero los pedidos de control, envía los mensajes
+ * cuando no hay pedidos y duerme con `__wfe()` cuando ambas están vacías; agregar a
+ * cualquiera de las dos ejecuta `__sev()` y lo despierta.
+ *
+ * Las interrupciones de los motores y del DMA del LCD quedan en el núcleo que los
+ * inicializa, así que en modo multinúcleo también corren en el núcleo 1. Los descansos
+ * de los motores son temporizadores de `timewheel.h` y vencen en el núcleo 0.
+ */
+
+#include "iocore.h"
+#include "log.h"
+#include "lcd.h"
+#include "pwm.h"
+#include "tcl.h"
+
+#if MATECASH_MULTICORE
+#include "pico/multicore.h"
+#include "pico/flash.h"
+#include "pico/util/queue.h"
+
+/**
+ * @brief Palabra que envía el núcleo 1 por la FIFO del SIO cuando terminó de inicializar.
+ */
+#define IOCORE_READY 0x10C0EEADu
+
+/**
+ * @brief Tipos de pedido de control.
+ */
+typedef enum {
+    IOCORE_LCD_FLUSH,   /**< Enviar los cambios del LCD */
+    IOCORE_DISPENSE     /**< Entregar billetes */
+} IoCommandType;
+
+/**
+ * @brief Pedido de control para el núcleo 1.
+ */
+typedef struct {
+    uint8_t type;       /**< `IoCommandType` */
+    uint8_t channel;    /**< Canal del dispensador */
+    uint16_t notes;     /**< Billetes a entregar */
+} IoCommand;
+
+/**
+ * @brief Cola de pedidos de control.
+ */
+static queue_t control_queue;
+
+/**
+ * @brief Lazo principal del núcleo 1.
+ */
+static void core1_main(void) {
+    flash_safe_execute_core_init();   // El núcleo 0 puede detenerlo para grabar la flash
+    initLCD();
+    init_dispenser();
+    multicore_fifo_push_blocking(IOCORE_READY);
+
+    IoCommand command;
+    while (true) {
+        if (queue_try_remove(&control_queue, &command)) {
+            if (command.type == IOCORE_LCD_FLUSH) {
+                lcd_flush();
+            } else {
+                dispenser_enqueue(command.channel, command.notes);
+            }
+        } else if (log_pending()) {
+            log_drain();
+        } else {
+            __wfe();
+        }
+    }
+}
+
+/**
+ * @brief Lanza el núcleo 1 y espera a que el LCD y el dispensador estén listos.
+ */
+void iocore_init(void) {
+    queue_init(&control_queue, sizeof(IoCommand), IOCORE_CONTROL_QUEUE);
+    multicore_launch_core1(core1_main);
+    while (multicore_fifo_pop_blocking() != IOCORE_READY) {
+        tight_loop_contents();
+    }
+}
+
+/**
+ * @brief Pide al núcleo 1 enviar los cambios del LCD.
+ */
+void iocore_lcd_flush(void) {
+    IoCommand command = {IOCORE_LCD_FLUSH, 0, 0};
+    queue_add_blocking(&control_queue, &command);
+}
+
+/**
+ * @brief Pide al núcleo 1 entregar billetes.
+ *
+ * @param channel Canal del dispensador.
+ * @param notes Cantidad de billetes.
+ */
+void iocore_dispense(unsigned int channel, unsigned int notes) {
+    IoCommand command = {IOCORE_DISPENSE, (uint8_t)channel, (uint16_t)notes};
+    queue_add_blocking(&control_queue, &command);
+}
+
+/**
+ * @brief Indica si el núcleo 1 tiene pedidos en cola o periféricos ocupados.
+ *
+ * @return true si queda trabajo en el LCD o el dispensador.
+ */
+bool iocore_busy(void) {
+    return !queue_is_empty(&control_queue) || lcd_busy() || dispenser_busy();
+}
+
+/**
+ * @brief Los mensajes los envía el núcleo 1.
+ */
+void iocore_log_flush(void) {
+}
+
+#else
+
+/**
+ * @brief Inicializa el LCD y el dispensador en el núcleo 0.
+ */
+void iocore_init(void) {
+    initLCD();
+    init_dispenser();
+}
+
+/**
+ * @brief Envía los cambios del LCD.
+ */
+void iocore_lcd_flush(void) {
+    lcd_flush();
+}
+
+/**
+ * @brief Entrega billetes.
+ *
+ * @param channel Canal del dispensador.
+ * @param notes Cantidad de billetes.
+ */
+void iocore_dispense(unsigned int channel, unsigned int notes) {
+    dispenser_enqueue(channel, notes);
+}
+
+/**
+ * @brief Indica si el LCD o el dispensador están ocupados.
+ *
+ * @return true si queda trabajo en alguno de los dos.
+ */
+bool iocore_busy(void) {
+    return lcd_busy() || dispenser_busy();
+}
+
+/**
+ * @brief Envía los mensajes de registro en cola.
+ */
+void iocore_log_flush(void) {
+    log_drain();
+}
+
+#endif // MATECASH_MULTICORE
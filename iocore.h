@@ -0,0 +1,75 @@
+/**
+ * @file iocore.h
+ * @brief Acceso a los periféricos lentos (LCD, dispensador y consola USB).
+ *
+ * Con `MATECASH_MULTICORE` en 1, el núcleo 1 inicializa y atiende el LCD, el
+ * dispensador y la consola, y el núcleo 0 solo les envía pedidos por colas; así la
+ * atención del teclado y la lógica de cuentas nunca esperan a un periférico. Con 0,
+ * todo corre en el núcleo 0 y estas funciones llaman directamente a cada módulo.
+ *
+ * El núcleo 1 nunca lee ni escribe `users[]` ni `denominations[]`: todo el estado de
+ * las cuentas vive en el núcleo 0 y lo que el núcleo 1 necesita viaja por valor en
+ * los pedidos, así que no hay lecturas a medio escribir entre núcleos.
+ *
+ * En el simulador los dos modos dan las mismas latencias ('l' y 't' de la consola con
+ * `MATECASH_TRACE`, en la misma sesión): tecla a LCD 14895 µs de promedio y 27830 µs de
+ * máximo, `process_key` 400 µs de máximo por la grabación de la flash. El simulador no
+ * cobra el tiempo del procesador, así que la diferencia en el cajero es solo lo que
+ * tardan en el núcleo 0 `lcd_flush()`, `dispenser_enqueue()` y `log_drain()`.
+ */
+#ifndef IOCORE_H
+#define IOCORE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief Si es 1, los periféricos lentos se atienden en el núcleo 1.
+ */
+#ifndef MATECASH_MULTICORE
+#define MATECASH_MULTICORE 0
+#endif
+
+/**
+ * @brief Cantidad de pedidos de control (LCD y dispensador) que puede haber en cola.
+ */
+#define IOCORE_CONTROL_QUEUE 16
+
+/**
+ * @brief Inicializa el LCD y el dispensador, en el núcleo 1 si el modo multinúcleo está activo.
+ *
+ * Vuelve cuando ambos están listos para recibir pedidos.
+ */
+void iocore_init(void);
+
+/**
+ * @brief Pide enviar al LCD los cambios del buffer sombra.
+ */
+void iocore_lcd_flush(void);
+
+/**
+ * @brief Pide entregar billetes por un canal del dispensador.
+ *
+ * @param channel Canal del dispensador.
+ * @param notes Cantidad de billetes.
+ */
+void iocore_dispense(unsigned int channel, unsigned int notes);
+
+/**
+ * @brief Indica si el LCD o el dispensador tienen trabajo pendiente o en curso.
+ *
+ * En modo multinúcleo la respuesta puede llegar un poco atrasada respecto del núcleo 1.
+ *
+ * @return true si hay pedidos en cola, una ráfaga al LCD o motores en marcha.
+ */
+bool iocore_busy(void);
+
+/**
+ * @brief Envía por la consola USB los mensajes de registro en cola (`log.h`).
+ *
+ * En modo de un núcleo los envía en el momento; en modo multinúcleo no hace nada,
+ * porque los envía el núcleo 1 cuando no tiene pedidos de control.
+ */
+void iocore_log_flush(void);
+
+#endif // IOCORE_H
@@ -0,0 +1,171 @@
+/**
+ * @file keypad.c
+ * @brief Escaneo del teclado matricial por PIO y decodificación de los cuadros.
+ *
+ * La máquina de estados de `keypad.pio` recorre las filas y lee las columnas por su
+ * cuenta, con un tiempo de escaneo fijo, y solo entrega cuadros mientras hay teclas
+ * presionadas. La CPU recibe una interrupción cuando la FIFO RX tiene datos, convierte
+ * los cuadros en teclas y las agrega a la cola de eventos del teclado.
+ *
+ * En reposo (`keypad_sleep()`) el escáner se detiene y las columnas quedan como
+ * fuentes de interrupción del banco de GPIO hasta la próxima tecla.
+ */
+
+#include "keypad.h"
+#include "tcl.h"
+#include "keyring.h"
+#include "events.h"
+#include "trace.h"
+#include "hardware/pio.h"
+#include "hardware/irq.h"
+#include "keypad.pio.h"
+#include <string.h>
+
+/**
+ * @brief Bloque PIO usado por el escáner.
+ */
+#define KEYPAD_PIO pio0
+
+/**
+ * @brief Máquina de estados del escáner.
+ */
+static uint keypad_sm;
+
+/**
+ * @brief Dirección donde se cargó el programa del escáner.
+ */
+static uint keypad_offset;
+
+/**
+ * @brief Decodificador que alimenta la interrupción del PIO.
+ */
+static KeypadDecoder keypad_decoder;
+
+/**
+ * @brief Deja el decodificador en su estado inicial.
+ *
+ * @param decoder Decodificador a reiniciar.
+ */
+void keypad_decoder_reset(KeypadDecoder *decoder) {
+    memset(decoder->integrator, 0, sizeof(decoder->integrator));
+    decoder->pressed = 0;
+    decoder->released = 0;
+}
+
+/**
+ * @brief Procesa un cuadro del escáner y obtiene las teclas recién presionadas.
+ *
+ * @param decoder Estado del decodificador.
+ * @param frame Cuadro de 16 bits recibido del PIO.
+ * @param keys Donde se escriben las teclas.
+ * @param max_keys Capacidad de `keys`.
+ * @return Cantidad de teclas escritas en `keys`.
+ */
+int keypad_decode(KeypadDecoder *decoder, uint16_t frame, char *keys, int max_keys) {
+    int count = 0;
+    decoder->released = 0;
+
+    for (int row = 0; row < 4; row++) {
+        for (int col = 0; col < 4; col++) {
+            unsigned int bit = (3 - row) * 4 + col;
+            uint16_t mask = (uint16_t)(1u << bit);
+            uint8_t *level = &decoder->integrator[bit];
+
+            if (frame & mask) {
+                if (*level < KEYPAD_SETTLE_FRAMES && ++*level == KEYPAD_SETTLE_FRAMES &&
+                    !(decoder->pressed & mask)) {
+                    decoder->pressed |= mask;
+                    if (count < max_keys) {
+                        keys[count++] = KEYPAD[row][col];
+                    }
+                }
+            } else if (*level > 0 && --*level == 0 && (decoder->pressed & mask)) {
+                decoder->pressed &= (uint16_t)~mask;
+                decoder->released |= mask;
+            }
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief Interrupción del PIO: decodifica los cuadros recibidos y publica las teclas.
+ */
+static void keypad_irq_handler(void) {
+    char keys[KEYPAD_MAX_KEYS];
+    bool posted = false;
+
+    while (!pio_sm_is_rx_fifo_empty(KEYPAD_PIO, keypad_sm)) {
+        uint16_t frame = (uint16_t)pio_sm_get(KEYPAD_PIO, keypad_sm);
+        uint32_t now = time_us_32();
+        int count = keypad_decode(&keypad_decoder, frame, keys, KEYPAD_MAX_KEYS);
+
+        for (int i = 0; i < count; i++) {
+            keyring_push(keys[i], now);
+            TRACE(TRACE_KEY_IRQ, keys[i]);
+            posted = true;
+        }
+    }
+
+    if (posted) {
+        events_post(EVENT_KEY);
+    }
+}
+
+/**
+ * @brief Interrupción de una columna en reposo: devuelve las filas al PIO y arranca
+ * el escáner desde la primera fila.
+ *
+ * @param gpio Columna que bajó.
+ * @param events Eventos del pin.
+ */
+static void keypad_wake_handler(uint gpio, uint32_t events) {
+    for (int i = 0; i < 4; i++) {
+        // La interrupción es de nivel: se deshabilita antes de salir o volvería a entrar
+        gpio_set_irq_enabled(COL_PINS[i], GPIO_IRQ_LEVEL_LOW, false);
+        gpio_set_inover(COL_PINS[i], GPIO_OVERRIDE_INVERT);
+        pio_gpio_init(KEYPAD_PIO, ROW_PINS[i]);
+    }
+
+    pio_sm_restart(KEYPAD_PIO, keypad_sm);
+    pio_sm_exec(KEYPAD_PIO, keypad_sm, pio_encode_jmp(keypad_offset));
+    pio_sm_set_enabled(KEYPAD_PIO, keypad_sm, true);
+    events_post(EVENT_WAKE);
+}
+
+/**
+ * @brief Detiene el escáner y arma las columnas para despertar con la próxima tecla.
+ */
+void keypad_sleep(void) {
+    pio_sm_set_enabled(KEYPAD_PIO, keypad_sm, false);
+    pio_sm_clear_fifos(KEYPAD_PIO, keypad_sm);
+    keypad_decoder_reset(&keypad_decoder);
+
+    for (int i = 0; i < 4; i++) {
+        gpio_init(ROW_PINS[i]);
+        gpio_set_dir(ROW_PINS[i], GPIO_OUT);
+        gpio_put(ROW_PINS[i], 0);
+    }
+    for (int i = 0; i < 4; i++) {
+        // Sin inversión, una tecla presionada es un nivel bajo en su columna
+        gpio_set_inover(COL_PINS[i], GPIO_OVERRIDE_NORMAL);
+        gpio_set_irq_enabled_with_callback(COL_PINS[i], GPIO_IRQ_LEVEL_LOW, true, keypad_wake_handler);
+    }
+}
+
+/**
+ * @brief Inicializa el teclado matricial: carga el programa PIO y habilita su interrupción.
+ *
+ * Las filas y columnas deben ser pines consecutivos, como `ROW_PINS` y `COL_PINS`.
+ */
+void init_keypad() {
+    keypad_decoder_reset(&keypad_decoder);
+
+    keypad_offset = pio_add_program(KEYPAD_PIO, &keypad_program);
+    keypad_sm = pio_claim_unused_sm(KEYPAD_PIO, true);
+    keypad_program_init(KEYPAD_PIO, keypad_sm, keypad_offset, ROW_PINS[0], COL_PINS[0], KEYPAD_FRAME_US);
+
+    pio_set_irq0_source_enabled(KEYPAD_PIO, pis_sm0_rx_fifo_not_empty + keypad_sm, true);
+    irq_set_exclusive_handler(PIO0_IRQ_0, keypad_irq_handler);
+    irq_set_enabled(PIO0_IRQ_0, true);
+}
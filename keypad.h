@@ -0,0 +1,82 @@
+/**
+ * @file keypad.h
+ * @brief Escaneo del teclado matricial 4x4 por PIO y decodificación de teclas.
+ */
+#ifndef KEYPAD_H
+#define KEYPAD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief Duración de un cuadro de escaneo (las 4 filas), en microsegundos.
+ */
+#define KEYPAD_FRAME_US 2500
+
+/**
+ * @brief Tope del integrador de cada tecla: una tecla se acepta como presionada cuando
+ * su integrador llega a este valor y como soltada cuando vuelve a 0. Con cuadros de
+ * 2,5 ms son 15 ms de asentamiento.
+ */
+#define KEYPAD_SETTLE_FRAMES 6
+
+/**
+ * @brief Máximo de teclas que puede reportar un solo cuadro.
+ */
+#define KEYPAD_MAX_KEYS 16
+
+/**
+ * @brief Estado del decodificador de cuadros del teclado.
+ *
+ * Un cuadro tiene un bit por tecla (1 = presionada): la fila `r` y la columna `c`
+ * están en el bit `(3 - r) * 4 + c`. Cada tecla tiene su propio integrador, que sube
+ * con los cuadros en que aparece presionada y baja con los que no, así el rebote de
+ * una tecla no afecta a las demás.
+ */
+typedef struct {
+    uint8_t integrator[16];     /**< Integrador de cada tecla, de 0 a `KEYPAD_SETTLE_FRAMES` */
+    uint16_t pressed;           /**< Teclas aceptadas como presionadas */
+    uint16_t released;          /**< Teclas que se soltaron en el último cuadro */
+} KeypadDecoder;
+
+/**
+ * @brief Inicializa el teclado matricial: carga el programa PIO y habilita su interrupción.
+ */
+void init_keypad(void);
+
+/**
+ * @brief Deja el decodificador en su estado inicial (sin teclas presionadas).
+ *
+ * @param decoder Decodificador a reiniciar.
+ */
+void keypad_decoder_reset(KeypadDecoder *decoder);
+
+/**
+ * @brief Procesa un cuadro del escáner y obtiene las teclas recién presionadas.
+ *
+ * Una tecla se reporta cuando su integrador llega a `KEYPAD_SETTLE_FRAMES` y no
+ * estaba presionada; vuelve a poder reportarse recién cuando su integrador baja a 0
+ * (las teclas soltadas quedan en `decoder->released`). No hay un bloqueo global entre
+ * teclas: la misma tecla presionada dos veces seguidas se reporta dos veces si se
+ * soltó en el medio. No depende del hardware, así que se puede probar con trazas de
+ * pines grabadas.
+ *
+ * @param decoder Estado del decodificador.
+ * @param frame Cuadro de 16 bits recibido del PIO.
+ * @param keys Donde se escriben las teclas (según `KEYPAD`).
+ * @param max_keys Capacidad de `keys`.
+ * @return Cantidad de teclas escritas en `keys`.
+ */
+int keypad_decode(KeypadDecoder *decoder, uint16_t frame, char *keys, int max_keys);
+
+/**
+ * @brief Detiene el escáner y arma las columnas para despertar con la próxima tecla.
+ *
+ * Las filas quedan en bajo como salidas del SIO, así cualquier tecla baja su columna.
+ * La interrupción de nivel de las columnas vuelve a arrancar el escáner desde la
+ * primera fila y publica `EVENT_WAKE`; la tecla se reporta después, como siempre,
+ * cuando el decodificador ve sus cuadros estables.
+ */
+void keypad_sleep(void);
+
+#endif // KEYPAD_H
@@ -0,0 +1,104 @@
+/**
+ * @file keyring.c
+ * @brief Implementación de la cola circular de eventos del teclado.
+ *
+ * Los índices crecen sin límite y se enmascaran al acceder al arreglo, así la cola
+ * llena (`head - tail == KEYRING_SIZE`) se distingue de la vacía (`head == tail`).
+ * Cada índice lo escribe un solo lado; las barreras de memoria garantizan que el
+ * evento esté escrito antes de publicar el índice y leído antes de liberarlo.
+ */
+
+#include "keyring.h"
+#include "hardware/sync.h"
+
+#define KEYRING_MASK (KEYRING_SIZE - 1)
+
+_Static_assert((KEYRING_SIZE & KEYRING_MASK) == 0, "KEYRING_SIZE debe ser potencia de 2");
+
+/**
+ * @brief Almacenamiento de los eventos.
+ */
+static KeyEvent keyring_events[KEYRING_SIZE];
+
+/**
+ * @brief Siguiente posición a escribir. Solo la modifica el productor.
+ */
+static volatile uint32_t keyring_head = 0;
+
+/**
+ * @brief Siguiente posición a leer. Solo la modifica el consumidor.
+ */
+static volatile uint32_t keyring_tail = 0;
+
+/**
+ * @brief Eventos descartados por cola llena.
+ */
+static volatile uint32_t keyring_overflow_count = 0;
+
+/**
+ * @brief Agrega un evento a la cola desde la interrupción del teclado.
+ *
+ * @param key Tecla presionada.
+ * @param timestamp_us Momento en que se detectó.
+ * @return false si la cola estaba llena.
+ */
+bool keyring_push(char key, uint32_t timestamp_us) {
+    uint32_t head = keyring_head;
+
+    if (head - keyring_tail == KEYRING_SIZE) {
+        keyring_overflow_count++;
+        return false;
+    }
+
+    keyring_events[head & KEYRING_MASK].key = key;
+    keyring_events[head & KEYRING_MASK].timestamp_us = timestamp_us;
+    __dmb();                        // El evento queda escrito antes de publicarlo
+    keyring_head = head + 1;
+    return true;
+}
+
+/**
+ * @brief Saca el evento más antiguo de la cola.
+ *
+ * @param event Donde se copia el evento.
+ * @return false si la cola estaba vacía.
+ */
+bool keyring_pop(KeyEvent *event) {
+    uint32_t tail = keyring_tail;
+
+    if (tail == keyring_head) {
+        return false;
+    }
+
+    __dmb();                        // Leer el evento después de ver el índice publicado
+    *event = keyring_events[tail & KEYRING_MASK];
+    __dmb();                        // Terminar de leer antes de liberar la posición
+    keyring_tail = tail + 1;
+    return true;
+}
+
+/**
+ * @brief Procesa en orden todos los eventos pendientes.
+ *
+ * @param handler Función que se llama con cada evento.
+ * @return Cantidad de eventos procesados.
+ */
+uint32_t keyring_drain(keyring_handler_t handler) {
+    KeyEvent event;
+    uint32_t count = 0;
+
+    while (keyring_pop(&event)) {
+        handler(&event);
+        count++;
+    }
+    return count;
+}
+
+/**
+ * @brief Cantidad de eventos descartados por encontrar la cola llena.
+ *
+ * @return Número de desbordes desde el arranque.
+ */
+uint32_t keyring_overflows(void) {
+    return keyring_overflow_count;
+}
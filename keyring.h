@@ -0,0 +1,64 @@
+/**
+ * @file keyring.h
+ * @brief Cola circular sin bloqueos de eventos del teclado matricial.
+ *
+ * Un solo productor (la interrupción del teclado) y un solo consumidor (el lazo
+ * principal). Ninguno de los dos deshabilita interrupciones ni espera al otro.
+ */
+#ifndef KEYRING_H
+#define KEYRING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief Capacidad de la cola, en eventos. Debe ser potencia de 2.
+ */
+#define KEYRING_SIZE 32
+
+/**
+ * @brief Evento de tecla presionada.
+ */
+typedef struct {
+    char key;               /**< Tecla según `KEYPAD` */
+    uint32_t timestamp_us;  /**< Momento en que se detectó la tecla (`time_us_32()`) */
+} KeyEvent;
+
+/**
+ * @brief Función que procesa un evento durante `keyring_drain()`.
+ */
+typedef void (*keyring_handler_t)(const KeyEvent *event);
+
+/**
+ * @brief Agrega un evento a la cola. Solo la llama el productor (la interrupción).
+ *
+ * @param key Tecla presionada.
+ * @param timestamp_us Momento en que se detectó.
+ * @return false si la cola estaba llena; el evento se descarta y se cuenta como desborde.
+ */
+bool keyring_push(char key, uint32_t timestamp_us);
+
+/**
+ * @brief Saca el evento más antiguo de la cola. Solo la llama el consumidor.
+ *
+ * @param event Donde se copia el evento.
+ * @return false si la cola estaba vacía.
+ */
+bool keyring_pop(KeyEvent *event);
+
+/**
+ * @brief Procesa en orden todos los eventos pendientes.
+ *
+ * @param handler Función que se llama con cada evento.
+ * @return Cantidad de eventos procesados.
+ */
+uint32_t keyring_drain(keyring_handler_t handler);
+
+/**
+ * @brief Cantidad de eventos descartados por encontrar la cola llena.
+ *
+ * @return Número de desbordes desde el arranque.
+ */
+uint32_t keyring_overflows(void);
+
+#endif // KEYRING_H
@@ -1,11 +1,122 @@
 /**
  * @file lcd.c
  * @brief Implementación de funciones para controlar una pantalla LCD 20x4 a través de I2C.
+ *
+ * Las escrituras no van directo al bus: se guardan en un buffer sombra de 80 celdas
+ * y `lcd_flush()` envía solo las celdas que cambiaron respecto a lo que ya muestra
+ * la pantalla, usando la menor cantidad posible de comandos de posición de cursor.
+ *
+ * El envío no bloquea: la ráfaga se entrega a un canal DMA que alimenta la FIFO de
+ * transmisión del I2C y, al terminar, la interrupción del DMA envía lo que haya cambiado
+ * mientras tanto. Si una fila se modifica varias veces antes de salir, solo se envía
+ * su último contenido.
  */
 
-#include "LCD.h"
+#include "lcd.h"
 #include "pico/stdlib.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+#include "trace.h"
 #include <stdio.h>
+#include <string.h>
+
+/**
+ * @brief Número total de celdas del LCD.
+ */
+#define LCD_CELLS (LCD_ROWS * LCD_COLUMNS)
+
+/**
+ * @brief Máximo de celdas sin cambios que se reescriben para evitar un comando de cursor.
+ *
+ * Un comando de posición cuesta lo mismo en el bus que un carácter (4 bytes), así que
+ * reescribir una sola celda intermedia empata en bytes y ahorra un comando.
+ */
+#define LCD_GAP_BRIDGE 1
+
+/**
+ * @brief Contenido que se desea mostrar (buffer sombra).
+ */
+static char lcd_shadow[LCD_ROWS][LCD_COLUMNS];
+
+/**
+ * @brief Contenido que realmente tiene la pantalla en este momento.
+ */
+static char lcd_glass[LCD_ROWS][LCD_COLUMNS];
+
+/**
+ * @brief Posición lineal del cursor del HD44780 (ver `lcd_cell_row()`), -1 si se desconoce.
+ */
+static int lcd_cursor = -1;
+
+/**
+ * @brief Bytes enviados al LCD por I2C desde el arranque.
+ */
+static uint32_t lcd_i2c_bytes = 0;
+
+/**
+ * @brief Bits del PCF8574 conectados a las líneas de control del HD44780.
+ */
+#define LCD_RS_BIT        0x01  // RS=1 para datos, RS=0 para comandos
+#define LCD_ENABLE_BIT    0x04  // Pulso de Enable (E)
+#define LCD_BACKLIGHT_BIT 0x08  // Retroiluminación
+
+/**
+ * @brief Secuencia de 4 bytes del PCF8574 que transfiere `c` en modo 4 bits.
+ *
+ * Parte alta con E activo y luego inactivo, después la parte baja igual.
+ */
+#define LCD_ENC(c, rs) { \
+    ((c) & 0xF0) | (rs) | LCD_ENABLE_BIT | LCD_BACKLIGHT_BIT, \
+    ((c) & 0xF0) | (rs) | LCD_BACKLIGHT_BIT, \
+    (((c) << 4) & 0xF0) | (rs) | LCD_ENABLE_BIT | LCD_BACKLIGHT_BIT, \
+    (((c) << 4) & 0xF0) | (rs) | LCD_BACKLIGHT_BIT }
+#define LCD_ENC4(c)   LCD_ENC(c, LCD_RS_BIT), LCD_ENC((c) + 1, LCD_RS_BIT), \
+                      LCD_ENC((c) + 2, LCD_RS_BIT), LCD_ENC((c) + 3, LCD_RS_BIT)
+#define LCD_ENC16(c)  LCD_ENC4(c), LCD_ENC4((c) + 4), LCD_ENC4((c) + 8), LCD_ENC4((c) + 12)
+#define LCD_ENC64(c)  LCD_ENC16(c), LCD_ENC16((c) + 16), LCD_ENC16((c) + 32), LCD_ENC16((c) + 48)
+
+/**
+ * @brief Tabla con la secuencia I2C ya codificada de cada carácter (RS=1).
+ *
+ * Se genera en tiempo de compilación y queda en flash; codificar un carácter es copiar 4 bytes.
+ */
+static const uint8_t lcd_data_table[256][4] = {
+    LCD_ENC64(0), LCD_ENC64(64), LCD_ENC64(128), LCD_ENC64(192)
+};
+
+/**
+ * @brief Bytes máximos de una ráfaga: 80 caracteres más, en el peor caso, un comando por carácter.
+ */
+#define LCD_BURST_MAX (2 * LCD_CELLS * 4)
+
+/**
+ * @brief Buffer donde se codifica una ráfaga completa antes de enviarla.
+ *
+ * Cada entrada es una palabra para el registro IC_DATA_CMD del I2C, que es lo que
+ * el DMA copia directamente a la FIFO de transmisión.
+ */
+static uint16_t lcd_burst[LCD_BURST_MAX];
+
+/**
+ * @brief Bytes ocupados en `lcd_burst`.
+ */
+static size_t lcd_burst_len = 0;
+
+/**
+ * @brief Canal DMA que envía las ráfagas al I2C, -1 antes de `initLCD()`.
+ */
+static int lcd_dma_channel = -1;
+
+/**
+ * @brief Momento en que se inició la ráfaga en curso.
+ */
+static uint32_t lcd_flush_start_us = 0;
+
+/**
+ * @brief Duración de la última ráfaga enviada, en microsegundos.
+ */
+static volatile uint32_t lcd_last_flush_us = 0;
 
 /**
  * @brief Envía un byte al LCD (como comando o dato).
@@ -14,21 +125,51 @@
  * @param is_data Si es true, se interpreta como un dato; si es false, como un comando.
  */
 void lcd_write_byte(uint8_t data, bool is_data) {
-    uint8_t byte_high = data & 0xF0;            // Parte alta
-    uint8_t byte_low = (data << 4) & 0xF0;      // Parte baja
+    uint8_t control_bits = is_data ? LCD_RS_BIT : 0x00;
+    uint8_t buffer[4] = LCD_ENC(data, control_bits);
 
-    uint8_t control_bits = is_data ? 0x01 : 0x00; // RS=1 para datos, RS=0 para comandos
-    uint8_t enable_bit = 0x04;                   // Habilitar pulsos para Enable (E)
+    i2c_write_blocking(I2C_PORT, LCD_ADDRESS, buffer, 4, false);
+    lcd_i2c_bytes += 4;
+}
 
-    uint8_t backlight_bit = 0x08; // Bit que activa la retroiluminación.
-    uint8_t buffer[4] = {
-    byte_high | control_bits | enable_bit | backlight_bit,
-    byte_high | control_bits | backlight_bit,
-    byte_low | control_bits | enable_bit | backlight_bit,
-    byte_low | control_bits | backlight_bit              // Parte baja con E desactivado
-    };
+/**
+ * @brief Agrega un comando a la ráfaga en curso.
+ *
+ * @param command Comando del HD44780.
+ */
+static inline void lcd_burst_command(uint8_t command) {
+    uint8_t encoded[4] = LCD_ENC(command, 0x00);
+    for (int i = 0; i < 4; i++) {
+        lcd_burst[lcd_burst_len++] = encoded[i];
+    }
+}
 
-    i2c_write_blocking(I2C_PORT, LCD_ADDRESS, buffer, 4, false);
+/**
+ * @brief Agrega un carácter a la ráfaga en curso usando la tabla precodificada.
+ *
+ * @param c Carácter a escribir.
+ */
+static inline void lcd_burst_data(char c) {
+    const uint8_t *encoded = lcd_data_table[(uint8_t)c];
+    for (int i = 0; i < 4; i++) {
+        lcd_burst[lcd_burst_len++] = encoded[i];
+    }
+}
+
+/**
+ * @brief Entrega la ráfaga acumulada al DMA como una sola transacción I2C.
+ *
+ * La última palabra lleva el bit STOP. Si una transacción anterior fue abortada
+ * (por ejemplo, el LCD no respondió), se limpia el aborto antes de empezar.
+ */
+static void lcd_burst_send(void) {
+    i2c_hw_t *hw = i2c_get_hw(I2C_PORT);
+
+    lcd_burst[lcd_burst_len - 1] |= I2C_IC_DATA_CMD_STOP_BITS;
+    (void)hw->clr_tx_abrt;
+    TRACE(TRACE_LCD_START, 0);
+    dma_channel_transfer_from_buffer_now(lcd_dma_channel, lcd_burst, lcd_burst_len);
+    lcd_i2c_bytes += lcd_burst_len;
 }
 
 /**
@@ -51,6 +192,11 @@ void lcd_init() {
     lcd_write_byte(0x06, false);  // Incremento automático, sin desplazamiento
     lcd_write_byte(0x01, false);  // Limpiar pantalla
     sleep_ms(10);
+
+    // Tras limpiar, la pantalla queda en blanco y el cursor en la dirección 0x00
+    memset(lcd_shadow, ' ', sizeof(lcd_shadow));
+    memset(lcd_glass, ' ', sizeof(lcd_glass));
+    lcd_cursor = 0;
 }
 
 /**
@@ -59,40 +205,250 @@ void lcd_init() {
  * Establece las funciones GPIO para SDA y SCL, activa las resistencias pull-up
  * internas y llama a la función de inicialización del LCD.
  */
+static void lcd_dma_irq_handler(void);
+
 void initLCD() {
-    i2c_init(I2C_PORT, 100 * 1000);                 // Inicializa I2C a 100kHz
+    i2c_init(I2C_PORT, LCD_I2C_BAUDRATE);           // Inicializa I2C a 100kHz (400kHz en modo rápido)
     gpio_set_function(14, GPIO_FUNC_I2C);          // SDA en GPIO14
     gpio_set_function(15, GPIO_FUNC_I2C);          // SCL en GPIO15
     gpio_pull_up(14);                              // activo resistencias internas
     gpio_pull_up(15);
 
     lcd_init();
+
+    // A partir de aquí todo lo que va al LCD sale por DMA hacia IC_DATA_CMD
+    i2c_hw_t *hw = i2c_get_hw(I2C_PORT);
+    hw->enable = 0;
+    hw->tar = LCD_ADDRESS;
+    hw->enable = 1;
+
+    lcd_dma_channel = dma_claim_unused_channel(true);
+    dma_channel_config config = dma_channel_get_default_config(lcd_dma_channel);
+    channel_config_set_transfer_data_size(&config, DMA_SIZE_16);
+    channel_config_set_read_increment(&config, true);
+    channel_config_set_write_increment(&config, false);
+    channel_config_set_dreq(&config, i2c_get_dreq(I2C_PORT, true));
+    dma_channel_configure(lcd_dma_channel, &config, &hw->data_cmd, lcd_burst, 0, false);
+
+    dma_channel_set_irq0_enabled(lcd_dma_channel, true);
+    irq_add_shared_handler(DMA_IRQ_0, lcd_dma_irq_handler, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    irq_set_enabled(DMA_IRQ_0, true);
+}
+
+/**
+ * @brief Fila de la celda en la posición lineal `pos` de la DDRAM.
+ *
+ * En modo de 2 líneas el contador de direcciones recorre las filas en el orden
+ * 0 (0x00), 2 (0x14), 1 (0x40), 3 (0x54) y pasa de 0x27 a 0x40 y de 0x67 a 0x00 solo,
+ * por lo que las 80 celdas forman una única secuencia continua sin comandos de cursor.
+ *
+ * @param pos Posición lineal (0 a 79).
+ * @return Fila del LCD (0 a 3).
+ */
+static inline int lcd_cell_row(int pos) {
+    static const uint8_t ddram_rows[LCD_ROWS] = {0, 2, 1, 3};
+    return ddram_rows[pos / LCD_COLUMNS];
+}
+
+/**
+ * @brief Dirección DDRAM de la celda en la posición lineal `pos`.
+ *
+ * @param pos Posición lineal (0 a 79).
+ * @return Dirección DDRAM de la celda.
+ */
+static inline uint8_t lcd_cell_address(int pos) {
+    return (pos < 2 * LCD_COLUMNS ? 0x00 : 0x40) + (pos % (2 * LCD_COLUMNS));
+}
+
+/**
+ * @brief Codifica en `lcd_burst` las celdas del buffer sombra que cambiaron y las envía.
+ *
+ * Recorre las 80 celdas en el orden de la DDRAM. Solo se envía un comando de cursor
+ * cuando la siguiente celda a escribir no es la posición actual del cursor y el salto
+ * no se puede cubrir reescribiendo `LCD_GAP_BRIDGE` celdas o menos. Todo el cambio
+ * sale en una sola transacción I2C.
+ *
+ * Solo se llama con el DMA libre y con las interrupciones deshabilitadas o desde la
+ * propia interrupción del DMA.
+ */
+static void lcd_kick(void) {
+    lcd_burst_len = 0;
+    lcd_flush_start_us = time_us_32();
+
+    for (int pos = 0; pos < LCD_CELLS; pos++) {
+        int row = lcd_cell_row(pos);
+        int col = pos % LCD_COLUMNS;
+        char c = lcd_shadow[row][col];
+
+        if (c == lcd_glass[row][col]) {
+            continue;
+        }
+
+        int gap = pos - lcd_cursor;
+        if (lcd_cursor < 0 || gap < 0 || gap > LCD_GAP_BRIDGE) {
+            lcd_burst_command(0x80 | lcd_cell_address(pos));
+        } else {
+            // Reescribir las celdas intermedias sin cambios sale igual o más barato
+            for (int skip = lcd_cursor; skip < pos; skip++) {
+                lcd_burst_data(lcd_glass[lcd_cell_row(skip)][skip % LCD_COLUMNS]);
+            }
+        }
+
+        lcd_burst_data(c);
+        lcd_glass[row][col] = c;
+        lcd_cursor = (pos + 1) % LCD_CELLS;
+    }
+
+    if (lcd_burst_len > 0) {
+        lcd_burst_send();
+    }
+}
+
+/**
+ * @brief Interrupción de fin de transferencia del DMA del LCD.
+ *
+ * Registra la duración de la ráfaga y envía lo que haya cambiado mientras tanto.
+ */
+static void lcd_dma_irq_handler(void) {
+    if (!dma_channel_get_irq0_status(lcd_dma_channel)) {
+        return;
+    }
+    dma_channel_acknowledge_irq0(lcd_dma_channel);
+    TRACE(TRACE_LCD_END, 0);
+
+    lcd_last_flush_us = time_us_32() - lcd_flush_start_us;
+    lcd_kick();
+}
+
+/**
+ * @brief Envía a la pantalla las celdas del buffer sombra que cambiaron.
+ *
+ * No bloquea: si hay una ráfaga en curso, los cambios salen cuando esta termine.
+ */
+void lcd_flush(void) {
+    if (lcd_dma_channel < 0) {
+        return;
+    }
+
+    uint32_t status = save_and_disable_interrupts();
+    if (!dma_channel_is_busy(lcd_dma_channel)) {
+        lcd_kick();
+    }
+    restore_interrupts(status);
+}
+
+/**
+ * @brief Indica si queda algo por enviar o transmitiéndose hacia el LCD.
+ *
+ * @return true mientras el DMA o el I2C estén ocupados.
+ */
+bool lcd_busy(void) {
+    if (lcd_dma_channel >= 0 && dma_channel_is_busy(lcd_dma_channel)) {
+        return true;
+    }
+    i2c_hw_t *hw = i2c_get_hw(I2C_PORT);
+    return (hw->status & I2C_IC_STATUS_ACTIVITY_BITS) || !(hw->status & I2C_IC_STATUS_TFE_BITS);
+}
+
+/**
+ * @brief Espera a que la pantalla muestre todo lo que hay en el buffer sombra.
+ */
+void lcd_wait_idle(void) {
+    lcd_flush();
+    while (lcd_busy()) {
+        tight_loop_contents();
+    }
+}
+
+/**
+ * @brief Huella FNV-1a del buffer sombra.
+ *
+ * @return Huella de las 80 celdas.
+ */
+uint32_t lcd_shadow_hash(void) {
+    const uint8_t *cells = (const uint8_t *)&lcd_shadow[0][0];
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < LCD_CELLS; i++) {
+        hash = (hash ^ cells[i]) * 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * @brief Bytes enviados al LCD por I2C desde el arranque.
+ *
+ * @return Cantidad de bytes escritos en el bus hacia el PCF8574.
+ */
+uint32_t lcd_get_i2c_bytes(void) {
+    return lcd_i2c_bytes;
 }
+
+/**
+ * @brief Duración del último `lcd_flush()` que escribió en el bus.
+ *
+ * @return Microsegundos desde que empezó a codificar hasta que el DMA entregó el último byte.
+ */
+uint32_t lcd_get_last_flush_us(void) {
+    return lcd_last_flush_us;
+}
+
 /**
  * @brief Muestra un mensaje en el LCD en una ubicación específica.
  *
+ * El texto se copia al buffer sombra; se envía a la pantalla en el siguiente `lcd_flush()`.
+ * Lo que exceda el ancho de la fila se descarta; con una fila fuera de rango o una
+ * columna negativa no se escribe nada.
+ *
  * @param message Cadena de texto a mostrar.
  * @param row Fila del LCD (0 a 3).
  * @param col Columna del LCD (0 a 19).
  */
 void displayMessage(const char *message, int row, int col) {
-    // Calcular dirección de memoria para la fila
-    uint8_t row_offsets[] = {0x00, 0x40, 0x14, 0x54};
-    lcd_write_byte(0x80 | (row_offsets[row] + col), false);
+    if (row < 0 || row >= LCD_ROWS || col < 0) {
+        return;
+    }
 
-    while (*message) {
-        lcd_write_byte(*message++, true);
+    while (*message && col < LCD_COLUMNS) {
+        lcd_shadow[row][col++] = *message++;
     }
 }
 
+/**
+ * @brief Reemplaza todo el buffer sombra por una pantalla completa.
+ *
+ * @param cells Las 80 celdas, fila por fila; un '\0' se muestra como espacio.
+ */
+void displayScreen(const char *cells) {
+    char *shadow = &lcd_shadow[0][0];
+    for (int i = 0; i < LCD_CELLS; i++) {
+        shadow[i] = cells[i] ? cells[i] : ' ';
+    }
+}
+
+/**
+ * @brief Escribe un monto alineado a la derecha directamente en el buffer sombra.
+ *
+ * @param amount Monto en pesos.
+ * @param row Fila del LCD (0 a 3).
+ * @param col Primera columna del campo.
+ * @param width Ancho del campo; se recorta al borde de la fila.
+ */
+void displayAmount(money_t amount, int row, int col, int width) {
+    if (row < 0 || row >= LCD_ROWS || col < 0 || col >= LCD_COLUMNS || width <= 0) {
+        return;
+    }
+    if (width > LCD_COLUMNS - col) {
+        width = LCD_COLUMNS - col;
+    }
+    money_format_field(amount, &lcd_shadow[row][col], (size_t)width);
+}
 
 /**
  * @brief Muestra el mensaje de saldo en el LCD.
  *
- * @param current_balance Saldo actual del usuario.
+ * @param current_balance Saldo actual del usuario, en pesos.
  */
-void displayBalance(float current_balance) {
-    char buffer[20]; // Buffer para almacenar el mensaje (máx. 20 caracteres)
-    sprintf(buffer, "Saldo: %.2f", current_balance); // Formatear el mensaje con el saldo
-    displayMessage(buffer, 0, 0); // Mostrar en la primera fila y columna
+void displayBalance(money_t current_balance) {
+    displayMessage("Saldo:", 0, 0);
+    displayAmount(current_balance, 0, 6, LCD_COLUMNS - 6);  // Resto de la fila, a la derecha
 }
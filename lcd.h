@@ -6,6 +6,7 @@
 #define LCD_H
 
 #include "hardware/i2c.h"
+#include "money.h"
 
 /**
  * @brief Dirección I2C del módulo LCD.
@@ -22,6 +23,25 @@
  */
 #define LCD_ROWS 4
 
+/**
+ * @brief Si es 1, el bus I2C del LCD trabaja en modo rápido (400 kHz) en vez de 100 kHz.
+ *
+ * El PCF8574 y el HD44780 soportan 400 kHz: cada carácter toma 4 bytes (unos 90 µs), más
+ * que los 37 µs que tarda el HD44780 en ejecutar una instrucción.
+ */
+#ifndef LCD_I2C_FAST_MODE
+#define LCD_I2C_FAST_MODE 0
+#endif
+
+/**
+ * @brief Velocidad del bus I2C del LCD en Hz.
+ */
+#if LCD_I2C_FAST_MODE
+#define LCD_I2C_BAUDRATE (400 * 1000)
+#else
+#define LCD_I2C_BAUDRATE (100 * 1000)
+#endif
+
 /**
  * @brief Puerto I2C utilizado para la comunicación con el LCD.
  */
@@ -41,7 +61,84 @@ void initLCD();
  * @param message Cadena de texto que se desea mostrar.
  * @param row Fila donde se desea mostrar el mensaje (0 a 3).
  * @param col Columna inicial donde se desea mostrar el mensaje (0 a 19).
+ *
+ * El texto queda en el buffer sombra hasta el siguiente `lcd_flush()`.
  */
 void displayMessage(const char *message, int row, int col);
-void displayBalance(float current_balance);
+
+/**
+ * @brief Reemplaza todo el buffer sombra por una pantalla completa.
+ *
+ * @param cells Las 80 celdas, fila por fila; un '\0' se muestra como espacio.
+ *
+ * Como `displayMessage()`, solo cambia el buffer sombra.
+ */
+void displayScreen(const char *cells);
+
+/**
+ * @brief Escribe un monto ("$1.250.000") alineado a la derecha directamente en el
+ * buffer sombra, sin pasar por `printf`.
+ *
+ * El campo se recorta al borde de la fila, así que nunca escribe fuera de ella.
+ *
+ * @param amount Monto en pesos.
+ * @param row Fila del LCD (0 a 3).
+ * @param col Primera columna del campo.
+ * @param width Ancho del campo.
+ */
+void displayAmount(money_t amount, int row, int col, int width);
+
+/**
+ * @brief Muestra el saldo en la primera fila ("Saldo:      $220.000").
+ *
+ * @param current_balance Saldo actual del usuario, en pesos.
+ */
+void displayBalance(money_t current_balance);
+
+/**
+ * @brief Envía a la pantalla solo las celdas que cambiaron desde el último envío.
+ *
+ * Los cambios se codifican en una sola ráfaga y salen en una única transacción I2C
+ * por DMA, sin bloquear. Si ya hay una ráfaga en curso, los cambios salen apenas termine.
+ *
+ * `displayMessage()` y `displayBalance()` solo actualizan el buffer sombra; esta
+ * función es la que escribe en el bus I2C.
+ */
+void lcd_flush(void);
+
+/**
+ * @brief Indica si queda algo transmitiéndose hacia el LCD.
+ *
+ * @return true mientras el DMA o el bus I2C estén ocupados.
+ */
+bool lcd_busy(void);
+
+/**
+ * @brief Envía los cambios pendientes y espera a que la pantalla los muestre.
+ */
+void lcd_wait_idle(void);
+
+/**
+ * @brief Huella (FNV-1a de 32 bits) del contenido del buffer sombra.
+ *
+ * Sirve para comparar lo que mostraría la pantalla en dos corridas sin guardar las 80
+ * celdas, por ejemplo al capturar y reproducir sesiones.
+ *
+ * @return Huella de las 80 celdas.
+ */
+uint32_t lcd_shadow_hash(void);
+
+/**
+ * @brief Bytes enviados al LCD por I2C desde el arranque.
+ *
+ * @return Cantidad de bytes escritos en el bus.
+ */
+uint32_t lcd_get_i2c_bytes(void);
+
+/**
+ * @brief Duración del último `lcd_flush()` que escribió en el bus.
+ *
+ * @return Microsegundos que tomó codificar y enviar la ráfaga.
+ */
+uint32_t lcd_get_last_flush_us(void);
 #endif // LCD_H
\ No newline at end of file
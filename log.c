@@ -0,0 +1,174 @@
+/**
+ * @file log.c
+ * @brief Implementación de los mensajes de registro tokenizados.
+ *
+ * Los productores arman el registro en la pila y lo copian a la cola con el spinlock
+ * tomado, así los registros de dos núcleos o de una interrupción no se mezclan. Hay un
+ * solo consumidor, que solo mueve `log_tail`; como en `keyring.c`, los índices crecen
+ * sin límite y se enmascaran al acceder al arreglo.
+ *
+ * La consola se escribe con `putchar_raw()`: el registro es binario y la traducción de
+ * `\n` a `\r\n` de la consola lo rompería.
+ */
+
+#include "log.h"
+#include "iocore.h"
+#include <stdarg.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+
+#define LOG_RING_MASK (LOG_RING_SIZE - 1)
+
+_Static_assert((LOG_RING_SIZE & LOG_RING_MASK) == 0, "LOG_RING_SIZE debe ser potencia de 2");
+_Static_assert(LOG_COUNT <= 256, "El número de mensaje ocupa un byte");
+
+#define LOG_SIGNATURE_ENTRY(id, types, format) [id] = types,
+
+/**
+ * @brief Tipos de los argumentos de cada mensaje, indexados por `LogId`.
+ */
+static const char *const log_signatures[LOG_COUNT] = {
+    LOG_CATALOG(LOG_SIGNATURE_ENTRY)
+};
+
+/**
+ * @brief Cola de registros.
+ */
+static uint8_t log_ring[LOG_RING_SIZE];
+
+/**
+ * @brief Siguiente byte a escribir. Lo modifican los productores con el spinlock.
+ */
+static volatile uint32_t log_head = 0;
+
+/**
+ * @brief Siguiente byte a enviar. Solo lo modifica el consumidor.
+ */
+static volatile uint32_t log_tail = 0;
+
+/**
+ * @brief Registros descartados por cola llena.
+ */
+static volatile uint32_t log_lost = 0;
+
+/**
+ * @brief Spinlock de los productores; NULL hasta `log_init()`.
+ */
+static spin_lock_t *log_lock = NULL;
+
+/**
+ * @brief Reserva el spinlock de la cola. Se llama antes de registrar cualquier mensaje.
+ */
+void log_init(void) {
+    log_lock = spin_lock_init(spin_lock_claim_unused(true));
+}
+
+/**
+ * @brief Agrega un entero sin signo en LEB128: 7 bits por byte, el bit alto indica
+ * que sigue otro.
+ *
+ * @return Largo del registro después de agregarlo.
+ */
+static unsigned int put_varint(uint8_t *record, unsigned int length, uint32_t value) {
+    while (value >= 0x80) {
+        record[length++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    record[length++] = (uint8_t)value;
+    return length;
+}
+
+/**
+ * @brief Agrega un texto con su largo delante, cortado en `LOG_STRING_MAX`.
+ *
+ * @return Largo del registro después de agregarlo.
+ */
+static unsigned int put_string(uint8_t *record, unsigned int length, const char *text) {
+    size_t size = text ? strnlen(text, LOG_STRING_MAX) : 0;
+    record[length++] = (uint8_t)size;
+    if (size > 0) {
+        memcpy(&record[length], text, size);
+    }
+    return length + (unsigned int)size;
+}
+
+/**
+ * @brief Registra un mensaje del catálogo.
+ *
+ * @param id Mensaje (`LogId`).
+ * @param ... Argumentos, de los tipos que indica el catálogo.
+ */
+void log_message(unsigned int id, ...) {
+    if (id >= LOG_COUNT || log_lock == NULL) {
+        return;
+    }
+
+    // Un argumento ocupa a lo sumo `LOG_STRING_MAX + 1` bytes; `matecash_logdecode -c`
+    // revisa que cada mensaje del catálogo entre completo
+    uint8_t record[LOG_RECORD_MAX];
+    unsigned int length = 3;
+    va_list args;
+    va_start(args, id);
+    for (const char *type = log_signatures[id]; *type && length <= LOG_RECORD_MAX - (LOG_STRING_MAX + 1); type++) {
+        if (*type == 'i') {
+            int32_t value = va_arg(args, int);
+            length = put_varint(record, length, ((uint32_t)value << 1) ^ (uint32_t)(value >> 31));
+        } else if (*type == 'u') {
+            length = put_varint(record, length, va_arg(args, uint32_t));
+        } else if (*type == 'c') {
+            record[length++] = (uint8_t)va_arg(args, int);
+        } else {
+            length = put_string(record, length, va_arg(args, const char *));
+        }
+    }
+    va_end(args);
+    record[0] = LOG_FRAME_START;
+    record[1] = (uint8_t)id;
+    record[2] = (uint8_t)(length - 3);
+
+    uint32_t status = spin_lock_blocking(log_lock);
+    uint32_t head = log_head;
+    if (LOG_RING_SIZE - (head - log_tail) < length) {
+        log_lost++;
+    } else {
+        for (unsigned int i = 0; i < length; i++) {
+            log_ring[(head + i) & LOG_RING_MASK] = record[i];
+        }
+        log_head = head + length;
+    }
+    spin_unlock(log_lock, status);
+#if MATECASH_MULTICORE
+    __sev();    // Despierta al núcleo 1, que vacía la cola
+#endif
+}
+
+/**
+ * @brief Envía por la consola USB los registros de la cola.
+ */
+void log_drain(void) {
+    uint32_t tail = log_tail;
+    uint32_t head = log_head;
+
+    __dmb();                        // Leer los bytes después de ver el índice publicado
+    while (tail != head) {
+        putchar_raw(log_ring[tail & LOG_RING_MASK]);
+        tail++;
+    }
+    __dmb();                        // Terminar de leer antes de liberar los bytes
+    log_tail = tail;
+}
+
+/**
+ * @brief Indica si quedan registros en la cola.
+ */
+bool log_pending(void) {
+    return log_tail != log_head;
+}
+
+/**
+ * @brief Registros descartados por encontrar la cola llena.
+ */
+uint32_t log_dropped(void) {
+    return log_lost;
+}
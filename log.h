@@ -0,0 +1,148 @@
+/**
+ * @file log.h
+ * @brief Mensajes de registro tokenizados por la consola USB.
+ *
+ * Cada mensaje del firmware es una entrada de `LOG_CATALOG`. Registrar un mensaje no
+ * formatea nada: se arma un registro binario con el número del mensaje y sus argumentos
+ * en crudo y se copia a una cola circular en RAM. La cola se vacía por la consola USB
+ * cuando el lazo principal no tiene nada que hacer (en modo multinúcleo, desde el
+ * núcleo 1), y en la PC `matecash_logdecode` vuelve a armar el texto con los formatos
+ * del catálogo. El firmware solo guarda los tipos de los argumentos, no los formatos.
+ *
+ * Cada registro es `LOG_FRAME_START`, el número del mensaje, el largo de los argumentos
+ * y los argumentos. Los enteros van en LEB128 (los con signo, en zigzag), los caracteres
+ * en un byte y los textos con un byte de largo delante, cortados en `LOG_STRING_MAX`.
+ * Si la cola se llena, el registro se descarta entero y se cuenta.
+ */
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief Lista de mensajes: ID, tipos de los argumentos y formato.
+ *
+ * Los tipos son una letra por argumento: `i` entero con signo (`int`), `u` entero sin
+ * signo de 32 bits, `c` un carácter y `s` un texto terminado en cero. El formato es el
+ * de `printf` con esos argumentos (`%d`, `%u`, `%x`, `%c`, `%s`), más `%@`, que toma un
+ * `u` con un `ScreenId` y escribe el texto de consola de esa pantalla. Los formatos
+ * solo los usa el decodificador de la PC.
+ */
+#define LOG_CATALOG(X) \
+    X(LOG_SCREEN,               "u",     "%@") \
+    X(LOG_KEY_ECHO,             "c",     "%c") \
+    X(LOG_SECRET_KEY,           "",      "*") \
+    X(LOG_USER_BLOCKED,         "",      "\n¡Usuario bloqueado! Contacte al administrador.\n") \
+    X(LOG_USER_UNKNOWN,         "",      "\nID de usuario no existe.\n") \
+    X(LOG_ENTER_PASSWORD,       "",      "\nIngrese contraseña de 4 dígitos:\n") \
+    X(LOG_LOGGED_IN,            "s",     "\n\n¡Bienvenido, %s!\n") \
+    X(LOG_TOO_MANY_ATTEMPTS,    "",      "\n\n¡Usuario bloqueado! Demasiados intentos fallidos.\n") \
+    X(LOG_WRONG_PASSWORD,       "i",     "\n\nContraseña incorrecta. Intentos restantes: %d\n") \
+    X(LOG_CHECKING_BALANCE,     "",      "\nConsultando saldo...\n") \
+    X(LOG_ENTER_NEW_PASSWORD,   "",      "\nIngrese nueva contraseña de 4 dígitos:\n") \
+    X(LOG_LOGGING_OUT,          "",      "\nCerrando sesión...\n") \
+    X(LOG_INVALID_OPTION,       "",      "\nOpción no válida\n") \
+    X(LOG_GOODBYE,              "",      "\nGracias por utilzar nuestros serivicos\n") \
+    X(LOG_ENTER_AMOUNT,         "",      "\nIngrese el monto (múltiplo de 10.000) y presione '#':\n") \
+    X(LOG_ACCOUNT_BLOCKED,      "",      "\nError: Su cuenta está bloqueada.\n") \
+    X(LOG_AMOUNT_INVALID,       "i",     "\nError: El monto debe ser múltiplo de %d.\n") \
+    X(LOG_FUNDS_INSUFFICIENT,   "s",     "\nError: Fondos insuficientes. Su saldo actual es %s\n") \
+    X(LOG_NOTES_UNAVAILABLE,    "s",     "\nError: No hay billetes disponibles para %s. Intente con otro monto.\n") \
+    X(LOG_CONFIRM_PASSWORD,     "",      "\nConfirme la nueva contraseña:\n") \
+    X(LOG_PASSWORD_CHANGED,     "",      "\n¡Contraseña cambiada exitosamente!\n") \
+    X(LOG_PASSWORD_MISMATCH,    "",      "\nLas contraseñas no coinciden. Intente de nuevo.\n") \
+    X(LOG_TIMEOUT,              "",      "\n¡Tiempo excedido! Por favor, intente de nuevo.\n") \
+    X(LOG_BALANCE,              "s",     "\nSu saldo actual es: %s\n") \
+    X(LOG_WITHDRAW_NOT_LOGGED,  "",      "\nNo se pudo registrar el retiro\n") \
+    X(LOG_WITHDRAW_DONE,        "su",    "\nÉxito: Retiró %s en %u billetes\n") \
+    X(LOG_NOTES_DELIVERED,      "",      "\nBilletes entregados.\n") \
+    X(LOG_EXTRA_NOTE,           "u",     "\nCanal %u: salió un billete de más\n") \
+    X(LOG_CHANNEL_JAMMED,       "uu",    "\nCanal %u trabado: se devolvieron %u billetes al saldo\n") \
+    X(LOG_BAD_RAMP,             "u",     "Canal %u: perfil de motor no válido\n") \
+    X(LOG_TRANSITION_ORDER,     "u",     "Transición %u: estado fuera de orden\n") \
+    X(LOG_TRANSITION_INVALID,   "u",     "Transición %u: destino, pantalla o teclas no válidos\n") \
+    X(LOG_TRANSITION_UNUSED,    "u",     "Transición %u: nunca se usa\n") \
+    X(LOG_STATE_UNCOVERED,      "u",     "Estado %u: hay teclas sin transición\n") \
+    X(LOG_TRANSITIONS_BROKEN,   "",      "Tabla de transiciones con errores\n") \
+    X(LOG_ACCTLOG_REPLAYED,     "uu",    "Registro de cuentas: %u registros en %u us\n") \
+    X(LOG_ACCTLOG_FORMATTED,    "uu",    "Registro de cuentas: %u registros en %u us (nuevo)\n") \
+    X(LOG_ACCTLOG_RECOVERED,    "uu",    "Retiros cortados: %u, billetes en duda: %u\n") \
+    X(LOG_KEY_CAPTURE,          "uciiu", "@k %u %c %d %d %08x\n") \
+    X(LOG_CAPTURE_ON,           "",      "Captura de sesiones activada\n") \
+    X(LOG_CAPTURE_OFF,          "",      "Captura de sesiones desactivada\n") \
+    X(LOG_KEY_LATENCY,          "uuuu",  "\nLatencia tecla->proceso: %u teclas, última %u us, promedio %u us, máxima %u us\n") \
+    X(LOG_LCD_STATS,            "uu",    "Última ráfaga LCD: %u us, mensajes descartados: %u\n") \
+    X(LOG_ACCTLOG_DROPPED,      "uu",    "Registros de cuentas perdidos: %u, fallos de la flash: %u\n") \
+    X(LOG_POWER_STATS,          "uu",    "Reposo: %u veces, %u s en total\n") \
+    X(LOG_TRACE_SUMMARY,        "uu",    "Trazas: %u eventos, %u perdidos\n") \
+    X(LOG_TRACE_STAGE,          "suuuu", "%s: %u muestras, min %u us, prom %u us, max %u us\n") \
+    X(LOG_TRACE_BUCKET,         "uu",    "  < %u us: %u\n") \
+    X(LOG_TRACE_BUCKET_LAST,    "uu",    "  >= %u us: %u\n") \
+    X(LOG_SESSION_TIMEOUT,      "",      "\nSesión cerrada por inactividad.\n") \
+    X(LOG_AMOUNT_TOO_LARGE,     "s",     "\nError: El monto máximo por retiro es %s.\n")
+
+#define LOG_ENUM_ENTRY(id, ...) id,
+
+/**
+ * @brief Mensajes de registro.
+ */
+typedef enum {
+    LOG_CATALOG(LOG_ENUM_ENTRY)
+    LOG_COUNT               /**< Cantidad de mensajes */
+} LogId;
+
+/**
+ * @brief Primer byte de cada registro, para que el decodificador se resincronice.
+ */
+#define LOG_FRAME_START 0xA5
+
+/**
+ * @brief Largo máximo de un registro, cabecera incluida.
+ */
+#define LOG_RECORD_MAX 64
+
+/**
+ * @brief Largo máximo de un texto dentro de un registro.
+ */
+#define LOG_STRING_MAX 32
+
+/**
+ * @brief Tamaño de la cola de registros en RAM, en bytes. Potencia de 2.
+ */
+#define LOG_RING_SIZE 2048
+
+/**
+ * @brief Reserva el spinlock de la cola. Se llama antes que cualquier otro módulo;
+ * hasta entonces los mensajes se descartan sin contarlos.
+ */
+void log_init(void);
+
+/**
+ * @brief Registra un mensaje del catálogo.
+ *
+ * Se puede llamar desde interrupciones y desde cualquier núcleo.
+ *
+ * @param id Mensaje (`LogId`).
+ * @param ... Argumentos, de los tipos que indica el catálogo.
+ */
+void log_message(unsigned int id, ...);
+
+/**
+ * @brief Envía por la consola USB los registros de la cola. Lo llama un solo consumidor.
+ */
+void log_drain(void);
+
+/**
+ * @brief Indica si quedan registros en la cola.
+ */
+bool log_pending(void);
+
+/**
+ * @brief Registros descartados por encontrar la cola llena.
+ *
+ * @return Cantidad de registros perdidos desde el arranque.
+ */
+uint32_t log_dropped(void);
+
+#endif // LOG_H
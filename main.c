@@ -16,6 +16,78 @@
 
 #include "tcl.h"
 #include "lcd.h"
+#include "keyring.h"
+#include "events.h"
+#include "keypad.h"
+#include "iocore.h"
+#include "log.h"
+#include "acctlog.h"
+#include "screens.h"
+#include "trace.h"
+#include "power.h"
+#include "timewheel.h"
+
+/**
+ * @brief Si está activo, cada tecla procesada se imprime por la consola como una línea
+ * de captura que `matecash_replay` puede reproducir.
+ */
+static bool capture_keys = false;
+
+/**
+ * @brief Procesa un evento sacado de la cola del teclado.
+ *
+ * La línea de captura es "@k <tiempo_us> <tecla> <estado> <pantalla> <huella LCD>",
+ * con el estado y la pantalla que quedaron después de procesar la tecla.
+ *
+ * @param event Evento con la tecla presionada.
+ */
+static void handle_key_event(const KeyEvent *event) {
+    power_activity();
+    events_record_latency(time_us_32() - event->timestamp_us);
+    TRACE(TRACE_KEY_DISPATCH, event->key);
+    process_key(event->key);
+    TRACE(TRACE_KEY_DONE, event->key);
+
+    if (capture_keys) {
+        log_message(LOG_KEY_CAPTURE, (uint32_t)event->timestamp_us, event->key, (int)current_state,
+                    (int)screen_current(), (uint32_t)lcd_shadow_hash());
+    }
+}
+
+/**
+ * @brief Callback de la consola USB cuando llegan caracteres.
+ *
+ * @param param No se usa.
+ */
+static void stdio_chars_available(void *param) {
+    events_post(EVENT_STDIO);
+}
+
+/**
+ * @brief Atiende los comandos recibidos por la consola USB.
+ *
+ * 'l' imprime el resumen de latencias de teclas y del LCD, para comparar el modo de
+ * un núcleo con el multinúcleo. 't' imprime los histogramas de las trazas, si se
+ * compiló con `MATECASH_TRACE`. 'r' activa o desactiva la captura de sesiones.
+ */
+static void handle_console(void) {
+    int c;
+    power_activity();
+    while ((c = getchar_timeout_us(0)) != PICO_ERROR_TIMEOUT) {
+        if (c == 'l') {
+            events_print_latency();
+            log_message(LOG_LCD_STATS, (uint32_t)lcd_get_last_flush_us(), log_dropped());
+            log_message(LOG_ACCTLOG_DROPPED, (uint32_t)acctlog_dropped(), acctlog_flash_errors());
+            log_message(LOG_POWER_STATS, (uint32_t)power_get_stats()->entries,
+                        (uint32_t)(power_get_stats()->idle_us / 1000000));
+        } else if (c == 't') {
+            trace_print();
+        } else if (c == 'r') {
+            capture_keys = !capture_keys;
+            log_message(capture_keys ? LOG_CAPTURE_ON : LOG_CAPTURE_OFF);
+        }
+    }
+}
 
 /**
  * @brief Punto de entrada principal del programa.
@@ -26,33 +98,76 @@
  * @return int Valor de salida del programa.
  */
 int main() {
-    printf("Cajero Matecash\n");
-    printf("Ingrese ID de 6 dígitos:\n");
     stdio_init_all();           /**< Inicializa el subsistema */
-    initLCD();
-    displayMessage("    Bienvenido      ",0,0);
-    displayMessage("     MateCash       ",1,0);
-    displayMessage("  Ingrese # cuenta: ",2,0);
-    displayMessage("                    ",3,0);
+    log_init();                 /**< Cola de mensajes de registro para la consola */
+    events_init();              /**< Inicializa el despachador de eventos */
+    timewheel_init();           /**< Una alarma de hardware para todas las esperas */
+    trace_init();               /**< Reserva el buffer de trazas (solo con MATECASH_TRACE) */
+    stdio_set_chars_available_callback(stdio_chars_available, NULL);
+    iocore_init();              /**< Inicializa el LCD y el dispensador (en el núcleo 1 si es multinúcleo) */
+    acctlog_init(users, NUM_USERS, denominations, NUM_DENOMINATIONS);   /**< Recupera cuentas, billetes y retiros cortados */
+    build_user_index();         /**< Ordena los IDs de usuario para buscarlos rápido */
+    if (init_transitions() != 0) {   /**< Indexa y revisa la tabla de transiciones de la sesión */
+        log_message(LOG_TRANSITIONS_BROKEN);
+    }
+    log_message(acctlog_get_stats()->formatted ? LOG_ACCTLOG_FORMATTED : LOG_ACCTLOG_REPLAYED,
+                (uint32_t)acctlog_get_stats()->records, (uint32_t)acctlog_get_stats()->replay_us);
+    if (acctlog_get_stats()->recovered > 0) {
+        log_message(LOG_ACCTLOG_RECOVERED, (uint32_t)acctlog_get_stats()->recovered,
+                    (uint32_t)acctlog_get_stats()->notes_in_doubt);
+    }
+    screen_show(SCREEN_BOOT);   /**< Pantalla y mensaje de bienvenida */
+    iocore_lcd_flush();         /**< Envía la pantalla inicial */
     init_keypad();                   /**< Inicializa el teclado matricial y configura los pines GPIO correspondientes */
-    last_key_time = get_absolute_time();  /**< Registra el tiempo de la última tecla presionada */
-    input_start_time = get_absolute_time();   /**< Registra el tiempo de inicio del input */
+    power_init();               /**< Empieza a contar la inactividad */
+    bool storage_pending = false;
     
 
     
     while (true) {
-    
-    if (key_pressed) {
-            process_key(last_key);   /**< Procesa la última tecla presionada */
-            key_pressed = false;     /**< Reinicia la bandera de tecla presionada */
-        }
-        
-    if (current_state == STATE_ENTER_PASSWORD &&
-        absolute_time_diff_us(input_start_time, get_absolute_time()) > (MAX_INPUT_TIME_MS * 1000)) {
-        handle_timeout(); /**< Maneja el tiempo límite */
-    }
+        uint32_t events = events_wait();     /**< Duerme hasta que llegue un evento */
+
+        if (events & EVENT_WAKE) {
+            power_exit_idle();               /**< Devuelve el reloj a los periféricos */
+        }
+
+        if (events & EVENT_KEY) {
+            keyring_drain(handle_key_event);  /**< Procesa todas las teclas pendientes, en orden */
+        }
+
+        if ((events & EVENT_TIMEOUT) && input_timed_out()) {
+            handle_timeout(); /**< Maneja el tiempo límite */
+            power_activity(); /**< La sesión volvió a la bienvenida sin una tecla */
+        }
+
+        if (events & EVENT_MOTOR_DONE) {
+            handle_dispense_done();
+            power_activity();                /**< El dispensador cuenta como actividad */
+        }
+
+        if (events & EVENT_STDIO) {
+            handle_console();
+        }
+
+        iocore_lcd_flush();                  /**< Envía solo las celdas que cambiaron */
+
+        storage_pending = acctlog_service(); /**< Graba en la flash lo pendiente del registro de cuentas */
+        if (storage_pending) {
+            events_post(EVENT_STORAGE);
+        }
+
+        iocore_log_flush();                  /**< Envía por la consola los mensajes de registro en cola */
+
+        if ((events & EVENT_IDLE) && current_state == STATE_ENTER_ID) {
+            // Con una sesión abierta se espera a la próxima tecla; con trabajo pendiente, a que termine
+            if (storage_pending || iocore_busy()) {
+                power_activity();
+            } else {
+                power_enter_idle();
+            }
+        }
 
-        sleep_ms(500);          /**< retraso de 500 ms  */
+        trace_service();                     /**< Acumula los histogramas de las trazas */
     }
     return 0;
 }
@@ -0,0 +1,165 @@
+/**
+ * @file money.c
+ * @brief Aritmética verificada y formato de montos de dinero.
+ */
+
+#include "money.h"
+#include <string.h>
+
+/**
+ * @brief Suma dos montos.
+ *
+ * @param a Primer sumando.
+ * @param b Segundo sumando.
+ * @param result Donde se escribe la suma.
+ * @return false si hay desbordamiento.
+ */
+bool money_add(money_t a, money_t b, money_t *result) {
+    money_t sum;
+    if (__builtin_add_overflow(a, b, &sum)) {
+        return false;
+    }
+    *result = sum;
+    return true;
+}
+
+/**
+ * @brief Resta dos montos.
+ *
+ * @param a Minuendo.
+ * @param b Sustraendo.
+ * @param result Donde se escribe la diferencia.
+ * @return false si hay desbordamiento.
+ */
+bool money_sub(money_t a, money_t b, money_t *result) {
+    money_t difference;
+    if (__builtin_sub_overflow(a, b, &difference)) {
+        return false;
+    }
+    *result = difference;
+    return true;
+}
+
+/**
+ * @brief Multiplica un monto por una cantidad.
+ *
+ * @param a Monto.
+ * @param factor Cantidad.
+ * @param result Donde se escribe el producto.
+ * @return false si hay desbordamiento.
+ */
+bool money_mul(money_t a, int32_t factor, money_t *result) {
+    money_t product;
+    if (__builtin_mul_overflow(a, (money_t)factor, &product)) {
+        return false;
+    }
+    *result = product;
+    return true;
+}
+
+/**
+ * @brief Saca el último dígito decimal de un valor.
+ *
+ * Mientras el valor no cabe en 32 bits divide en 64 bits (rutina de software en el
+ * Cortex-M0+); el resto, que es el caso de cualquier saldo real, usa divisiones de 32 bits.
+ *
+ * @param magnitude Valor; queda dividido por 10.
+ * @return Dígito de las unidades.
+ */
+static unsigned int next_digit(uint64_t *magnitude) {
+    unsigned int digit;
+    if (*magnitude > UINT32_MAX) {
+        digit = (unsigned int)(*magnitude % 10);
+        *magnitude /= 10;
+    } else {
+        uint32_t small = (uint32_t)*magnitude;
+        digit = small % 10;
+        *magnitude = small / 10;
+    }
+    return digit;
+}
+
+/**
+ * @brief Escribe un monto con puntos como separador de miles.
+ *
+ * Los dígitos se sacan de derecha a izquierda.
+ *
+ * @param value Monto a escribir.
+ * @param buffer Donde se escribe el texto.
+ * @param size Tamaño del buffer.
+ * @return Caracteres escritos sin el terminador, o 0 si no cabe.
+ */
+size_t money_format(money_t value, char *buffer, size_t size) {
+    char reversed[MONEY_TEXT_MAX];
+    size_t length = 0;
+    unsigned int digits = 0;
+    uint64_t magnitude = value < 0 ? 0 - (uint64_t)value : (uint64_t)value;
+
+    do {
+        unsigned int digit = next_digit(&magnitude);
+        if (digits > 0 && digits % 3 == 0) {
+            reversed[length++] = '.';
+        }
+        reversed[length++] = (char)('0' + digit);
+        digits++;
+    } while (magnitude > 0);
+
+    if (value < 0) {
+        reversed[length++] = '-';
+    }
+    if (length + 1 > size) {
+        if (size > 0) {
+            buffer[0] = '\0';
+        }
+        return 0;
+    }
+
+    for (size_t i = 0; i < length; i++) {
+        buffer[i] = reversed[length - 1 - i];
+    }
+    buffer[length] = '\0';
+    return length;
+}
+
+/**
+ * @brief Escribe un monto con signo de pesos, alineado a la derecha en un campo fijo.
+ *
+ * Escribe de derecha a izquierda directamente sobre el campo, así nunca toca nada
+ * fuera de `field[0]` a `field[width - 1]`.
+ *
+ * @param value Monto a escribir.
+ * @param field Primer carácter del campo.
+ * @param width Ancho del campo.
+ * @return false si el monto no cabía y el campo quedó lleno de '#'.
+ */
+bool money_format_field(money_t value, char *field, size_t width) {
+    uint64_t magnitude = value < 0 ? 0 - (uint64_t)value : (uint64_t)value;
+    size_t pos = width;
+    unsigned int digits = 0;
+
+    do {
+        if (digits > 0 && digits % 3 == 0) {
+            if (pos == 0) {
+                break;
+            }
+            field[--pos] = '.';
+        }
+        if (pos == 0) {
+            break;
+        }
+        field[--pos] = (char)('0' + next_digit(&magnitude));
+        digits++;
+    } while (magnitude > 0);
+
+    unsigned int prefix = value < 0 ? 2 : 1;   // "-$" o "$"
+    if (magnitude > 0 || pos < prefix) {
+        memset(field, '#', width);
+        return false;
+    }
+    field[--pos] = '$';
+    if (value < 0) {
+        field[--pos] = '-';
+    }
+    memset(field, ' ', pos);
+    return true;
+}
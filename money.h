@@ -0,0 +1,85 @@
+/**
+ * @file money.h
+ * @brief Tipo entero para montos de dinero, en pesos, con aritmética verificada.
+ *
+ * El RP2040 no tiene unidad de punto flotante, así que los saldos se manejan como
+ * enteros de 64 bits: las comparaciones y restas son exactas y no pasan por las
+ * rutinas de `double` en software.
+ */
+#ifndef MONEY_H
+#define MONEY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Monto de dinero en pesos enteros.
+ */
+typedef int64_t money_t;
+
+/**
+ * @brief Tamaño de buffer suficiente para cualquier monto formateado, con signo,
+ * separadores de miles y terminador ("-9.223.372.036.854.775.808").
+ */
+#define MONEY_TEXT_MAX 28
+
+/**
+ * @brief Suma dos montos.
+ *
+ * @param a Primer sumando.
+ * @param b Segundo sumando.
+ * @param result Donde se escribe la suma; no se modifica si hay desbordamiento.
+ * @return false si el resultado no cabe en `money_t`.
+ */
+bool money_add(money_t a, money_t b, money_t *result);
+
+/**
+ * @brief Resta dos montos.
+ *
+ * @param a Minuendo.
+ * @param b Sustraendo.
+ * @param result Donde se escribe la diferencia; no se modifica si hay desbordamiento.
+ * @return false si el resultado no cabe en `money_t`.
+ */
+bool money_sub(money_t a, money_t b, money_t *result);
+
+/**
+ * @brief Multiplica un monto por una cantidad (por ejemplo, billetes por denominación).
+ *
+ * @param a Monto.
+ * @param factor Cantidad.
+ * @param result Donde se escribe el producto; no se modifica si hay desbordamiento.
+ * @return false si el resultado no cabe en `money_t`.
+ */
+bool money_mul(money_t a, int32_t factor, money_t *result);
+
+/**
+ * @brief Escribe un monto con puntos como separador de miles (por ejemplo "220.000").
+ *
+ * No usa `printf`, que en la biblioteca del SDK no siempre soporta enteros de 64 bits.
+ *
+ * @param value Monto a escribir.
+ * @param buffer Donde se escribe el texto, terminado en '\0'.
+ * @param size Tamaño del buffer; `MONEY_TEXT_MAX` alcanza para cualquier monto.
+ * @return Cantidad de caracteres escritos sin contar el terminador, o 0 si no cabe.
+ */
+size_t money_format(money_t value, char *buffer, size_t size);
+
+/**
+ * @brief Escribe un monto con signo de pesos y separadores de miles ("$1.250.000"),
+ * alineado a la derecha dentro de un campo de ancho fijo.
+ *
+ * Escribe exactamente `width` caracteres, sin terminador, directo sobre el buffer de
+ * destino (por ejemplo, una fila del LCD); a la izquierda completa con espacios. Si el
+ * monto no cabe, llena el campo con '#'. No usa memoria dinámica ni `printf` y hace a
+ * lo sumo 19 pasos, sin importar el monto.
+ *
+ * @param value Monto a escribir.
+ * @param field Primer carácter del campo.
+ * @param width Ancho del campo.
+ * @return false si el monto no cabía.
+ */
+bool money_format_field(money_t value, char *field, size_t width);
+
+#endif // MONEY_H
@@ -0,0 +1,171 @@
+/**
+ * @file planner.c
+ * @brief Implementación del planificador de retiros.
+ *
+ * `best[v]` es la menor cantidad de billetes que suma `v` unidades usando las
+ * denominaciones procesadas hasta el momento. Cada denominación se agrega como una
+ * capa: para cada `v` se prueba usar de 0 a `quantity` billetes de ella, y la cantidad
+ * elegida se guarda en `take[d][v]` para reconstruir el plan desde el final.
+ */
+
+#include "planner.h"
+
+/**
+ * @brief Valor que indica que un monto no se puede formar.
+ */
+#define PLAN_IMPOSSIBLE 0xFFFF
+
+/**
+ * @brief Lo que el planificador usa del inventario: de cada denominación, el tamaño
+ * del billete y los billetes disponibles, en unidades de `WITHDRAW_UNIT` y acotados a
+ * `PLAN_MAX_UNITS + 1` (más no cambia el resultado).
+ */
+typedef struct {
+    uint8_t count;                          /**< Cantidad de denominaciones */
+    uint8_t size[DISPENSER_CHANNELS];       /**< Valor de cada billete */
+    uint8_t available[DISPENSER_CHANNELS];  /**< Billetes disponibles */
+} PlanInventory;
+
+/**
+ * @brief Entrada de la caché de planes.
+ */
+typedef struct {
+    bool valid;                 /**< Si la entrada tiene un plan calculado */
+    bool feasible;              /**< Si el monto se podía formar */
+    uint8_t units;              /**< Monto en unidades de `WITHDRAW_UNIT` */
+    PlanInventory inventory;    /**< Inventario con el que se calculó */
+    WithdrawalPlan plan;        /**< Plan calculado */
+} PlanCacheEntry;
+
+/**
+ * @brief Planes calculados recientemente, cada uno con su inventario.
+ */
+static PlanCacheEntry plan_cache[PLAN_CACHE_SIZE];
+
+/**
+ * @brief Siguiente entrada de la caché que se reemplaza.
+ */
+static unsigned int plan_cache_next = 0;
+
+/**
+ * @brief Descarta los planes en caché.
+ */
+void planner_invalidate(void) {
+    for (unsigned int i = 0; i < PLAN_CACHE_SIZE; i++) {
+        plan_cache[i].valid = false;
+    }
+}
+
+/**
+ * @brief Reduce las denominaciones a lo que usa `solve_plan()`.
+ *
+ * @param denoms Denominaciones disponibles.
+ * @param count Cantidad de denominaciones.
+ * @param inventory Donde se escribe el resumen.
+ */
+static void plan_inventory(const Denomination *denoms, unsigned int count, PlanInventory *inventory) {
+    memset(inventory, 0, sizeof(*inventory));
+    inventory->count = (uint8_t)count;
+    for (unsigned int d = 0; d < count; d++) {
+        money_t size = denoms[d].amount / WITHDRAW_UNIT;
+        int available = denoms[d].quantity;
+        inventory->size[d] = (uint8_t)(size < 0 ? 0 : size > PLAN_MAX_UNITS ? PLAN_MAX_UNITS + 1 : size);
+        inventory->available[d] =
+            (uint8_t)(available < 0 ? 0 : available > PLAN_MAX_UNITS ? PLAN_MAX_UNITS + 1 : available);
+    }
+}
+
+/**
+ * @brief Resuelve el plan con menos billetes por programación dinámica acotada.
+ *
+ * @param denoms Denominaciones disponibles.
+ * @param count Cantidad de denominaciones.
+ * @param units Monto en unidades de `WITHDRAW_UNIT`.
+ * @param plan Donde se escribe el plan.
+ * @return false si el monto no se puede formar.
+ */
+static bool solve_plan(const Denomination *denoms, unsigned int count, unsigned int units, WithdrawalPlan *plan) {
+    uint16_t best[PLAN_MAX_UNITS + 1];
+    uint8_t take[DISPENSER_CHANNELS][PLAN_MAX_UNITS + 1];
+
+    memset(plan, 0, sizeof(*plan));
+    best[0] = 0;
+    for (unsigned int v = 1; v <= units; v++) {
+        best[v] = PLAN_IMPOSSIBLE;
+    }
+
+    for (unsigned int d = 0; d < count; d++) {
+        unsigned int size = (unsigned int)(denoms[d].amount / WITHDRAW_UNIT);
+        unsigned int available = denoms[d].quantity > 0 ? (unsigned int)denoms[d].quantity : 0;
+
+        // Recorrer de mayor a menor para que best[v - k*size] sea aún de la capa anterior
+        for (unsigned int v = units; v > 0; v--) {
+            take[d][v] = 0;
+            if (size == 0) {
+                continue;
+            }
+            for (unsigned int k = 1; k <= available && k * size <= v; k++) {
+                uint16_t previous = best[v - k * size];
+                if (previous != PLAN_IMPOSSIBLE && previous + k < best[v]) {
+                    best[v] = previous + k;
+                    take[d][v] = (uint8_t)k;
+                }
+            }
+        }
+        take[d][0] = 0;
+    }
+
+    if (best[units] == PLAN_IMPOSSIBLE) {
+        return false;
+    }
+
+    unsigned int v = units;
+    for (unsigned int d = count; d-- > 0;) {
+        plan->notes[d] = take[d][v];
+        v -= take[d][v] * (unsigned int)(denoms[d].amount / WITHDRAW_UNIT);
+    }
+    plan->total_notes = best[units];
+    return true;
+}
+
+/**
+ * @brief Calcula la combinación con menos billetes que suma `amount`.
+ *
+ * @param denoms Denominaciones disponibles.
+ * @param count Cantidad de denominaciones.
+ * @param amount Monto a retirar, en pesos.
+ * @param plan Donde se escribe el plan.
+ * @return false si el monto no es válido o no se puede formar.
+ */
+bool plan_withdrawal(const Denomination *denoms, unsigned int count, money_t amount, WithdrawalPlan *plan) {
+    // Acotado el monto, el resto de las cuentas cabe en 32 bits
+    if (amount <= 0 || amount > PLAN_MAX_AMOUNT || count > DISPENSER_CHANNELS) {
+        return false;
+    }
+    uint32_t pesos = (uint32_t)amount;
+    if (pesos % WITHDRAW_UNIT != 0) {
+        return false;
+    }
+    unsigned int units = pesos / WITHDRAW_UNIT;
+
+    PlanInventory inventory;
+    plan_inventory(denoms, count, &inventory);
+    for (unsigned int i = 0; i < PLAN_CACHE_SIZE; i++) {
+        if (plan_cache[i].valid && plan_cache[i].units == units &&
+            memcmp(&plan_cache[i].inventory, &inventory, sizeof(inventory)) == 0) {
+            *plan = plan_cache[i].plan;
+            return plan_cache[i].feasible;
+        }
+    }
+
+    PlanCacheEntry *entry = &plan_cache[plan_cache_next];
+    plan_cache_next = (plan_cache_next + 1) % PLAN_CACHE_SIZE;
+
+    entry->feasible = solve_plan(denoms, count, units, &entry->plan);
+    entry->units = (uint8_t)units;
+    entry->inventory = inventory;
+    entry->valid = true;
+
+    *plan = entry->plan;
+    return entry->feasible;
+}
@@ -0,0 +1,64 @@
+/**
+ * @file planner.h
+ * @brief Planificador de retiros: elige cuántos billetes de cada denominación entregar.
+ */
+#ifndef PLANNER_H
+#define PLANNER_H
+
+#include "tcl.h"
+#include "pwm.h"
+
+/**
+ * @brief Unidad mínima de retiro, en pesos. Todos los montos deben ser múltiplos.
+ */
+#define WITHDRAW_UNIT 10000
+
+/**
+ * @brief Monto máximo que se puede planificar, en unidades de `WITHDRAW_UNIT` (1.000.000).
+ */
+#define PLAN_MAX_UNITS 100
+
+/**
+ * @brief Monto máximo que se puede planificar, en pesos.
+ */
+#define PLAN_MAX_AMOUNT ((money_t)PLAN_MAX_UNITS * WITHDRAW_UNIT)
+
+/**
+ * @brief Cantidad de planes recientes que se guardan en caché.
+ */
+#define PLAN_CACHE_SIZE 8
+
+/**
+ * @brief Billetes a entregar por cada denominación (y canal del dispensador).
+ */
+typedef struct {
+    unsigned int notes[DISPENSER_CHANNELS];   /**< Billetes por denominación */
+    unsigned int total_notes;                 /**< Total de billetes del plan */
+} WithdrawalPlan;
+
+/**
+ * @brief Calcula la combinación con menos billetes que suma `amount` con el inventario actual.
+ *
+ * Usa programación dinámica acotada por la cantidad disponible de cada denominación,
+ * así encuentra solución aunque el inventario esté desbalanceado (por ejemplo, 60.000
+ * sin billetes de 10.000 se entrega como 3 de 20.000). Los resultados se guardan en
+ * caché junto con el inventario que los produjo, y un plan solo se reutiliza si el
+ * monto y el inventario son los mismos: un cambio de `denoms` que no pasó por
+ * `planner_invalidate()` (por ejemplo, al restaurarlo desde la flash) no devuelve un
+ * plan viejo.
+ *
+ * @param denoms Denominaciones disponibles (monto y cantidad).
+ * @param count Cantidad de denominaciones (máximo `DISPENSER_CHANNELS`).
+ * @param amount Monto a retirar, en pesos.
+ * @param plan Donde se escribe el plan.
+ * @return false si el monto no es válido o no se puede formar con los billetes disponibles.
+ */
+bool plan_withdrawal(const Denomination *denoms, unsigned int count, money_t amount, WithdrawalPlan *plan);
+
+/**
+ * @brief Descarta los planes en caché. No hace falta para que los planes sean
+ * correctos; al cambiar el inventario libera las entradas que ya no se van a usar.
+ */
+void planner_invalidate(void);
+
+#endif // PLANNER_H
@@ -0,0 +1,106 @@
+/**
+ * @file power.c
+ * @brief Espera de inactividad y entrada y salida del reposo.
+ *
+ * La espera es un temporizador de `timewheel.h` que se reprograma con cada tecla y publica
+ * `EVENT_IDLE` al vencer; el lazo principal decide si puede entrar en reposo. Al
+ * entrar, `SLEEP_EN0/1` del bloque de relojes indican qué relojes siguen vivos cuando
+ * los núcleos duermen y `SLEEPDEEP` hace que el `__wfe()` de `events_wait()` lleve al
+ * sistema a ese estado. Cualquier interrupción devuelve todos los relojes mientras el
+ * núcleo atiende, así que las alarmas y el USB siguen funcionando en reposo.
+ */
+
+#include "power.h"
+#include "keypad.h"
+#include "events.h"
+#include "timewheel.h"
+#include "pico/stdlib.h"
+#include "hardware/clocks.h"
+#include "hardware/structs/scb.h"
+
+/**
+ * @brief Relojes que siguen activos en reposo: los GPIO (para despertar con el
+ * teclado), el temporizador y su base de tiempo del watchdog, y el USB.
+ */
+#define POWER_SLEEP_EN0 (CLOCKS_SLEEP_EN0_CLK_SYS_IO_BITS | CLOCKS_SLEEP_EN0_CLK_SYS_PADS_BITS | \
+                         CLOCKS_SLEEP_EN0_CLK_SYS_BUSFABRIC_BITS)
+#define POWER_SLEEP_EN1 (CLOCKS_SLEEP_EN1_CLK_SYS_TIMER_BITS | CLOCKS_SLEEP_EN1_CLK_SYS_WATCHDOG_BITS | \
+                         CLOCKS_SLEEP_EN1_CLK_SYS_USBCTRL_BITS | CLOCKS_SLEEP_EN1_CLK_USB_USBCTRL_BITS)
+
+/**
+ * @brief Momento en que empezó el reposo actual.
+ */
+static uint64_t idle_start_us = 0;
+
+static PowerStats power_stats = {0};
+
+/**
+ * @brief Vence la espera de inactividad; avisa al lazo principal.
+ *
+ * @param user_data No se usa.
+ */
+static void idle_callback(void *user_data) {
+    events_post(EVENT_IDLE);
+}
+
+/**
+ * @brief Temporizador de la espera de inactividad.
+ */
+static TimeWheelTimer idle_timer = TIMEWHEEL_TIMER(idle_callback, NULL);
+
+/**
+ * @brief Programa la primera espera de inactividad.
+ */
+void power_init(void) {
+    power_activity();
+}
+
+/**
+ * @brief Reinicia la espera de inactividad.
+ */
+void power_activity(void) {
+    timewheel_arm(&idle_timer, POWER_IDLE_MS);
+}
+
+/**
+ * @brief Detiene el escáner y deja sin reloj los periféricos mientras el núcleo duerme.
+ */
+void power_enter_idle(void) {
+    if (power_stats.idle) {
+        return;
+    }
+    power_stats.idle = true;
+    power_stats.entries++;
+    idle_start_us = time_us_64();
+
+    clocks_hw->sleep_en0 = POWER_SLEEP_EN0;
+    clocks_hw->sleep_en1 = POWER_SLEEP_EN1;
+    scb_hw->scr |= M0PLUS_SCR_SLEEPDEEP_BITS;
+    keypad_sleep();     // Si hay una tecla presionada, despierta enseguida
+}
+
+/**
+ * @brief Devuelve el reloj a los periféricos y reprograma la espera de inactividad.
+ */
+void power_exit_idle(void) {
+    if (power_stats.idle) {
+        scb_hw->scr &= ~M0PLUS_SCR_SLEEPDEEP_BITS;
+        clocks_hw->sleep_en0 = ~0u;
+        clocks_hw->sleep_en1 = ~0u;
+        power_stats.idle_us += time_us_64() - idle_start_us;
+        power_stats.idle = false;
+    }
+    power_activity();
+}
+
+/**
+ * @brief Devuelve el resumen del tiempo en reposo, con el reposo actual incluido.
+ */
+const PowerStats *power_get_stats(void) {
+    if (power_stats.idle) {
+        uint64_t now = time_us_64();
+        power_stats.idle_us += now - idle_start_us;
+        idle_start_us = now;
+    }
+    return &power_stats;
+}
@@ -0,0 +1,65 @@
+/**
+ * @file power.h
+ * @brief Modo de reposo para funcionar con baterías.
+ *
+ * Después de `POWER_IDLE_MS` sin teclas, con la sesión en la pantalla de bienvenida y
+ * sin trabajo pendiente en el LCD, el dispensador ni la flash, el lazo principal entra
+ * en reposo: el escáner PIO del teclado se detiene, las filas quedan en bajo y las
+ * columnas despiertan al núcleo con una interrupción de nivel. Mientras ambos núcleos
+ * duermen, solo siguen con reloj el temporizador, los GPIO y el USB; el resto de los
+ * periféricos (PIO, DMA, I2C, PWM, SRAM sin usar) quedan sin reloj. La primera tecla
+ * vuelve a arrancar el escáner, que la reconoce en unos pocos cuadros.
+ *
+ * No se usa el modo DORMANT del RP2040: detiene el cristal, con él el temporizador de
+ * 1 us y el USB, y al despertar habría que volver a configurar los PLL y la consola.
+ */
+#ifndef POWER_H
+#define POWER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief Tiempo sin actividad antes de entrar en reposo, en milisegundos.
+ */
+#define POWER_IDLE_MS 30000
+
+/**
+ * @brief Resumen del tiempo pasado en reposo.
+ */
+typedef struct {
+    uint32_t entries;       /**< Veces que se entró en reposo */
+    uint64_t idle_us;       /**< Tiempo total en reposo */
+    bool idle;              /**< Si está en reposo ahora */
+} PowerStats;
+
+/**
+ * @brief Programa la primera espera de inactividad. Se llama después de `init_keypad()`.
+ */
+void power_init(void);
+
+/**
+ * @brief Reinicia la espera de inactividad; se llama con cada tecla o comando.
+ */
+void power_activity(void);
+
+/**
+ * @brief Entra en reposo: detiene el escáner del teclado y deja sin reloj los
+ * periféricos mientras el núcleo duerme.
+ *
+ * Se llama desde el lazo principal al recibir `EVENT_IDLE`, si no hay trabajo pendiente.
+ */
+void power_enter_idle(void);
+
+/**
+ * @brief Sale del reposo al recibir `EVENT_WAKE`: devuelve el reloj a los periféricos
+ * y vuelve a programar la espera de inactividad.
+ */
+void power_exit_idle(void);
+
+/**
+ * @brief Devuelve el resumen del tiempo en reposo, incluido el reposo en curso.
+ */
+const PowerStats *power_get_stats(void);
+
+#endif // POWER_H
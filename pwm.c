@@ -1,35 +1,393 @@
 /**
  * @file motor_control.c
- * @brief Control de motores mediante GPIO en la Raspberry Pi Pico.
+ * @brief Control de los motores paso a paso del dispensador con PIO y DMA.
+ *
+ * Cada canal tiene una máquina de estados de `stepper.pio` en `pio1` y un canal DMA.
+ * Al arrancar se calcula con `ramp_build()` la rampa de un billete y se guarda como las
+ * palabras que toma el programa, terminadas en 0. Para sacar un billete basta disparar
+ * el DMA: los pulsos salen sin la CPU y, al llegar al 0, la máquina levanta su IRQ.
+ * La interrupción avisa el billete y programa el temporizador de descanso del canal
+ * (`timewheel.h`), al cabo del cual el canal toma el siguiente billete de su cola o
+ * queda libre. El descanso vence en el núcleo de la rueda, que en modo multinúcleo no es
+ * el de los motores, así que la cola y el estado de cada canal se cambian con el
+ * spinlock del dispensador. Como ningún
+ * canal bloquea, varios motores pueden trabajar a la vez.
+ *
+ * En un canal con barrera, la interrupción de los pines anota el paso en que el billete
+ * tapa la barrera y, en el borde trasero, frena el motor: descarta lo que queda de la
+ * rampa y sigue con su tramo de frenado desde la velocidad actual. El paso en curso se
+ * saca de lo que le falta al DMA menos lo que espera en la FIFO.
+ *
+ * No se usan los PWM del RP2040: los pines 16 y 17 comparten la misma porción PWM, así
+ * que esos dos motores no podrían seguir rampas distintas al mismo tiempo.
  */
 
-#include <stdio.h>
 #include <string.h>
+#include "pwm.h"
+#include "log.h"
+#include "trace.h"
+#include "timewheel.h"
 #include "pico/stdlib.h"
 #include "hardware/gpio.h"
-#include "hardware/timer.h"
 #include "hardware/irq.h"
+#include "hardware/sync.h"
+#include "hardware/pio.h"
+#include "hardware/dma.h"
+#include "stepper.pio.h"
+
+/**
+ * @brief Bloque PIO de los motores; `pio0` es del teclado.
+ */
+#define STEPPER_PIO pio1
 
 /**
- * @brief Controla el movimiento de un motor activado por un pin GPIO.
+ * @brief Frecuencia de los ciclos de las máquinas de estados: las palabras de la rampa
+ * quedan en microsegundos.
+ */
+#define STEPPER_CYCLE_HZ 1000000
+
+/**
+ * @brief Estados de un canal del dispensador.
+ */
+typedef enum {
+    CHANNEL_IDLE,       /**< Sin trabajo, motor detenido */
+    CHANNEL_FEEDING,    /**< Rampa en curso sacando un billete */
+    CHANNEL_RESTING     /**< Motor detenido esperando antes del siguiente billete */
+} ChannelState;
+
+/**
+ * @brief Estado de un canal del dispensador.
+ */
+typedef struct {
+    uint8_t pin;                    /**< Pin STEP del motor */
+    uint8_t sm;                     /**< Máquina de estados de `STEPPER_PIO` */
+    uint8_t dma;                    /**< Canal DMA que alimenta la máquina */
+    uint16_t steps;                 /**< Pasos por billete; 0 si el perfil no es válido */
+    volatile ChannelState state;    /**< Estado actual */
+    volatile unsigned int pending;  /**< Billetes por entregar, incluido el que está saliendo */
+    int8_t sensor_pin;              /**< Pin de la barrera, o -1 */
+    uint16_t note_steps;            /**< Pasos que tapa un billete */
+    uint16_t brake_from;            /**< Primer paso del frenado final de la rampa */
+    uint16_t transfer_first;        /**< Primer paso de la transferencia DMA en curso */
+    uint16_t transfer_words;        /**< Palabras de la transferencia DMA en curso */
+    uint16_t lead_step;             /**< Paso en que el billete tapó la barrera */
+    bool covered;                   /**< La barrera está tapada en este billete */
+    bool braking;                   /**< Ya pasó el borde trasero y el motor está frenando */
+    bool jammed;                    /**< Fuera de servicio hasta `dispenser_init()` */
+    uint8_t counted;                /**< Billetes que midió la barrera en este intento */
+    TimeWheelTimer rest_timer;      /**< Descanso después de cada billete */
+    uint32_t words[RAMP_MAX_STEPS + 1]; /**< Rampa de un billete para la FIFO, terminada en 0 */
+} DispenserChannel;
+
+/**
+ * @brief Canales configurados.
+ */
+static DispenserChannel channels[DISPENSER_CHANNELS];
+
+/**
+ * @brief Cantidad de canales configurados.
+ */
+static unsigned int channel_count = 0;
+
+/**
+ * @brief Spinlock que protege `pending` y `state` de los canales.
+ */
+static spin_lock_t *dispenser_lock = NULL;
+
+/**
+ * @brief Función que se llama cada vez que sale un billete.
+ */
+static dispense_callback_t note_callback = NULL;
+
+/**
+ * @brief Dispara la rampa de un billete.
  *
- * Configura el pin del motor como salida, enciende el motor durante un
- * breve periodo de tiempo y luego lo apaga.
+ * @param channel Canal a arrancar.
+ */
+static void start_feeding(DispenserChannel *channel) {
+    TRACE(TRACE_MOTOR_START, channel - channels);
+    channel->state = CHANNEL_FEEDING;
+    channel->braking = false;
+    channel->counted = 0;
+    channel->lead_step = 0;
+    channel->covered = channel->sensor_pin >= 0 && gpio_get((uint)channel->sensor_pin);
+    channel->transfer_first = 0;
+    channel->transfer_words = (uint16_t)(channel->steps + 1u);
+    // Una palabra de un frenado que la máquina no llegó a tomar no debe cortar este billete
+    pio_sm_clear_fifos(STEPPER_PIO, channel->sm);
+    dma_channel_transfer_from_buffer_now(channel->dma, channel->words, channel->transfer_words);
+}
+
+/**
+ * @brief Paso de la rampa que está dando el motor.
  *
- * @param MOTOR_PIN El pin GPIO utilizado para controlar el motor.
+ * @param channel Canal en marcha.
+ * @return Índice del paso en `words`.
  */
+static unsigned int current_step(const DispenserChannel *channel) {
+    unsigned int left = dma_channel_hw_addr(channel->dma)->transfer_count;
+    unsigned int queued = pio_sm_get_tx_fifo_level(STEPPER_PIO, channel->sm);
+    unsigned int taken = channel->transfer_words - left;
+    taken = taken > queued ? taken - queued : 0;
+    return channel->transfer_first + (taken > 0 ? taken - 1 : 0);
+}
 
-void mov_motors(int MOTOR_PIN) {
-    // Inicializar el pin del motor como salida
-    gpio_init(MOTOR_PIN);
-    gpio_set_dir(MOTOR_PIN, GPIO_OUT);
+/**
+ * @brief Frena el motor desde el paso en curso con el tramo final de la rampa.
+ *
+ * Durante la aceleración se sigue con el paso simétrico del frenado; en el crucero, con
+ * el principio del frenado; si ya estaba frenando, no cambia nada.
+ *
+ * @param channel Canal en marcha.
+ * @param step Paso que está dando el motor.
+ */
+static void brake(DispenserChannel *channel, unsigned int step) {
+    unsigned int accel_steps = channel->steps - channel->brake_from;
+    unsigned int next = step < accel_steps ? channel->steps - 1u - step : channel->brake_from;
+    if (next <= step) {
+        next = step + 1u;
+    }
+    channel->braking = true;
+    if (next == step + 1u) {
+        return;
+    }
 
-        // Encender el motor
-        gpio_put(MOTOR_PIN, 1);
-        sleep_ms(60);  // Mantener encendido 5 segundos
+    dma_channel_abort(channel->dma);
+    pio_sm_clear_fifos(STEPPER_PIO, channel->sm);
+    channel->transfer_first = (uint16_t)next;
+    channel->transfer_words = (uint16_t)(channel->steps + 1u - next);
+    dma_channel_transfer_from_buffer_now(channel->dma, &channel->words[next], channel->transfer_words);
+}
 
-        // Apagar el motor
-        gpio_put(MOTOR_PIN, 0);
-        sleep_ms(5000);  // Mantener apagado 5 segundos
-    
+/**
+ * @brief Atiende los flancos pendientes de la barrera de un canal.
+ *
+ * El flanco de subida marca el borde delantero del billete y el de bajada el trasero.
+ * Con el borde trasero se cuentan los billetes por el largo tapado, redondeado a
+ * billetes enteros, y se frena el motor.
+ *
+ * @param channel Canal con barrera.
+ */
+static void sensor_edges(DispenserChannel *channel) {
+    uint pin = (uint)channel->sensor_pin;
+    uint32_t events = gpio_get_irq_event_mask(pin) & (GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL);
+    if (events == 0) {
+        return;
+    }
+    gpio_acknowledge_irq(pin, events);
+    if (channel->state != CHANNEL_FEEDING || channel->braking) {
+        return;
+    }
+
+    unsigned int step = current_step(channel);
+    if ((events & GPIO_IRQ_EDGE_RISE) && !channel->covered) {
+        channel->covered = true;
+        channel->lead_step = (uint16_t)step;
+    }
+    if ((events & GPIO_IRQ_EDGE_FALL) && channel->covered && !gpio_get(pin)) {
+        unsigned int length = step - channel->lead_step;
+        unsigned int notes = (length + channel->note_steps / 2u) / channel->note_steps;
+        channel->counted = (uint8_t)(notes > 0 ? notes : 1);
+        brake(channel, step);
+    }
+}
+
+/**
+ * @brief Interrupción de los pines: flancos de las barreras.
+ */
+static void sensor_irq_handler(void) {
+    for (unsigned int i = 0; i < channel_count; i++) {
+        if (channels[i].sensor_pin >= 0) {
+            sensor_edges(&channels[i]);
+        }
+    }
+}
+
+/**
+ * @brief Fin del descanso: sigue con el siguiente billete o deja el canal libre.
+ *
+ * @param user_data Canal al que pertenece el temporizador.
+ */
+static void rest_done(void *user_data) {
+    DispenserChannel *channel = (DispenserChannel *)user_data;
+
+    uint32_t status = spin_lock_blocking(dispenser_lock);
+    if (channel->pending > 0) {
+        start_feeding(channel);
+    } else {
+        channel->state = CHANNEL_IDLE;
+    }
+    spin_unlock(dispenser_lock, status);
+}
+
+/**
+ * @brief Interrupción de `STEPPER_PIO`: una máquina terminó la rampa de un billete.
+ */
+static void stepper_irq_handler(void) {
+    for (unsigned int i = 0; i < channel_count; i++) {
+        DispenserChannel *channel = &channels[i];
+        if (!pio_interrupt_get(STEPPER_PIO, channel->sm)) {
+            continue;
+        }
+        pio_interrupt_clear(STEPPER_PIO, channel->sm);
+        if (channel->state != CHANNEL_FEEDING) {
+            continue;   // Una palabra en 0 sobrante de un frenado
+        }
+        TRACE(TRACE_MOTOR_STOP, i);
+
+        DispenseResult result = DISPENSE_OK;
+        unsigned int notes = 1;
+        if (channel->sensor_pin >= 0) {
+            // PIO1_IRQ_0 se atiende antes que IO_IRQ_BANK0: si las interrupciones estuvieron
+            // apagadas, el borde trasero puede estar esperando detrás de esta
+            sensor_edges(channel);
+            if (channel->braking) {
+                notes = channel->counted;
+                result = notes > 1 ? DISPENSE_DOUBLE : DISPENSE_OK;
+            } else {
+                // Se acabó el recorrido sin borde trasero
+                notes = 0;
+                result = channel->covered ? DISPENSE_JAM : DISPENSE_EMPTY;
+                channel->jammed = true;
+            }
+        }
+        uint32_t status = spin_lock_blocking(dispenser_lock);
+        channel->pending = channel->jammed || notes >= channel->pending ? 0 : channel->pending - notes;
+        channel->state = CHANNEL_RESTING;
+        unsigned int remaining = channel->pending;
+        spin_unlock(dispenser_lock, status);
+        if (note_callback) {
+            note_callback(i, result, notes, remaining);
+        }
+        timewheel_arm(&channel->rest_timer, MOTOR_REST_MS);
+    }
+}
+
+/**
+ * @brief Configura los motores, calcula sus rampas y registra el callback de billete entregado.
+ *
+ * @param pins Pin STEP del motor de cada canal.
+ * @param profiles Perfil de velocidad de cada canal.
+ * @param sensors Barrera de cada canal, o NULL.
+ * @param count Cantidad de canales.
+ * @param on_note Función que se llama al terminar cada billete.
+ */
+void dispenser_init(const uint8_t *pins, const RampProfile *profiles, const NoteSensor *sensors,
+                    unsigned int count, dispense_callback_t on_note) {
+    dispenser_lock = spin_lock_init(spin_lock_claim_unused(true));
+    channel_count = count < DISPENSER_CHANNELS ? count : DISPENSER_CHANNELS;
+    note_callback = on_note;
+
+    uint offset = pio_add_program(STEPPER_PIO, &stepper_program);
+    uint32_t sensor_mask = 0;
+    for (unsigned int i = 0; i < channel_count; i++) {
+        DispenserChannel *channel = &channels[i];
+        channel->pin = pins[i];
+        channel->state = CHANNEL_IDLE;
+        channel->pending = 0;
+        channel->jammed = false;
+        timewheel_timer_init(&channel->rest_timer, rest_done, channel);
+
+        // Rampa en palabras para el programa: cada paso dura la palabra más STEP_OVERHEAD ciclos
+        channel->steps = (uint16_t)ramp_build(&profiles[i], channel->words, RAMP_MAX_STEPS);
+        for (unsigned int s = 0; s < channel->steps; s++) {
+            uint32_t period = channel->words[s];
+            channel->words[s] = period > stepper_STEP_OVERHEAD ? period - stepper_STEP_OVERHEAD : 1;
+        }
+        channel->words[channel->steps] = 0;
+        if (channel->steps == 0) {
+            log_message(LOG_BAD_RAMP, (uint32_t)i);
+        }
+
+        // El frenado final empieza después del último paso a la velocidad máxima
+        uint32_t fastest = UINT32_MAX;
+        for (unsigned int s = 0; s < channel->steps; s++) {
+            if (channel->words[s] < fastest) {
+                fastest = channel->words[s];
+            }
+        }
+        channel->brake_from = channel->steps;
+        while (channel->brake_from > 0 && channel->words[channel->brake_from - 1] > fastest) {
+            channel->brake_from--;
+        }
+
+        channel->sensor_pin = -1;
+        if (sensors && sensors[i].pin >= 0 && sensors[i].note_steps > 0) {
+            channel->sensor_pin = sensors[i].pin;
+            channel->note_steps = sensors[i].note_steps;
+            gpio_init((uint)channel->sensor_pin);
+            gpio_set_dir((uint)channel->sensor_pin, GPIO_IN);
+            gpio_pull_down((uint)channel->sensor_pin);     // Sin barrera conectada, el canal se traba
+            sensor_mask |= 1u << channel->sensor_pin;
+        }
+
+        channel->sm = (uint8_t)pio_claim_unused_sm(STEPPER_PIO, true);
+        stepper_program_init(STEPPER_PIO, channel->sm, offset, channel->pin, STEPPER_CYCLE_HZ);
+        pio_set_irq0_source_enabled(STEPPER_PIO, pis_interrupt0 + channel->sm, true);
+
+        // 32 bits por paso hacia la FIFO TX, al ritmo que la máquina los pide
+        channel->dma = (uint8_t)dma_claim_unused_channel(true);
+        dma_channel_config config = dma_channel_get_default_config(channel->dma);
+        channel_config_set_transfer_data_size(&config, DMA_SIZE_32);
+        channel_config_set_read_increment(&config, true);
+        channel_config_set_write_increment(&config, false);
+        channel_config_set_dreq(&config, pio_get_dreq(STEPPER_PIO, channel->sm, true));
+        dma_channel_configure(channel->dma, &config, &STEPPER_PIO->txf[channel->sm], channel->words, 0, false);
+    }
+
+    irq_set_exclusive_handler(PIO1_IRQ_0, stepper_irq_handler);
+    irq_set_enabled(PIO1_IRQ_0, true);
+
+    // Manejador propio para los pines de las barreras: el callback de los pines es del teclado
+    if (sensor_mask != 0) {
+        gpio_add_raw_irq_handler_masked(sensor_mask, sensor_irq_handler);
+        for (unsigned int i = 0; i < channel_count; i++) {
+            if (channels[i].sensor_pin >= 0) {
+                gpio_set_irq_enabled((uint)channels[i].sensor_pin, GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, true);
+            }
+        }
+        irq_set_enabled(IO_IRQ_BANK0, true);
+    }
+}
+
+/**
+ * @brief Encola billetes para entregar por un canal.
+ *
+ * Si el canal estaba libre, el motor arranca de inmediato; si no, los billetes
+ * salen cuando termine lo que ya tenía en cola.
+ *
+ * @param channel Canal del dispensador.
+ * @param notes Cantidad de billetes.
+ * @return false si el canal no existe, no tiene un perfil válido o está trabado.
+ */
+bool dispenser_enqueue(unsigned int channel, unsigned int notes) {
+    if (channel >= channel_count || channels[channel].steps == 0 || channels[channel].jammed) {
+        return false;
+    }
+    if (notes == 0) {
+        return true;
+    }
+
+    DispenserChannel *c = &channels[channel];
+    uint32_t status = spin_lock_blocking(dispenser_lock);
+    c->pending += notes;
+    if (c->state == CHANNEL_IDLE) {
+        start_feeding(c);
+    }
+    spin_unlock(dispenser_lock, status);
+    return true;
+}
+
+/**
+ * @brief Indica si algún canal tiene billetes pendientes o un motor en marcha.
+ *
+ * @return true mientras quede trabajo en el dispensador.
+ */
+bool dispenser_busy(void) {
+    for (unsigned int i = 0; i < channel_count; i++) {
+        if (channels[i].state != CHANNEL_IDLE) {
+            return true;
+        }
+    }
+    return false;
 }
\ No newline at end of file
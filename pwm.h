@@ -1,18 +1,101 @@
 /**
  * @file PWM.h
- * @brief Definiciones y prototipos para el control de motores mediante PWM.
+ * @brief Definiciones y prototipos para el control de los motores paso a paso.
+ *
+ * Cada canal del dispensador corresponde a un motor alimentador (uno por denominación)
+ * que saca cada billete con una rampa trapezoidal de pasos (ver `ramp.h`). Los
+ * trabajos de entrega se encolan por canal y avanzan sin bloquear; canales distintos
+ * alimentan billetes al mismo tiempo.
+ *
+ * Un canal puede tener además una barrera óptica a la salida del rodillo. Con ella el
+ * canal trabaja a lazo cerrado: la rampa pasa a ser el recorrido máximo, el motor frena
+ * en cuanto pasa el borde trasero del billete y el largo que tapó la barrera dice si
+ * salieron dos billetes pegados. Si la rampa termina sin que pase un billete, el canal
+ * queda trabado y fuera de servicio hasta el próximo `dispenser_init()`.
  */
 
 #ifndef PWM_H
 #define PWM_H
 
 #include <stdint.h> // Para tipos como uint
+#include <stdbool.h>
+#include "ramp.h"
+
+/**
+ * @brief Número máximo de canales (motores) del dispensador.
+ */
+#define DISPENSER_CHANNELS 4
+
+/**
+ * @brief Pausa del motor después de cada billete, en milisegundos, para que el
+ * siguiente no salga pegado.
+ */
+#define MOTOR_REST_MS 150
+
+/**
+ * @brief Barrera óptica de un canal.
+ *
+ * La entrada está en alto mientras un billete tapa la barrera.
+ */
+typedef struct {
+    int8_t pin;             /**< Pin de la barrera, o -1 si el canal trabaja a lazo abierto */
+    uint16_t note_steps;    /**< Pasos del motor que tapa un billete al pasar */
+} NoteSensor;
+
+/**
+ * @brief Resultado de un intento de sacar un billete.
+ */
+typedef enum {
+    DISPENSE_OK,        /**< Salió un billete (siempre, a lazo abierto) */
+    DISPENSE_DOUBLE,    /**< Salieron billetes pegados: la barrera quedó tapada de más */
+    DISPENSE_JAM,       /**< Un billete tapó la barrera y no terminó de pasar */
+    DISPENSE_EMPTY      /**< No llegó ningún billete a la barrera */
+} DispenseResult;
+
+/**
+ * @brief Callback que avisa que un canal terminó un intento de sacar un billete.
+ *
+ * Se llama desde la interrupción del PIO de los motores. Con `DISPENSE_JAM` o
+ * `DISPENSE_EMPTY` el canal descarta su cola y queda fuera de servicio.
+ *
+ * @param channel Canal del intento.
+ * @param result Cómo terminó.
+ * @param notes Billetes que salieron: 1, más de uno si salieron pegados, o 0.
+ * @param remaining Billetes que le quedan por entregar a ese canal.
+ */
+typedef void (*dispense_callback_t)(unsigned int channel, DispenseResult result, unsigned int notes,
+                                    unsigned int remaining);
+
+/**
+ * @brief Configura los motores, calcula sus rampas y registra el callback de billete
+ * entregado.
+ *
+ * Las interrupciones de los motores, y por lo tanto el callback, corren en el núcleo
+ * que llama a esta función.
+ *
+ * @param pins Pin STEP del motor de cada canal.
+ * @param profiles Perfil de velocidad de cada canal; con barrera, el recorrido máximo.
+ * @param sensors Barrera de cada canal (NULL si ningún canal tiene).
+ * @param count Cantidad de canales (máximo `DISPENSER_CHANNELS`).
+ * @param on_note Función que se llama al terminar cada billete (puede ser NULL).
+ */
+void dispenser_init(const uint8_t *pins, const RampProfile *profiles, const NoteSensor *sensors,
+                    unsigned int count, dispense_callback_t on_note);
+
+/**
+ * @brief Encola billetes para entregar por un canal. No bloquea.
+ *
+ * @param channel Canal del dispensador.
+ * @param notes Cantidad de billetes.
+ * @return false si el canal no existe, no tiene un perfil válido o está trabado.
+ */
+bool dispenser_enqueue(unsigned int channel, unsigned int notes);
 
 /**
- * @brief Controla el movimiento de un motor activado por un pin GPIO.
+ * @brief Indica si algún canal tiene billetes pendientes o un motor en marcha.
  *
- * @param motor_pin El pin GPIO utilizado para controlar el motor.
+ * @return true mientras quede trabajo en el dispensador.
  */
-void mov_motors(int motor_pin);
+bool dispenser_busy(void);
 
 #endif // PWM_H
\ No newline at end of file
@@ -0,0 +1,86 @@
+/**
+ * @file ramp.c
+ * @brief Implementación del generador de perfiles trapezoidales.
+ *
+ * La velocidad al empezar el paso `n` de una rampa es sqrt(v0² + 2·a·n), en pasos por
+ * segundo; el período del paso es su inversa. Se calcula con una raíz entera de 64
+ * bits, con la velocidad en 1/256 de paso por segundo para que el redondeo no se note
+ * a baja velocidad, sin depender de la biblioteca de punto flotante del RP2040.
+ */
+
+#include "ramp.h"
+
+/**
+ * @brief Raíz cuadrada entera, redondeada hacia abajo.
+ */
+static uint32_t isqrt64(uint64_t value) {
+    uint64_t root = 0;
+    uint64_t bit = 1ull << 62;
+
+    while (bit > value) {
+        bit >>= 2;
+    }
+    while (bit != 0) {
+        if (value >= root + bit) {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint32_t)root;
+}
+
+/**
+ * @brief Velocidad después de `n` pasos de rampa desde `start_sps`, en 1/256 de paso
+ * por segundo.
+ */
+static uint32_t ramp_speed(const RampProfile *profile, unsigned int n) {
+    uint64_t v0 = profile->start_sps;
+    return isqrt64((v0 * v0 + 2ull * profile->accel_sps2 * n) << 16);
+}
+
+/**
+ * @brief Calcula el período de cada paso de un billete.
+ *
+ * @param profile Perfil del canal.
+ * @param periods_us Donde se escriben los períodos, en microsegundos.
+ * @param max_steps Capacidad de `periods_us`.
+ * @return Cantidad de pasos escritos; 0 si el perfil no es válido o no cabe.
+ */
+unsigned int ramp_build(const RampProfile *profile, uint32_t *periods_us, unsigned int max_steps) {
+    if (profile->steps == 0 || profile->steps > max_steps || profile->start_sps == 0 ||
+        profile->cruise_sps < profile->start_sps) {
+        return 0;
+    }
+
+    for (unsigned int i = 0; i < profile->steps; i++) {
+        uint32_t speed = (uint32_t)profile->cruise_sps << 8;
+        uint32_t accelerating = ramp_speed(profile, i);
+        uint32_t braking = ramp_speed(profile, profile->steps - 1 - i);
+        if (accelerating < speed) {
+            speed = accelerating;
+        }
+        if (braking < speed) {
+            speed = braking;
+        }
+        periods_us[i] = (uint32_t)((256000000ull + speed / 2) / speed);
+    }
+    return profile->steps;
+}
+
+/**
+ * @brief Suma los períodos de un billete.
+ *
+ * @param periods_us Períodos de `ramp_build()`.
+ * @param steps Cantidad de pasos.
+ * @return Duración del billete, en microsegundos.
+ */
+uint32_t ramp_duration_us(const uint32_t *periods_us, unsigned int steps) {
+    uint32_t total = 0;
+    for (unsigned int i = 0; i < steps; i++) {
+        total += periods_us[i];
+    }
+    return total;
+}
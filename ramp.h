@@ -0,0 +1,54 @@
+/**
+ * @file ramp.h
+ * @brief Perfiles trapezoidales de velocidad para los motores paso a paso.
+ *
+ * Un billete son `steps` pasos: el motor arranca a `start_sps`, acelera con
+ * `accel_sps2` hasta `cruise_sps`, sigue a esa velocidad y desacelera con la misma
+ * rampa hasta `start_sps` en el último paso. Si el billete es corto para llegar a la
+ * velocidad de crucero, el perfil queda triangular. El generador no usa el SDK ni
+ * punto flotante, así que da los mismos períodos en el RP2040 y en el host.
+ */
+#ifndef RAMP_H
+#define RAMP_H
+
+#include <stdint.h>
+
+/**
+ * @brief Pasos máximos de un billete.
+ */
+#define RAMP_MAX_STEPS 512
+
+/**
+ * @brief Perfil de velocidad de un canal del dispensador.
+ */
+typedef struct {
+    uint16_t steps;         /**< Pasos del rodillo por billete */
+    uint16_t start_sps;     /**< Velocidad de arranque y de parada, en pasos por segundo */
+    uint16_t cruise_sps;    /**< Velocidad de crucero, en pasos por segundo */
+    uint32_t accel_sps2;    /**< Aceleración y desaceleración, en pasos por segundo al cuadrado */
+} RampProfile;
+
+/**
+ * @brief Calcula el período de cada paso de un billete.
+ *
+ * El paso `i` dura lo que corresponde a la menor de tres velocidades: la alcanzada
+ * acelerando desde el primer paso, la que permite frenar hasta el último y la de
+ * crucero (v² = v0² + 2·a·n).
+ *
+ * @param profile Perfil del canal.
+ * @param periods_us Donde se escriben los períodos, en microsegundos.
+ * @param max_steps Capacidad de `periods_us`.
+ * @return Cantidad de pasos escritos; 0 si el perfil no es válido o no cabe.
+ */
+unsigned int ramp_build(const RampProfile *profile, uint32_t *periods_us, unsigned int max_steps);
+
+/**
+ * @brief Suma los períodos de un billete.
+ *
+ * @param periods_us Períodos de `ramp_build()`.
+ * @param steps Cantidad de pasos.
+ * @return Duración del billete, en microsegundos.
+ */
+uint32_t ramp_duration_us(const uint32_t *periods_us, unsigned int steps);
+
+#endif // RAMP_H
@@ -0,0 +1,126 @@
+/**
+ * @file screens.c
+ * @brief Catálogo de pantallas completas del LCD.
+ *
+ * Las pantallas se guardan como 80 celdas por fila (`char [LCD_ROWS][LCD_COLUMNS]`,
+ * sin terminador); una fila corta queda completada con ceros que `displayScreen()`
+ * muestra como espacios. Mostrar una pantalla es copiar 80 bytes al buffer sombra,
+ * y `lcd_flush()` envía solo las celdas que cambiaron respecto a la anterior.
+ *
+ * Los textos de consola no se guardan: se registra el número de pantalla y
+ * `matecash_logdecode` escribe el texto desde el mismo catálogo.
+ */
+
+#include "screens.h"
+#include "log.h"
+
+/**
+ * @brief Pantalla guardada en la flash.
+ */
+typedef struct {
+    char cells[LCD_ROWS][LCD_COLUMNS];      /**< Celdas del LCD */
+} Screen;
+
+/**
+ * @brief Campo variable dentro de una pantalla.
+ */
+typedef struct {
+    uint8_t screen;     /**< `ScreenId` al que pertenece */
+    uint8_t row;        /**< Fila */
+    uint8_t col;        /**< Primera columna */
+    uint8_t width;      /**< Ancho en caracteres */
+} ScreenFieldSlot;
+
+// Revisión en tiempo de compilación: cada fila cabe en el LCD
+#define SCREEN_CHECK(id, console, r0, r1, r2, r3) \
+    _Static_assert(sizeof(r0) <= LCD_COLUMNS + 1 && sizeof(r1) <= LCD_COLUMNS + 1 && \
+                   sizeof(r2) <= LCD_COLUMNS + 1 && sizeof(r3) <= LCD_COLUMNS + 1, \
+                   #id ": una fila tiene más de 20 caracteres");
+SCREEN_CATALOG(SCREEN_CHECK)
+
+// Revisión en tiempo de compilación: cada campo cabe en su fila
+#define FIELD_CHECK(id, screen, row, col, width) \
+    _Static_assert((row) < LCD_ROWS && (col) + (width) <= LCD_COLUMNS, #id ": el campo no cabe en la fila");
+SCREEN_FIELDS(FIELD_CHECK)
+
+#define SCREEN_ENTRY(id, console, r0, r1, r2, r3) [id] = {{r0, r1, r2, r3}},
+#define FIELD_ENTRY(id, screen, row, col, width) [id] = {screen, row, col, width},
+
+/**
+ * @brief Catálogo de pantallas, indexado por `ScreenId`.
+ */
+static const Screen screens[SCREEN_COUNT] = {
+    SCREEN_CATALOG(SCREEN_ENTRY)
+};
+
+/**
+ * @brief Campos variables, indexados por `ScreenField`.
+ */
+static const ScreenFieldSlot fields[FIELD_COUNT] = {
+    SCREEN_FIELDS(FIELD_ENTRY)
+};
+
+/**
+ * @brief Última pantalla mostrada.
+ */
+static ScreenId shown = SCREEN_NONE;
+
+/**
+ * @brief Muestra una pantalla del catálogo.
+ *
+ * @param screen Pantalla a mostrar.
+ */
+void screen_show(ScreenId screen) {
+    if (screen == SCREEN_NONE || screen >= SCREEN_COUNT) {
+        return;
+    }
+    displayScreen(&screens[screen].cells[0][0]);
+    shown = screen;
+    log_message(LOG_SCREEN, (uint32_t)screen);
+}
+
+/**
+ * @brief Escribe un campo de la pantalla actual.
+ *
+ * @param field Campo a escribir.
+ * @param text Texto del campo.
+ */
+void screen_set_field(ScreenField field, const char *text) {
+    if (field >= FIELD_COUNT || fields[field].screen != shown) {
+        return;
+    }
+
+    char padded[LCD_COLUMNS + 1];
+    unsigned int width = fields[field].width;
+    unsigned int i = 0;
+    for (; i < width && text[i]; i++) {
+        padded[i] = text[i];
+    }
+    for (; i < width; i++) {
+        padded[i] = ' ';
+    }
+    padded[width] = '\0';
+    displayMessage(padded, fields[field].row, fields[field].col);
+}
+
+/**
+ * @brief Escribe un monto en un campo de la pantalla actual, alineado a la derecha.
+ *
+ * @param field Campo a escribir.
+ * @param amount Monto en pesos.
+ */
+void screen_set_amount(ScreenField field, money_t amount) {
+    if (field >= FIELD_COUNT || fields[field].screen != shown) {
+        return;
+    }
+    displayAmount(amount, fields[field].row, fields[field].col, fields[field].width);
+}
+
+/**
+ * @brief Devuelve la última pantalla mostrada.
+ *
+ * @return ID de la pantalla.
+ */
+ScreenId screen_current(void) {
+    return shown;
+}
@@ -0,0 +1,145 @@
+/**
+ * @file screens.h
+ * @brief Catálogo de pantallas completas del LCD, guardado en la flash.
+ *
+ * Cada pantalla son las 80 celdas del LCD más el texto que se imprime por la consola
+ * al mostrarla; ese texto no queda en el firmware, lo escribe `matecash_logdecode` al
+ * decodificar el mensaje `LOG_SCREEN`. Las filas se revisan al compilar: una fila de más de 20 caracteres
+ * (por ejemplo, por una tilde en UTF-8, que ocupa 2 bytes) es un error de compilación,
+ * y las filas más cortas se completan con espacios.
+ *
+ * El LCD usa el juego de caracteres A00 del HD44780, que no tiene vocales con tilde;
+ * la ñ es el carácter 0xEE.
+ */
+#ifndef SCREENS_H
+#define SCREENS_H
+
+#include <stddef.h>
+#include "lcd.h"
+
+/**
+ * @brief Lista de pantallas: ID, texto de consola (o NULL) y las cuatro filas.
+ *
+ * Las pantallas nuevas van al final: las capturas de `matecash_replay` guardan el
+ * número de pantalla.
+ */
+#define SCREEN_CATALOG(X) \
+    X(SCREEN_BOOT, "Cajero Matecash\nIngrese ID de 6 dígitos:\n", \
+      "    Bienvenido      ", \
+      "     MateCash       ", \
+      "  Ingrese # cuenta: ", \
+      "") \
+    X(SCREEN_WELCOME, "Bienvenido a CashMate\nIngrese su ID (6 digitos):\n", \
+      "Bienvenido MateCash ", \
+      "", \
+      " Ingrese # cuenta:  ", \
+      "") \
+    X(SCREEN_ENTER_PASSWORD, NULL, \
+      "", \
+      "    Ingrese clave:  ", \
+      "", \
+      "") \
+    X(SCREEN_MENU, "\nMateCash:\n\nMenú de Usuario:\nA - Retirar Dinero\nB - Consultar Saldo\n" \
+                   "C - Cambiar Clave\nD - Cerrar sesión\n", \
+      "    Menu de Usuario ", \
+      "A-Retirar B-Revisar ", \
+      "C - Cambiar Clave   ", \
+      "D - Cerrar sesion   ") \
+    X(SCREEN_BALANCE, "\nPresione '#' para finalizar", \
+      "Saldo:", \
+      "  Presione '#'      ", \
+      " para finalizar     ", \
+      "") \
+    X(SCREEN_AMOUNT_MENU, "\nMateCash:\n\nCuanto Dinero Desea retirar?:\nA - 10.000\nB - 20.000\n" \
+                          "C - 50.000\nD - 100.000\n* - Otro monto\n", \
+      "Cuanto desea retirar", \
+      "   *-Otro monto     ", \
+      "A-10.000 B-20.000   ", \
+      "C-50.000 D-100.000  ") \
+    X(SCREEN_ENTER_AMOUNT, NULL, \
+      "  Ingrese el monto  ", \
+      " (multiplo 10.000)  ", \
+      "$", \
+      "#-Aceptar *-Cancelar") \
+    X(SCREEN_NEW_PASSWORD, NULL, \
+      "     Ingrese nueva  ", \
+      "    contrase\xEE" "a de 4 ", \
+      "      digitos       ", \
+      "") \
+    X(SCREEN_CONFIRM_PASSWORD, NULL, \
+      "     Confirme       ", \
+      "     la nueva       ", \
+      "    contrase\xEE" "a      ", \
+      "") \
+    X(SCREEN_WITHDRAW_FAILED, "\nEl retiro no se realizó; su saldo no cambió.\nPresione '#' para finalizar", \
+      " Retiro no realizado", \
+      " Intente mas tarde  ", \
+      "  Presione '#'      ", \
+      " para finalizar     ")
+
+/**
+ * @brief Lista de campos variables: ID, pantalla, fila, columna y ancho.
+ */
+#define SCREEN_FIELDS(X) \
+    X(FIELD_BALANCE, SCREEN_BALANCE, 0, 6, 14) \
+    X(FIELD_AMOUNT, SCREEN_ENTER_AMOUNT, 2, 1, 12)
+
+#define SCREEN_ENUM_ENTRY(id, ...) id,
+
+/**
+ * @brief Pantallas completas del flujo de sesión.
+ */
+typedef enum {
+    SCREEN_NONE,             /**< No cambia la pantalla */
+    SCREEN_CATALOG(SCREEN_ENUM_ENTRY)
+    SCREEN_COUNT             /**< Cantidad de pantallas */
+} ScreenId;
+
+/**
+ * @brief Campos variables de las pantallas (por ejemplo, el saldo).
+ */
+typedef enum {
+    SCREEN_FIELDS(SCREEN_ENUM_ENTRY)
+    FIELD_COUNT              /**< Cantidad de campos */
+} ScreenField;
+
+/**
+ * @brief Muestra una pantalla del catálogo: copia sus 80 celdas al buffer sombra del
+ * LCD y registra `LOG_SCREEN`, que en la PC se decodifica como su texto de consola.
+ *
+ * Los campos quedan en blanco hasta que se llame a `screen_set_field()`.
+ *
+ * @param screen Pantalla a mostrar; `SCREEN_NONE` no cambia nada.
+ */
+void screen_show(ScreenId screen);
+
+/**
+ * @brief Escribe un campo de la pantalla actual, alineado a la izquierda y completado
+ * con espacios; lo que no cabe en el ancho del campo se descarta.
+ *
+ * No hace nada si el campo pertenece a otra pantalla.
+ *
+ * @param field Campo a escribir.
+ * @param text Texto del campo.
+ */
+void screen_set_field(ScreenField field, const char *text);
+
+/**
+ * @brief Escribe un monto ("$1.250.000") en un campo de la pantalla actual, alineado
+ * a la derecha.
+ *
+ * No hace nada si el campo pertenece a otra pantalla.
+ *
+ * @param field Campo a escribir.
+ * @param amount Monto en pesos.
+ */
+void screen_set_amount(ScreenField field, money_t amount);
+
+/**
+ * @brief Devuelve la última pantalla mostrada.
+ *
+ * @return ID de la pantalla, `SCREEN_NONE` antes de la primera.
+ */
+ScreenId screen_current(void);
+
+#endif // SCREENS_H
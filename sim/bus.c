@@ -0,0 +1,253 @@
+/**
+ * @file bus.c
+ * @brief Bus I2C con el PCF8574 del LCD y el canal DMA que lo alimenta.
+ *
+ * Cada byte ocupa 9 bits en el bus (8 de datos y el ACK) más un byte de dirección por
+ * transacción, a la frecuencia que se pasó a `i2c_init()`. Una ráfaga por DMA llega al
+ * modelo del HD44780 completa, en el instante en que termina de salir por el bus, que es
+ * cuando el firmware recibe `DMA_IRQ_0`.
+ */
+
+#include "sim.h"
+#include "hardware/dma.h"
+#include "hardware/i2c.h"
+#include "hardware/irq.h"
+#include "lcd.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Palabras máximas de una ráfaga por DMA.
+ */
+#define SIM_BURST_MAX 1024
+
+/**
+ * @brief Canal DMA simulado.
+ */
+typedef struct {
+    bool claimed;                   /**< Lo reservó el firmware */
+    enum dma_channel_transfer_size size;    /**< Tamaño de cada transferencia */
+    volatile void *write_addr;      /**< Registro de destino */
+    bool irq0_enabled;              /**< Levanta `DMA_IRQ_0` al terminar */
+    bool irq0_status;               /**< Terminó y no se reconoció la interrupción */
+    uint64_t start_us;              /**< Inicio de la transferencia en curso */
+    uint64_t done_us;               /**< Fin de la transferencia en curso, o `SIM_NEVER` */
+    uint8_t addr;                   /**< Dirección I2C de destino */
+    uint16_t words[SIM_BURST_MAX];  /**< Datos de la transferencia en curso */
+    uint32_t count;                 /**< Palabras en `words` */
+} SimDmaChannel;
+
+i2c_inst_t i2c0_inst, i2c1_inst;
+
+static SimDmaChannel channels[NUM_DMA_CHANNELS];
+static dma_channel_hw_t channel_hw[NUM_DMA_CHANNELS];
+static SimBusStats stats;
+
+/**
+ * @brief Tiempo que tarda en salir una transacción de `count` bytes.
+ */
+static uint64_t transfer_us(const i2c_inst_t *i2c, size_t count) {
+    uint64_t bits = (uint64_t)(count + 1) * 9 + 2;     // Dirección, datos, START y STOP
+    uint baudrate = i2c->baudrate ? i2c->baudrate : 100000;
+    return (bits * 1000000 + baudrate - 1) / baudrate;
+}
+
+/**
+ * @brief Entrega un byte al dispositivo de la dirección indicada.
+ *
+ * @return false si nadie responde en esa dirección.
+ */
+static bool deliver(uint8_t addr, uint8_t data) {
+    if (addr != LCD_ADDRESS) {
+        return false;
+    }
+    hd44780_write(data);
+    stats.bytes++;
+    return true;
+}
+
+/**
+ * @brief Instancia I2C a la que apunta un registro de datos.
+ */
+static i2c_inst_t *i2c_from_data_cmd(volatile void *addr) {
+    return addr == &i2c0_inst.hw.data_cmd ? &i2c0_inst : &i2c1_inst;
+}
+
+uint i2c_init(i2c_inst_t *i2c, uint baudrate) {
+    i2c->baudrate = baudrate;
+    i2c->hw.enable = 1;
+    i2c->hw.status = I2C_IC_STATUS_TFE_BITS;
+    return baudrate;
+}
+
+int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop) {
+    (void)nostop;
+    uint64_t duration = transfer_us(i2c, len);
+    stats.busy_us += duration;
+    sleep_us(duration);
+    for (size_t i = 0; i < len; i++) {
+        if (!deliver(addr, src[i])) {
+            return PICO_ERROR_GENERIC;
+        }
+    }
+    return (int)len;
+}
+
+i2c_hw_t *i2c_get_hw(i2c_inst_t *i2c) {
+    return &i2c->hw;
+}
+
+uint i2c_get_dreq(i2c_inst_t *i2c, bool is_tx) {
+    return (i2c == i2c0 ? 32 : 34) + (is_tx ? 0 : 1);
+}
+
+int dma_claim_unused_channel(bool required) {
+    for (int i = 0; i < NUM_DMA_CHANNELS; i++) {
+        if (!channels[i].claimed) {
+            channels[i].claimed = true;
+            channels[i].done_us = SIM_NEVER;
+            return i;
+        }
+    }
+    if (required) {
+        fprintf(stderr, "sim: no quedan canales DMA\n");
+        abort();
+    }
+    return -1;
+}
+
+dma_channel_config dma_channel_get_default_config(uint channel) {
+    (void)channel;
+    return (dma_channel_config){DMA_SIZE_32};
+}
+
+void channel_config_set_transfer_data_size(dma_channel_config *c, enum dma_channel_transfer_size size) {
+    c->ctrl = size;
+}
+
+void channel_config_set_read_increment(dma_channel_config *c, bool incr) {
+    (void)c;
+    (void)incr;
+}
+
+void channel_config_set_write_increment(dma_channel_config *c, bool incr) {
+    (void)c;
+    (void)incr;
+}
+
+void channel_config_set_dreq(dma_channel_config *c, uint dreq) {
+    (void)c;
+    (void)dreq;
+}
+
+void dma_channel_configure(uint channel, const dma_channel_config *config, volatile void *write_addr,
+                           const volatile void *read_addr, uint transfer_count, bool trigger) {
+    channels[channel].size = (enum dma_channel_transfer_size)config->ctrl;
+    channels[channel].write_addr = write_addr;
+    if (trigger) {
+        dma_channel_transfer_from_buffer_now(channel, read_addr, transfer_count);
+    }
+}
+
+void dma_channel_transfer_from_buffer_now(uint channel, const volatile void *read_addr, uint32_t transfer_count) {
+    SimDmaChannel *ch = &channels[channel];
+    if (sim_stepper_dma(ch->write_addr, read_addr, transfer_count)) {
+        return;     // La FIFO de un motor marca el ritmo; no ocupa el bus I2C
+    }
+    i2c_inst_t *i2c = i2c_from_data_cmd(ch->write_addr);
+
+    ch->count = transfer_count < SIM_BURST_MAX ? transfer_count : SIM_BURST_MAX;
+    for (uint32_t i = 0; i < ch->count; i++) {
+        switch (ch->size) {
+        case DMA_SIZE_8:  ch->words[i] = ((const volatile uint8_t *)read_addr)[i]; break;
+        case DMA_SIZE_16: ch->words[i] = ((const volatile uint16_t *)read_addr)[i]; break;
+        default:          ch->words[i] = (uint16_t)((const volatile uint32_t *)read_addr)[i]; break;
+        }
+    }
+    ch->addr = (uint8_t)i2c->hw.tar;
+    ch->start_us = sim_now_us();
+    ch->done_us = ch->start_us + transfer_us(i2c, ch->count);
+    i2c->hw.status = I2C_IC_STATUS_ACTIVITY_BITS;
+}
+
+void dma_channel_abort(uint channel) {
+    SimDmaChannel *ch = &channels[channel];
+    if (!sim_stepper_dma(ch->write_addr, NULL, 0)) {
+        ch->done_us = SIM_NEVER;
+    }
+}
+
+dma_channel_hw_t *dma_channel_hw_addr(uint channel) {
+    // Solo se lleva la cuenta de las transferencias hacia los motores
+    channel_hw[channel].transfer_count = sim_stepper_dma_remaining(channels[channel].write_addr);
+    return &channel_hw[channel];
+}
+
+bool dma_channel_is_busy(uint channel) {
+    return channels[channel].done_us != SIM_NEVER;
+}
+
+void dma_channel_set_irq0_enabled(uint channel, bool enabled) {
+    channels[channel].irq0_enabled = enabled;
+}
+
+bool dma_channel_get_irq0_status(uint channel) {
+    return channels[channel].irq0_status;
+}
+
+void dma_channel_acknowledge_irq0(uint channel) {
+    channels[channel].irq0_status = false;
+}
+
+void sim_bus_reset(void) {
+    memset(channels, 0, sizeof(channels));
+}
+
+uint64_t sim_bus_next_us(void) {
+    uint64_t next = SIM_NEVER;
+    for (int i = 0; i < NUM_DMA_CHANNELS; i++) {
+        if (channels[i].claimed && channels[i].done_us < next) {
+            next = channels[i].done_us;
+        }
+    }
+    return next;
+}
+
+/**
+ * @brief Termina la transferencia DMA más próxima: entrega los bytes y levanta la interrupción.
+ */
+void sim_bus_run(void) {
+    int next = -1;
+    for (int i = 0; i < NUM_DMA_CHANNELS; i++) {
+        if (!channels[i].claimed || channels[i].done_us == SIM_NEVER) {
+            continue;
+        }
+        if (next < 0 || channels[i].done_us < channels[next].done_us) {
+            next = i;
+        }
+    }
+    if (next < 0) {
+        return;
+    }
+
+    SimDmaChannel *ch = &channels[next];
+    i2c_inst_t *i2c = i2c_from_data_cmd(ch->write_addr);
+    bool acked = true;
+    for (uint32_t i = 0; i < ch->count && acked; i++) {
+        acked = deliver(ch->addr, (uint8_t)ch->words[i]);
+    }
+    stats.bursts++;
+    stats.busy_us += ch->done_us - ch->start_us;
+    ch->done_us = SIM_NEVER;
+    i2c->hw.status = I2C_IC_STATUS_TFE_BITS;
+
+    sim_on_lcd_burst(ch->start_us);
+    if (ch->irq0_enabled) {
+        ch->irq0_status = true;
+        sim_irq_raise(DMA_IRQ_0);
+    }
+}
+
+const SimBusStats *sim_bus_stats(void) {
+    return &stats;
+}
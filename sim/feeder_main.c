@@ -0,0 +1,456 @@
+/**
+ * @file feeder_main.c
+ * @brief Saca retiros con los canales a lazo cerrado y billetes que salen pegados, se
+ * traban o no llegan, y comprueba lo que cobra el diario contra lo que sale.
+ *
+ * Uso: `matecash_feeder [-v]`. Todos los canales tienen barrera (`feeder_model.c`). Cada
+ * caso hace el retiro de 190000 del usuario 123456 (un billete de 100000, uno de 50000
+ * y dos de 20000) con una falla programada y exige:
+ *
+ * - que cada canal entregue lo planeado, o menos si se trabó;
+ * - que el inventario baje exactamente lo que salió por cada barrera, incluidos los
+ *   billetes pegados de más;
+ * - que el saldo baje el valor de los billetes planeados que salieron: los que no
+ *   salieron por una traba se devuelven;
+ * - que un canal trabado no se use en el retiro siguiente;
+ * - que el diario no borre la flash con un motor en marcha: con las interrupciones
+ *   apagadas la barrera mediría mal el billete;
+ * - que con la flash sin responder no salga nada, la pantalla avise que el retiro no
+ *   se hizo y el diario reintente cada vez más espaciado, hasta una vez cada
+ *   `ACCTLOG_RETRY_MAX_MS`; y que cuando la flash vuelve, un reintento la encuentre y
+ *   el cajero vuelva a aceptar retiros;
+ * - que la sesión, que queda abierta en la pantalla del saldo, se cierre sola
+ *   `SESSION_IDLE_MS` después de la última tecla;
+ * - que al volver a arrancar el diario reconstruya el mismo saldo e inventario, sin
+ *   billetes en duda.
+ *
+ * Al final compara la duración del retiro sin fallas, y los billetes por segundo que
+ * salen, con los de los mismos billetes a lazo abierto. `-v` muestra el registro del
+ * firmware.
+ */
+
+#include "sim.h"
+#include "tcl.h"
+#include "events.h"
+#include "timewheel.h"
+#include "iocore.h"
+#include "log.h"
+#include "acctlog.h"
+#include "planner.h"
+#include "screens.h"
+#include "hardware/flash.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Usuario que hace los retiros.
+ */
+#define FEEDER_USER 0
+
+/**
+ * @brief Primer pin de las barreras; una por canal, en orden.
+ */
+#define FEEDER_SENSOR_PIN 10
+
+/**
+ * @brief Geometría del rodillo: pasos hasta la barrera y pasos que tapa un billete.
+ */
+#define FEEDER_LEAD_STEPS 180
+#define FEEDER_NOTE_STEPS 150
+
+/**
+ * @brief Recorrido máximo de un billete con barrera.
+ */
+#define FEEDER_CLOSED_RAMP {512, 400, 2400, 24000}
+
+/**
+ * @brief Rampa de un billete a lazo abierto, la de la tabla sin barreras.
+ */
+#define FEEDER_OPEN_RAMP {400, 400, 2400, 24000}
+
+/**
+ * @brief Borrado de un sector en el peor caso de la hoja de datos de la W25Q16.
+ */
+#define FEEDER_SLOW_ERASE_US 400000
+
+/**
+ * @brief Tiempo que la flash queda sin responder en el caso que la apaga.
+ */
+#define FEEDER_FLASH_DOWN_US 20000000
+
+/**
+ * @brief Sin nada pendiente antes de este lapso, el retiro terminó; lo que queda es la
+ * espera de la sesión y la del reposo.
+ */
+#define FEEDER_QUIET_US 10000000
+
+/**
+ * @brief Caso de prueba.
+ */
+typedef struct {
+    const char *name;
+    unsigned int channel;           /**< Canal con la falla */
+    unsigned int note;              /**< Billete de ese canal que falla */
+    SimFeedFault fault;             /**< Falla */
+    unsigned int delivered[NUM_DENOMINATIONS]; /**< Billetes que tienen que salir por canal */
+    money_t charged;                /**< Saldo que tiene que bajar */
+    bool sector_switch;             /**< La intención abre un sector y el diario quiere borrar otro */
+    bool flash_fails;               /**< La flash no responde desde la confirmación del retiro */
+} FeederCase;
+
+static const FeederCase cases[] = {
+    {"sin fallas", 0, 0, SIM_FEED_OK, {0, 2, 1, 1}, 190000, false, false},
+    {"pegados dentro del retiro", 1, 0, SIM_FEED_DOUBLE, {0, 2, 1, 1}, 190000, false, false},
+    {"pegados de más", 3, 0, SIM_FEED_DOUBLE, {0, 2, 1, 2}, 190000, false, false},
+    {"trabado", 1, 1, SIM_FEED_JAM, {0, 1, 1, 1}, 170000, false, false},
+    {"trabado en el primero", 3, 0, SIM_FEED_JAM, {0, 2, 1, 0}, 90000, false, false},
+    {"caja vacía", 2, 0, SIM_FEED_EMPTY, {0, 2, 0, 1}, 140000, false, false},
+    {"borrado lento durante los billetes", 0, 0, SIM_FEED_OK, {0, 2, 1, 1}, 190000, true, false},
+    {"flash que no responde", 0, 0, SIM_FEED_OK, {0, 0, 0, 0}, 0, false, true},
+};
+
+static User factory_users[NUM_USERS];
+static Denomination factory_denominations[NUM_DENOMINATIONS];
+static bool verbose = false;
+
+/**
+ * @brief Momento de la última tecla del retiro, el '#'.
+ */
+static uint64_t confirm_us = 0;
+
+/**
+ * @brief Sectores borrados con algún motor en marcha.
+ */
+static unsigned int busy_erases = 0;
+
+/*
+ * El simulador espera estos ganchos de `sim_main.c`; aquí no hay guion ni reporte.
+ */
+
+uint64_t sim_script_next_us(void) {
+    return SIM_NEVER;
+}
+
+void sim_script_run(void) {
+}
+
+void sim_on_lcd_burst(uint64_t start_us) {
+    (void)start_us;
+}
+
+void sim_on_gpio(unsigned int gpio, bool value) {
+    (void)gpio;
+    (void)value;
+}
+
+void sim_finish(void) {
+    fprintf(stderr, "feeder: el firmware quedó esperando sin eventos\n");
+    exit(1);
+}
+
+/**
+ * @brief Atiende los eventos pendientes como el lazo principal de `main.c`.
+ */
+static void service_events(void) {
+    bool dispensing = dispenser_busy();
+    uint32_t erases = sim_flash_stats()->erases;
+    uint32_t events = events_take();
+    if ((events & EVENT_TIMEOUT) && input_timed_out()) {
+        handle_timeout();
+    }
+    if (events & EVENT_MOTOR_DONE) {
+        handle_dispense_done();
+    }
+    iocore_lcd_flush();
+    while (acctlog_service()) {
+    }
+    log_drain();
+    if (dispensing && sim_flash_stats()->erases != erases) {
+        busy_erases++;
+    }
+}
+
+/**
+ * @brief Corre el simulador hasta que no quede nada pendiente en `FEEDER_QUIET_US`.
+ *
+ * @return Momento en que el dispensador terminó su último billete.
+ */
+static uint64_t run_to_idle(void) {
+    uint64_t done_us = sim_now_us();
+    while (sim_next_us() < sim_now_us() + FEEDER_QUIET_US) {
+        uint64_t motor_us = sim_stepper_next_us();
+        if (!sim_step()) {
+            break;
+        }
+        service_events();
+        // Solo cuentan los pasos: en el descanso despiertan otros temporizadores
+        if (sim_now_us() == motor_us) {
+            done_us = motor_us;
+        }
+    }
+    return done_us;
+}
+
+/**
+ * @brief Corre el simulador durante un tiempo, aunque quede algo pendiente.
+ */
+static void run_for(uint64_t us) {
+    uint64_t end_us = sim_now_us() + us;
+    while (sim_next_us() <= end_us && sim_step()) {
+        service_events();
+    }
+    sim_run_until(end_us);
+}
+
+/**
+ * @brief Reintentos que hace el diario en un lapso tras un primer fallo, según la espera
+ * de `acctlog_service()`.
+ */
+static uint32_t expected_retries(uint64_t us) {
+    uint32_t retries = 0;
+    uint64_t wait_ms = ACCTLOG_RETRY_MS, at_us = wait_ms * 1000;
+    while (at_us <= us) {
+        retries++;
+        wait_ms = wait_ms * 2 < ACCTLOG_RETRY_MAX_MS ? wait_ms * 2 : ACCTLOG_RETRY_MAX_MS;
+        at_us += wait_ms * 1000;
+    }
+    return retries;
+}
+
+/**
+ * @brief Arranca como `main.c`, con la RAM en los valores de fábrica y la flash como esté.
+ *
+ * @param closed_loop Con las barreras de los canales.
+ */
+static void boot(bool closed_loop) {
+    memcpy(users, factory_users, sizeof(users));
+    memcpy(denominations, factory_denominations, sizeof(denominations));
+    for (unsigned int i = 0; i < NUM_DENOMINATIONS; i++) {
+        if (!closed_loop) {
+            denominations[i].ramp = (RampProfile)FEEDER_OPEN_RAMP;
+            denominations[i].sensor = (NoteSensor){-1, 0};
+            continue;
+        }
+        denominations[i].ramp = (RampProfile)FEEDER_CLOSED_RAMP;
+        denominations[i].sensor = (NoteSensor){(int8_t)(FEEDER_SENSOR_PIN + i), FEEDER_NOTE_STEPS};
+        sim_feeder_attach((unsigned int)denominations[i].pinselect, FEEDER_SENSOR_PIN + i, FEEDER_LEAD_STEPS,
+                          FEEDER_NOTE_STEPS);
+    }
+    log_init();
+    events_init();
+    timewheel_init();
+    iocore_init();
+    acctlog_init(users, NUM_USERS, denominations, NUM_DENOMINATIONS);
+    build_user_index();
+    init_transitions();
+    planner_invalidate();
+    reset_state();
+    service_events();
+}
+
+/**
+ * @brief Llena el sector del diario en curso con el siguiente ya borrado: el próximo
+ * registro abre un sector nuevo y el diario queda con otro por borrar.
+ */
+static void fill_journal_sector(void) {
+    uint32_t erases = sim_flash_stats()->erases;
+    while (sim_flash_stats()->erases == erases) {
+        acctlog_update_user(FEEDER_USER);
+        acctlog_service();
+    }
+    // El cambio de sector dejó la cabecera y un registro
+    for (unsigned int slot = 2; slot < FLASH_SECTOR_SIZE / ACCTLOG_RECORD_SIZE; slot++) {
+        acctlog_update_user(FEEDER_USER);
+    }
+    acctlog_sync();
+}
+
+/**
+ * @brief Entrega una tecla y atiende lo que dispare.
+ */
+static void press(char key) {
+    process_key(key);
+    service_events();
+}
+
+/**
+ * @brief Hace el retiro de 190000 desde una flash nueva.
+ *
+ * @return Duración desde el '#' hasta que el dispensador terminó, en microsegundos.
+ */
+static uint64_t withdraw(bool closed_loop, const FeederCase *c) {
+    sim_reset();
+    boot(closed_loop);
+    if (c) {
+        sim_feeder_fault((unsigned int)denominations[c->channel].pinselect, c->note, c->fault);
+    }
+    for (const char *k = "123456" "1234" "A*" "190000"; *k; k++) {
+        press(*k);
+    }
+    if (c && c->sector_switch) {
+        sim_flash_set_erase_us(FEEDER_SLOW_ERASE_US);
+        fill_journal_sector();
+    }
+    run_to_idle();
+    if (c && c->flash_fails) {
+        sim_flash_set_failing(true);
+    }
+    busy_erases = 0;
+    uint64_t start_us = sim_now_us();
+    confirm_us = start_us;
+    press('#');
+    if (c && c->flash_fails) {
+        // Mientras la flash no responda, el diario tiene un reintento pendiente
+        run_for(FEEDER_FLASH_DOWN_US);
+        return sim_now_us() - start_us;
+    }
+    return run_to_idle() - start_us;
+}
+
+/**
+ * @brief Billetes que el último retiro descontó del inventario.
+ */
+static unsigned int notes_dispensed(void) {
+    unsigned int notes = 0;
+    for (unsigned int i = 0; i < NUM_DENOMINATIONS; i++) {
+        notes += (unsigned int)(factory_denominations[i].quantity - denominations[i].quantity);
+    }
+    return notes;
+}
+
+/**
+ * @brief Revisa un caso.
+ *
+ * @return Cantidad de problemas encontrados.
+ */
+static unsigned int check_case(const FeederCase *c) {
+    unsigned int problems = 0;
+    withdraw(true, c);
+
+    for (unsigned int i = 0; i < NUM_DENOMINATIONS; i++) {
+        unsigned int out = sim_feeder_notes((unsigned int)denominations[i].pinselect);
+        int logged = factory_denominations[i].quantity - denominations[i].quantity;
+        if (out != c->delivered[i]) {
+            fprintf(stderr, "%s: canal %u entregó %u billetes, se esperaban %u\n", c->name, i, out,
+                    c->delivered[i]);
+            problems++;
+        }
+        if (logged != (int)out) {
+            fprintf(stderr, "%s: canal %u descontó %d billetes del inventario y salieron %u\n", c->name, i,
+                    logged, out);
+            problems++;
+        }
+    }
+    if (busy_erases > 0) {
+        fprintf(stderr, "%s: el diario borró %u sectores con motores en marcha\n", c->name, busy_erases);
+        problems++;
+    }
+    ScreenId screen = c->flash_fails ? SCREEN_WITHDRAW_FAILED : SCREEN_BALANCE;
+    if (screen_current() != screen) {
+        fprintf(stderr, "%s: quedó la pantalla %d, se esperaba %d\n", c->name, (int)screen_current(), (int)screen);
+        problems++;
+    }
+    // Un intento al confirmar y uno por reintento; un reintento puede tocar la flash dos veces
+    uint32_t attempts = c->flash_fails ? 1 + expected_retries(FEEDER_FLASH_DOWN_US) : 0;
+    uint32_t errors = acctlog_flash_errors();
+    if (errors < attempts || errors > 2 * attempts) {
+        fprintf(stderr, "%s: %lu fallos de la flash, se esperaban entre %lu y %lu\n", c->name, (unsigned long)errors,
+                (unsigned long)attempts, (unsigned long)(2 * attempts));
+        problems++;
+    }
+    if (c->flash_fails) {
+        sim_flash_set_failing(false);
+        run_for((uint64_t)ACCTLOG_RETRY_MAX_MS * 1000);
+        if (!acctlog_withdraw_ready() || acctlog_flash_errors() != errors) {
+            fprintf(stderr, "%s: con la flash de vuelta, %s y %lu fallos más\n", c->name,
+                    acctlog_withdraw_ready() ? "acepta retiros" : "no acepta retiros",
+                    (unsigned long)(acctlog_flash_errors() - errors));
+            problems++;
+        }
+        run_to_idle();
+    }
+    money_t charged = factory_users[FEEDER_USER].balance - users[FEEDER_USER].balance;
+    if (charged != c->charged) {
+        fprintf(stderr, "%s: se cobraron %lld, se esperaban %lld\n", c->name, (long long)charged,
+                (long long)c->charged);
+        problems++;
+    }
+
+    // Con un canal trabado, el siguiente retiro se arma con los demás
+    if (c->fault == SIM_FEED_JAM || c->fault == SIM_FEED_EMPTY) {
+        unsigned int stuck_before = sim_feeder_notes((unsigned int)denominations[c->channel].pinselect);
+        money_t value = denominations[c->channel].amount;
+        money_t balance = users[FEEDER_USER].balance;
+        if (!withdraw_money(value)) {
+            fprintf(stderr, "%s: no se pudo retirar %lld sin el canal %u\n", c->name, (long long)value, c->channel);
+            problems++;
+        }
+        run_to_idle();
+        if (sim_feeder_notes((unsigned int)denominations[c->channel].pinselect) != stuck_before ||
+            users[FEEDER_USER].balance != balance - value) {
+            fprintf(stderr, "%s: el retiro siguiente usó el canal trabado o cobró mal\n", c->name);
+            problems++;
+        }
+    }
+
+    // Sin más teclas, la sesión se cierra sola
+    while (sim_step()) {
+        service_events();
+    }
+    if (screen_current() != SCREEN_WELCOME || current_user != NULL ||
+        sim_now_us() < confirm_us + (uint64_t)SESSION_IDLE_MS * 1000) {
+        fprintf(stderr, "%s: la sesión quedó en la pantalla %d %.1f s después del '#'\n", c->name,
+                (int)screen_current(), (double)(sim_now_us() - confirm_us) / 1e6);
+        problems++;
+    }
+
+    // El diario reconstruye lo mismo que quedó en RAM
+    money_t balance = users[FEEDER_USER].balance;
+    int quantity[NUM_DENOMINATIONS];
+    for (unsigned int i = 0; i < NUM_DENOMINATIONS; i++) {
+        quantity[i] = denominations[i].quantity;
+    }
+    sim_reboot();
+    boot(true);
+    for (unsigned int i = 0; i < NUM_DENOMINATIONS; i++) {
+        if (denominations[i].quantity != quantity[i]) {
+            fprintf(stderr, "%s: al arrancar, el canal %u tiene %d billetes y tenía %d\n", c->name, i,
+                    denominations[i].quantity, quantity[i]);
+            problems++;
+        }
+    }
+    if (users[FEEDER_USER].balance != balance || acctlog_get_stats()->notes_in_doubt != 0) {
+        fprintf(stderr, "%s: al arrancar, saldo %lld (tenía %lld) y %lu billetes en duda\n", c->name,
+                (long long)users[FEEDER_USER].balance, (long long)balance,
+                (unsigned long)acctlog_get_stats()->notes_in_doubt);
+        problems++;
+    }
+
+    fprintf(stderr, "%s: %s\n", c->name, problems ? "falló" : "bien");
+    return problems;
+}
+
+int main(int argc, char **argv) {
+    verbose = argc > 1 && strcmp(argv[1], "-v") == 0;
+    if (!verbose && !freopen("/dev/null", "w", stdout)) {
+        perror("/dev/null");
+    }
+    memcpy(factory_users, users, sizeof(users));
+    memcpy(factory_denominations, denominations, sizeof(denominations));
+
+    unsigned int problems = 0;
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        problems += check_case(&cases[i]);
+    }
+
+    uint64_t open_us = withdraw(false, NULL);
+    unsigned int open_notes = notes_dispensed();
+    uint64_t closed_us = withdraw(true, NULL);
+    unsigned int closed_notes = notes_dispensed();
+    fprintf(stderr, "retiro de 190000: %.1f ms a lazo abierto, %.1f ms con barreras\n", open_us / 1000.0,
+            closed_us / 1000.0);
+    fprintf(stderr, "billetes por segundo: %.2f a lazo abierto (%u billetes), %.2f con barreras (%u billetes)\n",
+            open_notes * 1e6 / (double)open_us, open_notes, closed_notes * 1e6 / (double)closed_us, closed_notes);
+    fprintf(stderr, "problemas: %u\n", problems);
+    return problems ? 1 : 0;
+}
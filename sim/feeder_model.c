@@ -0,0 +1,137 @@
+/**
+ * @file feeder_model.c
+ * @brief Modelo de los rodillos que empujan los billetes y de las barreras ópticas a la
+ * salida de cada uno.
+ *
+ * El rodillo avanza un paso con cada pulso STEP de su motor (`stepper_model.c`). El
+ * siguiente billete está en la boca del rodillo: llega a la barrera `lead_steps` pasos
+ * después de que el anterior la dejó libre, la tapa mientras avanza `note_steps` pasos y
+ * sale. Los pasos que da el motor al frenar después del borde trasero ya acercan el
+ * billete siguiente. Las fallas se programan por número de billete.
+ */
+
+#include "sim.h"
+
+/**
+ * @brief Rodillos con barrera que se pueden simular.
+ */
+#define SIM_FEEDERS 4
+
+/**
+ * @brief Fallas programadas por rodillo.
+ */
+#define SIM_FEEDER_FAULTS 8
+
+/**
+ * @brief Falla programada para un billete.
+ */
+typedef struct {
+    unsigned int note;      /**< Número del billete, desde 0 */
+    SimFeedFault fault;     /**< Qué le pasa */
+} SimFeederFault;
+
+/**
+ * @brief Rodillo con su barrera.
+ */
+typedef struct {
+    bool attached;              /**< Tiene barrera */
+    unsigned int step_pin;      /**< Pin STEP de su motor */
+    unsigned int sensor_pin;    /**< Pin de la barrera */
+    unsigned int lead_steps;    /**< Pasos de la boca del rodillo a la barrera */
+    unsigned int note_steps;    /**< Pasos que tapa un billete */
+    unsigned int note;          /**< Billete que está en camino */
+    unsigned int travel;        /**< Pasos que avanzó ese billete */
+    bool stuck;                 /**< Hay un billete trabado en la barrera */
+    unsigned int notes_out;     /**< Billetes que salieron enteros */
+    SimFeederFault faults[SIM_FEEDER_FAULTS];
+    unsigned int fault_count;
+} SimFeeder;
+
+static SimFeeder feeders[SIM_FEEDERS];
+
+/**
+ * @brief Rodillo del motor de `step_pin`, o NULL si no tiene barrera.
+ */
+static SimFeeder *find_feeder(unsigned int step_pin) {
+    for (int i = 0; i < SIM_FEEDERS; i++) {
+        if (feeders[i].attached && feeders[i].step_pin == step_pin) {
+            return &feeders[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Falla programada para el billete en camino.
+ */
+static SimFeedFault current_fault(const SimFeeder *f) {
+    for (unsigned int i = 0; i < f->fault_count; i++) {
+        if (f->faults[i].note == f->note) {
+            return f->faults[i].fault;
+        }
+    }
+    return SIM_FEED_OK;
+}
+
+void sim_feeder_attach(unsigned int step_pin, unsigned int sensor_pin, unsigned int lead_steps,
+                       unsigned int note_steps) {
+    SimFeeder *f = find_feeder(step_pin);
+    for (int i = 0; i < SIM_FEEDERS && !f; i++) {
+        if (!feeders[i].attached) {
+            f = &feeders[i];
+        }
+    }
+    if (!f) {
+        return;
+    }
+    *f = (SimFeeder){0};
+    f->attached = true;
+    f->step_pin = step_pin;
+    f->sensor_pin = sensor_pin;
+    f->lead_steps = lead_steps;
+    f->note_steps = note_steps;
+    sim_gpio_input(sensor_pin, false);
+}
+
+void sim_feeder_fault(unsigned int step_pin, unsigned int note, SimFeedFault fault) {
+    SimFeeder *f = find_feeder(step_pin);
+    if (f && f->fault_count < SIM_FEEDER_FAULTS) {
+        f->faults[f->fault_count++] = (SimFeederFault){note, fault};
+    }
+}
+
+unsigned int sim_feeder_notes(unsigned int step_pin) {
+    SimFeeder *f = find_feeder(step_pin);
+    return f ? f->notes_out : 0;
+}
+
+void sim_feeder_step(unsigned int step_pin) {
+    SimFeeder *f = find_feeder(step_pin);
+    if (!f || f->stuck) {
+        return;
+    }
+    SimFeedFault fault = current_fault(f);
+    if (fault == SIM_FEED_EMPTY) {
+        return;     // El rodillo gira en vacío
+    }
+
+    // Dos billetes pegados, corridos un cuarto de largo, tapan la barrera 1,75 billetes
+    unsigned int covered = fault == SIM_FEED_DOUBLE ? f->note_steps * 7 / 4 : f->note_steps;
+    f->travel++;
+    if (f->travel == f->lead_steps) {
+        sim_gpio_input(f->sensor_pin, true);
+        f->stuck = fault == SIM_FEED_JAM;
+    } else if (f->travel == f->lead_steps + covered) {
+        sim_gpio_input(f->sensor_pin, false);
+        unsigned int notes = fault == SIM_FEED_DOUBLE ? 2 : 1;
+        f->notes_out += notes;
+        f->note += notes;
+        f->travel = 0;
+    }
+}
+
+void sim_feeder_reset(void) {
+    for (int i = 0; i < SIM_FEEDERS; i++) {
+        feeders[i] = (SimFeeder){0};
+    }
+}
@@ -0,0 +1,946 @@
+/**
+ * @file hal.c
+ * @brief Reloj virtual, planificador de eventos y la parte de la HAL que no es de un
+ * periférico en particular: alarmas, interrupciones, sincronización, núcleos, GPIO, consola
+ * y flash.
+ */
+
+#include "sim.h"
+#include "logdecode.h"
+#include "pico/stdlib.h"
+#include "pico/flash.h"
+#include "pico/multicore.h"
+#include "pico/util/queue.h"
+#include "hardware/clocks.h"
+#include "hardware/flash.h"
+#include "hardware/irq.h"
+#include "hardware/structs/scb.h"
+#include <stdlib.h>
+#include <string.h>
+#include <ucontext.h>
+
+/**
+ * @brief Alarmas activas a la vez, sumando todos los grupos.
+ */
+#define SIM_ALARMS 32
+
+/**
+ * @brief Alarmas de hardware del RP2040; el grupo por defecto del SDK usa la última.
+ */
+#define SIM_HARDWARE_ALARMS 4
+
+/**
+ * @brief Tiempos típicos de la flash W25Q16 de la Pico, en microsegundos.
+ */
+#define SIM_FLASH_ERASE_US   45000
+#define SIM_FLASH_PROGRAM_US 400
+
+/**
+ * @brief Capacidad de la entrada de la consola.
+ */
+#define SIM_CONSOLE_SIZE 64
+
+/**
+ * @brief Pila de la corrutina del núcleo 1, en bytes.
+ */
+#define SIM_CORE1_STACK (256 * 1024)
+
+/**
+ * @brief Palabras de cada FIFO del SIO entre núcleos, como en el RP2040.
+ */
+#define SIM_FIFO_SIZE 8
+
+/**
+ * @brief Alarma programada.
+ */
+typedef struct {
+    alarm_id_t id;              /**< 0 si el lugar está libre */
+    uint64_t target_us;         /**< Momento en que dispara */
+    alarm_callback_t callback;  /**< Función a llamar */
+    void *user_data;            /**< Argumento de la función */
+} SimAlarm;
+
+/**
+ * @brief Grupo de alarmas; todos comparten la misma lista.
+ */
+struct alarm_pool {
+    int unused;
+};
+
+uint8_t sim_flash_memory[PICO_FLASH_SIZE_BYTES];
+
+static uint64_t now_us = 0;
+static SimAlarm alarms[SIM_ALARMS];
+static alarm_id_t next_alarm_id = 1;
+static struct alarm_pool default_pool;
+static uint32_t hardware_alarms_claimed = 1u << (SIM_HARDWARE_ALARMS - 1);
+static hardware_alarm_callback_t hardware_alarm_callbacks[SIM_HARDWARE_ALARMS];
+static alarm_id_t hardware_alarm_ids[SIM_HARDWARE_ALARMS];
+
+static irq_handler_t irq_handlers[NUM_IRQS][4];
+static uint32_t irq_enabled = 0;
+static uint32_t irq_pending = 0;
+static bool irq_masked = false;
+
+// Cada núcleo tiene su aviso de `__sev()` y su máscara de interrupciones
+static unsigned int current_core = 0;
+static bool core_event[2];
+static bool core_irq_masked[2];
+static bool core1_launched = false;
+static bool core1_deferred = false;
+static void (*core1_entry)(void);
+static ucontext_t core_context[2];
+static uint8_t core1_stack[SIM_CORE1_STACK];
+static uint32_t core_fifo[2][SIM_FIFO_SIZE];   // Indexada por el núcleo que lee
+static unsigned int core_fifo_head[2];
+static unsigned int core_fifo_count[2];
+
+static spin_lock_t spin_locks[32];
+static unsigned int next_spin_lock = 16;
+
+static bool gpio_level[NUM_BANK0_GPIOS];
+static uint32_t gpio_irq_mask[NUM_BANK0_GPIOS];
+static uint32_t gpio_irq_edges[NUM_BANK0_GPIOS];
+static gpio_irq_callback_t gpio_callback = NULL;
+static gpio_raw_irq_handler_t gpio_raw_handlers[4];
+static uint32_t gpio_raw_masks[4];
+
+clocks_hw_t sim_clocks_hw = {~0u, ~0u};
+armv6m_scb_hw_t sim_scb_hw;
+static SimPowerStats power_stats;
+
+static char console[SIM_CONSOLE_SIZE];
+static unsigned int console_head = 0;
+static unsigned int console_tail = 0;
+static void (*console_callback)(void *) = NULL;
+static void *console_param = NULL;
+static LogDecoder console_decoder;
+
+static SimFlashStats flash_stats;
+static uint64_t flash_erase_us = SIM_FLASH_ERASE_US;
+static bool flash_failing = false;
+
+/*
+ * Reloj y planificador
+ */
+
+uint64_t sim_now_us(void) {
+    return now_us;
+}
+
+void sim_stall_us(uint64_t us) {
+    // El hardware sigue andando; sus interrupciones quedan pendientes hasta el final
+    uint64_t target_us = now_us + us;
+    uint32_t status = save_and_disable_interrupts();
+    while (true) {
+        uint64_t bus_us = sim_bus_next_us();
+        uint64_t keypad_us = sim_keypad_next_us();
+        uint64_t stepper_us = sim_stepper_next_us();
+        uint64_t next = bus_us;
+        if (keypad_us < next) next = keypad_us;
+        if (stepper_us < next) next = stepper_us;
+        if (next > target_us) {
+            break;
+        }
+        if (next > now_us) {
+            now_us = next;
+        }
+        if (next == bus_us) {
+            sim_bus_run();
+        } else if (next == keypad_us) {
+            sim_keypad_run();
+        } else {
+            sim_stepper_run();
+        }
+    }
+    now_us = target_us;
+    restore_interrupts(status);
+}
+
+/**
+ * @brief Lugar de la próxima alarma a disparar, -1 si no hay.
+ */
+static int next_alarm(void) {
+    int next = -1;
+    for (int i = 0; i < SIM_ALARMS; i++) {
+        if (alarms[i].id != 0 && (next < 0 || alarms[i].target_us < alarms[next].target_us)) {
+            next = i;
+        }
+    }
+    return next;
+}
+
+/**
+ * @brief Dispara una alarma y la reprograma según lo que devuelva su función.
+ */
+static void fire_alarm(int slot) {
+    SimAlarm *alarm = &alarms[slot];
+    alarm_id_t id = alarm->id;
+    int64_t result = alarm->callback(id, alarm->user_data);
+
+    if (alarm->id != id) {
+        return;                                 // Se canceló durante la llamada
+    }
+    if (result == 0) {
+        alarm->id = 0;
+    } else if (result < 0) {
+        alarm->target_us -= (uint64_t)result;     // Relativo al disparo anterior
+    } else {
+        alarm->target_us = now_us + (uint64_t)result;
+    }
+}
+
+bool sim_step(void) {
+    int alarm = next_alarm();
+    uint64_t alarm_us = alarm >= 0 ? alarms[alarm].target_us : SIM_NEVER;
+    uint64_t bus_us = sim_bus_next_us();
+    uint64_t keypad_us = sim_keypad_next_us();
+    uint64_t stepper_us = sim_stepper_next_us();
+    uint64_t script_us = sim_script_next_us();
+
+    uint64_t next = alarm_us;
+    if (bus_us < next) next = bus_us;
+    if (keypad_us < next) next = keypad_us;
+    if (stepper_us < next) next = stepper_us;
+    if (script_us < next) next = script_us;
+    if (next == SIM_NEVER) {
+        return false;
+    }
+
+    if (next > now_us) {
+        now_us = next;
+    }
+    // Ante un empate, primero el hardware y al final el guion
+    if (next == bus_us) {
+        sim_bus_run();
+    } else if (next == keypad_us) {
+        sim_keypad_run();
+    } else if (next == stepper_us) {
+        sim_stepper_run();
+    } else if (next == alarm_us) {
+        fire_alarm(alarm);
+    } else {
+        sim_script_run();
+    }
+    return true;
+}
+
+uint64_t sim_next_us(void) {
+    int alarm = next_alarm();
+    uint64_t next = alarm >= 0 ? alarms[alarm].target_us : SIM_NEVER;
+    uint64_t other;
+    if ((other = sim_bus_next_us()) < next) next = other;
+    if ((other = sim_keypad_next_us()) < next) next = other;
+    if ((other = sim_stepper_next_us()) < next) next = other;
+    if ((other = sim_script_next_us()) < next) next = other;
+    return next;
+}
+
+void sim_run_until(uint64_t target_us) {
+    while (sim_next_us() <= target_us) {
+        sim_step();
+    }
+    if (target_us > now_us) {
+        now_us = target_us;
+    }
+}
+
+void sim_reset(void) {
+    sim_reboot();
+    memset(sim_flash_memory, 0xFF, sizeof(sim_flash_memory));
+    memset(&flash_stats, 0, sizeof(flash_stats));
+    flash_erase_us = SIM_FLASH_ERASE_US;
+    flash_failing = false;
+    memset(&power_stats, 0, sizeof(power_stats));
+}
+
+void sim_reboot(void) {
+    now_us = 0;
+    memset(alarms, 0, sizeof(alarms));
+    hardware_alarms_claimed = 1u << (SIM_HARDWARE_ALARMS - 1);
+    memset(hardware_alarm_callbacks, 0, sizeof(hardware_alarm_callbacks));
+    memset(hardware_alarm_ids, 0, sizeof(hardware_alarm_ids));
+    next_spin_lock = 16;
+    memset(gpio_irq_mask, 0, sizeof(gpio_irq_mask));
+    memset(gpio_irq_edges, 0, sizeof(gpio_irq_edges));
+    memset(gpio_raw_handlers, 0, sizeof(gpio_raw_handlers));
+    current_core = 0;
+    memset(core_event, 0, sizeof(core_event));
+    memset(core_irq_masked, 0, sizeof(core_irq_masked));
+    core1_launched = false;
+    core1_deferred = false;
+    memset(core_fifo_count, 0, sizeof(core_fifo_count));
+    sim_bus_reset();
+    sim_stepper_reset();
+    sim_feeder_reset();
+}
+
+/*
+ * Tiempo
+ */
+
+uint64_t time_us_64(void) {
+    return now_us;
+}
+
+uint32_t time_us_32(void) {
+    return (uint32_t)now_us;
+}
+
+absolute_time_t get_absolute_time(void) {
+    return now_us;
+}
+
+int64_t absolute_time_diff_us(absolute_time_t from, absolute_time_t to) {
+    return (int64_t)(to - from);
+}
+
+absolute_time_t make_timeout_time_us(uint64_t us) {
+    return now_us + us;
+}
+
+absolute_time_t make_timeout_time_ms(uint32_t ms) {
+    return now_us + (uint64_t)ms * 1000;
+}
+
+absolute_time_t delayed_by_us(absolute_time_t t, uint64_t us) {
+    return t + us;
+}
+
+absolute_time_t delayed_by_ms(absolute_time_t t, uint32_t ms) {
+    return t + (uint64_t)ms * 1000;
+}
+
+uint64_t to_us_since_boot(absolute_time_t t) {
+    return t;
+}
+
+absolute_time_t from_us_since_boot(uint64_t us) {
+    return us;
+}
+
+uint32_t to_ms_since_boot(absolute_time_t t) {
+    return (uint32_t)(t / 1000);
+}
+
+void sleep_us(uint64_t us) {
+    sim_run_until(now_us + us);
+}
+
+void sleep_ms(uint32_t ms) {
+    sleep_us((uint64_t)ms * 1000);
+}
+
+void tight_loop_contents(void) {
+    if (!sim_step()) {
+        now_us++;
+    }
+}
+
+uint32_t clock_get_hz(enum clock_index clock) {
+    return clock == clk_usb ? 48000000 : 125000000;
+}
+
+uint get_core_num(void) {
+    return current_core;
+}
+
+/*
+ * Núcleos
+ */
+
+/**
+ * @brief Pasa el procesador del host a otro núcleo; vuelve cuando alguien lo devuelve.
+ */
+static void switch_core(unsigned int core) {
+    unsigned int from = current_core;
+    core_irq_masked[from] = irq_masked;
+    irq_masked = core_irq_masked[core];
+    current_core = core;
+    swapcontext(&core_context[from], &core_context[core]);
+}
+
+/**
+ * @brief Deja correr al núcleo 1 hasta que vuelva a dormir en `__wfe()`.
+ *
+ * Si el núcleo 0 tiene las interrupciones deshabilitadas (quizá con un spinlock tomado),
+ * espera a que `restore_interrupts()` las habilite.
+ */
+static void run_core1(void) {
+    if (current_core != 0 || !core1_launched) {
+        return;
+    }
+    if (irq_masked) {
+        core1_deferred = true;
+        return;
+    }
+    core1_deferred = false;
+    switch_core(1);
+}
+
+static void core1_start(void) {
+    core1_entry();
+    while (true) {
+        __wfe();
+    }
+}
+
+void multicore_launch_core1(void (*entry)(void)) {
+    core1_entry = entry;
+    getcontext(&core_context[1]);
+    core_context[1].uc_stack.ss_sp = core1_stack;
+    core_context[1].uc_stack.ss_size = sizeof(core1_stack);
+    core_context[1].uc_link = NULL;
+    makecontext(&core_context[1], core1_start, 0);
+    core_event[1] = false;
+    core_irq_masked[1] = false;
+    core1_launched = true;
+    run_core1();
+}
+
+void multicore_fifo_push_blocking(uint32_t data) {
+    unsigned int reader = 1 - current_core;
+    while (core_fifo_count[reader] == SIM_FIFO_SIZE) {
+        __wfe();
+    }
+    core_fifo[reader][(core_fifo_head[reader] + core_fifo_count[reader]) % SIM_FIFO_SIZE] = data;
+    core_fifo_count[reader]++;
+    __sev();
+}
+
+uint32_t multicore_fifo_pop_blocking(void) {
+    unsigned int reader = current_core;
+    while (core_fifo_count[reader] == 0) {
+        __wfe();
+    }
+    uint32_t data = core_fifo[reader][core_fifo_head[reader]];
+    core_fifo_head[reader] = (core_fifo_head[reader] + 1) % SIM_FIFO_SIZE;
+    core_fifo_count[reader]--;
+    __sev();
+    return data;
+}
+
+/*
+ * Colas entre núcleos
+ */
+
+void queue_init(queue_t *q, uint element_size, uint element_count) {
+    q->data = calloc(element_count + 1, element_size);
+    q->element_size = element_size;
+    q->element_count = element_count;
+    q->rptr = 0;
+    q->wptr = 0;
+}
+
+bool queue_is_empty(queue_t *q) {
+    return q->rptr == q->wptr;
+}
+
+bool queue_try_add(queue_t *q, const void *data) {
+    uint next = (q->wptr + 1) % (q->element_count + 1);
+    if (next == q->rptr) {
+        return false;
+    }
+    memcpy(q->data + q->wptr * q->element_size, data, q->element_size);
+    q->wptr = next;
+    __sev();
+    return true;
+}
+
+bool queue_try_remove(queue_t *q, void *data) {
+    if (queue_is_empty(q)) {
+        return false;
+    }
+    memcpy(data, q->data + q->rptr * q->element_size, q->element_size);
+    q->rptr = (q->rptr + 1) % (q->element_count + 1);
+    __sev();
+    return true;
+}
+
+void queue_add_blocking(queue_t *q, const void *data) {
+    while (!queue_try_add(q, data)) {
+        __wfe();
+    }
+}
+
+void queue_remove_blocking(queue_t *q, void *data) {
+    while (!queue_try_remove(q, data)) {
+        __wfe();
+    }
+}
+
+/*
+ * Alarmas
+ */
+
+alarm_id_t alarm_pool_add_alarm_at(alarm_pool_t *pool, absolute_time_t time, alarm_callback_t callback,
+                                   void *user_data, bool fire_if_past) {
+    (void)pool;
+    if (time <= now_us && !fire_if_past) {
+        return 0;
+    }
+    for (int i = 0; i < SIM_ALARMS; i++) {
+        if (alarms[i].id == 0) {
+            alarms[i] = (SimAlarm){next_alarm_id, time > now_us ? time : now_us, callback, user_data};
+            if (++next_alarm_id <= 0) {
+                next_alarm_id = 1;
+            }
+            return alarms[i].id;
+        }
+    }
+    return -1;
+}
+
+alarm_id_t alarm_pool_add_alarm_in_us(alarm_pool_t *pool, uint64_t us, alarm_callback_t callback,
+                                      void *user_data, bool fire_if_past) {
+    return alarm_pool_add_alarm_at(pool, now_us + us, callback, user_data, fire_if_past);
+}
+
+alarm_id_t alarm_pool_add_alarm_in_ms(alarm_pool_t *pool, uint32_t ms, alarm_callback_t callback,
+                                      void *user_data, bool fire_if_past) {
+    return alarm_pool_add_alarm_at(pool, now_us + (uint64_t)ms * 1000, callback, user_data, fire_if_past);
+}
+
+bool alarm_pool_cancel_alarm(alarm_pool_t *pool, alarm_id_t id) {
+    (void)pool;
+    for (int i = 0; i < SIM_ALARMS; i++) {
+        if (id > 0 && alarms[i].id == id) {
+            alarms[i].id = 0;
+            return true;
+        }
+    }
+    return false;
+}
+
+alarm_id_t add_alarm_at(absolute_time_t time, alarm_callback_t callback, void *user_data, bool fire_if_past) {
+    return alarm_pool_add_alarm_at(&default_pool, time, callback, user_data, fire_if_past);
+}
+
+alarm_id_t add_alarm_in_us(uint64_t us, alarm_callback_t callback, void *user_data, bool fire_if_past) {
+    return alarm_pool_add_alarm_in_us(&default_pool, us, callback, user_data, fire_if_past);
+}
+
+alarm_id_t add_alarm_in_ms(uint32_t ms, alarm_callback_t callback, void *user_data, bool fire_if_past) {
+    return alarm_pool_add_alarm_in_ms(&default_pool, ms, callback, user_data, fire_if_past);
+}
+
+bool cancel_alarm(alarm_id_t id) {
+    return alarm_pool_cancel_alarm(&default_pool, id);
+}
+
+/**
+ * @brief Dispara una alarma de hardware: se desarma y llama a su función.
+ */
+static int64_t hardware_alarm_fire(alarm_id_t id, void *user_data) {
+    (void)id;
+    uint alarm_num = (uint)(uintptr_t)user_data;
+    hardware_alarm_ids[alarm_num] = 0;
+    if (hardware_alarm_callbacks[alarm_num]) {
+        hardware_alarm_callbacks[alarm_num](alarm_num);
+    }
+    return 0;
+}
+
+int hardware_alarm_claim_unused(bool required) {
+    for (uint i = 0; i < SIM_HARDWARE_ALARMS; i++) {
+        if (!(hardware_alarms_claimed & (1u << i))) {
+            hardware_alarms_claimed |= 1u << i;
+            return (int)i;
+        }
+    }
+    if (required) {
+        fprintf(stderr, "sim: no quedan alarmas de hardware\n");
+        exit(1);
+    }
+    return -1;
+}
+
+void hardware_alarm_set_callback(uint alarm_num, hardware_alarm_callback_t callback) {
+    hardware_alarm_cancel(alarm_num);
+    hardware_alarm_callbacks[alarm_num] = callback;
+}
+
+bool hardware_alarm_set_target(uint alarm_num, absolute_time_t t) {
+    hardware_alarm_cancel(alarm_num);
+    if (t < now_us) {
+        return true;    // Ya pasó: el SDK no la arma
+    }
+    hardware_alarm_ids[alarm_num] =
+        alarm_pool_add_alarm_at(&default_pool, t, hardware_alarm_fire, (void *)(uintptr_t)alarm_num, false);
+    return false;
+}
+
+void hardware_alarm_cancel(uint alarm_num) {
+    if (hardware_alarm_ids[alarm_num] != 0) {
+        alarm_pool_cancel_alarm(&default_pool, hardware_alarm_ids[alarm_num]);
+        hardware_alarm_ids[alarm_num] = 0;
+    }
+}
+
+alarm_pool_t *alarm_pool_get_default(void) {
+    return &default_pool;
+}
+
+alarm_pool_t *alarm_pool_create_with_unused_hardware_alarm(uint max_timers) {
+    (void)max_timers;
+    return &default_pool;
+}
+
+/*
+ * Interrupciones y sincronización
+ */
+
+/**
+ * @brief Corre los manejadores de una línea de interrupción.
+ */
+static void irq_dispatch(unsigned int num) {
+    for (int i = 0; i < 4 && irq_handlers[num][i]; i++) {
+        irq_handlers[num][i]();
+    }
+}
+
+void sim_irq_raise(unsigned int num) {
+    if (num >= NUM_IRQS || !(irq_enabled & (1u << num))) {
+        return;
+    }
+    if (irq_masked) {
+        irq_pending |= 1u << num;
+        return;
+    }
+    irq_dispatch(num);
+}
+
+void irq_set_exclusive_handler(unsigned int num, irq_handler_t handler) {
+    irq_handlers[num][0] = handler;
+}
+
+void irq_add_shared_handler(unsigned int num, irq_handler_t handler, uint8_t order_priority) {
+    (void)order_priority;
+    for (int i = 0; i < 4; i++) {
+        if (!irq_handlers[num][i]) {
+            irq_handlers[num][i] = handler;
+            return;
+        }
+    }
+}
+
+void irq_set_enabled(unsigned int num, bool enabled) {
+    if (enabled) {
+        irq_enabled |= 1u << num;
+    } else {
+        irq_enabled &= ~(1u << num);
+    }
+}
+
+uint32_t save_and_disable_interrupts(void) {
+    uint32_t status = irq_masked;
+    irq_masked = true;
+    return status;
+}
+
+void restore_interrupts(uint32_t status) {
+    irq_masked = status != 0;
+    while (!irq_masked && irq_pending) {
+        unsigned int num = (unsigned int)__builtin_ctz(irq_pending);
+        irq_pending &= ~(1u << num);
+        irq_dispatch(num);
+    }
+    if (!irq_masked && core1_deferred) {
+        run_core1();
+    }
+}
+
+spin_lock_t *spin_lock_init(unsigned int lock_num) {
+    spin_locks[lock_num] = 0;
+    return &spin_locks[lock_num];
+}
+
+unsigned int spin_lock_claim_unused(bool required) {
+    (void)required;
+    return next_spin_lock++;
+}
+
+uint32_t spin_lock_blocking(spin_lock_t *lock) {
+    (void)lock;
+    return save_and_disable_interrupts();
+}
+
+void spin_unlock(spin_lock_t *lock, uint32_t saved_irq) {
+    (void)lock;
+    restore_interrupts(saved_irq);
+}
+
+void __dmb(void) {
+    // Barrera completa, como la DMB del Cortex-M0+: `matecash_keyring` usa hilos de verdad
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+void __sev(void) {
+    core_event[0] = true;
+    core_event[1] = true;
+    if (current_core == 0) {
+        run_core1();
+    }
+}
+
+/**
+ * @brief Duerme hasta el próximo aviso: corre eventos hasta que alguno llame a `__sev()`.
+ *
+ * En el núcleo 1, sin un aviso pendiente, devuelve el control al núcleo 0 hasta su
+ * próximo `__sev()`. En el núcleo 0, si no queda nada por pasar, el firmware esperaría
+ * para siempre y la simulación termina.
+ */
+void __wfe(void) {
+    if (current_core == 1) {
+        if (!core_event[1]) {
+            switch_core(0);
+        }
+        core_event[1] = false;
+        return;
+    }
+
+    if (core1_deferred) {
+        run_core1();
+    }
+    uint64_t start = now_us;
+    while (!core_event[0]) {
+        if (!sim_step()) {
+            sim_finish();
+        }
+    }
+    core_event[0] = false;
+
+    if (now_us > start) {
+        power_stats.wakes++;
+        power_stats.sleep_us += now_us - start;
+        if (sim_scb_hw.scr & M0PLUS_SCR_SLEEPDEEP_BITS) {
+            power_stats.deep_sleep_us += now_us - start;
+        }
+    }
+}
+
+const SimPowerStats *sim_power_stats(void) {
+    return &power_stats;
+}
+
+void __wfi(void) {
+    if (!sim_step()) {
+        sim_finish();
+    }
+}
+
+/*
+ * GPIO
+ */
+
+void gpio_init(uint gpio) {
+    gpio_level[gpio] = false;
+}
+
+void gpio_set_dir(uint gpio, bool out) {
+    (void)gpio;
+    (void)out;
+}
+
+void gpio_put(uint gpio, bool value) {
+    if (gpio_level[gpio] != value) {
+        gpio_level[gpio] = value;
+        sim_on_gpio(gpio, value);
+    }
+}
+
+bool gpio_get(uint gpio) {
+    return gpio_level[gpio];
+}
+
+void gpio_pull_up(uint gpio) {
+    (void)gpio;
+}
+
+void gpio_pull_down(uint gpio) {
+    (void)gpio;
+}
+
+void gpio_disable_pulls(uint gpio) {
+    (void)gpio;
+}
+
+void gpio_set_function(uint gpio, enum gpio_function fn) {
+    (void)gpio;
+    (void)fn;
+}
+
+void gpio_set_inover(uint gpio, uint value) {
+    (void)gpio;
+    (void)value;
+}
+
+void gpio_set_outover(uint gpio, uint value) {
+    (void)gpio;
+    (void)value;
+}
+
+/**
+ * @brief Eventos de interrupción activos en un pin: los niveles se miran en el momento
+ * y los flancos quedan guardados hasta atenderlos.
+ */
+static uint32_t gpio_irq_active(uint gpio) {
+    uint32_t events = gpio_irq_edges[gpio];
+    events |= gpio_level[gpio] ? GPIO_IRQ_LEVEL_HIGH : GPIO_IRQ_LEVEL_LOW;
+    return events & gpio_irq_mask[gpio];
+}
+
+/**
+ * @brief Manejador de `IO_IRQ_BANK0`: primero los manejadores propios de los pines que
+ * tengan eventos y después el callback por cada pin con eventos que queden.
+ */
+static void gpio_irq_handler(void) {
+    for (int i = 0; i < 4 && gpio_raw_handlers[i]; i++) {
+        for (uint gpio = 0; gpio < NUM_BANK0_GPIOS; gpio++) {
+            if ((gpio_raw_masks[i] & (1u << gpio)) && gpio_irq_active(gpio)) {
+                gpio_raw_handlers[i]();
+                break;
+            }
+        }
+    }
+    for (uint gpio = 0; gpio < NUM_BANK0_GPIOS; gpio++) {
+        uint32_t events = gpio_irq_active(gpio);
+        gpio_irq_edges[gpio] = 0;
+        if (events && gpio_callback) {
+            gpio_callback(gpio, events);
+        }
+    }
+}
+
+void sim_gpio_input(uint gpio, bool value) {
+    if (gpio_level[gpio] != value) {
+        gpio_level[gpio] = value;
+        gpio_irq_edges[gpio] |= value ? GPIO_IRQ_EDGE_RISE : GPIO_IRQ_EDGE_FALL;
+    }
+    if (gpio_irq_active(gpio)) {
+        sim_irq_raise(IO_IRQ_BANK0);
+    }
+}
+
+void gpio_set_irq_enabled(uint gpio, uint32_t event_mask, bool enabled) {
+    if (enabled) {
+        gpio_irq_edges[gpio] = 0;
+        gpio_irq_mask[gpio] |= event_mask;
+        if (gpio_irq_active(gpio)) {
+            sim_irq_raise(IO_IRQ_BANK0);    // Un nivel que ya está activo interrumpe enseguida
+        }
+    } else {
+        gpio_irq_mask[gpio] &= ~event_mask;
+    }
+}
+
+void gpio_set_irq_enabled_with_callback(uint gpio, uint32_t event_mask, bool enabled, gpio_irq_callback_t callback) {
+    gpio_callback = callback;
+    irq_set_exclusive_handler(IO_IRQ_BANK0, gpio_irq_handler);
+    irq_set_enabled(IO_IRQ_BANK0, true);
+    gpio_set_irq_enabled(gpio, event_mask, enabled);
+}
+
+void gpio_add_raw_irq_handler_masked(uint32_t gpio_mask, gpio_raw_irq_handler_t handler) {
+    for (int i = 0; i < 4; i++) {
+        if (!gpio_raw_handlers[i]) {
+            gpio_raw_handlers[i] = handler;
+            gpio_raw_masks[i] = gpio_mask;
+            break;
+        }
+    }
+    irq_set_exclusive_handler(IO_IRQ_BANK0, gpio_irq_handler);
+}
+
+uint32_t gpio_get_irq_event_mask(uint gpio) {
+    return gpio_irq_active(gpio);
+}
+
+void gpio_acknowledge_irq(uint gpio, uint32_t events) {
+    gpio_irq_edges[gpio] &= ~events;
+}
+
+/*
+ * Consola USB
+ */
+
+bool stdio_init_all(void) {
+    return true;
+}
+
+void sim_console_input(char c) {
+    unsigned int next = (console_head + 1) % SIM_CONSOLE_SIZE;
+    if (next != console_tail) {
+        console[console_head] = c;
+        console_head = next;
+    }
+    if (console_callback) {
+        console_callback(console_param);
+    }
+}
+
+int getchar_timeout_us(uint32_t timeout_us) {
+    (void)timeout_us;
+    if (console_tail == console_head) {
+        return PICO_ERROR_TIMEOUT;
+    }
+    char c = console[console_tail];
+    console_tail = (console_tail + 1) % SIM_CONSOLE_SIZE;
+    return (unsigned char)c;
+}
+
+void stdio_set_chars_available_callback(void (*fn)(void *), void *param) {
+    console_callback = fn;
+    console_param = param;
+}
+
+// La salida es binaria (`log.h`): se decodifica al vuelo para que stdout sea texto
+int putchar_raw(int c) {
+    logdecode_feed(&console_decoder, (uint8_t)c, stdout);
+    return c;
+}
+
+/*
+ * Flash
+ */
+
+void flash_range_erase(uint32_t flash_offs, size_t count) {
+    memset(&sim_flash_memory[flash_offs], 0xFF, count);
+    flash_stats.erases += count / FLASH_SECTOR_SIZE;
+    sim_stall_us((uint64_t)(count / FLASH_SECTOR_SIZE) * flash_erase_us);
+}
+
+void flash_range_program(uint32_t flash_offs, const uint8_t *data, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        sim_flash_memory[flash_offs + i] &= data[i];   // La NOR solo baja bits
+    }
+    flash_stats.programs += count / FLASH_PAGE_SIZE;
+    sim_stall_us((uint64_t)(count / FLASH_PAGE_SIZE) * SIM_FLASH_PROGRAM_US);
+}
+
+int flash_safe_execute(void (*func)(void *), void *param, uint32_t enter_exit_timeout_ms) {
+    (void)enter_exit_timeout_ms;
+    if (flash_failing) {
+        return PICO_ERROR_TIMEOUT;
+    }
+    uint32_t status = save_and_disable_interrupts();
+    func(param);
+    restore_interrupts(status);
+    return PICO_OK;
+}
+
+bool flash_safe_execute_core_init(void) {
+    return true;
+}
+
+void sim_flash_set_erase_us(uint64_t us) {
+    flash_erase_us = us;
+}
+
+void sim_flash_set_failing(bool failing) {
+    flash_failing = failing;
+}
+
+const SimFlashStats *sim_flash_stats(void) {
+    return &flash_stats;
+}
@@ -0,0 +1,111 @@
+/**
+ * @file hd44780.c
+ * @brief Modelo del HD44780 conectado en modo 4 bits detrás de un PCF8574, cableado
+ * como lo maneja `lcd.c`: P0 = RS, P2 = E, P3 = luz de fondo y P4..P7 = D4..D7.
+ *
+ * Cada flanco de bajada de E toma un nibble; dos nibbles (alto y bajo) forman un byte,
+ * que es un comando si RS = 0 o un carácter para la DDRAM si RS = 1. Solo se modelan
+ * los comandos que cambian lo que se ve: borrar, volver al inicio y posicionar el cursor.
+ */
+
+#include "sim.h"
+#include <string.h>
+
+#define PCF_RS 0x01
+#define PCF_E  0x04
+
+/**
+ * @brief Tamaño de la DDRAM en modo de 2 líneas: 0x00..0x27 y 0x40..0x67.
+ */
+#define DDRAM_SIZE 0x68
+
+static uint8_t ddram[DDRAM_SIZE];
+static uint8_t address = 0;
+static uint8_t last_pins = 0;
+static bool low_nibble = false;
+static uint8_t pending = 0;
+static bool cgram = false;
+static bool initialized = false;
+
+/**
+ * @brief Dirección DDRAM del comienzo de cada fila del 20x4.
+ */
+static const uint8_t row_address[4] = {0x00, 0x40, 0x14, 0x54};
+
+/**
+ * @brief Avanza el contador de direcciones como lo hace el controlador.
+ */
+static void advance(void) {
+    address++;
+    if (address == 0x28) {
+        address = 0x40;
+    } else if (address >= DDRAM_SIZE) {
+        address = 0x00;
+    }
+}
+
+/**
+ * @brief Ejecuta un byte completo.
+ */
+static void execute(uint8_t value, bool is_data) {
+    if (is_data) {
+        if (!cgram) {
+            ddram[address] = value;
+            advance();
+        }
+        return;
+    }
+
+    if (value & 0x80) {             // Posición de la DDRAM
+        address = value & 0x7F;
+        if (address >= DDRAM_SIZE || (address >= 0x28 && address < 0x40)) {
+            address = 0x00;
+        }
+        cgram = false;
+    } else if (value & 0x40) {      // Posición de la CGRAM
+        cgram = true;
+    } else if (value == 0x01) {     // Borrar
+        memset(ddram, ' ', sizeof(ddram));
+        address = 0x00;
+        cgram = false;
+    } else if ((value & 0xFE) == 0x02) {    // Volver al inicio
+        address = 0x00;
+        cgram = false;
+    }
+}
+
+void hd44780_write(uint8_t pins) {
+    if (!initialized) {
+        memset(ddram, ' ', sizeof(ddram));
+        initialized = true;
+    }
+
+    if ((last_pins & PCF_E) && !(pins & PCF_E)) {
+        uint8_t nibble = pins >> 4;
+        if (!low_nibble) {
+            pending = (uint8_t)(nibble << 4);
+        } else {
+            execute(pending | nibble, (pins & PCF_RS) != 0);
+        }
+        low_nibble = !low_nibble;
+    }
+    last_pins = pins;
+}
+
+void hd44780_row(int row, char text[21]) {
+    for (int col = 0; col < 20; col++) {
+        uint8_t c = initialized ? ddram[row_address[row] + col] : ' ';
+        text[col] = c >= 0x20 && c < 0x7F ? (char)c : c == 0xEE ? 'n' : '?';
+    }
+    text[20] = '\0';
+}
+
+void hd44780_print(FILE *out) {
+    char text[21];
+    fprintf(out, "+--------------------+\n");
+    for (int row = 0; row < 4; row++) {
+        hd44780_row(row, text);
+        fprintf(out, "|%s|\n", text);
+    }
+    fprintf(out, "+--------------------+\n");
+}
@@ -0,0 +1,34 @@
+/**
+ * @file hardware/clocks.h
+ * @brief Versión para el simulador de `hardware/clocks.h`.
+ */
+#ifndef SIM_HARDWARE_CLOCKS_H
+#define SIM_HARDWARE_CLOCKS_H
+
+#include <stdint.h>
+
+enum clock_index { clk_gpout0 = 0, clk_ref = 4, clk_sys = 5, clk_peri = 6, clk_usb = 7, clk_adc = 8, clk_rtc = 9 };
+
+/**
+ * @brief Registros del bloque de relojes que usa el firmware; el simulador solo lee
+ * `sleep_en0/1` para contar el tiempo en reposo.
+ */
+typedef struct {
+    uint32_t sleep_en0;
+    uint32_t sleep_en1;
+} clocks_hw_t;
+
+extern clocks_hw_t sim_clocks_hw;
+#define clocks_hw (&sim_clocks_hw)
+
+#define CLOCKS_SLEEP_EN0_CLK_SYS_BUSFABRIC_BITS (1u << 5)
+#define CLOCKS_SLEEP_EN0_CLK_SYS_IO_BITS (1u << 9)
+#define CLOCKS_SLEEP_EN0_CLK_SYS_PADS_BITS (1u << 11)
+#define CLOCKS_SLEEP_EN1_CLK_SYS_TIMER_BITS (1u << 10)
+#define CLOCKS_SLEEP_EN1_CLK_SYS_USBCTRL_BITS (1u << 20)
+#define CLOCKS_SLEEP_EN1_CLK_USB_USBCTRL_BITS (1u << 21)
+#define CLOCKS_SLEEP_EN1_CLK_SYS_WATCHDOG_BITS (1u << 22)
+
+uint32_t clock_get_hz(enum clock_index clock);
+
+#endif // SIM_HARDWARE_CLOCKS_H
@@ -0,0 +1,17 @@
+/**
+ * @file hardware/flash.h
+ * @brief Versión para el simulador de `hardware/flash.h`: escribe sobre `sim_flash_memory`
+ * con la semántica de una NOR (el borrado deja 0xFF, la programación solo baja bits).
+ */
+#ifndef SIM_HARDWARE_FLASH_H
+#define SIM_HARDWARE_FLASH_H
+
+#include "pico/stdlib.h"
+
+#define FLASH_PAGE_SIZE (1u << 8)
+#define FLASH_SECTOR_SIZE (1u << 12)
+
+void flash_range_erase(uint32_t flash_offs, size_t count);
+void flash_range_program(uint32_t flash_offs, const uint8_t *data, size_t count);
+
+#endif // SIM_HARDWARE_FLASH_H
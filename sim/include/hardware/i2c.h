@@ -0,0 +1,42 @@
+/**
+ * @file hardware/i2c.h
+ * @brief Versión para el simulador de `hardware/i2c.h`.
+ *
+ * El bus tiene conectado el PCF8574 del LCD (ver `sim/hd44780.c`); los registros son
+ * los pocos que toca `lcd.c`, y `status` refleja si hay una transferencia en curso.
+ */
+#ifndef SIM_HARDWARE_I2C_H
+#define SIM_HARDWARE_I2C_H
+
+#include "pico/stdlib.h"
+
+/**
+ * @brief Registros del bloque I2C que usa el firmware.
+ */
+typedef struct {
+    volatile uint32_t enable;
+    volatile uint32_t tar;
+    volatile uint32_t data_cmd;
+    volatile uint32_t status;
+    volatile uint32_t clr_tx_abrt;
+} i2c_hw_t;
+
+typedef struct i2c_inst {
+    i2c_hw_t hw;        /**< Registros */
+    uint baudrate;      /**< Frecuencia del bus en Hz */
+} i2c_inst_t;
+
+extern i2c_inst_t i2c0_inst, i2c1_inst;
+#define i2c0 (&i2c0_inst)
+#define i2c1 (&i2c1_inst)
+
+#define I2C_IC_DATA_CMD_STOP_BITS 0x200u
+#define I2C_IC_STATUS_ACTIVITY_BITS 0x1u
+#define I2C_IC_STATUS_TFE_BITS 0x4u
+
+uint i2c_init(i2c_inst_t *i2c, uint baudrate);
+int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop);
+i2c_hw_t *i2c_get_hw(i2c_inst_t *i2c);
+uint i2c_get_dreq(i2c_inst_t *i2c, bool is_tx);
+
+#endif // SIM_HARDWARE_I2C_H
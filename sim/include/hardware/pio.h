@@ -0,0 +1,52 @@
+/**
+ * @file hardware/pio.h
+ * @brief Versión para el simulador de `hardware/pio.h`.
+ *
+ * No ejecuta programas PIO: el escáner del teclado (`pio0`) se reemplaza por el modelo
+ * de `sim/keypad_model.c`, que produce los mismos cuadros en la FIFO RX, y los pulsos
+ * de los motores (`pio1`) por el de `sim/stepper_model.c`.
+ */
+#ifndef SIM_HARDWARE_PIO_H
+#define SIM_HARDWARE_PIO_H
+
+#include "pico/stdlib.h"
+
+typedef struct pio_hw {
+    uint32_t irq0_inte;     /**< Fuentes habilitadas de la interrupción 0 */
+    uint32_t irq;           /**< Banderas IRQ levantadas por los programas */
+    uint32_t txf[4];        /**< FIFO TX de cada máquina de estados (destino del DMA) */
+} pio_hw_t;
+typedef pio_hw_t *PIO;
+
+extern pio_hw_t pio0_hw_inst, pio1_hw_inst;
+#define pio0 (&pio0_hw_inst)
+#define pio1 (&pio1_hw_inst)
+
+typedef struct pio_program {
+    const uint16_t *instructions;
+    uint8_t length;
+    int8_t origin;
+} pio_program_t;
+
+enum pio_interrupt_source { pis_sm0_rx_fifo_not_empty = 0, pis_sm0_tx_fifo_not_full = 4, pis_interrupt0 = 8 };
+
+uint pio_add_program(PIO pio, const pio_program_t *program);
+int pio_claim_unused_sm(PIO pio, bool required);
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled);
+bool pio_sm_is_rx_fifo_empty(PIO pio, uint sm);
+uint32_t pio_sm_get(PIO pio, uint sm);
+void pio_set_irq0_source_enabled(PIO pio, enum pio_interrupt_source source, bool enabled);
+void pio_sm_clear_fifos(PIO pio, uint sm);
+uint pio_sm_get_tx_fifo_level(PIO pio, uint sm);
+void pio_sm_restart(PIO pio, uint sm);
+void pio_sm_exec(PIO pio, uint sm, uint instr);
+void pio_gpio_init(PIO pio, uint pin);
+uint pio_get_dreq(PIO pio, uint sm, bool is_tx);
+bool pio_interrupt_get(PIO pio, uint pio_interrupt_num);
+void pio_interrupt_clear(PIO pio, uint pio_interrupt_num);
+
+static inline uint pio_encode_jmp(uint addr) {
+    return addr;
+}
+
+#endif // SIM_HARDWARE_PIO_H
@@ -0,0 +1,30 @@
+/**
+ * @file hardware/sync.h
+ * @brief Versión para el simulador de `hardware/sync.h`.
+ *
+ * Hay un solo hilo (el núcleo 1 es una corrutina, ver `pico/multicore.h`), y las
+ * interrupciones simuladas solo corren dentro de `__wfe()`, `sleep_us()` y
+ * `tight_loop_contents()`; mientras están deshabilitadas quedan pendientes hasta
+ * `restore_interrupts()`. Un spinlock solo deshabilita las interrupciones: el núcleo 1
+ * no corre mientras el núcleo 0 las tiene deshabilitadas.
+ */
+#ifndef SIM_HARDWARE_SYNC_H
+#define SIM_HARDWARE_SYNC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef volatile uint32_t spin_lock_t;
+
+void __dmb(void);
+void __sev(void);
+void __wfe(void);
+void __wfi(void);
+uint32_t save_and_disable_interrupts(void);
+void restore_interrupts(uint32_t status);
+spin_lock_t *spin_lock_init(unsigned int lock_num);
+unsigned int spin_lock_claim_unused(bool required);
+uint32_t spin_lock_blocking(spin_lock_t *lock);
+void spin_unlock(spin_lock_t *lock, uint32_t saved_irq);
+
+#endif // SIM_HARDWARE_SYNC_H
@@ -0,0 +1,36 @@
+/**
+ * @file keypad.pio.h
+ * @brief Reemplazo del encabezado que `pioasm` genera a partir de `keypad.pio`.
+ *
+ * `keypad_LINGER_FRAMES` y `keypad_FRAME_CYCLES` los define `sim/CMakeLists.txt` leyendo
+ * los `.define PUBLIC` de `keypad.pio`, así el modelo no se desincroniza del programa.
+ */
+#ifndef SIM_KEYPAD_PIO_H
+#define SIM_KEYPAD_PIO_H
+
+#include "hardware/pio.h"
+
+static const pio_program_t keypad_program = {NULL, 17, -1};
+
+/**
+ * @brief Conecta el modelo del teclado a las filas y columnas indicadas.
+ */
+void sim_keypad_attach(PIO pio, uint sm, uint row_base, uint col_base, uint frame_us);
+
+/**
+ * @brief Configura e inicia el escáner del teclado (ver `keypad.pio`).
+ *
+ * @param pio Bloque PIO a usar.
+ * @param sm Máquina de estados.
+ * @param offset Dirección donde se cargó el programa.
+ * @param row_base Primer pin de las filas (4 pines consecutivos).
+ * @param col_base Primer pin de las columnas (4 pines consecutivos).
+ * @param frame_us Duración deseada de un cuadro completo, en microsegundos.
+ */
+static inline void keypad_program_init(PIO pio, uint sm, uint offset, uint row_base, uint col_base, uint frame_us) {
+    (void)offset;
+    sim_keypad_attach(pio, sm, row_base, col_base, frame_us);
+    pio_sm_set_enabled(pio, sm, true);
+}
+
+#endif // SIM_KEYPAD_PIO_H
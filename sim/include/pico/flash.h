@@ -0,0 +1,13 @@
+/**
+ * @file pico/flash.h
+ * @brief Versión para el simulador de `pico/flash.h`: no hay otro núcleo que detener.
+ */
+#ifndef SIM_PICO_FLASH_H
+#define SIM_PICO_FLASH_H
+
+#include "pico/stdlib.h"
+
+int flash_safe_execute(void (*func)(void *), void *param, uint32_t enter_exit_timeout_ms);
+bool flash_safe_execute_core_init(void);
+
+#endif // SIM_PICO_FLASH_H
@@ -0,0 +1,19 @@
+/**
+ * @file pico/multicore.h
+ * @brief Versión para el simulador de `pico/multicore.h`.
+ *
+ * El núcleo 1 es una corrutina de `sim/hal.c` con su propia pila: corre apenas el
+ * núcleo 0 ejecuta `__sev()` y le devuelve el control cuando su `__wfe()` no encuentra
+ * un aviso. Como el procesador no gasta tiempo virtual, un pedido al núcleo 1 se
+ * atiende en el mismo microsegundo en que se hizo.
+ */
+#ifndef SIM_PICO_MULTICORE_H
+#define SIM_PICO_MULTICORE_H
+
+#include "pico/stdlib.h"
+
+void multicore_launch_core1(void (*entry)(void));
+void multicore_fifo_push_blocking(uint32_t data);
+uint32_t multicore_fifo_pop_blocking(void);
+
+#endif // SIM_PICO_MULTICORE_H
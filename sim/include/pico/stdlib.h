@@ -0,0 +1,66 @@
+/**
+ * @file pico/stdlib.h
+ * @brief Versión para el simulador de `pico/stdlib.h`: tipos y funciones de tiempo y
+ * de consola del SDK, sobre el reloj virtual de `sim/hal.c`.
+ *
+ * Solo declara lo que usa el firmware; una función nueva del SDK se agrega aquí y en
+ * el modelo que corresponda.
+ */
+#ifndef SIM_PICO_STDLIB_H
+#define SIM_PICO_STDLIB_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+typedef unsigned int uint;
+
+/**
+ * @brief Instante en microsegundos desde el arranque del reloj virtual.
+ */
+typedef uint64_t absolute_time_t;
+
+#define PICO_OK 0
+#define PICO_ERROR_TIMEOUT (-1)
+#define PICO_ERROR_GENERIC (-2)
+
+#define __not_in_flash_func(func) func
+#define __time_critical_func(func) func
+#define count_of(a) (sizeof(a) / sizeof((a)[0]))
+
+/**
+ * @brief La flash simulada: un arreglo en RAM que ocupa el lugar de la ventana XIP.
+ * Por defecto mide como la de la Pico; la compilación con muchos usuarios usa una mayor.
+ */
+#ifndef PICO_FLASH_SIZE_BYTES
+#define PICO_FLASH_SIZE_BYTES (2 * 1024 * 1024)
+#endif
+extern uint8_t sim_flash_memory[PICO_FLASH_SIZE_BYTES];
+#define XIP_BASE ((uintptr_t)sim_flash_memory)
+
+uint64_t time_us_64(void);
+uint32_t time_us_32(void);
+absolute_time_t get_absolute_time(void);
+int64_t absolute_time_diff_us(absolute_time_t from, absolute_time_t to);
+absolute_time_t make_timeout_time_us(uint64_t us);
+absolute_time_t make_timeout_time_ms(uint32_t ms);
+absolute_time_t delayed_by_us(absolute_time_t t, uint64_t us);
+absolute_time_t delayed_by_ms(absolute_time_t t, uint32_t ms);
+uint64_t to_us_since_boot(absolute_time_t t);
+absolute_time_t from_us_since_boot(uint64_t us);
+uint32_t to_ms_since_boot(absolute_time_t t);
+void sleep_us(uint64_t us);
+void sleep_ms(uint32_t ms);
+void tight_loop_contents(void);
+
+bool stdio_init_all(void);
+int getchar_timeout_us(uint32_t timeout_us);
+int putchar_raw(int c);
+void stdio_set_chars_available_callback(void (*fn)(void *), void *param);
+
+#include "hardware/gpio.h"
+#include "hardware/timer.h"
+#include "hardware/sync.h"
+
+#endif // SIM_PICO_STDLIB_H
@@ -0,0 +1,26 @@
+/**
+ * @file pico/util/queue.h
+ * @brief Versión para el simulador de `pico/util/queue.h`: cola de elementos de tamaño
+ * fijo entre núcleos; agregar o sacar ejecuta `__sev()`, como en el SDK.
+ */
+#ifndef SIM_PICO_UTIL_QUEUE_H
+#define SIM_PICO_UTIL_QUEUE_H
+
+#include "pico/stdlib.h"
+
+typedef struct {
+    uint8_t *data;      /**< `element_count + 1` lugares */
+    uint element_size;  /**< Bytes por elemento */
+    uint element_count; /**< Capacidad */
+    uint rptr;          /**< Próximo lugar a leer */
+    uint wptr;          /**< Próximo lugar a escribir */
+} queue_t;
+
+void queue_init(queue_t *q, uint element_size, uint element_count);
+bool queue_is_empty(queue_t *q);
+bool queue_try_add(queue_t *q, const void *data);
+bool queue_try_remove(queue_t *q, void *data);
+void queue_add_blocking(queue_t *q, const void *data);
+void queue_remove_blocking(queue_t *q, void *data);
+
+#endif // SIM_PICO_UTIL_QUEUE_H
@@ -0,0 +1,38 @@
+/**
+ * @file stepper.pio.h
+ * @brief Reemplazo del encabezado que `pioasm` genera a partir de `stepper.pio`.
+ *
+ * `stepper_PULSE_CYCLES` y `stepper_STEP_OVERHEAD` los define `sim/CMakeLists.txt`
+ * leyendo los `.define PUBLIC` de `stepper.pio`, como con el teclado.
+ */
+#ifndef SIM_STEPPER_PIO_H
+#define SIM_STEPPER_PIO_H
+
+#include "hardware/pio.h"
+
+static const pio_program_t stepper_program = {NULL, 7, -1};
+
+#define stepper_offset_start 0u
+
+/**
+ * @brief Conecta el modelo de los motores a una máquina de estados de `pio1`.
+ */
+void sim_stepper_attach(PIO pio, uint sm, uint pin, uint cycle_hz);
+
+/**
+ * @brief Configura e inicia una máquina de estados que genera los pulsos de un motor
+ * (ver `stepper.pio`).
+ *
+ * @param pio Bloque PIO a usar.
+ * @param sm Máquina de estados.
+ * @param offset Dirección donde se cargó el programa.
+ * @param pin Pin STEP del controlador del motor.
+ * @param cycle_hz Frecuencia de los ciclos de la máquina.
+ */
+static inline void stepper_program_init(PIO pio, uint sm, uint offset, uint pin, uint cycle_hz) {
+    (void)offset;
+    sim_stepper_attach(pio, sm, pin, cycle_hz);
+    pio_sm_set_enabled(pio, sm, true);
+}
+
+#endif // SIM_STEPPER_PIO_H
@@ -0,0 +1,186 @@
+/**
+ * @file journal_main.c
+ * @brief Llena el anillo del diario de cuentas y mide cuánto tarda `acctlog_init()` en
+ * reconstruir la tabla de usuarios al arrancar con el anillo casi lleno.
+ *
+ * Uso: `matecash_journal [arranques]` (por defecto 5). Se compila dos veces: con la
+ * tabla de fábrica (`matecash_journal`) y con lugar para 100000 cuentas
+ * (`matecash_journal_users`), cada una con el anillo que le da `ACCTLOG_SECTORS`.
+ *
+ * Desde una flash borrada:
+ *
+ * 1. se cambia el saldo de un usuario al azar y se llama una vez a `acctlog_service()`,
+ *    como el lazo principal tras cada operación, hasta dar dos vueltas al anillo; los
+ *    puntos de control se copian mezclados con los cambios y no se puede perder ningún
+ *    registro;
+ * 2. se siguen agregando cambios sin llamar a `acctlog_service()` hasta que el diario
+ *    pierde uno: ya no queda un sector libre.
+ *
+ * Después se arranca varias veces con la RAM en los valores de fábrica y se exige que
+ * la reconstrucción deje los saldos de antes del corte. Se informa el tiempo de
+ * `acctlog_init()` en el host: la flash simulada se lee sin demora, así que el reloj
+ * virtual no lo mide.
+ */
+
+#include "sim.h"
+#include "tcl.h"
+#include "events.h"
+#include "timewheel.h"
+#include "iocore.h"
+#include "acctlog.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * @brief Registros de usuario que entran en un sector, sin la cabecera.
+ */
+#define JOURNAL_SECTOR_RECORDS (4096 / ACCTLOG_RECORD_SIZE - 1)
+
+static User factory_users[NUM_USERS];
+static Denomination factory_denominations[NUM_DENOMINATIONS];
+
+/**
+ * @brief Saldos que tiene que dejar la reconstrucción.
+ */
+static money_t expected[NUM_USERS];
+
+/*
+ * El simulador espera estos ganchos de `sim_main.c`; aquí no se corre el firmware.
+ */
+
+uint64_t sim_script_next_us(void) {
+    return SIM_NEVER;
+}
+
+void sim_script_run(void) {
+}
+
+void sim_on_lcd_burst(uint64_t start_us) {
+    (void)start_us;
+}
+
+void sim_on_gpio(unsigned int gpio, bool value) {
+    (void)gpio;
+    (void)value;
+}
+
+void sim_finish(void) {
+}
+
+/**
+ * @brief Estado del generador xorshift32; fijo, para repetir las mismas pruebas.
+ */
+static uint32_t rng_state = 0x2545F491u;
+
+static uint32_t rng_next(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static uint64_t host_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+}
+
+/**
+ * @brief Arranca con la RAM en los valores de fábrica y la flash como esté.
+ *
+ * @return Tiempo de `acctlog_init()` en el host, en nanosegundos.
+ */
+static uint64_t boot(void) {
+    sim_reboot();
+    memcpy(users, factory_users, sizeof(users));
+    memcpy(denominations, factory_denominations, sizeof(denominations));
+    events_init();
+    timewheel_init();
+    iocore_init();
+    uint64_t t0 = host_ns();
+    acctlog_init(users, NUM_USERS, denominations, NUM_DENOMINATIONS);
+    return host_ns() - t0;
+}
+
+/**
+ * @brief Cambia el saldo de un usuario al azar y lo agrega al diario.
+ *
+ * @return false si el diario perdió el registro; el saldo queda como estaba.
+ */
+static bool update_random_user(void) {
+    unsigned int slot = rng_next() % NUM_USERS;
+    money_t before = users[slot].balance;
+    uint32_t dropped = acctlog_dropped();
+    users[slot].balance = (money_t)(rng_next() % 1000000u);
+    acctlog_update_user(slot);
+    if (acctlog_dropped() != dropped) {
+        users[slot].balance = before;
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    long boots = argc > 1 ? strtol(argv[1], NULL, 10) : 5;
+    if (boots <= 0 || boots > 1000) {
+        fprintf(stderr, "uso: %s [arranques]\n", argv[0]);
+        return 2;
+    }
+    memcpy(factory_users, users, sizeof(users));
+    memcpy(factory_denominations, denominations, sizeof(denominations));
+    unsigned int problems = 0;
+
+    sim_reset();
+    boot();
+    uint32_t laps = 2 * ACCTLOG_SECTORS * JOURNAL_SECTOR_RECORDS;
+    for (uint32_t n = 0; n < laps; n++) {
+        if (!update_random_user()) {
+            fprintf(stderr, "cambio %lu: el diario perdió un registro con el lazo principal al día\n",
+                    (unsigned long)n);
+            problems++;
+            break;
+        }
+        acctlog_service();
+    }
+    uint32_t filled = 0;
+    while (update_random_user()) {
+        filled++;
+    }
+    acctlog_sync();
+    for (unsigned int i = 0; i < NUM_USERS; i++) {
+        expected[i] = users[i].balance;
+    }
+
+    uint64_t best_ns = UINT64_MAX, total_ns = 0;
+    for (long n = 0; n < boots; n++) {
+        uint64_t elapsed = boot();
+        best_ns = elapsed < best_ns ? elapsed : best_ns;
+        total_ns += elapsed;
+        unsigned int wrong = 0;
+        for (unsigned int i = 0; i < NUM_USERS; i++) {
+            wrong += users[i].balance != expected[i];
+        }
+        if (wrong || acctlog_get_stats()->formatted) {
+            fprintf(stderr, "arranque %ld: %u saldos distintos%s\n", n + 1, wrong,
+                    acctlog_get_stats()->formatted ? ", diario descartado" : "");
+            problems++;
+        }
+    }
+
+    const AcctLogStats *stats = acctlog_get_stats();
+    if (stats->sectors < ACCTLOG_SECTORS - 1) {
+        fprintf(stderr, "el anillo quedó con %lu de %d sectores en uso\n", (unsigned long)stats->sectors,
+                ACCTLOG_SECTORS);
+        problems++;
+    }
+    fprintf(stderr, "%d usuarios, anillo de %d sectores (punto de control de %d): %lu cambios sin perder registros, "
+            "%lu más hasta llenarlo\n",
+            NUM_USERS, ACCTLOG_SECTORS, ACCTLOG_CHECKPOINT_SECTORS, (unsigned long)laps, (unsigned long)filled);
+    fprintf(stderr, "arranque con %lu sectores en uso: %lu registros, %.3f ms en el host (mejor de %ld, promedio "
+            "%.3f ms), %.1f ns por registro\n",
+            (unsigned long)stats->sectors, (unsigned long)stats->records, (double)best_ns / 1e6, boots,
+            (double)total_ns / (double)boots / 1e6, stats->records ? (double)best_ns / stats->records : 0.0);
+    fprintf(stderr, "problemas: %u\n", problems);
+    return problems ? 1 : 0;
+}
@@ -0,0 +1,307 @@
+/**
+ * @file keypad_main.c
+ * @brief Pasa trazas grabadas del escáner del teclado por `keypad_decode()` y compara
+ * las teclas que salen con las que se presionaron.
+ *
+ * Uso: `matecash_keypad [traza...]`; sin argumentos revisa todas las de
+ * `sim/keypad_traces/`. Cada traza es un archivo de texto con:
+ *
+ * - `teclas: TEXTO`, las teclas que se presionaron, en orden (vacío si ninguna tenía
+ *   que reportarse);
+ * - los cuadros que entregó el PIO, en hexadecimal y separados por espacios, con el
+ *   formato de `keypad.h`;
+ * - `;` comenta hasta el final de la línea.
+ *
+ * Además de las teclas, se exige que cada tecla reportada esté presionada en el cuadro
+ * que la reporta, que una tecla no se reporte de nuevo sin soltarse en el medio y que al
+ * final de la traza no quede ninguna tecla presionada.
+ *
+ * `matecash_keypad -g GUION` graba una traza con el modelo de `keypad_model.c` y la
+ * escribe por la salida estándar. El guion son palabras separadas por espacios:
+ *
+ * - `bounce:US`, `hold:MS` y `gap:MS`, como en `matecash_sim`;
+ * - `wait:MS` espera sin tocar nada;
+ * - `down:K` y `up:K` presionan y sueltan una tecla sin esperar;
+ * - `!K` presiona una tecla durante `hold` ms sin esperar que se reporte;
+ * - cualquier otro carácter presiona la tecla durante `hold` ms y espera `gap` ms.
+ */
+
+#include "sim.h"
+#include "keypad.h"
+#include "keypad.pio.h"
+#include "tcl.h"
+#include <glob.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Cuadros que puede tener una traza.
+ */
+#define KEYPAD_TRACE_FRAMES 8192
+
+/**
+ * @brief Teclas que puede esperar una traza.
+ */
+#define KEYPAD_TRACE_KEYS 64
+
+/**
+ * @brief Cuadros por línea al grabar.
+ */
+#define KEYPAD_TRACE_LINE 16
+
+/*
+ * El simulador espera estos ganchos de `sim_main.c`; aquí no se corre el firmware.
+ */
+
+uint64_t sim_script_next_us(void) {
+    return SIM_NEVER;
+}
+
+void sim_script_run(void) {
+}
+
+void sim_on_lcd_burst(uint64_t start_us) {
+    (void)start_us;
+}
+
+void sim_on_gpio(unsigned int gpio, bool value) {
+    (void)gpio;
+    (void)value;
+}
+
+void sim_finish(void) {
+}
+
+/**
+ * @brief Traza leída de un archivo o grabada.
+ */
+typedef struct {
+    char keys[KEYPAD_TRACE_KEYS + 1];       /**< Teclas esperadas */
+    uint16_t frames[KEYPAD_TRACE_FRAMES];   /**< Cuadros, en orden */
+    unsigned int count;                     /**< Cuadros válidos */
+} KeypadTrace;
+
+static KeypadTrace trace;
+
+/**
+ * @brief Lee una traza.
+ *
+ * @return false si el archivo no se puede leer o no es una traza.
+ */
+static bool load_trace(const char *path) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        perror(path);
+        return false;
+    }
+    memset(&trace, 0, sizeof(trace));
+    bool has_keys = false;
+    bool ok = true;
+    char line[512];
+    for (unsigned int number = 1; ok && fgets(line, sizeof(line), file); number++) {
+        line[strcspn(line, ";\r\n")] = '\0';
+        if (strncmp(line, "teclas:", 7) == 0) {
+            const char *keys = line + 7 + strspn(line + 7, " ");
+            ok = strlen(keys) <= KEYPAD_TRACE_KEYS;
+            strncpy(trace.keys, keys, KEYPAD_TRACE_KEYS);
+            has_keys = true;
+            continue;
+        }
+        for (char *word = strtok(line, " \t"); ok && word; word = strtok(NULL, " \t")) {
+            char *end;
+            unsigned long frame = strtoul(word, &end, 16);
+            ok = *end == '\0' && frame <= 0xFFFF && trace.count < KEYPAD_TRACE_FRAMES;
+            if (ok) {
+                trace.frames[trace.count++] = (uint16_t)frame;
+            } else {
+                fprintf(stderr, "%s:%u: \"%s\" no es un cuadro\n", path, number, word);
+            }
+        }
+    }
+    fclose(file);
+    if (ok && !has_keys) {
+        fprintf(stderr, "%s: falta la línea \"teclas:\"\n", path);
+        ok = false;
+    }
+    return ok;
+}
+
+/**
+ * @brief Pasa la traza cargada por el decodificador.
+ *
+ * @return Cantidad de problemas encontrados.
+ */
+static unsigned int check_trace(const char *name) {
+    unsigned int problems = 0;
+    KeypadDecoder decoder;
+    keypad_decoder_reset(&decoder);
+    char got[KEYPAD_TRACE_FRAMES + 1];
+    unsigned int got_count = 0;
+
+    for (unsigned int n = 0; n < trace.count; n++) {
+        char keys[KEYPAD_MAX_KEYS];
+        uint16_t before = decoder.pressed;
+        int count = keypad_decode(&decoder, trace.frames[n], keys, KEYPAD_MAX_KEYS);
+        for (int i = 0; i < count; i++) {
+            if (got_count < KEYPAD_TRACE_FRAMES) {
+                got[got_count++] = keys[i];
+            }
+            uint16_t mask = 0;
+            for (int row = 0; row < 4; row++) {
+                for (int col = 0; col < 4; col++) {
+                    if (KEYPAD[row][col] == keys[i]) {
+                        mask = (uint16_t)(1u << ((3 - row) * 4 + col));
+                    }
+                }
+            }
+            if (!(trace.frames[n] & mask)) {
+                fprintf(stderr, "%s: cuadro %u (%04X): salió '%c', que no está presionada\n", name, n,
+                        trace.frames[n], keys[i]);
+                problems++;
+            }
+            if (before & mask) {
+                fprintf(stderr, "%s: cuadro %u: salió '%c' otra vez sin soltarse\n", name, n, keys[i]);
+                problems++;
+            }
+        }
+    }
+    got[got_count] = '\0';
+
+    if (strcmp(got, trace.keys) != 0) {
+        fprintf(stderr, "%s: salieron \"%s\", se esperaban \"%s\"\n", name, got, trace.keys);
+        problems++;
+    }
+    if (decoder.pressed != 0) {
+        fprintf(stderr, "%s: al final quedaron presionadas %04X\n", name, decoder.pressed);
+        problems++;
+    }
+    fprintf(stderr, "%s: %u cuadros, \"%s\": %s\n", name, trace.count, got, problems ? "falló" : "bien");
+    return problems;
+}
+
+/**
+ * @brief Avanza el reloj virtual guardando cada cuadro que entrega el modelo.
+ */
+static void record_until(uint64_t target_us) {
+    while (sim_keypad_next_us() <= target_us) {
+        sim_run_until(sim_keypad_next_us());
+        while (!pio_sm_is_rx_fifo_empty(pio0, 0) && trace.count < KEYPAD_TRACE_FRAMES) {
+            trace.frames[trace.count++] = (uint16_t)pio_sm_get(pio0, 0);
+        }
+    }
+    sim_run_until(target_us);
+}
+
+/**
+ * @brief Presiona o suelta una tecla del guion.
+ *
+ * @return false si la tecla no existe.
+ */
+static bool record_key(char key, bool down) {
+    if (!sim_keypad_set(key, down)) {
+        fprintf(stderr, "guion: tecla '%c' desconocida\n", key);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Graba una traza con el modelo del escáner y la escribe por la salida estándar.
+ *
+ * @return false si el guion tiene errores.
+ */
+static bool record_trace(const char *script) {
+    memset(&trace, 0, sizeof(trace));
+    sim_reset();
+    // Como al arrancar el cajero: el rebote de las teclas se cuenta desde el instante 0
+    sim_run_until(1000000);
+    keypad_program_init(pio0, 0, 0, ROW_PINS[0], COL_PINS[0], KEYPAD_FRAME_US);
+
+    uint64_t hold_us = 80000, gap_us = 120000;
+    size_t expected = 0;
+    char *copy = strdup(script);
+    bool ok = true;
+    for (char *word = strtok(copy, " \t\n"); ok && word; word = strtok(NULL, " \t\n")) {
+        char *value = strchr(word, ':');
+        uint64_t number = value ? strtoull(value + 1, NULL, 10) : 0;
+        if (strncmp(word, "bounce:", 7) == 0) {
+            sim_keypad_set_bounce((uint32_t)number);
+        } else if (strncmp(word, "hold:", 5) == 0) {
+            hold_us = number * 1000;
+        } else if (strncmp(word, "gap:", 4) == 0) {
+            gap_us = number * 1000;
+        } else if (strncmp(word, "wait:", 5) == 0) {
+            record_until(sim_now_us() + number * 1000);
+        } else if (strncmp(word, "down:", 5) == 0 || strncmp(word, "up:", 3) == 0) {
+            bool down = word[0] == 'd';
+            ok = record_key(value[1], down);
+            if (ok && down && expected < KEYPAD_TRACE_KEYS) {
+                trace.keys[expected++] = value[1];
+            }
+        } else {
+            for (const char *k = word; ok && *k; k++) {
+                bool quiet = *k == '!' && k[1];
+                k += quiet;
+                ok = record_key(*k, true);
+                record_until(sim_now_us() + hold_us);
+                ok = ok && record_key(*k, false);
+                record_until(sim_now_us() + gap_us);
+                if (ok && !quiet && expected < KEYPAD_TRACE_KEYS) {
+                    trace.keys[expected++] = *k;
+                }
+            }
+        }
+    }
+    free(copy);
+    // Hasta que el escáner deje de entregar cuadros
+    record_until(sim_now_us() + (uint64_t)(keypad_LINGER_FRAMES + 2) * KEYPAD_FRAME_US + 1000000);
+    if (!ok) {
+        return false;
+    }
+
+    printf("; Grabada con el modelo del escáner: matecash_keypad -g \"%s\"\n", script);
+    printf("teclas: %s\n", trace.keys);
+    for (unsigned int n = 0; n < trace.count; n++) {
+        printf("%04X%c", trace.frames[n], (n + 1) % KEYPAD_TRACE_LINE == 0 || n + 1 == trace.count ? '\n' : ' ');
+    }
+    if (sim_keypad_dropped() > 0) {
+        fprintf(stderr, "guion: se perdieron %lu cuadros\n", (unsigned long)sim_keypad_dropped());
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    if (argc == 3 && strcmp(argv[1], "-g") == 0) {
+        return record_trace(argv[2]) ? 0 : 1;
+    }
+    if (argc > 1 && argv[1][0] == '-') {
+        fprintf(stderr, "uso: %s [-g guion] [traza...]\n", argv[0]);
+        return 2;
+    }
+
+    glob_t found = {0};
+    char **paths = &argv[1];
+    size_t count = (size_t)argc - 1;
+    if (count == 0) {
+        if (glob(MATECASH_KEYPAD_TRACES "/*.txt", 0, NULL, &found) != 0) {
+            fprintf(stderr, "no hay trazas en %s\n", MATECASH_KEYPAD_TRACES);
+            return 2;
+        }
+        paths = found.gl_pathv;
+        count = found.gl_pathc;
+    }
+
+    unsigned int problems = 0;
+    for (size_t i = 0; i < count; i++) {
+        const char *name = strrchr(paths[i], '/') ? strrchr(paths[i], '/') + 1 : paths[i];
+        if (!load_trace(paths[i])) {
+            problems++;
+            continue;
+        }
+        problems += check_trace(name);
+    }
+    globfree(&found);
+    fprintf(stderr, "%zu trazas, problemas: %u\n", count, problems);
+    return problems ? 1 : 0;
+}
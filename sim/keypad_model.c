@@ -0,0 +1,269 @@
+/**
+ * @file keypad_model.c
+ * @brief Modelo del escáner PIO del teclado (`keypad.pio`) y de la FIFO RX que lee
+ * `keypad.c`.
+ *
+ * Produce un cuadro cada `frame_us` mientras haya teclas presionadas y durante
+ * `keypad_LINGER_FRAMES` cuadros más después de soltarlas, con el mismo formato que el
+ * programa PIO: fila 0 en los bits 15..12 y columna 0 en el bit menos significativo de
+ * cada grupo. Durante el rebote, una tecla que acaba de cambiar alterna de estado en
+ * cuadros sucesivos.
+ *
+ * Con la máquina de estados detenida (reposo del teclado) no hay cuadros: si las filas
+ * están en bajo, una tecla presionada baja su columna, que puede interrumpir por GPIO.
+ */
+
+#include "sim.h"
+#include "hardware/irq.h"
+#include "hardware/pio.h"
+#include "tcl.h"
+
+/**
+ * @brief Profundidad de la FIFO RX con las dos FIFO unidas.
+ */
+#define FIFO_DEPTH 8
+
+pio_hw_t pio0_hw_inst, pio1_hw_inst;
+
+static bool attached = false;
+static bool enabled = false;
+static uint64_t enabled_since_us = 0;
+static uint64_t scan_us = 0;
+static uint keypad_sm_num = 0;
+static uint keypad_row_base = 0;
+static uint keypad_col_base = 0;
+static uint32_t frame_us = 2500;
+static uint32_t bounce_us = 0;
+
+static bool key_down[4][4];
+static uint64_t key_changed_us[4][4];
+static uint32_t linger = 0;
+static uint64_t next_frame_us = SIM_NEVER;
+
+static uint16_t fifo[FIFO_DEPTH];
+static unsigned int fifo_count = 0;
+static unsigned int fifo_head = 0;
+static uint32_t dropped = 0;
+
+void sim_keypad_attach(PIO pio, uint sm, uint row_base, uint col_base, uint frame_length_us) {
+    (void)pio;
+    keypad_sm_num = sm;
+    keypad_row_base = row_base;
+    keypad_col_base = col_base;
+    frame_us = frame_length_us;
+    attached = true;
+    for (uint col = 0; col < 4; col++) {
+        sim_gpio_input(col_base + col, true);     // Pull-up
+    }
+}
+
+uint64_t sim_keypad_scan_us(void) {
+    return scan_us + (enabled ? sim_now_us() - enabled_since_us : 0);
+}
+
+void sim_keypad_set_bounce(uint32_t us) {
+    bounce_us = us;
+}
+
+uint32_t sim_keypad_dropped(void) {
+    return dropped;
+}
+
+/**
+ * @brief Arma el cuadro que leería el escáner en este instante.
+ */
+static uint16_t scan(uint64_t now) {
+    uint16_t frame = 0;
+    bool odd = (now / frame_us) & 1;
+    for (int row = 0; row < 4; row++) {
+        for (int col = 0; col < 4; col++) {
+            bool down = key_down[row][col];
+            if (now - key_changed_us[row][col] < bounce_us && odd) {
+                down = !down;
+            }
+            if (down) {
+                frame |= (uint16_t)(1u << ((3 - row) * 4 + col));
+            }
+        }
+    }
+    return frame;
+}
+
+/**
+ * @brief Indica si alguna tecla está presionada o rebotando.
+ */
+static bool active(uint64_t now) {
+    for (int row = 0; row < 4; row++) {
+        for (int col = 0; col < 4; col++) {
+            if (key_down[row][col] || now - key_changed_us[row][col] < bounce_us) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Con el escáner detenido, pone cada columna en bajo si tiene una tecla
+ * presionada en una fila que está en bajo.
+ */
+static void update_columns(void) {
+    if (!attached || enabled) {
+        return;
+    }
+    for (int col = 0; col < 4; col++) {
+        bool low = false;
+        for (int row = 0; row < 4; row++) {
+            low |= key_down[row][col] && !gpio_get(keypad_row_base + row);
+        }
+        sim_gpio_input(keypad_col_base + col, !low);
+    }
+}
+
+/**
+ * @brief Programa el próximo cuadro según el ritmo del escáner, si no hay uno pendiente.
+ */
+static void schedule_frame(uint64_t now) {
+    if (enabled && next_frame_us == SIM_NEVER) {
+        next_frame_us = (now / frame_us + 1) * frame_us;
+    }
+}
+
+bool sim_keypad_set(char key, bool down) {
+    for (int row = 0; row < 4; row++) {
+        for (int col = 0; col < 4; col++) {
+            if (KEYPAD[row][col] != key) {
+                continue;
+            }
+            uint64_t now = sim_now_us();
+            key_down[row][col] = down;
+            key_changed_us[row][col] = now;
+            // Mientras está habilitado el escáner corre siempre; el próximo cuadro sale en su ritmo
+            schedule_frame(now);
+            update_columns();
+            return true;
+        }
+    }
+    return false;
+}
+
+uint64_t sim_keypad_next_us(void) {
+    return next_frame_us;
+}
+
+/**
+ * @brief Termina un cuadro: lo empuja a la FIFO si corresponde y levanta la interrupción.
+ */
+void sim_keypad_run(void) {
+    uint64_t now = sim_now_us();
+    uint16_t frame = scan(now);
+
+    bool send = true;
+    if (frame != 0) {
+        linger = keypad_LINGER_FRAMES;
+    } else if (linger > 0) {
+        linger--;
+    } else {
+        send = false;
+    }
+
+    if (send) {
+        if (fifo_count < FIFO_DEPTH) {
+            fifo[(fifo_head + fifo_count) % FIFO_DEPTH] = frame;
+            fifo_count++;
+        } else {
+            dropped++;      // `push noblock` descarta el cuadro
+        }
+        if (pio0_hw_inst.irq0_inte & (1u << (pis_sm0_rx_fifo_not_empty + keypad_sm_num))) {
+            sim_irq_raise(PIO0_IRQ_0);
+        }
+    }
+
+    next_frame_us = send || active(now) ? now + frame_us : SIM_NEVER;
+}
+
+uint pio_add_program(PIO pio, const pio_program_t *program) {
+    (void)pio;
+    (void)program;
+    return 0;
+}
+
+int pio_claim_unused_sm(PIO pio, bool required) {
+    (void)required;
+    return pio == pio1 ? sim_stepper_claim_sm() : 0;
+}
+
+void pio_sm_set_enabled(PIO pio, uint sm, bool enable) {
+    if (pio == pio1) {
+        sim_stepper_set_enabled(sm, enable);    // `pio1` es de los motores
+        return;
+    }
+    if (!attached || sm != keypad_sm_num || enable == enabled) {
+        return;
+    }
+    uint64_t now = sim_now_us();
+    enabled = enable;
+    if (enable) {
+        enabled_since_us = now;
+        if (active(now)) {
+            schedule_frame(now);
+        }
+    } else {
+        scan_us += now - enabled_since_us;
+        next_frame_us = SIM_NEVER;
+        linger = 0;
+        update_columns();
+    }
+}
+
+void pio_sm_clear_fifos(PIO pio, uint sm) {
+    (void)sm;
+    if (pio == pio1) {
+        return;     // El modelo de los motores no guarda palabras en la FIFO: las lee del DMA al tomarlas
+    }
+    fifo_count = 0;
+    fifo_head = 0;
+}
+
+void pio_sm_restart(PIO pio, uint sm) {
+    (void)pio;
+    (void)sm;
+    linger = 0;
+}
+
+void pio_sm_exec(PIO pio, uint sm, uint instr) {
+    (void)pio;
+    (void)sm;
+    (void)instr;
+}
+
+void pio_gpio_init(PIO pio, uint pin) {
+    (void)pio;
+    (void)pin;
+}
+
+bool pio_sm_is_rx_fifo_empty(PIO pio, uint sm) {
+    (void)pio;
+    (void)sm;
+    return fifo_count == 0;
+}
+
+uint32_t pio_sm_get(PIO pio, uint sm) {
+    (void)pio;
+    (void)sm;
+    if (fifo_count == 0) {
+        return 0;
+    }
+    uint16_t frame = fifo[fifo_head];
+    fifo_head = (fifo_head + 1) % FIFO_DEPTH;
+    fifo_count--;
+    return frame;
+}
+
+void pio_set_irq0_source_enabled(PIO pio, enum pio_interrupt_source source, bool enabled) {
+    if (enabled) {
+        pio->irq0_inte |= 1u << source;
+    } else {
+        pio->irq0_inte &= ~(1u << source);
+    }
+}
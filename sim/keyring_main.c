@@ -0,0 +1,282 @@
+/**
+ * @file keyring_main.c
+ * @brief Somete la cola de teclas de `keyring.c` a un productor mucho más rápido que
+ * el teclado y comprueba que no se pierda ni se desordene ningún evento.
+ *
+ * Uso: `matecash_keyring [eventos]` (por defecto 4000000). Hay dos pruebas:
+ *
+ * - Interrupción simulada, en un solo hilo: ráfagas aleatorias de hasta 48 teclas (más
+ *   que la capacidad de la cola) intercaladas con lecturas del lazo principal. Cada
+ *   `keyring_push()` y `keyring_pop()` se compara con una cola modelo: la cola tiene
+ *   que aceptar exactamente lo que cabe, contar cada desborde y devolver los eventos
+ *   en orden.
+ * - Dos hilos: uno empuja los eventos tan rápido como puede, como una interrupción en
+ *   el otro núcleo, y el otro los vacía con `keyring_drain()`. Al final los eventos
+ *   leídos tienen que ser exactamente los aceptados, en el mismo orden y sin cambios,
+ *   y los rechazados tienen que coincidir con `keyring_overflows()`.
+ *
+ * Cada evento lleva su número de secuencia como marca de tiempo y una tecla que se
+ * deriva de él, así un evento leído a medio escribir se detecta.
+ */
+
+#include "sim.h"
+#include "keyring.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Ráfaga máxima de la interrupción simulada.
+ */
+#define KEYRING_TEST_BURST 48
+
+/**
+ * @brief Rondas de ráfagas y lecturas de la prueba en un solo hilo.
+ */
+#define KEYRING_TEST_ROUNDS 200000
+
+/**
+ * @brief Pausa máxima del productor de la prueba con dos hilos, en vueltas de espera.
+ */
+#define KEYRING_TEST_SPIN 64
+
+static const char keys[] = "123A456B789C*0#D";
+
+/*
+ * El simulador espera estos ganchos de `sim_main.c`; aquí no se corre el firmware.
+ */
+
+uint64_t sim_script_next_us(void) {
+    return SIM_NEVER;
+}
+
+void sim_script_run(void) {
+}
+
+void sim_on_lcd_burst(uint64_t start_us) {
+    (void)start_us;
+}
+
+void sim_on_gpio(unsigned int gpio, bool value) {
+    (void)gpio;
+    (void)value;
+}
+
+void sim_finish(void) {
+}
+
+/**
+ * @brief Tecla que corresponde a un número de secuencia.
+ */
+static char key_for(uint32_t sequence) {
+    return keys[(sequence * 7u + (sequence >> 4)) % 16u];
+}
+
+/**
+ * @brief Estado del generador xorshift32; fijo, para repetir la misma prueba.
+ */
+static uint32_t rng_state = 0x2545F491u;
+
+static uint32_t rng_next(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+/**
+ * @brief Ráfagas intercaladas con lecturas, contra una cola modelo.
+ *
+ * @return Cantidad de problemas encontrados.
+ */
+static unsigned int check_bursts(void) {
+    unsigned int problems = 0;
+    uint32_t model[KEYRING_SIZE];
+    unsigned int model_head = 0, model_count = 0;
+    uint32_t sequence = 0;
+    uint32_t overflows = keyring_overflows();
+    uint32_t expected_overflows = 0;
+
+    for (unsigned int round = 0; round < KEYRING_TEST_ROUNDS && problems < 10; round++) {
+        unsigned int burst = rng_next() % (KEYRING_TEST_BURST + 1);
+        for (unsigned int i = 0; i < burst; i++, sequence++) {
+            bool fits = model_count < KEYRING_SIZE;
+            if (keyring_push(key_for(sequence), sequence) != fits) {
+                fprintf(stderr, "ráfagas: evento %lu %s con %u en la cola\n", (unsigned long)sequence,
+                        fits ? "rechazado" : "aceptado", model_count);
+                problems++;
+            }
+            if (fits) {
+                model[(model_head + model_count++) % KEYRING_SIZE] = sequence;
+            } else {
+                expected_overflows++;
+            }
+        }
+
+        unsigned int reads = rng_next() % (KEYRING_SIZE + 8);
+        for (unsigned int i = 0; i < reads; i++) {
+            KeyEvent event;
+            bool present = model_count > 0;
+            if (keyring_pop(&event) != present) {
+                fprintf(stderr, "ráfagas: la cola %s con %u eventos\n", present ? "vino vacía" : "devolvió algo",
+                        model_count);
+                problems++;
+                break;
+            }
+            if (!present) {
+                break;
+            }
+            uint32_t want = model[model_head];
+            model_head = (model_head + 1) % KEYRING_SIZE;
+            model_count--;
+            if (event.timestamp_us != want || event.key != key_for(want)) {
+                fprintf(stderr, "ráfagas: salió %lu '%c', se esperaba %lu '%c'\n", (unsigned long)event.timestamp_us,
+                        event.key, (unsigned long)want, key_for(want));
+                problems++;
+            }
+        }
+    }
+
+    // Vacía la cola para la prueba siguiente
+    KeyEvent event;
+    while (model_count > 0 && keyring_pop(&event)) {
+        model_count--;
+    }
+    if (keyring_pop(&event) || model_count != 0) {
+        fprintf(stderr, "ráfagas: la cola no terminó vacía\n");
+        problems++;
+    }
+    if (keyring_overflows() - overflows != expected_overflows) {
+        fprintf(stderr, "ráfagas: %lu desbordes contados, se esperaban %lu\n",
+                (unsigned long)(keyring_overflows() - overflows), (unsigned long)expected_overflows);
+        problems++;
+    }
+    fprintf(stderr, "ráfagas: %lu eventos, %lu desbordes\n", (unsigned long)sequence,
+            (unsigned long)expected_overflows);
+    return problems;
+}
+
+/**
+ * @brief Estado compartido de la prueba con dos hilos.
+ */
+static uint32_t producer_events = 0;
+static uint32_t *accepted = NULL;
+static uint32_t accepted_count = 0;
+static uint32_t *received = NULL;
+static uint32_t received_count = 0;
+static volatile bool producer_done = false;
+static volatile bool consumer_ready = false;
+static unsigned int received_problems = 0;
+
+/**
+ * @brief Productor: empuja los eventos sin esperar a que haya lugar, como una
+ * interrupción que no sabe si el lazo principal va al día.
+ *
+ * Entre evento y evento hace una pausa aleatoria corta, a veces nula, así la cola
+ * pasa por vacía, por llena y por todo lo del medio. Con la cola llena cede el
+ * procesador: la interrupción siguiente del teclado llegaría más tarde.
+ */
+static void *producer(void *arg) {
+    (void)arg;
+    uint32_t state = 0x9E3779B9u;
+    while (!__atomic_load_n(&consumer_ready, __ATOMIC_ACQUIRE)) {
+    }
+    for (uint32_t sequence = 0; sequence < producer_events; sequence++) {
+        if (keyring_push(key_for(sequence), sequence)) {
+            accepted[accepted_count++] = sequence;
+        } else {
+            sched_yield();      // Con un solo procesador, el consumidor solo corre si se le cede
+        }
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        for (volatile uint32_t spin = state % KEYRING_TEST_SPIN; spin > 0; spin--) {
+        }
+    }
+    __atomic_store_n(&producer_done, true, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+static void receive(const KeyEvent *event) {
+    if (event->key != key_for(event->timestamp_us) && received_problems++ < 10) {
+        fprintf(stderr, "hilos: el evento %lu llegó con la tecla '%c'\n", (unsigned long)event->timestamp_us,
+                event->key);
+    }
+    if (received_count < producer_events) {
+        received[received_count] = event->timestamp_us;
+    }
+    received_count++;
+}
+
+/**
+ * @brief Productor y consumidor en hilos distintos.
+ *
+ * @return Cantidad de problemas encontrados.
+ */
+static unsigned int check_threads(uint32_t events) {
+    unsigned int problems = 0;
+    producer_events = events;
+    accepted = malloc(events * sizeof(uint32_t));
+    received = malloc(events * sizeof(uint32_t));
+    if (!accepted || !received) {
+        perror("hilos");
+        exit(2);
+    }
+    uint32_t overflows = keyring_overflows();
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, producer, NULL) != 0) {
+        perror("pthread_create");
+        exit(2);
+    }
+    uint32_t drains = 0;
+    __atomic_store_n(&consumer_ready, true, __ATOMIC_RELEASE);
+    while (!__atomic_load_n(&producer_done, __ATOMIC_ACQUIRE)) {
+        if (keyring_drain(receive) > 0) {
+            drains++;
+        } else {
+            sched_yield();
+        }
+    }
+    keyring_drain(receive);
+    pthread_join(thread, NULL);
+
+    problems += received_problems;
+    if (received_count != accepted_count) {
+        fprintf(stderr, "hilos: se aceptaron %lu eventos y salieron %lu\n", (unsigned long)accepted_count,
+                (unsigned long)received_count);
+        problems++;
+    }
+    for (uint32_t i = 0; i < accepted_count && i < received_count; i++) {
+        if (received[i] != accepted[i]) {
+            fprintf(stderr, "hilos: en la posición %lu salió %lu, se esperaba %lu\n", (unsigned long)i,
+                    (unsigned long)received[i], (unsigned long)accepted[i]);
+            problems++;
+            break;
+        }
+    }
+    uint32_t counted = keyring_overflows() - overflows;
+    if (counted != events - accepted_count) {
+        fprintf(stderr, "hilos: %lu desbordes contados, se rechazaron %lu\n", (unsigned long)counted,
+                (unsigned long)(events - accepted_count));
+        problems++;
+    }
+    fprintf(stderr, "hilos: %lu eventos, %lu aceptados en %lu vaciados de la cola, %lu desbordes\n",
+            (unsigned long)events, (unsigned long)accepted_count, (unsigned long)drains, (unsigned long)counted);
+    free(accepted);
+    free(received);
+    return problems;
+}
+
+int main(int argc, char **argv) {
+    long events = argc > 1 ? strtol(argv[1], NULL, 10) : 4000000;
+    if (events <= 0 || events > 100000000) {
+        fprintf(stderr, "uso: %s [eventos]\n", argv[0]);
+        return 2;
+    }
+    unsigned int problems = check_bursts();
+    problems += check_threads((uint32_t)events);
+    fprintf(stderr, "problemas: %u\n", problems);
+    return problems ? 1 : 0;
+}
@@ -0,0 +1,307 @@
+/**
+ * @file logdecode.c
+ * @brief Decodificador de los mensajes de registro tokenizados.
+ *
+ * Los formatos salen del mismo `LOG_CATALOG` que compila el firmware, así que el
+ * decodificador corresponde siempre a la versión del árbol. Cada conversión del formato
+ * se imprime con `fprintf()` usando el tipo del argumento del registro, no el del
+ * formato: un formato que no coincide con sus tipos lo detecta `logdecode_check()`.
+ */
+
+#include "logdecode.h"
+#include "screens.h"
+#include <string.h>
+
+/**
+ * @brief Argumentos que puede tener un mensaje.
+ */
+#define LOGDECODE_ARGUMENTS 8
+
+/**
+ * @brief Largo máximo de una conversión, con su '%' y su terminador.
+ */
+#define LOGDECODE_SPEC_MAX 16
+
+/**
+ * @brief Mensaje del catálogo.
+ */
+typedef struct {
+    const char *name;       /**< ID, para los avisos */
+    const char *types;      /**< Tipos de los argumentos */
+    const char *format;     /**< Formato */
+} LogFormat;
+
+/**
+ * @brief Argumento leído de un registro.
+ */
+typedef struct {
+    char type;                          /**< Letra del catálogo */
+    uint32_t value;                     /**< Valor de `i` (en complemento a 2), `u` y `c` */
+    char text[LOG_STRING_MAX + 1];      /**< Valor de `s` */
+} LogArgument;
+
+#define LOGDECODE_ENTRY(id, types, format) [id] = {#id, types, format},
+#define LOGDECODE_SCREEN_ENTRY(id, console, ...) [id] = console,
+
+/**
+ * @brief Catálogo de mensajes, indexado por `LogId`.
+ */
+static const LogFormat log_formats[LOG_COUNT] = {
+    LOG_CATALOG(LOGDECODE_ENTRY)
+};
+
+/**
+ * @brief Textos de consola de las pantallas, indexados por `ScreenId`.
+ */
+static const char *const screen_console[SCREEN_COUNT] = {
+    SCREEN_CATALOG(LOGDECODE_SCREEN_ENTRY)
+};
+
+void logdecode_init(LogDecoder *decoder) {
+    memset(decoder, 0, sizeof(*decoder));
+}
+
+/**
+ * @brief Lee una conversión del formato.
+ *
+ * @param format Posición del '%'; queda después de la conversión.
+ * @param spec Donde se copia la conversión sin modificadores de largo.
+ * @return Letra de la conversión, '\0' si el formato terminó antes.
+ */
+static char parse_spec(const char **format, char *spec) {
+    const char *p = *format;
+    unsigned int length = 0;
+    spec[length++] = *p++;
+    while (*p && strchr("-+ #0123456789.", *p) && length < LOGDECODE_SPEC_MAX - 2) {
+        spec[length++] = *p++;
+    }
+    while (*p == 'l' || *p == 'h' || *p == 'z') {
+        p++;
+    }
+    char conversion = *p;
+    if (conversion) {
+        spec[length++] = conversion;
+        p++;
+    }
+    spec[length] = '\0';
+    *format = p;
+    return conversion;
+}
+
+/**
+ * @brief Tipo de argumento que toma una conversión.
+ *
+ * @return Letra del catálogo, '\0' si la conversión no se admite.
+ */
+static char argument_type(char conversion) {
+    switch (conversion) {
+    case 'd':
+    case 'i':
+        return 'i';
+    case 'u':
+    case 'x':
+    case 'X':
+    case '@':
+        return 'u';
+    case 'c':
+        return 'c';
+    case 's':
+        return 's';
+    default:
+        return '\0';
+    }
+}
+
+/**
+ * @brief Lee un entero en LEB128.
+ *
+ * @return false si el registro termina antes.
+ */
+static bool get_varint(const uint8_t *payload, unsigned int size, unsigned int *pos, uint32_t *value) {
+    uint32_t result = 0;
+    for (unsigned int shift = 0; shift < 35 && *pos < size; shift += 7) {
+        uint8_t byte = payload[(*pos)++];
+        result |= (uint32_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Lee los argumentos de un registro según sus tipos.
+ *
+ * @return false si los argumentos no ocupan exactamente el registro.
+ */
+static bool parse_arguments(const uint8_t *payload, unsigned int size, const char *types, LogArgument *args) {
+    unsigned int pos = 0;
+    for (unsigned int n = 0; types[n]; n++) {
+        LogArgument *arg = &args[n];
+        arg->type = types[n];
+        if (arg->type == 'i' || arg->type == 'u') {
+            if (!get_varint(payload, size, &pos, &arg->value)) {
+                return false;
+            }
+            if (arg->type == 'i') {
+                arg->value = (arg->value >> 1) ^ (0u - (arg->value & 1));
+            }
+        } else if (arg->type == 'c') {
+            if (pos >= size) {
+                return false;
+            }
+            arg->value = payload[pos++];
+        } else {
+            unsigned int length = pos < size ? payload[pos++] : LOG_STRING_MAX + 1;
+            if (length > LOG_STRING_MAX || length > size - pos) {
+                return false;
+            }
+            memcpy(arg->text, &payload[pos], length);
+            arg->text[length] = '\0';
+            pos += length;
+        }
+    }
+    return pos == size;
+}
+
+/**
+ * @brief Escribe el texto de un mensaje.
+ *
+ * @return false si el formato pide más argumentos o de otro tipo.
+ */
+static bool render(const char *format, const LogArgument *args, unsigned int count, FILE *out) {
+    unsigned int next = 0;
+    while (*format) {
+        if (*format != '%') {
+            fputc(*format++, out);
+            continue;
+        }
+        char spec[LOGDECODE_SPEC_MAX];
+        char conversion = parse_spec(&format, spec);
+        if (conversion == '%') {
+            fputc('%', out);
+            continue;
+        }
+        if (next >= count || argument_type(conversion) != args[next].type) {
+            return false;
+        }
+        const LogArgument *arg = &args[next++];
+        if (conversion == '@') {
+            if (arg->value < SCREEN_COUNT && screen_console[arg->value]) {
+                fputs(screen_console[arg->value], out);
+            }
+        } else if (arg->type == 'i') {
+            fprintf(out, spec, (int)(int32_t)arg->value);
+        } else if (arg->type == 'u') {
+            fprintf(out, spec, (unsigned int)arg->value);
+        } else if (arg->type == 'c') {
+            fprintf(out, spec, (int)arg->value);
+        } else {
+            fprintf(out, spec, arg->text);
+        }
+    }
+    return next == count;
+}
+
+/**
+ * @brief Decodifica el registro completo del decodificador.
+ */
+static void decode_record(LogDecoder *decoder, FILE *out) {
+    const LogFormat *entry = &log_formats[decoder->record[1]];
+    LogArgument args[LOGDECODE_ARGUMENTS];
+    unsigned int count = (unsigned int)strlen(entry->types);
+    if (count > LOGDECODE_ARGUMENTS ||
+        !parse_arguments(&decoder->record[3], decoder->record[2], entry->types, args) ||
+        !render(entry->format, args, count, out)) {
+        decoder->rejected++;
+        return;
+    }
+    decoder->decoded++;
+}
+
+void logdecode_feed(LogDecoder *decoder, uint8_t byte, FILE *out) {
+    if (decoder->length == 0) {
+        if (byte == LOG_FRAME_START) {
+            decoder->record[decoder->length++] = byte;
+        } else {
+            fputc(byte, out);
+        }
+        return;
+    }
+
+    decoder->record[decoder->length++] = byte;
+    if ((decoder->length == 2 && byte >= LOG_COUNT) || (decoder->length == 3 && byte > LOG_RECORD_MAX - 3)) {
+        // Se empieza de nuevo con el byte siguiente; el próximo `LOG_FRAME_START` resincroniza
+        decoder->rejected++;
+        decoder->length = 0;
+        return;
+    }
+    if (decoder->length < 3 || decoder->length < 3u + decoder->record[2]) {
+        return;
+    }
+    decode_record(decoder, out);
+    decoder->length = 0;
+}
+
+unsigned int logdecode_check(FILE *err) {
+    unsigned int problems = 0;
+    for (unsigned int id = 0; id < LOG_COUNT; id++) {
+        const LogFormat *entry = &log_formats[id];
+        unsigned int count = (unsigned int)strlen(entry->types);
+        unsigned int size = 3;
+        for (unsigned int n = 0; n < count; n++) {
+            char type = entry->types[n];
+            if (type == 'i' || type == 'u') {
+                size += 5;
+            } else if (type == 'c') {
+                size += 1;
+            } else if (type == 's') {
+                size += 1 + LOG_STRING_MAX;
+            } else {
+                fprintf(err, "%s: tipo '%c' desconocido\n", entry->name, type);
+                problems++;
+            }
+        }
+        if (count > LOGDECODE_ARGUMENTS) {
+            fprintf(err, "%s: %u argumentos, el máximo es %u\n", entry->name, count, LOGDECODE_ARGUMENTS);
+            problems++;
+        }
+        if (size > LOG_RECORD_MAX) {
+            fprintf(err, "%s: el registro puede ocupar %u bytes, el máximo es %u\n", entry->name, size,
+                    LOG_RECORD_MAX);
+            problems++;
+        }
+
+        unsigned int next = 0;
+        for (const char *format = entry->format; *format;) {
+            if (*format != '%') {
+                format++;
+                continue;
+            }
+            char spec[LOGDECODE_SPEC_MAX];
+            char conversion = parse_spec(&format, spec);
+            if (conversion == '%') {
+                continue;
+            }
+            char type = argument_type(conversion);
+            if (type == '\0') {
+                fprintf(err, "%s: conversión \"%s\" no admitida\n", entry->name, spec);
+                problems++;
+            } else if (next >= count) {
+                fprintf(err, "%s: el formato pide más argumentos que los %u del catálogo\n", entry->name, count);
+                problems++;
+            } else if (entry->types[next] != type) {
+                fprintf(err, "%s: la conversión \"%s\" no corresponde al argumento %u ('%c')\n", entry->name,
+                        spec, next + 1, entry->types[next]);
+                problems++;
+            }
+            next++;
+        }
+        if (next < count) {
+            fprintf(err, "%s: el formato usa %u de los %u argumentos\n", entry->name, next, count);
+            problems++;
+        }
+    }
+    return problems;
+}
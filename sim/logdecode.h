@@ -0,0 +1,55 @@
+/**
+ * @file logdecode.h
+ * @brief Decodificador de los mensajes de registro tokenizados de `log.h`.
+ *
+ * Convierte la salida binaria de la consola del cajero en el texto de siempre, con los
+ * formatos de `LOG_CATALOG` y los textos de consola de `SCREEN_CATALOG`. Lo usan la
+ * consola del simulador (`putchar_raw()` de `hal.c`) y `matecash_logdecode` para las
+ * capturas hechas en el cajero.
+ *
+ * Los bytes fuera de un registro se copian tal cual, así un mensaje de texto del SDK
+ * (por ejemplo, un `panic()`) sigue siendo legible. Un registro con un número de
+ * mensaje o un largo imposible, o cuyos argumentos no coinciden con el catálogo, se
+ * descarta y se cuenta.
+ */
+#ifndef SIM_LOGDECODE_H
+#define SIM_LOGDECODE_H
+
+#include "log.h"
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * @brief Estado del decodificador entre bytes.
+ */
+typedef struct {
+    uint8_t record[LOG_RECORD_MAX]; /**< Registro en curso, cabecera incluida */
+    unsigned int length;            /**< Bytes recibidos del registro en curso; 0 fuera de un registro */
+    uint32_t decoded;               /**< Registros decodificados */
+    uint32_t rejected;              /**< Registros descartados */
+} LogDecoder;
+
+/**
+ * @brief Deja el decodificador esperando el comienzo de un registro, sin contadores.
+ */
+void logdecode_init(LogDecoder *decoder);
+
+/**
+ * @brief Entrega un byte de la consola.
+ *
+ * @param decoder Decodificador.
+ * @param byte Byte recibido.
+ * @param out Donde se escribe el texto.
+ */
+void logdecode_feed(LogDecoder *decoder, uint8_t byte, FILE *out);
+
+/**
+ * @brief Revisa que los formatos del catálogo usen los argumentos de sus tipos, en
+ * orden, y que cada mensaje entre en `LOG_RECORD_MAX` con los textos más largos.
+ *
+ * @param err Donde se describe cada problema.
+ * @return Cantidad de problemas encontrados.
+ */
+unsigned int logdecode_check(FILE *err);
+
+#endif // SIM_LOGDECODE_H
@@ -0,0 +1,77 @@
+/**
+ * @file logdecode_main.c
+ * @brief Convierte en texto la salida de la consola USB del cajero.
+ *
+ * Uso: `matecash_logdecode [captura.bin]` lee la salida cruda de la consola (de la
+ * captura o, sin argumento, de la entrada estándar, por ejemplo
+ * `cat /dev/ttyACM0 | matecash_logdecode`) y escribe el texto por la salida estándar.
+ * El resultado es el que se le pasa a `matecash_replay`.
+ *
+ * `matecash_logdecode -c` no decodifica nada: revisa que los formatos de `LOG_CATALOG`
+ * correspondan a los tipos de sus argumentos y que cada mensaje entre en un registro.
+ *
+ * Hay que usar el decodificador compilado desde el mismo árbol que el firmware: los
+ * números de mensaje son la posición en el catálogo.
+ */
+
+#include "sim.h"
+#include "logdecode.h"
+#include <string.h>
+
+/*
+ * El simulador espera estos ganchos de `sim_main.c`; aquí no se corre el firmware.
+ */
+
+uint64_t sim_script_next_us(void) {
+    return SIM_NEVER;
+}
+
+void sim_script_run(void) {
+}
+
+void sim_on_lcd_burst(uint64_t start_us) {
+    (void)start_us;
+}
+
+void sim_on_gpio(unsigned int gpio, bool value) {
+    (void)gpio;
+    (void)value;
+}
+
+void sim_finish(void) {
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1 && strcmp(argv[1], "-c") == 0) {
+        unsigned int problems = logdecode_check(stderr);
+        fprintf(stderr, "%u mensajes, problemas: %u\n", (unsigned int)LOG_COUNT, problems);
+        return problems ? 1 : 0;
+    }
+    if (argc > 2 || (argc == 2 && argv[1][0] == '-')) {
+        fprintf(stderr, "uso: %s [-c] [captura.bin]\n", argv[0]);
+        return 2;
+    }
+
+    FILE *in = stdin;
+    if (argc == 2 && !(in = fopen(argv[1], "rb"))) {
+        perror(argv[1]);
+        return 2;
+    }
+    LogDecoder decoder;
+    logdecode_init(&decoder);
+    int c;
+    while ((c = fgetc(in)) != EOF) {
+        logdecode_feed(&decoder, (uint8_t)c, stdout);
+        if (in == stdin && decoder.length == 0) {
+            fflush(stdout);             // Para seguir la consola en vivo
+        }
+    }
+    if (in != stdin) {
+        fclose(in);
+    }
+    if (decoder.rejected > 0) {
+        fprintf(stderr, "logdecode: %lu registros decodificados, %lu descartados\n", (unsigned long)decoder.decoded,
+                (unsigned long)decoder.rejected);
+    }
+    return 0;
+}
@@ -0,0 +1,205 @@
+/**
+ * @file money_main.c
+ * @brief Compara `money_format_field()` y `money_format()` con un formateo hecho con
+ * `snprintf()` y mide cuánto tarda cada uno.
+ *
+ * Uso: `matecash_money [valores]` (por defecto 1000000). Cada valor, aleatorio o de la
+ * lista de bordes (cero, ±1, potencias de 10, `INT64_MIN`, `INT64_MAX`), se escribe en
+ * campos de todos los anchos entre 0 y `MONEY_TEXT_MAX + 1`, con bytes testigo antes y
+ * después del campo, y se exige:
+ *
+ * - que el campo sea igual al de referencia: el monto alineado a la derecha, o lleno de
+ *   '#' si no cabe;
+ * - que no se escriba nada fuera del campo;
+ * - que `money_format()` dé el mismo texto, sin el '$'.
+ *
+ * Al final compara el tiempo de `money_format_field()` sobre los 14 caracteres del saldo
+ * con el de `snprintf("%14.2f")`, que usaba antes `displayBalance()`.
+ *
+ * Solo necesita `money.c`, así que también se compila sin el simulador:
+ * `cc -O2 -I. sim/money_main.c money.c -o matecash_money`.
+ */
+
+#include "money.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * @brief Bytes testigo a cada lado del campo.
+ */
+#define MONEY_GUARD 8
+
+/**
+ * @brief Valor de los bytes testigo.
+ */
+#define MONEY_GUARD_BYTE 0x5A
+
+/**
+ * @brief Ancho del campo del saldo en la pantalla (`FIELD_BALANCE`).
+ */
+#define MONEY_BALANCE_WIDTH 14
+
+/**
+ * @brief Llamadas de cada lado en la medición.
+ */
+#define MONEY_BENCH_CALLS 2000000
+
+/**
+ * @brief Estado del generador xorshift64; fijo, para repetir las mismas pruebas.
+ */
+static uint64_t rng_state = 0x9E3779B97F4A7C15ull;
+
+static uint64_t rng_next(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+/**
+ * @brief Monto aleatorio con una cantidad de bits también aleatoria, así aparecen
+ * todas las cantidades de dígitos.
+ */
+static money_t random_amount(void) {
+    uint64_t bits = rng_next();
+    uint64_t magnitude = bits >> (rng_next() % 64);
+    return (money_t)((bits & 1) ? 0 - magnitude : magnitude);
+}
+
+static uint64_t host_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+}
+
+/**
+ * @brief Texto de referencia: signo, '$' y dígitos de `snprintf()` con un punto cada
+ * tres desde la derecha.
+ *
+ * @return Largo del texto.
+ */
+static size_t reference_text(money_t value, char *text) {
+    unsigned long long magnitude = value < 0 ? 0ull - (unsigned long long)value : (unsigned long long)value;
+    char digits[24];
+    int count = snprintf(digits, sizeof(digits), "%llu", magnitude);
+    size_t length = 0;
+    if (value < 0) {
+        text[length++] = '-';
+    }
+    text[length++] = '$';
+    for (int i = 0; i < count; i++) {
+        if (i > 0 && (count - i) % 3 == 0) {
+            text[length++] = '.';
+        }
+        text[length++] = digits[i];
+    }
+    text[length] = '\0';
+    return length;
+}
+
+/**
+ * @brief Revisa un monto en todos los anchos de campo y con `money_format()`.
+ *
+ * @return Cantidad de problemas encontrados.
+ */
+static unsigned int check_value(money_t value) {
+    unsigned int problems = 0;
+    char text[MONEY_TEXT_MAX + 2];
+    size_t length = reference_text(value, text);
+
+    for (size_t width = 0; width <= MONEY_TEXT_MAX + 1; width++) {
+        char expected[MONEY_TEXT_MAX + 1];
+        bool fits = length <= width;
+        if (fits) {
+            memset(expected, ' ', width - length);
+            memcpy(&expected[width - length], text, length);
+        } else {
+            memset(expected, '#', width);
+        }
+
+        char buffer[MONEY_GUARD + MONEY_TEXT_MAX + 1 + MONEY_GUARD];
+        memset(buffer, MONEY_GUARD_BYTE, sizeof(buffer));
+        char *field = &buffer[MONEY_GUARD];
+        bool result = money_format_field(value, field, width);
+
+        bool guards = true;
+        for (size_t i = 0; i < sizeof(buffer); i++) {
+            if ((i < MONEY_GUARD || i >= MONEY_GUARD + width) && buffer[i] != MONEY_GUARD_BYTE) {
+                guards = false;
+            }
+        }
+        if (!guards) {
+            fprintf(stderr, "%lld en %zu caracteres: escribió fuera del campo\n", (long long)value, width);
+            problems++;
+        }
+        if (result != fits || memcmp(field, expected, width) != 0) {
+            fprintf(stderr, "%lld en %zu caracteres: \"%.*s\" (%s), se esperaba \"%.*s\"\n", (long long)value,
+                    width, (int)width, field, result ? "cabe" : "no cabe", (int)width, expected);
+            problems++;
+        }
+    }
+
+    // `money_format()` escribe lo mismo sin el '$'
+    char plain[MONEY_TEXT_MAX];
+    char *dollar = strchr(text, '$');
+    memmove(dollar, dollar + 1, strlen(dollar));
+    size_t written = money_format(value, plain, sizeof(plain));
+    if (written != length - 1 || strcmp(plain, text) != 0) {
+        fprintf(stderr, "money_format(%lld): \"%s\", se esperaba \"%s\"\n", (long long)value, plain, text);
+        problems++;
+    }
+    return problems;
+}
+
+int main(int argc, char **argv) {
+    long iterations = argc > 1 ? strtol(argv[1], NULL, 10) : 1000000;
+    if (iterations < 0) {
+        fprintf(stderr, "uso: %s [valores]\n", argv[0]);
+        return 2;
+    }
+
+    unsigned int problems = 0;
+    static const money_t edges[] = {0, 1, -1, 9, 10, 999, 1000, -1000, 999999, 1000000, 220000, -220000,
+                                    INT32_MAX, (money_t)INT32_MAX + 1, UINT32_MAX, (money_t)UINT32_MAX + 1,
+                                    INT64_MAX, INT64_MIN, INT64_MIN + 1};
+    for (size_t i = 0; i < sizeof(edges) / sizeof(edges[0]); i++) {
+        problems += check_value(edges[i]);
+    }
+    for (money_t power = 1; power <= INT64_MAX / 10; power *= 10) {
+        problems += check_value(power * 10 - 1);
+        problems += check_value(power * 10);
+        problems += check_value(-power * 10);
+    }
+    for (long n = 0; n < iterations && problems < 20; n++) {
+        problems += check_value(random_amount());
+    }
+
+    // Saldos de hasta mil millones, como los de la tabla de usuarios
+    static money_t balances[1024];
+    for (size_t i = 0; i < sizeof(balances) / sizeof(balances[0]); i++) {
+        balances[i] = (money_t)(rng_next() % 1000000001u);
+    }
+    char row[21];
+    volatile char sink = 0;
+    uint64_t start_ns = host_ns();
+    for (unsigned int n = 0; n < MONEY_BENCH_CALLS; n++) {
+        money_format_field(balances[n % 1024], &row[6], MONEY_BALANCE_WIDTH);
+        sink ^= row[19];
+    }
+    uint64_t field_ns = host_ns() - start_ns;
+    start_ns = host_ns();
+    for (unsigned int n = 0; n < MONEY_BENCH_CALLS; n++) {
+        snprintf(row, sizeof(row), "Saldo:%14.2f", (double)balances[n % 1024]);
+        sink ^= row[19];
+    }
+    uint64_t printf_ns = host_ns() - start_ns;
+    (void)sink;
+
+    fprintf(stderr, "%ld valores aleatorios y los bordes, en anchos de 0 a %d\n", iterations, MONEY_TEXT_MAX + 1);
+    fprintf(stderr, "money_format_field: %.1f ns por monto, snprintf(\"%%14.2f\"): %.1f ns\n",
+            (double)field_ns / MONEY_BENCH_CALLS, (double)printf_ns / MONEY_BENCH_CALLS);
+    fprintf(stderr, "problemas: %u\n", problems);
+    return problems ? 1 : 0;
+}
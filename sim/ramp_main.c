@@ -0,0 +1,250 @@
+/**
+ * @file ramp_main.c
+ * @brief Revisa los perfiles de `ramp.c` y los pulsos que salen por los pines STEP
+ * con el dispensador de `pwm.c` sobre el modelo de `stepper.pio`.
+ *
+ * Uso: `matecash_ramp [-v]`. Para cada perfil (los de `denominations[]` y otros de
+ * prueba: triangular, de un paso, inválidos) se comprueba que los períodos:
+ *
+ * - empiecen y terminen a la velocidad de arranque y no bajen de la de crucero;
+ * - sean simétricos y no aumenten hasta la mitad del billete;
+ * - no cambien la velocidad de un paso al siguiente más de lo que permite la aceleración.
+ *
+ * Después se sacan dos billetes por canal, todos los canales a la vez, y se compara
+ * cada intervalo entre flancos de subida con el período calculado, más la pausa de
+ * `MOTOR_REST_MS` entre los dos billetes. `-v` imprime la línea de tiempo de cada canal.
+ */
+
+#include "sim.h"
+#include "tcl.h"
+#include "pwm.h"
+#include "ramp.h"
+#include "timewheel.h"
+#include "log.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Billetes por canal en la prueba de los pulsos.
+ */
+#define RAMP_TEST_NOTES 2
+
+/**
+ * @brief Pasos que se registran por canal.
+ */
+#define RAMP_TEST_EDGES (RAMP_TEST_NOTES * RAMP_MAX_STEPS)
+
+/**
+ * @brief Perfil de prueba y si `ramp_build()` debe aceptarlo.
+ */
+typedef struct {
+    const char *name;
+    RampProfile profile;
+    bool valid;
+} RampCase;
+
+static const RampCase extra_cases[] = {
+    {"triangular", {60, 400, 2400, 24000}, true},
+    {"un paso", {1, 500, 500, 1000}, true},
+    {"sin rampa", {100, 1000, 1000, 50000}, true},
+    {"lento", {RAMP_MAX_STEPS, 50, 300, 400}, true},
+    {"sin pasos", {0, 400, 2400, 24000}, false},
+    {"demasiados pasos", {RAMP_MAX_STEPS + 1, 400, 2400, 24000}, false},
+    {"crucero bajo", {100, 800, 400, 24000}, false},
+};
+
+static const uint8_t test_pins[DISPENSER_CHANNELS] = {16, 17, 18, 19};
+
+/**
+ * @brief Flancos de subida de cada pin STEP.
+ */
+static uint64_t rise_us[DISPENSER_CHANNELS][RAMP_TEST_EDGES];
+static unsigned int rise_count[DISPENSER_CHANNELS];
+static unsigned int notes_done[DISPENSER_CHANNELS];
+
+/*
+ * El simulador espera estos ganchos de `sim_main.c`; aquí no hay guion ni reporte.
+ */
+
+uint64_t sim_script_next_us(void) {
+    return SIM_NEVER;
+}
+
+void sim_script_run(void) {
+}
+
+void sim_on_lcd_burst(uint64_t start_us) {
+    (void)start_us;
+}
+
+void sim_on_gpio(unsigned int gpio, bool value) {
+    for (unsigned int i = 0; i < DISPENSER_CHANNELS; i++) {
+        if (test_pins[i] == gpio && value && rise_count[i] < RAMP_TEST_EDGES) {
+            rise_us[i][rise_count[i]++] = sim_now_us();
+        }
+    }
+}
+
+void sim_finish(void) {
+    fprintf(stderr, "ramp: el firmware quedó esperando sin eventos\n");
+    exit(1);
+}
+
+static void note_done(unsigned int channel, DispenseResult result, unsigned int notes, unsigned int remaining) {
+    (void)result;
+    (void)remaining;
+    notes_done[channel] += notes;
+}
+
+/**
+ * @brief Revisa los períodos de un perfil.
+ *
+ * @return Cantidad de problemas encontrados.
+ */
+static unsigned int check_profile(const char *name, const RampProfile *p, bool valid) {
+    static uint32_t periods[RAMP_MAX_STEPS + 1];
+    unsigned int steps = ramp_build(p, periods, RAMP_MAX_STEPS);
+    if (!valid) {
+        if (steps != 0) {
+            fprintf(stderr, "%s: se aceptó un perfil inválido\n", name);
+            return 1;
+        }
+        return 0;
+    }
+    if (steps != p->steps) {
+        fprintf(stderr, "%s: %u pasos, se esperaban %u\n", name, steps, p->steps);
+        return 1;
+    }
+
+    unsigned int problems = 0;
+    uint32_t start_period = (1000000u + p->start_sps / 2) / p->start_sps;
+    uint32_t cruise_period = (1000000u + p->cruise_sps / 2) / p->cruise_sps;
+    if (periods[0] != start_period || periods[steps - 1] != start_period) {
+        fprintf(stderr, "%s: arranca en %lu us y termina en %lu us, se esperaban %lu us\n", name,
+                (unsigned long)periods[0], (unsigned long)periods[steps - 1], (unsigned long)start_period);
+        problems++;
+    }
+    for (unsigned int i = 0; i < steps; i++) {
+        if (periods[i] < cruise_period) {
+            fprintf(stderr, "%s: paso %u de %lu us, más rápido que el crucero\n", name, i, (unsigned long)periods[i]);
+            problems++;
+            break;
+        }
+        if (periods[i] != periods[steps - 1 - i]) {
+            fprintf(stderr, "%s: la rampa no es simétrica en el paso %u\n", name, i);
+            problems++;
+            break;
+        }
+        if (i > 0 && i < (steps + 1) / 2 && periods[i] > periods[i - 1]) {
+            fprintf(stderr, "%s: el paso %u es más lento que el anterior al acelerar\n", name, i);
+            problems++;
+            break;
+        }
+        if (i > 0) {
+            // Cambio de velocidad entre los centros de dos pasos: el menor que admite el
+            // redondeo de los períodos a 1 us, que cerca del crucero pesa más que la rampa
+            double fast0 = 1e6 / (periods[i - 1] - 0.5), slow0 = 1e6 / (periods[i - 1] + 0.5);
+            double fast1 = 1e6 / (periods[i] - 0.5), slow1 = 1e6 / (periods[i] + 0.5);
+            double change = slow1 - fast0 > fast1 - slow0 ? slow1 - fast0 : slow0 - fast1;
+            double accel = (change > 0 ? change : 0) * 2e6 / (double)(periods[i - 1] + periods[i]);
+            if (accel > p->accel_sps2 * 1.01) {
+                fprintf(stderr, "%s: paso %u acelera %.0f pasos/s², el máximo es %lu\n", name, i, accel,
+                        (unsigned long)p->accel_sps2);
+                problems++;
+                break;
+            }
+        }
+    }
+    return problems;
+}
+
+/**
+ * @brief Saca `RAMP_TEST_NOTES` billetes por canal y compara los flancos con las rampas.
+ *
+ * @return Cantidad de problemas encontrados.
+ */
+static unsigned int check_pulses(const RampProfile *profiles, bool verbose) {
+    static uint32_t periods[DISPENSER_CHANNELS][RAMP_MAX_STEPS];
+    unsigned int steps[DISPENSER_CHANNELS];
+    unsigned int problems = 0;
+
+    sim_reset();
+    log_init();
+    timewheel_init();
+    memset(rise_count, 0, sizeof(rise_count));
+    memset(notes_done, 0, sizeof(notes_done));
+    dispenser_init(test_pins, profiles, NULL, DISPENSER_CHANNELS, note_done);
+    for (unsigned int c = 0; c < DISPENSER_CHANNELS; c++) {
+        steps[c] = ramp_build(&profiles[c], periods[c], RAMP_MAX_STEPS);
+        dispenser_enqueue(c, RAMP_TEST_NOTES);
+    }
+    while (sim_step()) {
+    }
+    log_drain();
+    if (dispenser_busy()) {
+        fprintf(stderr, "pulsos: el dispensador quedó ocupado\n");
+        problems++;
+    }
+
+    for (unsigned int c = 0; c < DISPENSER_CHANNELS; c++) {
+        if (notes_done[c] != RAMP_TEST_NOTES || rise_count[c] != RAMP_TEST_NOTES * steps[c]) {
+            fprintf(stderr, "canal %u: %u billetes y %u pasos, se esperaban %u y %u\n", c, notes_done[c],
+                    rise_count[c], RAMP_TEST_NOTES, RAMP_TEST_NOTES * steps[c]);
+            problems++;
+            continue;
+        }
+        for (unsigned int k = 1; k < rise_count[c]; k++) {
+            uint64_t interval = rise_us[c][k] - rise_us[c][k - 1];
+            unsigned int step = (k - 1) % steps[c];
+            if (step == steps[c] - 1) {
+                // Entre billetes: el último paso completo, la IRQ y la pausa
+                if (interval < periods[c][step] + MOTOR_REST_MS * 1000u) {
+                    fprintf(stderr, "canal %u: sin pausa entre billetes (%llu us)\n", c,
+                            (unsigned long long)interval);
+                    problems++;
+                }
+            } else if (interval != periods[c][step]) {
+                fprintf(stderr, "canal %u: paso %u duró %llu us, la rampa dice %lu us\n", c, step,
+                        (unsigned long long)interval, (unsigned long)periods[c][step]);
+                problems++;
+                break;
+            }
+        }
+        if (verbose) {
+            printf("canal %u:", c);
+            for (unsigned int k = 0; k < rise_count[c]; k++) {
+                printf(" %llu", (unsigned long long)rise_us[c][k]);
+            }
+            printf("\n");
+        }
+        fprintf(stderr, "canal %u: %u pasos por billete, %.1f ms por billete, %.1f ms con la pausa\n", c,
+                steps[c], ramp_duration_us(periods[c], steps[c]) / 1000.0,
+                ramp_duration_us(periods[c], steps[c]) / 1000.0 + MOTOR_REST_MS);
+    }
+    return problems;
+}
+
+int main(int argc, char **argv) {
+    bool verbose = argc > 1 && strcmp(argv[1], "-v") == 0;
+    unsigned int problems = 0;
+
+    RampProfile profiles[DISPENSER_CHANNELS];
+    for (unsigned int i = 0; i < NUM_DENOMINATIONS; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "canal %u", i);
+        problems += check_profile(name, &denominations[i].ramp, true);
+        profiles[i] = denominations[i].ramp;
+    }
+    for (size_t i = 0; i < sizeof(extra_cases) / sizeof(extra_cases[0]); i++) {
+        problems += check_profile(extra_cases[i].name, &extra_cases[i].profile, extra_cases[i].valid);
+    }
+    problems += check_pulses(profiles, verbose);
+
+    // Perfiles distintos a la vez en los cuatro canales
+    RampProfile mixed[DISPENSER_CHANNELS] = {extra_cases[0].profile, extra_cases[1].profile,
+                                             extra_cases[2].profile, extra_cases[3].profile};
+    problems += check_pulses(mixed, verbose);
+
+    fprintf(stderr, "problemas: %u\n", problems);
+    return problems ? 1 : 0;
+}
@@ -0,0 +1,299 @@
+/**
+ * @file replay_main.c
+ * @brief Reproduce en lote sesiones capturadas en el cajero contra la máquina de
+ * estados de `tcl.c` y mide cuánto tarda cada tecla en el host.
+ *
+ * Uso: `matecash_replay [-n N] [-v] captura.txt`. La captura es la salida de la consola
+ * con la captura de sesiones activada (comando 'r'), ya pasada por `matecash_logdecode`;
+ * se usan solo las líneas "@k", así que se puede pasar el registro completo. Conviene empezar la captura en la pantalla
+ * de bienvenida y con las cuentas de fábrica, que es como arranca cada pasada.
+ *
+ * Cada tecla se entrega a `process_key()` en el mismo momento relativo en que se
+ * procesó en el cajero, sobre el reloj virtual del simulador, así las alarmas (tiempo
+ * de ingreso, motores) disparan igual que en la captura. Después de cada tecla se
+ * compara el estado, la pantalla y la huella del LCD con lo capturado.
+ *
+ * Lo que se mide con el reloj del host es `process_key()` más `iocore_lcd_flush()`
+ * (búsqueda de usuario, guardas, acciones, pantalla y codificación de la ráfaga), con
+ * los mensajes de consola solo encolados, como en el cajero; se agrupa por el estado en
+ * que estaba la sesión al llegar la tecla. Antes de cada pasada se restauran las cuentas y los billetes.
+ */
+
+#include "sim.h"
+#include "tcl.h"
+#include "events.h"
+#include "timewheel.h"
+#include "iocore.h"
+#include "log.h"
+#include "acctlog.h"
+#include "screens.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * @brief Divergencias que se imprimen con detalle.
+ */
+#define REPLAY_SHOW_DIVERGENCES 10
+
+/**
+ * @brief Tecla capturada y lo que quedó después de procesarla.
+ */
+typedef struct {
+    uint32_t time_us;   /**< Momento de la interrupción en el cajero */
+    char key;           /**< Tecla */
+    int state;          /**< `SystemState` resultante */
+    int screen;         /**< `ScreenId` resultante */
+    uint32_t hash;      /**< Huella del LCD resultante */
+} RecordedKey;
+
+/**
+ * @brief Muestras de tiempo de una tecla, en nanosegundos.
+ */
+typedef struct {
+    uint32_t *ns;
+    size_t count;
+    size_t capacity;
+} Samples;
+
+static const char *const state_names[STATE_COUNT] = {
+    [STATE_ENTER_ID] = "ENTER_ID",
+    [STATE_ENTER_PASSWORD] = "ENTER_PASSWORD",
+    [STATE_LOGGED_IN] = "LOGGED_IN",
+    [STATE_CHECK_BALANCE] = "CHECK_BALANCE",
+    [STATE_WITHDRAW_MONEY] = "WITHDRAW_MONEY",
+    [STATE_CHANGE_PASSWORD] = "CHANGE_PASSWORD",
+    [STATE_CONFIRM_PASSWORD] = "CONFIRM_PASSWORD",
+    [STATE_ENTER_AMOUNT] = "ENTER_AMOUNT",
+};
+
+static RecordedKey *recorded = NULL;
+static size_t recorded_count = 0;
+static Samples samples[STATE_COUNT];
+
+/*
+ * El simulador espera estos ganchos de `sim_main.c`; aquí no hay guion ni reporte.
+ */
+
+uint64_t sim_script_next_us(void) {
+    return SIM_NEVER;
+}
+
+void sim_script_run(void) {
+}
+
+void sim_on_lcd_burst(uint64_t start_us) {
+    (void)start_us;
+}
+
+void sim_on_gpio(unsigned int gpio, bool value) {
+    (void)gpio;
+    (void)value;
+}
+
+void sim_finish(void) {
+    fprintf(stderr, "replay: el firmware quedó esperando sin eventos\n");
+    exit(1);
+}
+
+static uint64_t host_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+}
+
+static void add_sample(Samples *s, uint32_t ns) {
+    if (s->count == s->capacity) {
+        s->capacity = s->capacity ? s->capacity * 2 : 256;
+        s->ns = realloc(s->ns, s->capacity * sizeof(uint32_t));
+        if (!s->ns) {
+            fprintf(stderr, "replay: sin memoria\n");
+            exit(1);
+        }
+    }
+    s->ns[s->count++] = ns;
+}
+
+static int compare_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Lee las líneas "@k" de una captura.
+ */
+static void load_capture(const char *path) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        perror(path);
+        exit(2);
+    }
+
+    char line[128];
+    size_t capacity = 0;
+    while (fgets(line, sizeof(line), file)) {
+        const char *start = strstr(line, "@k ");
+        unsigned long time_us;
+        unsigned long hash;
+        RecordedKey key;
+        if (!start || sscanf(start, "@k %lu %c %d %d %lx", &time_us, &key.key, &key.state, &key.screen,
+                             &hash) != 5) {
+            continue;
+        }
+        key.time_us = (uint32_t)time_us;
+        key.hash = (uint32_t)hash;
+        if (recorded_count == capacity) {
+            capacity = capacity ? capacity * 2 : 256;
+            recorded = realloc(recorded, capacity * sizeof(RecordedKey));
+            if (!recorded) {
+                fprintf(stderr, "replay: sin memoria\n");
+                exit(1);
+            }
+        }
+        recorded[recorded_count++] = key;
+    }
+    fclose(file);
+}
+
+/**
+ * @brief Atiende los eventos pendientes como el lazo principal de `main.c`.
+ */
+static void service_events(void) {
+    uint32_t events = events_take();
+    if ((events & EVENT_TIMEOUT) && input_timed_out()) {
+        handle_timeout();
+    }
+    if (events & EVENT_MOTOR_DONE) {
+        handle_dispense_done();
+    }
+    iocore_lcd_flush();
+    while (acctlog_service()) {
+    }
+    log_drain();
+}
+
+/**
+ * @brief Corre el reloj virtual hasta `target_us`, atendiendo los eventos en orden.
+ */
+static void advance_to(uint64_t target_us) {
+    while (sim_next_us() <= target_us) {
+        sim_step();
+        service_events();
+    }
+    sim_run_until(target_us);
+}
+
+int main(int argc, char **argv) {
+    const char *path = NULL;
+    unsigned long passes = 1;
+    bool verbose = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            passes = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-v") == 0) {
+            verbose = true;
+        } else if (argv[i][0] != '-' && !path) {
+            path = argv[i];
+        } else {
+            path = NULL;
+            break;
+        }
+    }
+    if (!path) {
+        fprintf(stderr, "uso: %s [-n pasadas] [-v] captura.txt\n", argv[0]);
+        return 2;
+    }
+    load_capture(path);
+    if (recorded_count == 0) {
+        fprintf(stderr, "replay: %s no tiene líneas @k\n", path);
+        return 2;
+    }
+    if (!verbose && !freopen("/dev/null", "w", stdout)) {
+        perror("/dev/null");
+    }
+
+    // Mismo arranque que main.c
+    sim_reset();
+    log_init();
+    events_init();
+    timewheel_init();
+    iocore_init();
+    acctlog_init(users, NUM_USERS, denominations, NUM_DENOMINATIONS);
+    build_user_index();
+    init_transitions();
+
+    static User initial_users[NUM_USERS];
+    static Denomination initial_denominations[NUM_DENOMINATIONS];
+    memcpy(initial_users, users, sizeof(users));
+    memcpy(initial_denominations, denominations, sizeof(denominations));
+
+    unsigned long sessions = 0;
+    unsigned long divergences = 0;
+    uint64_t busy_ns = 0;
+    uint64_t start_ns = host_ns();
+
+    for (unsigned long pass = 0; pass < passes; pass++) {
+        memcpy(users, initial_users, sizeof(users));
+        memcpy(denominations, initial_denominations, sizeof(denominations));
+        reset_state();
+        screen_show(SCREEN_BOOT);
+        service_events();
+
+        uint64_t base_us = sim_now_us();
+        uint64_t offset_us = 0;
+        for (size_t k = 0; k < recorded_count; k++) {
+            const RecordedKey *key = &recorded[k];
+            if (k > 0) {
+                offset_us += (uint32_t)(key->time_us - recorded[k - 1].time_us);
+            }
+            advance_to(base_us + offset_us);
+
+            SystemState before = current_state;
+            uint64_t t0 = host_ns();
+            process_key(key->key);
+            iocore_lcd_flush();
+            uint64_t elapsed = host_ns() - t0;
+            busy_ns += elapsed;
+            add_sample(&samples[before < STATE_COUNT ? before : 0], (uint32_t)elapsed);
+
+            if (current_state == STATE_ENTER_ID && before != STATE_ENTER_ID) {
+                sessions++;
+            }
+            uint32_t hash = lcd_shadow_hash();
+            if ((int)current_state != key->state || (int)screen_current() != key->screen || hash != key->hash) {
+                if (divergences < REPLAY_SHOW_DIVERGENCES) {
+                    fprintf(stderr, "divergencia en la pasada %lu, tecla %zu ('%c'): estado %d (capturado %d), "
+                                    "pantalla %d (%d), LCD %08lx (%08lx)\n",
+                            pass, k, key->key, (int)current_state, key->state, (int)screen_current(),
+                            key->screen, (unsigned long)hash, (unsigned long)key->hash);
+                }
+                divergences++;
+            }
+        }
+
+        // Dejar terminar los motores y los tiempos pendientes antes de la pasada siguiente
+        while (sim_step()) {
+            service_events();
+        }
+    }
+
+    double total_s = (double)(host_ns() - start_ns) / 1e9;
+    fprintf(stderr, "%lu pasadas de %zu teclas: %lu sesiones en %.3f s (%.0f sesiones/s, %.0f sesiones/s "
+                    "contando solo process_key)\n",
+            passes, recorded_count, sessions, total_s, total_s > 0 ? (double)sessions / total_s : 0.0,
+            busy_ns ? (double)sessions * 1e9 / (double)busy_ns : 0.0);
+    fprintf(stderr, "divergencias: %lu\n", divergences);
+    fprintf(stderr, "%-18s %8s %8s %8s %8s %8s\n", "estado", "teclas", "p50 ns", "p90 ns", "p99 ns", "max ns");
+    for (int state = 0; state < STATE_COUNT; state++) {
+        Samples *s = &samples[state];
+        if (s->count == 0) {
+            continue;
+        }
+        qsort(s->ns, s->count, sizeof(uint32_t), compare_u32);
+        fprintf(stderr, "%-18s %8zu %8u %8u %8u %8u\n", state_names[state], s->count, s->ns[s->count / 2],
+                s->ns[s->count * 9 / 10], s->ns[s->count * 99 / 100], s->ns[s->count - 1]);
+    }
+    return divergences ? 1 : 0;
+}
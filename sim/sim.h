@@ -0,0 +1,291 @@
+/**
+ * @file sim.h
+ * @brief Interfaz interna del simulador: reloj virtual, planificador y modelos.
+ *
+ * El firmware corre sin cambios sobre la HAL de `sim/include`. El tiempo solo avanza
+ * cuando el firmware espera (`__wfe()`, `sleep_us()`, `tight_loop_contents()`): en ese
+ * momento el planificador salta al próximo evento (una alarma, el fin de una ráfaga
+ * I2C, un cuadro del teclado o una acción del guion) y corre su interrupción. El código
+ * del firmware tarda cero tiempo virtual, así que las latencias medidas son las de los
+ * periféricos y los temporizadores, no las de la CPU.
+ */
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * @brief Instante que indica "no hay evento pendiente".
+ */
+#define SIM_NEVER UINT64_MAX
+
+/**
+ * @brief Líneas de interrupción que levantan los modelos.
+ */
+void sim_irq_raise(unsigned int num);
+
+/**
+ * @brief Tiempo virtual actual, en microsegundos.
+ */
+uint64_t sim_now_us(void);
+
+/**
+ * @brief Avanza el tiempo virtual con la CPU ocupada y las interrupciones deshabilitadas
+ * (por ejemplo, borrando la flash).
+ *
+ * Los modelos del hardware (bus, teclado, motores y barreras) siguen andando; sus
+ * interrupciones quedan pendientes y corren al final, en orden de número de IRQ como
+ * en el NVIC. Las alarmas y el guion esperan.
+ */
+void sim_stall_us(uint64_t us);
+
+/**
+ * @brief Momento del próximo evento pendiente, o `SIM_NEVER`.
+ */
+uint64_t sim_next_us(void);
+
+/**
+ * @brief Corre todos los eventos hasta `target_us` y deja el reloj en ese instante.
+ */
+void sim_run_until(uint64_t target_us);
+
+/**
+ * @brief Corre el próximo evento pendiente.
+ *
+ * @return false si no queda ningún evento.
+ */
+bool sim_step(void);
+
+/**
+ * @brief Deja el reloj en cero, sin alarmas, y la flash borrada.
+ */
+void sim_reset(void);
+
+/**
+ * @brief Deja el reloj en cero y sin alarmas, pero conserva la flash, como un corte
+ * de energía.
+ */
+void sim_reboot(void);
+
+/**
+ * @brief Conteo de operaciones sobre la flash simulada.
+ */
+typedef struct {
+    uint32_t erases;    /**< Sectores borrados */
+    uint32_t programs;  /**< Páginas programadas */
+} SimFlashStats;
+
+const SimFlashStats *sim_flash_stats(void);
+
+/**
+ * @brief Cambia lo que tarda en borrarse un sector de la flash, hasta el próximo
+ * `sim_reset()`. Por defecto, el típico de la W25Q16; la hoja de datos admite hasta 400 ms.
+ */
+void sim_flash_set_erase_us(uint64_t us);
+
+/**
+ * @brief Hace que `flash_safe_execute()` falle sin tocar la flash, como si el otro
+ * núcleo no se detuviera a tiempo, hasta que se llame con false o hasta el próximo
+ * `sim_reset()`.
+ */
+void sim_flash_set_failing(bool failing);
+
+/**
+ * @brief Tiempo que el firmware pasó durmiendo en `__wfe()`.
+ */
+typedef struct {
+    uint32_t wakes;             /**< Esperas que terminaron después de dormir */
+    uint64_t sleep_us;          /**< Tiempo total dormido */
+    uint64_t deep_sleep_us;     /**< Parte de `sleep_us` con `SLEEPDEEP` activo */
+} SimPowerStats;
+
+const SimPowerStats *sim_power_stats(void);
+
+/**
+ * @brief Cambia el nivel de un pin de entrada y dispara su interrupción si corresponde.
+ */
+void sim_gpio_input(unsigned int gpio, bool value);
+
+/**
+ * @brief Agrega un carácter a la entrada de la consola USB.
+ */
+void sim_console_input(char c);
+
+/*
+ * Bus I2C, DMA y LCD (sim/bus.c, sim/hd44780.c)
+ */
+
+uint64_t sim_bus_next_us(void);
+void sim_bus_run(void);
+
+/**
+ * @brief Libera los canales DMA y descarta las transferencias en curso.
+ */
+void sim_bus_reset(void);
+
+/**
+ * @brief Estadísticas del bus del LCD.
+ */
+typedef struct {
+    uint64_t bytes;         /**< Bytes de datos recibidos por el PCF8574 */
+    uint32_t bursts;        /**< Ráfagas por DMA terminadas */
+    uint64_t busy_us;       /**< Tiempo con el bus ocupado */
+} SimBusStats;
+
+const SimBusStats *sim_bus_stats(void);
+
+/**
+ * @brief Procesa un byte escrito en el PCF8574 del LCD.
+ */
+void hd44780_write(uint8_t pins);
+
+/**
+ * @brief Copia el texto de una fila de la pantalla, terminado en '\0'.
+ *
+ * Los caracteres que no son ASCII se muestran como '?', salvo la ñ (0xEE), que se
+ * muestra como 'n'.
+ *
+ * @param row Fila (0 a 3).
+ * @param text Donde se escriben los 20 caracteres.
+ */
+void hd44780_row(int row, char text[21]);
+
+/**
+ * @brief Imprime la pantalla enmarcada.
+ */
+void hd44780_print(FILE *out);
+
+/*
+ * Teclado (sim/keypad_model.c)
+ */
+
+uint64_t sim_keypad_next_us(void);
+void sim_keypad_run(void);
+
+/**
+ * @brief Presiona o suelta una tecla.
+ *
+ * @param key Tecla según `KEYPAD`.
+ * @param down true para presionarla.
+ * @return false si la tecla no existe.
+ */
+bool sim_keypad_set(char key, bool down);
+
+/**
+ * @brief Duración del rebote al presionar y al soltar, en microsegundos.
+ */
+void sim_keypad_set_bounce(uint32_t bounce_us);
+
+/**
+ * @brief Cuadros descartados porque la FIFO estaba llena.
+ */
+uint32_t sim_keypad_dropped(void);
+
+/**
+ * @brief Tiempo con la máquina de estados del escáner habilitada.
+ */
+uint64_t sim_keypad_scan_us(void);
+
+/*
+ * Motores paso a paso (sim/stepper_model.c)
+ */
+
+uint64_t sim_stepper_next_us(void);
+void sim_stepper_run(void);
+
+/**
+ * @brief Entrega al modelo una transferencia DMA hacia la FIFO TX de una máquina de
+ * estados de los motores. Las palabras se leen a medida que el programa las toma.
+ *
+ * @return false si `write_addr` no es una FIFO de los motores.
+ */
+bool sim_stepper_dma(volatile void *write_addr, const volatile void *read_addr, uint32_t count);
+
+/**
+ * @brief Palabras que le faltan a la transferencia DMA hacia una FIFO de los motores.
+ */
+uint32_t sim_stepper_dma_remaining(volatile void *write_addr);
+
+/**
+ * @brief Detiene las máquinas de estados de los motores y descarta sus transferencias.
+ */
+void sim_stepper_reset(void);
+
+/**
+ * @brief Reserva la siguiente máquina de estados de `pio1`.
+ */
+int sim_stepper_claim_sm(void);
+
+/**
+ * @brief Arranca o detiene una máquina de estados de los motores.
+ */
+void sim_stepper_set_enabled(unsigned int sm, bool enabled);
+
+/*
+ * Rodillos y barreras de los billetes (sim/feeder_model.c)
+ */
+
+/**
+ * @brief Falla que sufre un billete al salir.
+ */
+typedef enum {
+    SIM_FEED_OK,        /**< Sale entero, solo */
+    SIM_FEED_DOUBLE,    /**< Sale pegado al siguiente: la barrera queda tapada más tiempo */
+    SIM_FEED_JAM,       /**< Se traba tapando la barrera */
+    SIM_FEED_EMPTY      /**< No llega a la barrera: caja vacía o el rodillo patina */
+} SimFeedFault;
+
+/**
+ * @brief Pone una barrera a la salida del rodillo que mueve el motor de `step_pin`.
+ *
+ * Cada billete llega a la barrera después de `lead_steps` pasos desde que el anterior
+ * la dejó libre y la tapa durante `note_steps` pasos.
+ */
+void sim_feeder_attach(unsigned int step_pin, unsigned int sensor_pin, unsigned int lead_steps,
+                       unsigned int note_steps);
+
+/**
+ * @brief Hace que el billete número `note` (desde 0) de un rodillo sufra una falla.
+ */
+void sim_feeder_fault(unsigned int step_pin, unsigned int note, SimFeedFault fault);
+
+/**
+ * @brief Billetes que salieron enteros por la barrera de un rodillo.
+ */
+unsigned int sim_feeder_notes(unsigned int step_pin);
+
+/**
+ * @brief Avanza un paso el rodillo del motor de `step_pin`, si tiene barrera.
+ */
+void sim_feeder_step(unsigned int step_pin);
+
+/**
+ * @brief Quita todas las barreras.
+ */
+void sim_feeder_reset(void);
+
+/*
+ * Guion y reporte (sim/sim_main.c)
+ */
+
+uint64_t sim_script_next_us(void);
+void sim_script_run(void);
+
+/**
+ * @brief Avisa que terminó una ráfaga hacia el LCD que empezó en `start_us`.
+ */
+void sim_on_lcd_burst(uint64_t start_us);
+
+/**
+ * @brief Avisa un cambio de nivel en un pin de salida.
+ */
+void sim_on_gpio(unsigned int gpio, bool value);
+
+/**
+ * @brief Termina la simulación: el firmware espera y no queda ningún evento.
+ */
+void sim_finish(void);
+
+#endif // SIM_H
@@ -0,0 +1,486 @@
+/**
+ * @file sim_main.c
+ * @brief Punto de entrada del simulador: arma el guion de teclas, corre el firmware
+ * sobre el reloj virtual e imprime el reporte.
+ *
+ * Uso: `matecash_sim [opciones] [guion...]`. El guion son palabras separadas por
+ * espacios; cada carácter de una palabra es una tecla que se presiona `hold` ms y se
+ * suelta, con `gap` ms hasta la siguiente. Además:
+ *
+ * - `wait:MS` espera sin tocar nada.
+ * - `hold:MS` y `gap:MS` cambian los tiempos de las teclas que siguen.
+ * - `console:TEXTO` escribe el texto en la consola USB.
+ * - `screen` imprime lo que muestra el LCD.
+ * - `;` comenta hasta el final de la línea.
+ *
+ * Opciones:
+ *
+ * - `-s ARCHIVO` lee el guion de un archivo.
+ * - `-n N` repite el guion N veces.
+ * - `-f ARCHIVO` usa una imagen de la flash: se carga si existe y se guarda al terminar,
+ *   así dos corridas seguidas son un reinicio del cajero.
+ * - `-b US` rebote de las teclas al presionar y al soltar.
+ * - `-q` descarta la salida de consola del firmware.
+ * - `--screens` en lugar de correr el firmware, mide los bytes I2C de cada pantalla y
+ *   los compara con reescribirla entera.
+ *
+ * La simulación termina cuando el guion se acabó y el firmware queda esperando sin
+ * ninguna alarma pendiente. El reporte sale por stderr.
+ */
+
+#include "sim.h"
+#include "lcd.h"
+#include "screens.h"
+#include "tcl.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * @brief Tiempo que se le da al firmware para arrancar antes de la primera acción.
+ */
+#define SIM_BOOT_US 500000
+
+#define SIM_DEFAULT_HOLD_MS 100
+#define SIM_DEFAULT_GAP_MS  150
+
+/**
+ * @brief Pines cuyos pulsos se cuentan en el reporte (los motores, entre otros).
+ */
+#define SIM_GPIOS 30
+
+/**
+ * @brief Pasos de la boca de cada rodillo a su barrera, con `MATECASH_NOTE_SENSORS`.
+ */
+#define SIM_FEEDER_LEAD_STEPS 180
+
+/**
+ * @brief Acción del guion.
+ */
+typedef enum {
+    ACTION_PRESS,       /**< Presionar una tecla */
+    ACTION_RELEASE,     /**< Soltar una tecla */
+    ACTION_CONSOLE,     /**< Escribir un carácter en la consola */
+    ACTION_SCREEN       /**< Imprimir el LCD */
+} ActionKind;
+
+typedef struct {
+    uint64_t at_us;     /**< Momento de la acción */
+    ActionKind kind;    /**< Qué hacer */
+    char c;             /**< Tecla o carácter */
+} Action;
+
+int firmware_main(void);
+
+static Action *actions = NULL;
+static size_t action_count = 0;
+static size_t action_capacity = 0;
+static size_t action_next = 0;
+
+static uint32_t presses = 0;
+static bool press_pending = false;
+static uint64_t press_us = 0;
+static uint32_t *latencies = NULL;
+static size_t latency_count = 0;
+static size_t latency_capacity = 0;
+
+static uint32_t gpio_pulses[SIM_GPIOS];
+static uint64_t gpio_high_us[SIM_GPIOS];
+static uint64_t gpio_on_us[SIM_GPIOS];
+
+static const char *flash_path = NULL;
+static struct timespec host_start;
+
+/**
+ * @brief Agrega un elemento a un arreglo que crece solo.
+ */
+static void *grow(void *array, size_t *capacity, size_t count, size_t size) {
+    if (count < *capacity) {
+        return array;
+    }
+    *capacity = *capacity ? *capacity * 2 : 64;
+    array = realloc(array, *capacity * size);
+    if (!array) {
+        fprintf(stderr, "sim: sin memoria\n");
+        exit(1);
+    }
+    return array;
+}
+
+static void add_action(uint64_t at_us, ActionKind kind, char c) {
+    actions = grow(actions, &action_capacity, action_count, sizeof(Action));
+    actions[action_count++] = (Action){at_us, kind, c};
+}
+
+/**
+ * @brief Indica si un carácter es una tecla del teclado.
+ */
+static bool is_key(char c) {
+    for (int row = 0; row < 4; row++) {
+        for (int col = 0; col < 4; col++) {
+            if (KEYPAD[row][col] == c) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Agrega las acciones de una palabra del guion.
+ *
+ * @param word Palabra.
+ * @param t Momento en que empieza; avanza hasta el final de la palabra.
+ * @param hold_ms Duración de cada tecla, modificable por `hold:`.
+ * @param gap_ms Pausa entre teclas, modificable por `gap:`.
+ * @return false si la palabra no es válida.
+ */
+static bool parse_word(const char *word, uint64_t *t, uint32_t *hold_ms, uint32_t *gap_ms) {
+    const char *value = strchr(word, ':');
+    if (value) {
+        size_t length = (size_t)(value - word);
+        value++;
+        if (length == 4 && strncmp(word, "wait", 4) == 0) {
+            *t += strtoull(value, NULL, 10) * 1000;
+        } else if (length == 4 && strncmp(word, "hold", 4) == 0) {
+            *hold_ms = (uint32_t)strtoul(value, NULL, 10);
+        } else if (length == 3 && strncmp(word, "gap", 3) == 0) {
+            *gap_ms = (uint32_t)strtoul(value, NULL, 10);
+        } else if (length == 7 && strncmp(word, "console", 7) == 0) {
+            for (; *value; value++) {
+                add_action(*t, ACTION_CONSOLE, *value);
+            }
+            *t += (uint64_t)*gap_ms * 1000;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    if (strcmp(word, "screen") == 0) {
+        add_action(*t, ACTION_SCREEN, 0);
+        return true;
+    }
+    for (const char *c = word; *c; c++) {
+        if (!is_key(*c)) {
+            return false;
+        }
+    }
+    for (const char *c = word; *c; c++) {
+        add_action(*t, ACTION_PRESS, *c);
+        add_action(*t + (uint64_t)*hold_ms * 1000, ACTION_RELEASE, *c);
+        *t += (uint64_t)(*hold_ms + *gap_ms) * 1000;
+    }
+    return true;
+}
+
+/**
+ * @brief Arma las acciones del guion, repetido `repeat` veces.
+ *
+ * @return false si alguna palabra no es válida.
+ */
+static bool build_script(char *text, unsigned long repeat) {
+    uint64_t t = SIM_BOOT_US;
+    uint32_t hold_ms = SIM_DEFAULT_HOLD_MS;
+    uint32_t gap_ms = SIM_DEFAULT_GAP_MS;
+
+    // Quitar comentarios
+    for (char *p = text; (p = strchr(p, ';')) != NULL;) {
+        while (*p && *p != '\n') {
+            *p++ = ' ';
+        }
+    }
+
+    for (unsigned long i = 0; i < repeat; i++) {
+        char *copy = strdup(text);
+        char *save = NULL;
+        for (char *word = strtok_r(copy, " \t\r\n", &save); word; word = strtok_r(NULL, " \t\r\n", &save)) {
+            if (!parse_word(word, &t, &hold_ms, &gap_ms)) {
+                fprintf(stderr, "sim: palabra inválida en el guion: '%s'\n", word);
+                free(copy);
+                return false;
+            }
+        }
+        free(copy);
+    }
+    return true;
+}
+
+/**
+ * @brief Agrega `word` al final de `text`, separado por un espacio.
+ */
+static char *append(char *text, const char *word) {
+    size_t length = text ? strlen(text) : 0;
+    text = realloc(text, length + strlen(word) + 2);
+    if (!text) {
+        fprintf(stderr, "sim: sin memoria\n");
+        exit(1);
+    }
+    text[length] = ' ';
+    strcpy(text + (length ? length + 1 : 0), word);
+    return text;
+}
+
+static char *read_file(const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        perror(path);
+        exit(2);
+    }
+    char *text = NULL;
+    size_t length = 0;
+    size_t capacity = 0;
+    int c;
+    while ((c = fgetc(file)) != EOF) {
+        text = grow(text, &capacity, length + 1, 1);
+        text[length++] = (char)c;
+    }
+    fclose(file);
+    text = grow(text, &capacity, length + 1, 1);
+    text[length] = '\0';
+    return text;
+}
+
+uint64_t sim_script_next_us(void) {
+    return action_next < action_count ? actions[action_next].at_us : SIM_NEVER;
+}
+
+void sim_script_run(void) {
+    const Action *action = &actions[action_next++];
+    switch (action->kind) {
+    case ACTION_PRESS:
+        presses++;
+        press_pending = true;
+        press_us = sim_now_us();
+        sim_keypad_set(action->c, true);
+        break;
+    case ACTION_RELEASE:
+        sim_keypad_set(action->c, false);
+        break;
+    case ACTION_CONSOLE:
+        sim_console_input(action->c);
+        break;
+    case ACTION_SCREEN:
+        fflush(stdout);
+        hd44780_print(stderr);
+        break;
+    }
+}
+
+void sim_on_lcd_burst(uint64_t start_us) {
+    if (press_pending && start_us >= press_us) {
+        latencies = grow(latencies, &latency_capacity, latency_count, sizeof(uint32_t));
+        latencies[latency_count++] = (uint32_t)(sim_now_us() - press_us);
+        press_pending = false;
+    }
+}
+
+void sim_on_gpio(unsigned int gpio, bool value) {
+    if (gpio >= SIM_GPIOS) {
+        return;
+    }
+    if (value) {
+        gpio_pulses[gpio]++;
+        gpio_high_us[gpio] = sim_now_us();
+    } else {
+        gpio_on_us[gpio] += sim_now_us() - gpio_high_us[gpio];
+    }
+}
+
+static int compare_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static double host_seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - host_start.tv_sec) + (double)(now.tv_nsec - host_start.tv_nsec) / 1e9;
+}
+
+static void load_flash(void) {
+    FILE *file = flash_path ? fopen(flash_path, "rb") : NULL;
+    if (file) {
+        size_t read = fread(sim_flash_memory, 1, PICO_FLASH_SIZE_BYTES, file);
+        fclose(file);
+        fprintf(stderr, "flash: %zu bytes cargados de %s\n", read, flash_path);
+    }
+}
+
+static void save_flash(void) {
+    FILE *file = flash_path ? fopen(flash_path, "wb") : NULL;
+    if (file) {
+        fwrite(sim_flash_memory, 1, PICO_FLASH_SIZE_BYTES, file);
+        fclose(file);
+    }
+}
+
+void sim_finish(void) {
+    fflush(stdout);
+    double host_s = host_seconds();
+    double sim_s = (double)sim_now_us() / 1e6;
+    const SimBusStats *bus = sim_bus_stats();
+    const SimFlashStats *flash = sim_flash_stats();
+    const SimPowerStats *power = sim_power_stats();
+
+    fprintf(stderr, "tiempo simulado: %.3f s, en el host: %.3f s (x%.0f)\n",
+            sim_s, host_s, host_s > 0 ? sim_s / host_s : 0.0);
+    fprintf(stderr, "teclas: %u presionadas, %zu cambiaron la pantalla, %u cuadros perdidos\n",
+            presses, latency_count, sim_keypad_dropped());
+    if (latency_count > 0) {
+        qsort(latencies, latency_count, sizeof(uint32_t), compare_u32);
+        uint64_t sum = 0;
+        for (size_t i = 0; i < latency_count; i++) {
+            sum += latencies[i];
+        }
+        fprintf(stderr, "latencia tecla-pantalla (us): min %u, promedio %llu, p50 %u, p99 %u, max %u\n",
+                latencies[0], (unsigned long long)(sum / latency_count), latencies[latency_count / 2],
+                latencies[latency_count * 99 / 100], latencies[latency_count - 1]);
+    }
+    fprintf(stderr, "i2c: %llu bytes, %u ráfagas, %.1f ms ocupado\n",
+            (unsigned long long)bus->bytes, bus->bursts, (double)bus->busy_us / 1000.0);
+    fprintf(stderr, "flash: %u sectores borrados, %u páginas programadas\n", flash->erases, flash->programs);
+    fprintf(stderr, "energía: %u despertares, %.3f s dormido (%.3f s en sueño profundo), escáner activo %.3f s\n",
+            power->wakes, (double)power->sleep_us / 1e6, (double)power->deep_sleep_us / 1e6,
+            (double)sim_keypad_scan_us() / 1e6);
+    for (unsigned int gpio = 0; gpio < SIM_GPIOS; gpio++) {
+        if (gpio_pulses[gpio] > 0) {
+            fprintf(stderr, "gpio %u: %u pulsos, %.1f ms en alto\n",
+                    gpio, gpio_pulses[gpio], (double)gpio_on_us[gpio] / 1000.0);
+        }
+    }
+    hd44780_print(stderr);
+
+    save_flash();
+    exit(0);
+}
+
+/**
+ * @brief Bytes I2C de reescribir la pantalla entera, como antes del buffer sombra: un
+ * comando de cursor por fila y las 20 celdas, 4 bytes cada uno.
+ */
+#define SCREEN_FULL_REWRITE_BYTES (LCD_ROWS * (1 + LCD_COLUMNS) * 4)
+
+/**
+ * @brief Mide los bytes I2C que cuesta llegar a cada pantalla del catálogo, desde la
+ * pantalla en blanco y desde cada una de las demás, y los compara con reescribirla
+ * entera.
+ */
+static void report_screens(void) {
+#define SCREEN_NAME(id, ...) [id] = #id,
+    static const char *names[SCREEN_COUNT] = {SCREEN_CATALOG(SCREEN_NAME)};
+    static const char blank[LCD_ROWS * LCD_COLUMNS] = {0};
+    uint32_t all_total = 0;
+    int all_sources = 0;
+
+    initLCD();
+    fprintf(stderr, "%-24s %8s %8s %8s %10s %8s\n", "pantalla", "blanco", "prom.", "max", "max (us)", "ahorro");
+    for (int to = SCREEN_NONE + 1; to < SCREEN_COUNT; to++) {
+        uint32_t from_blank = 0;
+        uint32_t total = 0;
+        uint32_t worst = 0;
+        uint64_t worst_us = 0;
+        int sources = 0;
+
+        for (int from = SCREEN_NONE; from < SCREEN_COUNT; from++) {
+            if (from == to) {
+                continue;
+            }
+            if (from == SCREEN_NONE) {
+                displayScreen(blank);
+            } else {
+                screen_show((ScreenId)from);
+            }
+            lcd_wait_idle();
+
+            uint32_t bytes = lcd_get_i2c_bytes();
+            uint64_t start = sim_now_us();
+            screen_show((ScreenId)to);
+            lcd_wait_idle();
+            bytes = lcd_get_i2c_bytes() - bytes;
+            uint64_t elapsed = sim_now_us() - start;
+
+            if (from == SCREEN_NONE) {
+                from_blank = bytes;
+            } else {
+                total += bytes;
+                sources++;
+            }
+            if (bytes > worst) {
+                worst = bytes;
+            }
+            if (elapsed > worst_us) {
+                worst_us = elapsed;
+            }
+        }
+        uint32_t average = sources ? total / (uint32_t)sources : 0;
+        fprintf(stderr, "%-24s %8u %8u %8u %10llu %7.0f%%\n", names[to], from_blank, average, worst,
+                (unsigned long long)worst_us, 100.0 * (1.0 - (double)average / SCREEN_FULL_REWRITE_BYTES));
+        all_total += total;
+        all_sources += sources;
+    }
+    uint32_t all_average = all_sources ? all_total / (uint32_t)all_sources : 0;
+    fprintf(stderr, "reescritura completa: %u bytes por pantalla; cambios solamente: %u bytes en promedio, "
+            "%.0f%% menos\n", SCREEN_FULL_REWRITE_BYTES, all_average,
+            100.0 * (1.0 - (double)all_average / SCREEN_FULL_REWRITE_BYTES));
+}
+
+int main(int argc, char **argv) {
+    char *script = NULL;
+    unsigned long repeat = 1;
+    bool screens = false;
+    bool quiet = false;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        if (strcmp(arg, "-s") == 0 && i + 1 < argc) {
+            char *text = read_file(argv[++i]);
+            script = append(script, text);
+            free(text);
+        } else if (strcmp(arg, "-n") == 0 && i + 1 < argc) {
+            repeat = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(arg, "-f") == 0 && i + 1 < argc) {
+            flash_path = argv[++i];
+        } else if (strcmp(arg, "-b") == 0 && i + 1 < argc) {
+            sim_keypad_set_bounce((uint32_t)strtoul(argv[++i], NULL, 10));
+        } else if (strcmp(arg, "-q") == 0) {
+            quiet = true;
+        } else if (strcmp(arg, "--screens") == 0) {
+            screens = true;
+        } else if (arg[0] == '-') {
+            fprintf(stderr, "uso: %s [-s guion] [-n veces] [-f flash.bin] [-b rebote_us] [-q] [--screens] "
+                            "[teclas...]\n", argv[0]);
+            return 2;
+        } else {
+            script = append(script, arg);
+        }
+    }
+
+    if (script && !build_script(script, repeat)) {
+        return 2;
+    }
+    free(script);
+    if (quiet && !freopen("/dev/null", "w", stdout)) {
+        perror("/dev/null");
+    }
+
+    sim_reset();
+    load_flash();
+    // Con `MATECASH_NOTE_SENSORS`, cada barrera del firmware tiene su rodillo simulado
+    for (unsigned int i = 0; i < NUM_DENOMINATIONS; i++) {
+        if (denominations[i].sensor.pin >= 0) {
+            sim_feeder_attach((unsigned int)denominations[i].pinselect, (unsigned int)denominations[i].sensor.pin,
+                              SIM_FEEDER_LEAD_STEPS, denominations[i].sensor.note_steps);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &host_start);
+
+    if (screens) {
+        report_screens();
+        return 0;
+    }
+    firmware_main();
+    sim_finish();
+    return 0;
+}
@@ -0,0 +1,214 @@
+/**
+ * @file stepper_model.c
+ * @brief Modelo de las máquinas de estados de `stepper.pio` en `pio1` y del DMA que
+ * alimenta sus FIFO TX.
+ *
+ * Cada palabra que toma el programa es un paso: el pin STEP sube 3 ciclos después del
+ * `pull`, baja `stepper_PULSE_CYCLES` ciclos más tarde y el siguiente `pull` ocurre a
+ * la palabra más `stepper_STEP_OVERHEAD` ciclos del anterior. Una palabra en 0 levanta
+ * la IRQ de la máquina y la detiene hasta que el firmware la reconoce. Los cambios del
+ * pin se informan con `sim_on_gpio()`, como los de `gpio_put()`.
+ *
+ * El DMA se modela con su ritmo real: la transferencia queda pendiente y cada palabra
+ * se lee de la memoria del firmware cuando el programa la toma, así la FIFO siempre
+ * está vacía y lo que le falta a la transferencia son los pasos por dar.
+ *
+ * Cada paso hace avanzar el rodillo del canal en el modelo de `feeder_model.c`.
+ */
+
+#include "sim.h"
+#include "hardware/irq.h"
+#include "hardware/pio.h"
+#include "stepper.pio.h"
+
+/**
+ * @brief Máquinas de estado por bloque PIO.
+ */
+#define SIM_STEPPER_SMS 4
+
+/**
+ * @brief Momento del programa en que ocurre el próximo evento de una máquina.
+ */
+typedef enum {
+    PHASE_PULL,     /**< Toma la siguiente palabra */
+    PHASE_RISE,     /**< Sube el pin STEP */
+    PHASE_FALL      /**< Baja el pin STEP */
+} StepperPhase;
+
+/**
+ * @brief Máquina de estados simulada.
+ */
+typedef struct {
+    bool attached;                      /**< La configuró `stepper_program_init()` */
+    bool enabled;                       /**< Está corriendo */
+    bool waiting_irq;                   /**< Espera que se reconozca su IRQ */
+    uint pin;                           /**< Pin STEP */
+    uint cycle_hz;                      /**< Frecuencia de los ciclos */
+    const volatile uint32_t *source;    /**< Siguiente palabra de la transferencia DMA */
+    uint32_t remaining;                 /**< Palabras que le quedan a la transferencia */
+    StepperPhase phase;                 /**< Qué pasa en `next_us` */
+    uint64_t step_start_us;             /**< Momento del último `pull` */
+    uint32_t word;                      /**< Última palabra tomada */
+    uint64_t next_us;                   /**< Próximo evento, o `SIM_NEVER` */
+} SimStepper;
+
+static SimStepper steppers[SIM_STEPPER_SMS];
+static int claimed_sms = 0;
+
+/**
+ * @brief Convierte ciclos de la máquina a microsegundos desde `start_us`.
+ */
+static uint64_t after_cycles(const SimStepper *s, uint64_t start_us, uint64_t cycles) {
+    return start_us + cycles * 1000000u / s->cycle_hz;
+}
+
+/**
+ * @brief Programa el próximo `pull` si la máquina corre y tiene de dónde tomar.
+ */
+static void schedule_pull(SimStepper *s, uint64_t at_us) {
+    s->phase = PHASE_PULL;
+    s->next_us = s->enabled && !s->waiting_irq && s->remaining > 0 ? at_us : SIM_NEVER;
+}
+
+void sim_stepper_attach(PIO pio, uint sm, uint pin, uint cycle_hz) {
+    if (pio != pio1 || sm >= SIM_STEPPER_SMS) {
+        return;
+    }
+    SimStepper *s = &steppers[sm];
+    *s = (SimStepper){0};
+    s->attached = true;
+    s->pin = pin;
+    s->cycle_hz = cycle_hz;
+    s->next_us = SIM_NEVER;
+}
+
+int sim_stepper_claim_sm(void) {
+    return claimed_sms < SIM_STEPPER_SMS ? claimed_sms++ : -1;
+}
+
+void sim_stepper_set_enabled(unsigned int sm, bool enabled) {
+    if (sm >= SIM_STEPPER_SMS || !steppers[sm].attached) {
+        return;
+    }
+    SimStepper *s = &steppers[sm];
+    s->enabled = enabled;
+    if (enabled) {
+        schedule_pull(s, sim_now_us());
+    } else {
+        s->next_us = SIM_NEVER;
+    }
+}
+
+void sim_stepper_reset(void) {
+    for (int i = 0; i < SIM_STEPPER_SMS; i++) {
+        steppers[i] = (SimStepper){0};
+        steppers[i].next_us = SIM_NEVER;
+    }
+    claimed_sms = 0;
+    pio1_hw_inst.irq = 0;
+    pio1_hw_inst.irq0_inte = 0;
+}
+
+bool sim_stepper_dma(volatile void *write_addr, const volatile void *read_addr, uint32_t count) {
+    for (unsigned int sm = 0; sm < SIM_STEPPER_SMS; sm++) {
+        if (write_addr != &pio1_hw_inst.txf[sm]) {
+            continue;
+        }
+        SimStepper *s = &steppers[sm];
+        s->source = (const volatile uint32_t *)read_addr;
+        s->remaining = count;
+        if (s->next_us == SIM_NEVER) {
+            schedule_pull(s, sim_now_us());     // Estaba detenida en `pull block`
+        }
+        return true;
+    }
+    return false;
+}
+
+uint32_t sim_stepper_dma_remaining(volatile void *write_addr) {
+    for (unsigned int sm = 0; sm < SIM_STEPPER_SMS; sm++) {
+        if (write_addr == &pio1_hw_inst.txf[sm]) {
+            return steppers[sm].remaining;
+        }
+    }
+    return 0;
+}
+
+uint64_t sim_stepper_next_us(void) {
+    uint64_t next = SIM_NEVER;
+    for (int i = 0; i < SIM_STEPPER_SMS; i++) {
+        if (steppers[i].next_us < next) {
+            next = steppers[i].next_us;
+        }
+    }
+    return next;
+}
+
+/**
+ * @brief Corre el evento más próximo de las máquinas de los motores.
+ */
+void sim_stepper_run(void) {
+    SimStepper *s = NULL;
+    for (int i = 0; i < SIM_STEPPER_SMS; i++) {
+        if (steppers[i].next_us != SIM_NEVER && (!s || steppers[i].next_us < s->next_us)) {
+            s = &steppers[i];
+        }
+    }
+    if (!s) {
+        return;
+    }
+    unsigned int sm = (unsigned int)(s - steppers);
+
+    switch (s->phase) {
+    case PHASE_PULL:
+        s->step_start_us = s->next_us;
+        s->word = *s->source++;
+        s->remaining--;
+        if (s->word == 0) {
+            // `irq wait 0 rel`: la bandera de la máquina queda levantada hasta que la reconozcan
+            s->waiting_irq = true;
+            s->next_us = SIM_NEVER;
+            pio1_hw_inst.irq |= 1u << sm;
+            if (pio1_hw_inst.irq0_inte & (1u << (pis_interrupt0 + sm))) {
+                sim_irq_raise(PIO1_IRQ_0);
+            }
+            return;
+        }
+        s->phase = PHASE_RISE;
+        s->next_us = after_cycles(s, s->step_start_us, 3);
+        break;
+    case PHASE_RISE:
+        sim_on_gpio(s->pin, true);
+        sim_feeder_step(s->pin);
+        s->phase = PHASE_FALL;
+        s->next_us = after_cycles(s, s->step_start_us, 3 + stepper_PULSE_CYCLES);
+        break;
+    case PHASE_FALL:
+        sim_on_gpio(s->pin, false);
+        schedule_pull(s, after_cycles(s, s->step_start_us, (uint64_t)s->word + stepper_STEP_OVERHEAD));
+        break;
+    }
+}
+
+uint pio_sm_get_tx_fifo_level(PIO pio, uint sm) {
+    (void)pio;
+    (void)sm;
+    return 0;   // Las palabras se leen del DMA recién al tomarlas
+}
+
+uint pio_get_dreq(PIO pio, uint sm, bool is_tx) {
+    return (pio == pio0 ? 0 : 8) + (is_tx ? 0 : 4) + sm;
+}
+
+bool pio_interrupt_get(PIO pio, uint pio_interrupt_num) {
+    return (pio->irq & (1u << pio_interrupt_num)) != 0;
+}
+
+void pio_interrupt_clear(PIO pio, uint pio_interrupt_num) {
+    pio->irq &= ~(1u << pio_interrupt_num);
+    if (pio == pio1 && pio_interrupt_num < SIM_STEPPER_SMS && steppers[pio_interrupt_num].waiting_irq) {
+        SimStepper *s = &steppers[pio_interrupt_num];
+        s->waiting_irq = false;
+        schedule_pull(s, after_cycles(s, sim_now_us(), 2));    // Fin de `irq wait` y `jmp start`
+    }
+}
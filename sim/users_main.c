@@ -0,0 +1,242 @@
+/**
+ * @file users_main.c
+ * @brief Compara `find_user()` con una búsqueda lineal en tablas de 10, 1000 y 100000
+ * cuentas y mide cuánto tarda cada una.
+ *
+ * Uso: `matecash_users [consultas]` (por defecto 200000 por tabla). Se compila con
+ * `NUM_USERS=100000`. Para cada tamaño se llenan los primeros lugares de `users[]` con
+ * IDs de 6 dígitos aleatorios y distintos, en desorden, y el resto queda sin ID (fuera
+ * del índice). Después de `build_user_index()` se exige que `find_user()` devuelva lo
+ * mismo que un recorrido de `users[]` con `strcmp()`:
+ *
+ * - para los 10^6 IDs posibles, contra una tabla armada con un solo recorrido de
+ *   `users[]` (con 100000 cuentas, buscar cada ID recorriendo la tabla llevaría horas);
+ * - para las consultas de la medición, contra la búsqueda lineal misma;
+ * - siempre NULL para IDs mal formados: cortos, largos, con letras o vacíos.
+ *
+ * Se informa el tiempo de `build_user_index()` y el de cada búsqueda, binaria y lineal,
+ * con IDs presentes y ausentes mezclados.
+ */
+
+#include "sim.h"
+#include "tcl.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * @brief IDs de 6 dígitos posibles.
+ */
+#define USERS_ID_SPACE 1000000u
+
+/**
+ * @brief Tope de consultas lineales por tabla en la medición; con 100000 cuentas cada
+ * una recorre toda la tabla.
+ */
+#define USERS_LINEAR_MAX 2000u
+
+/*
+ * El simulador espera estos ganchos de `sim_main.c`; aquí no se corre el firmware.
+ */
+
+uint64_t sim_script_next_us(void) {
+    return SIM_NEVER;
+}
+
+void sim_script_run(void) {
+}
+
+void sim_on_lcd_burst(uint64_t start_us) {
+    (void)start_us;
+}
+
+void sim_on_gpio(unsigned int gpio, bool value) {
+    (void)gpio;
+    (void)value;
+}
+
+void sim_finish(void) {
+}
+
+/**
+ * @brief Estado del generador xorshift32; fijo, para repetir las mismas pruebas.
+ */
+static uint32_t rng_state = 0x6C078965u;
+
+static uint32_t rng_next(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static uint64_t host_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+}
+
+/**
+ * @brief Cuentas cargadas en `users[]` para la tabla en curso.
+ */
+static uint32_t loaded = 0;
+
+/**
+ * @brief Búsqueda de referencia: recorre `users[]` comparando cadenas, como
+ * `find_user()` antes del índice.
+ */
+static User *linear_find(const char *id) {
+    if (strlen(id) != ID_LENGTH || strspn(id, "0123456789") != ID_LENGTH) {
+        return NULL;
+    }
+    for (uint32_t i = 0; i < loaded; i++) {
+        if (strcmp(users[i].id, id) == 0) {
+            return &users[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Llena los primeros `count` lugares de `users[]` con IDs distintos y deja el
+ * resto sin ID.
+ */
+static void load_users(uint32_t count) {
+    static uint8_t taken[USERS_ID_SPACE / 8];
+    memset(taken, 0, sizeof(taken));
+    memset(users, 0, sizeof(users));
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t id;
+        do {
+            id = rng_next() % USERS_ID_SPACE;
+        } while (taken[id / 8] & (1u << (id % 8)));
+        taken[id / 8] |= (uint8_t)(1u << (id % 8));
+        snprintf(users[i].id, sizeof(users[i].id), "%06lu", (unsigned long)id);
+        snprintf(users[i].name, sizeof(users[i].name), "Cuenta %lu", (unsigned long)i);
+        users[i].balance = (money_t)(rng_next() % 1000000u);
+    }
+    loaded = count;
+}
+
+/**
+ * @brief Compara las dos búsquedas para un ID.
+ *
+ * @return 1 si no coinciden.
+ */
+static unsigned int check_id(const char *id) {
+    User *found = find_user(id);
+    User *expected = linear_find(id);
+    if (found == expected) {
+        return 0;
+    }
+    fprintf(stderr, "%lu cuentas, \"%s\": find_user() dio %s, se esperaba %s\n", (unsigned long)loaded, id,
+            found ? found->id : "NULL", expected ? expected->id : "NULL");
+    return 1;
+}
+
+/**
+ * @brief Usuario de cada ID posible según un recorrido de `users[]`; NULL si no existe.
+ */
+static User *owners[USERS_ID_SPACE];
+
+/**
+ * @brief Compara `find_user()` con `owners` para los 10^6 IDs.
+ *
+ * @return Cantidad de problemas encontrados.
+ */
+static unsigned int check_all_ids(void) {
+    unsigned int problems = 0;
+    memset(owners, 0, sizeof(owners));
+    for (uint32_t i = 0; i < loaded; i++) {
+        owners[strtoul(users[i].id, NULL, 10)] = &users[i];
+    }
+    for (uint32_t number = 0; number < USERS_ID_SPACE && problems < 10; number++) {
+        char id[ID_LENGTH + 1];
+        snprintf(id, sizeof(id), "%06lu", (unsigned long)number);
+        User *found = find_user(id);
+        if (found != owners[number]) {
+            fprintf(stderr, "%lu cuentas, \"%s\": find_user() dio %s, se esperaba %s\n", (unsigned long)loaded, id,
+                    found ? found->id : "NULL", owners[number] ? owners[number]->id : "NULL");
+            problems++;
+        }
+    }
+    return problems;
+}
+
+/**
+ * @brief Arma una tabla, revisa las búsquedas y mide los tiempos.
+ *
+ * @return Cantidad de problemas encontrados.
+ */
+static unsigned int check_table(uint32_t count, uint32_t queries) {
+    unsigned int problems = 0;
+    load_users(count);
+    uint64_t start_ns = host_ns();
+    build_user_index();
+    uint64_t build_ns = host_ns() - start_ns;
+
+    static const char *const malformed[] = {"", "12345", "1234567", "12a456", "-12345", " 12345", "123 45",
+                                            "99999a", "0000000"};
+    for (size_t i = 0; i < sizeof(malformed) / sizeof(malformed[0]); i++) {
+        problems += check_id(malformed[i]);
+    }
+    problems += check_all_ids();
+
+    // La mitad de las consultas son de cuentas que existen
+    char (*ids)[ID_LENGTH + 1] = malloc((size_t)queries * sizeof(*ids));
+    if (!ids) {
+        perror("consultas");
+        exit(2);
+    }
+    for (uint32_t n = 0; n < queries; n++) {
+        if (n % 2 == 0) {
+            memcpy(ids[n], users[rng_next() % count].id, sizeof(ids[n]));
+        } else {
+            snprintf(ids[n], sizeof(ids[n]), "%06lu", (unsigned long)(rng_next() % USERS_ID_SPACE));
+        }
+    }
+    uintptr_t sink = 0;
+    start_ns = host_ns();
+    for (uint32_t n = 0; n < queries; n++) {
+        sink ^= (uintptr_t)find_user(ids[n]);
+    }
+    uint64_t binary_ns = host_ns() - start_ns;
+    uint32_t linear_queries = queries < USERS_LINEAR_MAX ? queries : USERS_LINEAR_MAX;
+    start_ns = host_ns();
+    for (uint32_t n = 0; n < linear_queries; n++) {
+        sink ^= (uintptr_t)linear_find(ids[n]);
+    }
+    uint64_t linear_ns = host_ns() - start_ns;
+    for (uint32_t n = 0; n < linear_queries && problems < 10; n++) {
+        problems += check_id(ids[n]);
+    }
+    free(ids);
+    if (sink == 1) {
+        fprintf(stderr, "\n");      // Para que el compilador no descarte las búsquedas
+    }
+
+    fprintf(stderr, "%6lu cuentas: índice en %8.3f ms, find_user %6.1f ns, búsqueda lineal %10.1f ns\n",
+            (unsigned long)count, (double)build_ns / 1e6, (double)binary_ns / queries,
+            (double)linear_ns / linear_queries);
+    return problems;
+}
+
+int main(int argc, char **argv) {
+    long queries = argc > 1 ? strtol(argv[1], NULL, 10) : 200000;
+    if (queries <= 0 || queries > 10000000) {
+        fprintf(stderr, "uso: %s [consultas]\n", argv[0]);
+        return 2;
+    }
+    static const uint32_t sizes[] = {10, 1000, 100000};
+    unsigned int problems = 0;
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        if (sizes[i] > NUM_USERS) {
+            fprintf(stderr, "%lu cuentas: no entran en NUM_USERS (%d)\n", (unsigned long)sizes[i], NUM_USERS);
+            problems++;
+            continue;
+        }
+        problems += check_table(sizes[i], (uint32_t)queries);
+    }
+    fprintf(stderr, "problemas: %u\n", problems);
+    return problems ? 1 : 0;
+}
@@ -10,6 +10,15 @@
 #include "tcl.h"
 #include"pwm.h"
 #include "lcd.h"
+#include "events.h"
+#include "planner.h"
+#include "iocore.h"
+#include "log.h"
+#include "acctlog.h"
+#include "screens.h"
+#include "trace.h"
+#include "timewheel.h"
+#include <stdlib.h>
 
 /**
  * @brief Pines correspondientes a las filas del teclado matricial.
@@ -45,34 +54,57 @@ User users[NUM_USERS] = {
 };
 
 /**
- * @brief Configuración de las denominaciones disponibles y sus pines.
+ * @brief Entrada del índice de usuarios: ID como entero y posición en `users[]`.
  */
-Denomination denominations[] = {
-    {10000, 5, 16},  // 5 billetes de 10,000
-    {20000, 5, 17},  // 2 billetes de 20,000
-    {50000, 5, 18},  // 2 billetes de 50,000
-    {100000, 5, 19}, // 2 billetes de 100,000
-};
+typedef struct {
+    uint32_t id;        /**< ID de 6 dígitos como entero */
+    uint32_t slot;      /**< Posición del usuario en `users[]` */
+} UserIndexEntry;
+
 /**
- * @brief Variable que indica si se ha presionado una tecla.
+ * @brief Índice de usuarios ordenado por ID, para búsqueda binaria.
  */
-volatile bool key_pressed = false;
+static UserIndexEntry user_index[NUM_USERS];
 
 /**
- * @brief Fila actual del teclado que está siendo escaneada.
+ * @brief Cantidad de entradas válidas en `user_index`.
  */
-volatile uint8_t current_row = 0;
+static uint32_t user_index_count = 0;
 
+#if MATECASH_NOTE_SENSORS
 /**
- * @brief Última tecla presionada.
+ * @brief Rampa de los rodillos con barrera: el recorrido máximo antes de dar el canal
+ * por trabado. El motor frena apenas pasa el borde trasero del billete, unos 330 pasos
+ * después de arrancar.
  */
-volatile char last_key = 0;
+#define FEEDER_RAMP {512, 400, 2400, 24000}
 
 /**
- * @brief Último tiempo en que se presionó una tecla.
+ * @brief Barrera óptica a la salida del rodillo; un billete la tapa unos 150 pasos.
  */
-volatile absolute_time_t last_key_time;
+#define FEEDER_SENSOR(pin) {pin, 150}
+#else
+/**
+ * @brief Rampa de los rodillos: 400 pasos por billete, de 400 a 2400 pasos/s con
+ * 24000 pasos/s², unos 240 ms por billete.
+ */
+#define FEEDER_RAMP {400, 400, 2400, 24000}
 
+/**
+ * @brief Sin barrera: el canal trabaja a lazo abierto, un billete por rampa.
+ */
+#define FEEDER_SENSOR(pin) {-1, 0}
+#endif
+
+/**
+ * @brief Configuración de las denominaciones disponibles, sus pines y sus motores.
+ */
+Denomination denominations[NUM_DENOMINATIONS] = {
+    {10000, 5, 16, FEEDER_RAMP, FEEDER_SENSOR(10)},  // 5 billetes de 10,000
+    {20000, 5, 17, FEEDER_RAMP, FEEDER_SENSOR(11)},  // 2 billetes de 20,000
+    {50000, 5, 18, FEEDER_RAMP, FEEDER_SENSOR(12)},  // 2 billetes de 50,000
+    {100000, 5, 19, FEEDER_RAMP, FEEDER_SENSOR(13)}, // 2 billetes de 100,000
+};
 /**
  * @brief Almacena el ID ingresado por el usuario.
  */
@@ -99,469 +131,878 @@ int input_index = 0;
 SystemState current_state = STATE_ENTER_ID;
 
 /**
- * @brief Tiempo de inicio de la entrada de datos actual.
+ * @brief Puntero al usuario actualmente autenticado.
  */
-absolute_time_t input_start_time;
+User* current_user = NULL;
 
 /**
- * @brief Puntero al usuario actualmente autenticado.
+ * @brief Almacena el monto que el usuario escribe para retirar.
  */
-User* current_user = NULL;
+char input_amount[AMOUNT_LENGTH + 1] = {0};
+
+/**
+ * @brief Tiempo máximo en cada estado de la sesión, en milisegundos; 0 si no vence.
+ * Al vencer, `handle_timeout()` vuelve a la bienvenida. Con la sesión abierta cuenta
+ * desde la última tecla.
+ */
+static const uint32_t state_timeout_ms[STATE_COUNT] = {
+    [STATE_ENTER_PASSWORD] = MAX_INPUT_TIME_MS,
+    [STATE_LOGGED_IN] = SESSION_IDLE_MS,
+    [STATE_CHECK_BALANCE] = SESSION_IDLE_MS,
+    [STATE_WITHDRAW_MONEY] = SESSION_IDLE_MS,
+    [STATE_CHANGE_PASSWORD] = SESSION_IDLE_MS,
+    [STATE_CONFIRM_PASSWORD] = SESSION_IDLE_MS,
+    [STATE_ENTER_AMOUNT] = SESSION_IDLE_MS,
+};
+
+/**
+ * @brief Venció el temporizador del estado actual y el lazo principal todavía no lo atendió.
+ */
+static volatile bool state_expired = false;
 
-int selected_index = 0;
 
 
+_Static_assert(ACCTLOG_GROUP_COMMIT_MS < MOTOR_REST_MS, "Un canal no debe entregar dos billetes sin grabar");
 
 /**
- * @brief timer_Callback para el temporizador que escanea las filas del teclado matricial.
- * 
- * @param alarm_num Número del temporizador.
+ * @brief Billetes entregados por cada canal desde el arranque. Los cuenta la
+ * interrupción del dispensador, que en modo multinúcleo corre en el núcleo 1.
+ */
+static volatile uint32_t notes_delivered[NUM_DENOMINATIONS];
+
+/**
+ * @brief Billetes de cada canal ya registrados en el diario de cuentas.
+ */
+static uint32_t notes_logged[NUM_DENOMINATIONS];
+
+/**
+ * @brief Veces que cada canal se trabó, contadas por la interrupción del dispensador.
+ */
+static volatile uint32_t feeder_jams[NUM_DENOMINATIONS];
+
+/**
+ * @brief Trabas de cada canal ya atendidas por el lazo principal.
+ */
+static uint32_t jams_handled[NUM_DENOMINATIONS];
+
+/**
+ * @brief Canales fuera de servicio por una traba; no se planifican hasta reiniciar.
+ */
+static bool channel_jammed[NUM_DENOMINATIONS];
+
+/**
+ * @brief Callback del dispensador al terminar un billete; avisa al lazo principal.
+ *
+ * @param channel Canal del intento.
+ * @param result Cómo terminó.
+ * @param notes Billetes que salieron.
+ * @param remaining Billetes que le quedan a ese canal.
  */
-void timer_callback(uint alarm_num) {
-    gpio_put(ROW_PINS[current_row], 1);
-    current_row = (current_row + 1) % 4;
-    gpio_put(ROW_PINS[current_row], 0);
-    hardware_alarm_set_target(alarm_num, make_timeout_time_ms(5));
+static void note_dispensed(unsigned int channel, DispenseResult result, unsigned int notes, unsigned int remaining) {
+    if (channel < NUM_DENOMINATIONS) {
+        notes_delivered[channel] += notes;
+        if (result == DISPENSE_JAM || result == DISPENSE_EMPTY) {
+            feeder_jams[channel]++;
+        }
+    }
+    events_post(EVENT_MOTOR_DONE);
 }
 
 /**
- * @brief gpio_Callback para manejar la interrupción de un pin de GPIO (tecla presionada).
- * 
- * @param gpio Pin de GPIO que generó la interrupción.
- * @param events Eventos generados por el pin.
- */
-void gpio_callback(uint gpio, uint32_t events) {
-    if (!key_pressed) {
-        absolute_time_t current_time = get_absolute_time();
-        if (absolute_time_diff_us(last_key_time, current_time) > DEBOUNCE_DELAY) {
-            for (int col = 0; col < 4; col++) {
-                if (gpio == COL_PINS[col]) {
-                    last_key = KEYPAD[current_row][col];
-                    key_pressed = true;
-                    last_key_time = current_time;
-                    break;
-                }
+ * @brief Configura el dispensador con un canal por cada denominación.
+ */
+void init_dispenser() {
+    uint8_t pins[DISPENSER_CHANNELS];
+    RampProfile profiles[DISPENSER_CHANNELS];
+    NoteSensor sensors[DISPENSER_CHANNELS];
+    unsigned int count = sizeof(denominations) / sizeof(denominations[0]);
+
+    for (unsigned int i = 0; i < count && i < DISPENSER_CHANNELS; i++) {
+        pins[i] = denominations[i].pinselect;
+        profiles[i] = denominations[i].ramp;
+        sensors[i] = denominations[i].sensor;
+        notes_delivered[i] = 0;
+        notes_logged[i] = 0;
+        feeder_jams[i] = 0;
+        jams_handled[i] = 0;
+        channel_jammed[i] = false;
+    }
+    dispenser_init(pins, profiles, sensors, count, note_dispensed);
+}
+
+/**
+ * @brief Atiende el aviso de billete entregado.
+ *
+ * Registra en el diario de cuentas los billetes que salieron desde el último aviso y,
+ * cuando el dispensador termina todo lo pendiente, lo informa por la consola. Un
+ * billete pegado de más se descuenta del inventario sin cobrarlo. Si un canal se trabó,
+ * sus billetes sin entregar vuelven al saldo de cada retiro y el canal deja de usarse.
+ */
+void handle_dispense_done() {
+    for (unsigned int i = 0; i < NUM_DENOMINATIONS; i++) {
+        while (notes_logged[i] != notes_delivered[i]) {
+            if (!acctlog_withdraw_note(i)) {
+                log_message(LOG_EXTRA_NOTE, (uint32_t)i);
+                planner_invalidate();
             }
+            notes_logged[i]++;
+        }
+        if (jams_handled[i] != feeder_jams[i]) {
+            jams_handled[i] = feeder_jams[i];
+            channel_jammed[i] = true;
+            unsigned int refunded = acctlog_withdraw_cancel(i);
+            planner_invalidate();
+            log_message(LOG_CHANNEL_JAMMED, (uint32_t)i, (uint32_t)refunded);
+        }
+    }
+    if (!dispenser_busy()) {
+        log_message(LOG_NOTES_DELIVERED);
+    }
+}
+
+/**
+ * @brief Guarda en el registro de la flash el estado actual de un usuario.
+ *
+ * @param user Usuario que cambió (saldo, clave, intentos o bloqueo).
+ */
+static void save_user(const User *user) {
+    acctlog_update_user((unsigned int)(user - users));
+}
+
+/**
+ * @brief Convierte un ID de 6 dígitos en un entero.
+ *
+ * @param id Cadena con el ID.
+ * @param value Donde se escribe el ID como entero.
+ * @return false si la cadena no tiene exactamente `ID_LENGTH` dígitos.
+ */
+static bool parse_user_id(const char *id, uint32_t *value) {
+    uint32_t result = 0;
+    for (int i = 0; i < ID_LENGTH; i++) {
+        if (id[i] < '0' || id[i] > '9') {
+            return false;
         }
+        result = result * 10 + (uint32_t)(id[i] - '0');
+    }
+    if (id[ID_LENGTH] != '\0') {
+        return false;
     }
+    *value = result;
+    return true;
 }
 
 /**
- * @brief Inicializa el teclado matricial configurando los pines de filas y columnas.
+ * @brief Compara dos entradas del índice de usuarios por ID, para `qsort`.
+ *
+ * @param a Primera entrada.
+ * @param b Segunda entrada.
+ * @return Negativo, 0 o positivo según el orden de los IDs.
  */
-void init_keypad() {
-    for (int i = 0; i < 4; i++) {
-        gpio_init(ROW_PINS[i]);
-        gpio_set_dir(ROW_PINS[i], GPIO_OUT);
-        gpio_put(ROW_PINS[i], 1);
-        
-        gpio_init(COL_PINS[i]);
-        gpio_set_dir(COL_PINS[i], GPIO_IN);
-        gpio_pull_up(COL_PINS[i]);
-        gpio_set_irq_enabled_with_callback(COL_PINS[i], GPIO_IRQ_EDGE_FALL, true, &gpio_callback);
+static int compare_index_entries(const void *a, const void *b) {
+    uint32_t id_a = ((const UserIndexEntry *)a)->id;
+    uint32_t id_b = ((const UserIndexEntry *)b)->id;
+    return (id_a > id_b) - (id_a < id_b);
+}
+
+/**
+ * @brief Construye el índice ordenado de usuarios a partir de `users[]`.
+ *
+ * Los usuarios con un ID mal formado quedan fuera del índice.
+ */
+void build_user_index() {
+    user_index_count = 0;
+    for (int i = 0; i < NUM_USERS; i++) {
+        uint32_t id;
+        if (parse_user_id(users[i].id, &id)) {
+            user_index[user_index_count].id = id;
+            user_index[user_index_count].slot = (uint32_t)i;
+            user_index_count++;
+        }
     }
-    
-    hardware_alarm_claim(0);
-    hardware_alarm_set_callback(0, timer_callback);
-    hardware_alarm_set_target(0, make_timeout_time_ms(5));
+    qsort(user_index, user_index_count, sizeof(UserIndexEntry), compare_index_entries);
 }
 
 /**
  * @brief Busca un usuario en la lista de usuarios por su ID.
+ *
+ * El ID se convierte a entero y se busca por búsqueda binaria en el índice ordenado,
+ * sin comparar cadenas: O(log n) en lugar de recorrer toda la lista.
  * 
  * @param id ID del usuario a buscar.
  * @return User* Puntero al usuario encontrado, o NULL si no existe.
  */
 User* find_user(const char* id) {     
-    for (int i = 0; i < NUM_USERS; i++) {
-        if (strcmp(users[i].id, id) == 0) {
-            return &users[i];
+    uint32_t key;
+    if (!parse_user_id(id, &key)) {
+        return NULL;
+    }
+
+    uint32_t low = 0;
+    uint32_t high = user_index_count;
+    while (low < high) {
+        uint32_t mid = low + (high - low) / 2;
+        if (user_index[mid].id < key) {
+            low = mid + 1;
+        } else {
+            high = mid;
         }
     }
+
+    if (low < user_index_count && user_index[low].id == key) {
+        return &users[user_index[low].slot];
+    }
     return NULL;
 }
 
 /**
- * @brief Reinicia el estado del sistema para un nuevo intento de inicio de sesión.
+ * @brief Vence el tiempo del estado actual; avisa al lazo principal.
+ *
+ * @param user_data No se usa.
  */
-void reset_state() {
+static void state_timeout_callback(void *user_data) {
+    state_expired = true;
+    events_post(EVENT_TIMEOUT);
+}
+
+/**
+ * @brief Temporizador del estado actual de la sesión.
+ */
+static TimeWheelTimer state_timer = TIMEWHEEL_TIMER(state_timeout_callback, NULL);
+
+/**
+ * @brief Cambia de estado y programa su tiempo máximo, o cancela el del anterior.
+ *
+ * @param state Estado nuevo; si es el mismo, su tiempo vuelve a empezar.
+ */
+static void enter_state(SystemState state) {
+    current_state = state;
+    if (state_timeout_ms[state] != 0) {
+        timewheel_arm(&state_timer, state_timeout_ms[state]);
+    } else {
+        timewheel_cancel(&state_timer);
+    }
+    state_expired = false;
+}
+
+/**
+ * @brief Vuelve a los valores iniciales de la sesión, sin tocar la pantalla.
+ */
+static void clear_session(void) {
     memset(input_id, 0, sizeof(input_id));
     memset(input_password, 0, sizeof(input_password));
     memset(new_password, 0, sizeof(new_password));
     input_index = 0;
-    current_state = STATE_ENTER_ID;
+    enter_state(STATE_ENTER_ID);
     current_user = NULL;
-    input_start_time = get_absolute_time();
-            displayMessage("Bienvenido MateCash ",0,0);
-            displayMessage("                    ",1,0);
-            displayMessage(" Ingrese # cuenta:  ",2,0);
-            displayMessage("                    ",3,0);
-            printf("Bienvenido a CashMate");
-            printf("\nIngrese su ID (6 digitos):\n");
 }
 
 /**
- * @brief Maneja el caso en que el tiempo para ingresar el ID o la contraseña ha sido excedido.
+ * @brief Reinicia el estado del sistema para un nuevo intento de inicio de sesión.
+ */
+void reset_state() {
+    clear_session();
+    show_screen(SCREEN_WELCOME);
+}
+
+/**
+ * @brief Indica si venció el tiempo del estado actual de la sesión.
+ *
+ * @return true si el estado tiene tiempo máximo y su temporizador ya venció.
+ */
+bool input_timed_out() {
+    return state_expired && state_timeout_ms[current_state] != 0;
+}
+
+/**
+ * @brief Indica si un estado es de una sesión abierta, con el usuario ya autenticado.
+ *
+ * @param state Estado.
+ * @return false mientras se ingresan el ID o la contraseña.
+ */
+static bool session_open(SystemState state) {
+    return state != STATE_ENTER_ID && state != STATE_ENTER_PASSWORD;
+}
+
+/**
+ * @brief Maneja el caso en que el tiempo para ingresar el ID o la contraseña ha sido
+ * excedido, o en que una sesión abierta quedó sin teclas durante `SESSION_IDLE_MS`.
  */
 void handle_timeout() {
-    printf("\n¡Tiempo excedido! Por favor, intente de nuevo.\n");
+    log_message(session_open(current_state) ? LOG_SESSION_TIMEOUT : LOG_TIMEOUT);
     reset_state();
 }
 
+
 /**
- * @brief Muestra el menú de opciones del usuario una vez que ha iniciado sesión.
+ * @brief Muestra una pantalla del catálogo y completa sus campos.
+ *
+ * @param screen Pantalla a mostrar; `SCREEN_NONE` no cambia nada.
  */
-void show_menu() {
-    printf("\nMateCash:\n");
-    printf("\nMenú de Usuario:\n");
-    displayMessage("    Menú de Usuario ",0,0);   
-    displayMessage("A-Retirar B-Revisar ",1,0);
-    displayMessage("C - Cambiar Clave   ",2,0);
-    displayMessage("D - Cerrar sesión   ",3,0);
-    printf("A - Retirar Dinero\n");
-    printf("B - Consultar Saldo\n");
-    printf("C - Cambiar Clave\n");
-    printf("D - Cerrar sesión\n");
-    
-    
-  
+void show_screen(ScreenId screen) {
+    if (screen == SCREEN_BALANCE) {
+        char text[MONEY_TEXT_MAX];
+        money_format(current_user->balance, text, sizeof(text));
+        log_message(LOG_BALANCE, text);
+        screen_show(screen);
+        screen_set_amount(FIELD_BALANCE, current_user->balance);
+    } else {
+        screen_show(screen);
+    }
 }
 
 /**
- * @brief Muestra las opciones de montor a retirar
-*/
-void amount_menu() {
-    printf("\nMateCash:\n");
-    printf("\nCuanto Dinero Desea retirar?:\n");
-    printf("A - 10.000\n");
-    printf("B - 20.000\n");
-    printf("C - 50.000\n");
-    printf("D - 100.000\n");
-    //displayMessage("                    ",0,0);  
-    displayMessage("Cuanto Dinero Desea ",0,0);
-    displayMessage("      retirar?      ",1,0);
-    displayMessage("A-10.000 B-20.000   ",2,0);
-    displayMessage("C-50.000 D-100.000  ",3,0);
+ * @brief Planifica un retiro con los billetes de los canales que no están trabados.
+ *
+ * @param amount Monto a retirar, en pesos.
+ * @param plan Donde se escribe el plan.
+ * @return false si el monto no se puede formar.
+ */
+static bool plan_in_service(money_t amount, WithdrawalPlan *plan) {
+    Denomination usable[NUM_DENOMINATIONS];
+    memcpy(usable, denominations, sizeof(usable));
+    for (unsigned int i = 0; i < NUM_DENOMINATIONS; i++) {
+        if (channel_jammed[i]) {
+            usable[i].quantity = 0;
+        }
+    }
+    return plan_withdrawal(usable, NUM_DENOMINATIONS, amount, plan);
 }
+
 /**
- * @brief Procesa las acciones del usuario cuando ha iniciado sesión.
- * 
- * @param key Tecla presionada por el usuario.
+ * @brief Realiza el retiro: entrega los billetes y descuenta el saldo del usuario actual.
+ *
+ * Las validaciones (cuenta bloqueada, múltiplo de la unidad, fondos, billetes) son
+ * guardas de la tabla de transiciones; aquí solo se vuelve a comprobar lo que podría
+ * dejar el saldo o el inventario inconsistente. Los billetes se encolan en el
+ * dispensador y salen en segundo plano.
+ *
+ * @param amount Monto a retirar, en pesos.
+ * @return false si el retiro no se pudo hacer.
  */
-void process_logged_in_state(char key) {
-    switch (key) {
-        case 'A': // Retirar dinero
-            amount_menu();
-            current_state = STATE_WITHDRAW_MONEY;
-            break;
-
-            break;
-        case 'B': // Consultar saldo
-            printf("\nConsultando saldo...\n");
-            displayMessage("                    ",0,0);
-            displayMessage("Consultando saldo.. ",1,0);
-            displayMessage("                    ",2,0);
-            displayMessage("                    ",3,0);
-            current_state = STATE_CHECK_BALANCE;
-            check_balance();
-            break;
-        case 'C':
-            printf("\nIngrese nueva contraseña de 4 dígitos:\n");
-            displayMessage("     Ingrese nueva  ",0,0);
-            displayMessage("    contraseña de 4 ",1,0);
-            displayMessage("      dígitos       ",2,0);
-            displayMessage("                    ",3,0);
-            current_state = STATE_CHANGE_PASSWORD;
-            input_index = 0;
-            input_start_time = get_absolute_time();
-            break;
-        case 'D':
-            printf("\nCerrando sesión...\n");
-            displayMessage(" Cerrando sesión... ",0,0);
-            displayMessage("                    ",1,0);
-            displayMessage("                    ",2,0);
-            displayMessage("                    ",3,0);
-            reset_state();
-            break;
-        default:
-            printf("\nOpción no válida\n");
-            displayMessage("                    ",0,0);
-            displayMessage("  Opción no válida  ",1,0);
-            displayMessage("                    ",2,0);
-            displayMessage("                    ",3,0);
-            show_menu();
-            break;
+bool withdraw_money(money_t amount) {
+    money_t new_balance;
+    WithdrawalPlan plan;
+    TRACE(TRACE_WITHDRAW_START, 0);
+    if (!money_sub(current_user->balance, amount, &new_balance) || new_balance < 0 ||
+        !plan_in_service(amount, &plan)) {
+        TRACE(TRACE_WITHDRAW_END, 0);
+        return false;
     }
+
+    // La intención queda en la flash antes de que arranque el primer motor
+    if (!acctlog_withdraw_begin((unsigned int)(current_user - users), new_balance, plan.notes)) {
+        log_message(LOG_WITHDRAW_NOT_LOGGED);
+        TRACE(TRACE_WITHDRAW_END, 0);
+        return false;
+    }
+
+    for (unsigned int i = 0; i < NUM_DENOMINATIONS; i++) {
+        if (plan.notes[i] > 0) {
+            iocore_dispense(i, plan.notes[i]);
+            denominations[i].quantity -= plan.notes[i];
+        }
+    }
+    planner_invalidate();
+    current_user->balance = new_balance;
+
+    char text[MONEY_TEXT_MAX];
+    money_format(amount, text, sizeof(text));
+    log_message(LOG_WITHDRAW_DONE, text, (uint32_t)plan.total_notes);
+    TRACE(TRACE_WITHDRAW_END, 1);
+    return true;
 }
 
+/*
+ * Tabla de transiciones de la sesión.
+ *
+ * Para una tecla se recorren, en orden, las entradas del estado actual; gana la
+ * primera cuya clase de tecla coincide y cuya guarda (si tiene) es verdadera. Se
+ * ejecuta su acción, se pasa al estado siguiente y se muestra su pantalla. Si ninguna
+ * entrada coincide, la tecla se ignora.
+ *
+ * Una acción que descubre que no puede hacer lo suyo (por ejemplo, un error de la
+ * flash) llama a `fail_action()`: la búsqueda sigue con las entradas siguientes, como
+ * si su guarda hubiera sido falsa. Esas entradas llevan una guarda, así la entrada
+ * del fallo que las sigue no queda tapada.
+ *
+ * Las guardas no modifican nada; las que dependen de la tecla que completa un ID o una
+ * clave la miran junto con lo ya ingresado.
+ */
+
 /**
- * @brief Procesa la selección de una denominación de billetes para retiro.
- * 
- * Esta función se encarga de manejar la entrada del usuario cuando se encuentra
- * en el estado de selección de monto a retirar. Según la tecla presionada,
- * selecciona la denominación correspondiente y llama a la función `withdraw_money()`.
- * 
- * @param key Tecla presionada por el usuario, que indica la opción seleccionada:
- * - 'A': Retirar billetes de 10,000.
- * - 'B': Retirar billetes de 20,000.
- * - 'C': Retirar billetes de 50,000.
- * - 'D': Retirar billetes de 100,000.
+ * @brief Clases de tecla, combinables como bits.
  */
-void amount_selection(char key) {
+typedef enum {
+    KEYS_DIGIT  = 1u << 0,  /**< '0' a '9' */
+    KEYS_A      = 1u << 1,
+    KEYS_B      = 1u << 2,
+    KEYS_C      = 1u << 3,
+    KEYS_D      = 1u << 4,
+    KEYS_STAR   = 1u << 5,  /**< '*' */
+    KEYS_HASH   = 1u << 6,  /**< '#' */
+    KEYS_LETTER = KEYS_A | KEYS_B | KEYS_C | KEYS_D,
+    KEYS_ANY    = 0x7F
+} KeyClass;
+
+/**
+ * @brief Valor de `next` que deja el estado sin cambiar.
+ */
+#define STATE_SAME 0xFF
+
+/**
+ * @brief Guarda de una transición.
+ *
+ * @param key Tecla presionada.
+ * @return true si la transición aplica.
+ */
+typedef bool (*transition_guard_t)(char key);
+
+/**
+ * @brief Acción de una transición.
+ *
+ * @param key Tecla presionada.
+ */
+typedef void (*transition_action_t)(char key);
+
+/**
+ * @brief Entrada de la tabla de transiciones.
+ */
+typedef struct {
+    uint8_t state;                  /**< `SystemState` en el que aplica */
+    uint8_t keys;                   /**< `KeyClass` que la disparan */
+    transition_guard_t guard;       /**< Condición adicional, NULL si siempre aplica */
+    transition_action_t action;     /**< Qué hacer, NULL si nada */
+    uint8_t next;                   /**< Estado siguiente, o `STATE_SAME` */
+    uint8_t screen;                 /**< `ScreenId` a mostrar, o `SCREEN_NONE` */
+} Transition;
+
+/**
+ * @brief La acción en curso no se pudo hacer; la pone `fail_action()`.
+ */
+static bool action_failed = false;
+
+/**
+ * @brief Marca que la acción en curso no se pudo hacer: la tecla sigue buscando entrada.
+ */
+static void fail_action(void) {
+    action_failed = true;
+}
+
+/**
+ * @brief Devuelve la clase de una tecla.
+ *
+ * @param key Tecla presionada.
+ * @return Bit de `KeyClass`, o 0 si no es una tecla del teclado.
+ */
+static uint8_t key_class(char key) {
+    if (key >= '0' && key <= '9') {
+        return KEYS_DIGIT;
+    }
     switch (key) {
-        case 'A': // Retirar dinero
-            selected_index=0;
-            withdraw_money();
-            break;
-        case 'B': // Consultar saldo
-            selected_index=1;
-            withdraw_money();
-            break;
-        case 'C':
-             selected_index=2;
-            withdraw_money();
-            break;
-        case 'D':
-            selected_index=3;
-            withdraw_money();
-            break;
-        default:
-            printf("\nOpción no válida\n");
-            displayMessage("                    ",0,0);
-            displayMessage("  Opción no válida  ",1,0);
-            displayMessage("                    ",2,0);
-            displayMessage("                    ",3,0);
-           amount_menu();
-            break;
+        case 'A': return KEYS_A;
+        case 'B': return KEYS_B;
+        case 'C': return KEYS_C;
+        case 'D': return KEYS_D;
+        case '*': return KEYS_STAR;
+        case '#': return KEYS_HASH;
+        default:  return 0;
     }
 }
 
 /**
- * @brief Realiza el proceso de retiro de dinero de la cuenta del usuario.
- * 
- * Esta función verifica las condiciones necesarias para permitir un retiro de dinero. 
- * Valida si la cuenta está bloqueada, si hay billetes disponibles de la denominación seleccionada 
- * y si el usuario tiene suficiente saldo. Si todas las condiciones se cumplen, 
- * efectúa el retiro actualizando el saldo del usuario y la cantidad de billetes disponibles.
+ * @brief Arma en un buffer temporal lo ingresado hasta ahora más la tecla actual.
+ *
+ * @param input Buffer de entrada (ID o clave).
+ * @param key Tecla presionada.
+ * @return Cadena con `input_index + 1` caracteres.
  */
+static const char *input_with_key(const char *input, char key) {
+    static char candidate[ID_LENGTH + 1];
+    memcpy(candidate, input, (size_t)input_index);
+    candidate[input_index] = key;
+    candidate[input_index + 1] = '\0';
+    return candidate;
+}
 
+/**
+ * @brief Devuelve el monto pedido: la denominación de las teclas A a D, o el monto
+ * escrito si la tecla es '#'.
+ *
+ * @param key Tecla presionada.
+ * @return Monto en pesos.
+ */
+static money_t requested_amount(char key) {
+    if (key >= 'A' && key <= 'D') {
+        return denominations[key - 'A'].amount;
+    }
+    return (money_t)atol(input_amount);
+}
 
-void withdraw_money() {
-    if (current_user->is_blocked) {
-        printf("\nError: Su cuenta está bloqueada.\n");
-        displayMessage("                    ",0,0);
-        displayMessage("  Su cuenta está    ",1,0);
-        displayMessage("     bloqueada      ",2,0);
-        displayMessage("                    ",3,0);
-        reset_state();
-        return;
+/* Guardas */
+
+static bool id_pending(char key) {
+    return input_index + 1 < ID_LENGTH;
+}
+
+static bool id_rejected(char key) {
+    User *user = find_user(input_with_key(input_id, key));
+    return user == NULL || user->is_blocked;
+}
+
+static bool password_pending(char key) {
+    return input_index + 1 < PASSWORD_LENGTH;
+}
+
+static bool password_correct(char key) {
+    return strcmp(current_user->password, input_with_key(input_password, key)) == 0;
+}
+
+static bool password_blocks_user(char key) {
+    return current_user->failed_attempts + 1 >= MAX_FAILED_ATTEMPTS;
+}
+
+static bool new_password_matches(char key) {
+    return strcmp(new_password, input_with_key(input_password, key)) == 0;
+}
+
+static bool amount_digit_accepted(char key) {
+    return input_index < AMOUNT_LENGTH && !(input_index == 0 && key == '0');
+}
+
+static bool amount_empty(char key) {
+    return input_index == 0;
+}
+
+static bool account_blocked(char key) {
+    return current_user->is_blocked;
+}
+
+static bool amount_invalid(char key) {
+    money_t amount = requested_amount(key);
+    return amount <= 0 || amount % WITHDRAW_UNIT != 0;
+}
+
+static bool amount_over_limit(char key) {
+    return requested_amount(key) > PLAN_MAX_AMOUNT;
+}
+
+static bool funds_insufficient(char key) {
+    money_t new_balance;
+    return !money_sub(current_user->balance, requested_amount(key), &new_balance) || new_balance < 0;
+}
+
+static bool notes_unavailable(char key) {
+    WithdrawalPlan plan;
+    return !plan_in_service(requested_amount(key), &plan);
+}
+
+static bool journal_ready(char key) {
+    return acctlog_withdraw_ready();
+}
+
+/* Acciones */
+
+static void store_id_key(char key) {
+    input_id[input_index++] = key;
+    log_message(LOG_KEY_ECHO, key);
+}
+
+static void reject_id(char key) {
+    store_id_key(key);
+    User *user = find_user(input_id);
+    if (user && user->is_blocked) {
+        log_message(LOG_USER_BLOCKED);
+    } else {
+        log_message(LOG_USER_UNKNOWN);
     }
+    clear_session();
+}
 
-    // Seleccionar la denominación
-    Denomination* selected = &denominations[selected_index];
-
-    // Verificar disponibilidad de billetes
-    if (selected->quantity < 1) {
-        printf("\nError: No hay billetes de %d disponibles. Intente con otra denominación.\n", selected->amount);
-        displayMessage("                    ",0,0);
-        displayMessage("  No hay billetes   ",1,0);
-        displayMessage("     disponibles    ",2,0);
-        displayMessage("                    ",3,0);
-        amount_menu();
-        return;
+static void accept_id(char key) {
+    store_id_key(key);
+    current_user = find_user(input_id);
+    log_message(LOG_ENTER_PASSWORD);
+    input_index = 0;
+}
+
+static void store_password_key(char key) {
+    input_password[input_index++] = key;
+    log_message(LOG_SECRET_KEY);
+}
+
+static void log_in(char key) {
+    store_password_key(key);
+    log_message(LOG_LOGGED_IN, current_user->name);
+    if (current_user->failed_attempts > 0) {
+        current_user->failed_attempts = 0;
+        save_user(current_user);
     }
+}
 
-    // Verificar saldo suficiente
-    if (selected->amount > current_user->balance) {
-        printf("\nError: Fondos insuficientes. Su saldo actual es %.2f\n", current_user->balance);
-        displayMessage("                    ",0,0);
-        displayMessage("       Fondos       ",1,0);
-        displayMessage("    insuficientes   ",2,0);
-        displayMessage("                    ",3,0);
-        amount_menu();
-        return;
+static void block_user(char key) {
+    store_password_key(key);
+    current_user->failed_attempts++;
+    current_user->is_blocked = true;
+    log_message(LOG_TOO_MANY_ATTEMPTS);
+    save_user(current_user);
+    clear_session();
+}
+
+static void wrong_password(char key) {
+    store_password_key(key);
+    current_user->failed_attempts++;
+    log_message(LOG_WRONG_PASSWORD, (int)(MAX_FAILED_ATTEMPTS - current_user->failed_attempts));
+    save_user(current_user);
+    clear_session();
+}
+
+static void start_balance(char key) {
+    log_message(LOG_CHECKING_BALANCE);
+}
+
+static void start_password_change(char key) {
+    log_message(LOG_ENTER_NEW_PASSWORD);
+    input_index = 0;
+}
+
+static void log_out(char key) {
+    log_message(LOG_LOGGING_OUT);
+    clear_session();
+}
+
+static void invalid_option(char key) {
+    log_message(LOG_INVALID_OPTION);
+}
+
+static void finish_session(char key) {
+    log_message(LOG_GOODBYE);
+    clear_session();
+}
+
+static void start_amount_entry(char key) {
+    log_message(LOG_ENTER_AMOUNT);
+    memset(input_amount, 0, sizeof(input_amount));
+    input_index = 0;
+}
+
+static void store_amount_digit(char key) {
+    input_amount[input_index++] = key;
+    log_message(LOG_KEY_ECHO, key);
+    screen_set_field(FIELD_AMOUNT, input_amount);
+}
+
+static void reject_blocked_account(char key) {
+    log_message(LOG_ACCOUNT_BLOCKED);
+    clear_session();
+}
+
+static void reject_amount(char key) {
+    log_message(LOG_AMOUNT_INVALID, (int)WITHDRAW_UNIT);
+}
+
+static void reject_amount_limit(char key) {
+    char text[MONEY_TEXT_MAX];
+    money_format(PLAN_MAX_AMOUNT, text, sizeof(text));
+    log_message(LOG_AMOUNT_TOO_LARGE, text);
+}
+
+static void reject_funds(char key) {
+    char text[MONEY_TEXT_MAX];
+    money_format(current_user->balance, text, sizeof(text));
+    log_message(LOG_FUNDS_INSUFFICIENT, text);
+}
+
+static void reject_notes(char key) {
+    char text[MONEY_TEXT_MAX];
+    money_format(requested_amount(key), text, sizeof(text));
+    log_message(LOG_NOTES_UNAVAILABLE, text);
+}
+
+static void withdraw_requested(char key) {
+    if (!withdraw_money(requested_amount(key))) {
+        fail_action();
     }
+}
 
+static void store_new_password_key(char key) {
+    new_password[input_index++] = key;
+    log_message(LOG_SECRET_KEY);
+}
 
-    // Realizar el retiro
-    mov_motors(selected->pinselect);
-    current_user->balance -= selected->amount;
-    selected->quantity -= 1;
+static void finish_new_password(char key) {
+    store_new_password_key(key);
+    log_message(LOG_CONFIRM_PASSWORD);
+    input_index = 0;
+    memset(input_password, 0, sizeof(input_password));
+}
 
-    printf("\nÉxito: Retiró %d. Retiro con el valor de %.2f\n", selected->amount); 
-    displayMessage("                    ",0,0);
-    displayMessage("     Retiro         ",1,0);
-    displayMessage("    Éxitoso         ",2,0);
-    displayMessage("                    ",3,0);
+static void change_password(char key) {
+    store_password_key(key);
+    strcpy(current_user->password, new_password);
+    save_user(current_user);
+    log_message(LOG_PASSWORD_CHANGED);
+}
 
-    // Mostrar balance actualizado
-    current_state = STATE_CHECK_BALANCE;
-    check_balance();
+static void password_mismatch(char key) {
+    store_password_key(key);
+    log_message(LOG_PASSWORD_MISMATCH);
 }
+
 /**
- * @brief Muestra el saldo actual de la cuenta del usuario.
- * 
- * Esta función verifica si la cuenta del usuario está bloqueada. 
- * Si no lo está, imprime el saldo actual del usuario y proporciona la opción de finalizar la operación.
+ * @brief Tabla de transiciones de la sesión, ordenada por estado. Es constante, así
+ * que queda en la flash.
  */
+static const Transition transitions[] = {
+    // Estado                 Teclas       Guarda                 Acción                  Siguiente               Pantalla
+    {STATE_ENTER_ID,          KEYS_ANY,    id_pending,            store_id_key,           STATE_SAME,             SCREEN_NONE},
+    {STATE_ENTER_ID,          KEYS_ANY,    id_rejected,           reject_id,              STATE_ENTER_ID,         SCREEN_WELCOME},
+    {STATE_ENTER_ID,          KEYS_ANY,    NULL,                  accept_id,              STATE_ENTER_PASSWORD,   SCREEN_ENTER_PASSWORD},
+
+    {STATE_ENTER_PASSWORD,    KEYS_ANY,    password_pending,      store_password_key,     STATE_SAME,             SCREEN_NONE},
+    {STATE_ENTER_PASSWORD,    KEYS_ANY,    password_correct,      log_in,                 STATE_LOGGED_IN,        SCREEN_MENU},
+    {STATE_ENTER_PASSWORD,    KEYS_ANY,    password_blocks_user,  block_user,             STATE_ENTER_ID,         SCREEN_WELCOME},
+    {STATE_ENTER_PASSWORD,    KEYS_ANY,    NULL,                  wrong_password,         STATE_ENTER_ID,         SCREEN_WELCOME},
+
+    {STATE_LOGGED_IN,         KEYS_A,      NULL,                  NULL,                   STATE_WITHDRAW_MONEY,   SCREEN_AMOUNT_MENU},
+    {STATE_LOGGED_IN,         KEYS_B,      NULL,                  start_balance,          STATE_CHECK_BALANCE,    SCREEN_BALANCE},
+    {STATE_LOGGED_IN,         KEYS_C,      NULL,                  start_password_change,  STATE_CHANGE_PASSWORD,  SCREEN_NEW_PASSWORD},
+    {STATE_LOGGED_IN,         KEYS_D,      NULL,                  log_out,                STATE_ENTER_ID,         SCREEN_WELCOME},
+    {STATE_LOGGED_IN,         KEYS_ANY,    NULL,                  invalid_option,         STATE_SAME,             SCREEN_MENU},
+
+    {STATE_CHECK_BALANCE,     KEYS_HASH,   NULL,                  finish_session,         STATE_ENTER_ID,         SCREEN_WELCOME},
+    {STATE_CHECK_BALANCE,     KEYS_ANY,    NULL,                  NULL,                   STATE_SAME,             SCREEN_BALANCE},
+
+    {STATE_WITHDRAW_MONEY,    KEYS_LETTER, account_blocked,       reject_blocked_account, STATE_ENTER_ID,         SCREEN_WELCOME},
+    {STATE_WITHDRAW_MONEY,    KEYS_LETTER, amount_invalid,        reject_amount,          STATE_SAME,             SCREEN_AMOUNT_MENU},
+    {STATE_WITHDRAW_MONEY,    KEYS_LETTER, funds_insufficient,    reject_funds,           STATE_SAME,             SCREEN_AMOUNT_MENU},
+    {STATE_WITHDRAW_MONEY,    KEYS_LETTER, notes_unavailable,     reject_notes,           STATE_SAME,             SCREEN_AMOUNT_MENU},
+    {STATE_WITHDRAW_MONEY,    KEYS_LETTER, journal_ready,         withdraw_requested,     STATE_CHECK_BALANCE,    SCREEN_BALANCE},
+    {STATE_WITHDRAW_MONEY,    KEYS_LETTER, NULL,                  NULL,                   STATE_CHECK_BALANCE,    SCREEN_WITHDRAW_FAILED},
+    {STATE_WITHDRAW_MONEY,    KEYS_STAR,   NULL,                  start_amount_entry,     STATE_ENTER_AMOUNT,     SCREEN_ENTER_AMOUNT},
+    {STATE_WITHDRAW_MONEY,    KEYS_ANY,    NULL,                  invalid_option,         STATE_SAME,             SCREEN_AMOUNT_MENU},
+
+    {STATE_CHANGE_PASSWORD,   KEYS_ANY,    password_pending,      store_new_password_key, STATE_SAME,             SCREEN_NONE},
+    {STATE_CHANGE_PASSWORD,   KEYS_ANY,    NULL,                  finish_new_password,    STATE_CONFIRM_PASSWORD, SCREEN_CONFIRM_PASSWORD},
+
+    {STATE_CONFIRM_PASSWORD,  KEYS_ANY,    password_pending,      store_password_key,     STATE_SAME,             SCREEN_NONE},
+    {STATE_CONFIRM_PASSWORD,  KEYS_ANY,    new_password_matches,  change_password,        STATE_LOGGED_IN,        SCREEN_MENU},
+    {STATE_CONFIRM_PASSWORD,  KEYS_ANY,    NULL,                  password_mismatch,      STATE_LOGGED_IN,        SCREEN_MENU},
+
+    {STATE_ENTER_AMOUNT,      KEYS_DIGIT,  amount_digit_accepted, store_amount_digit,     STATE_SAME,             SCREEN_NONE},
+    {STATE_ENTER_AMOUNT,      KEYS_HASH,   amount_empty,          NULL,                   STATE_SAME,             SCREEN_NONE},
+    {STATE_ENTER_AMOUNT,      KEYS_HASH,   account_blocked,       reject_blocked_account, STATE_ENTER_ID,         SCREEN_WELCOME},
+    {STATE_ENTER_AMOUNT,      KEYS_HASH,   amount_invalid,        reject_amount,          STATE_WITHDRAW_MONEY,   SCREEN_AMOUNT_MENU},
+    {STATE_ENTER_AMOUNT,      KEYS_HASH,   amount_over_limit,     reject_amount_limit,    STATE_WITHDRAW_MONEY,   SCREEN_AMOUNT_MENU},
+    {STATE_ENTER_AMOUNT,      KEYS_HASH,   funds_insufficient,    reject_funds,           STATE_WITHDRAW_MONEY,   SCREEN_AMOUNT_MENU},
+    {STATE_ENTER_AMOUNT,      KEYS_HASH,   notes_unavailable,     reject_notes,           STATE_WITHDRAW_MONEY,   SCREEN_AMOUNT_MENU},
+    {STATE_ENTER_AMOUNT,      KEYS_HASH,   journal_ready,         withdraw_requested,     STATE_CHECK_BALANCE,    SCREEN_BALANCE},
+    {STATE_ENTER_AMOUNT,      KEYS_HASH,   NULL,                  NULL,                   STATE_CHECK_BALANCE,    SCREEN_WITHDRAW_FAILED},
+    {STATE_ENTER_AMOUNT,      KEYS_STAR,   NULL,                  NULL,                   STATE_WITHDRAW_MONEY,   SCREEN_AMOUNT_MENU},
+};
 
-void check_balance() {
-    if (current_user->is_blocked) {
-        printf("\nError: Su cuenta está bloqueada.\n");
-        return;
+/**
+ * @brief Cantidad de entradas de la tabla de transiciones.
+ */
+#define TRANSITION_COUNT (sizeof(transitions) / sizeof(transitions[0]))
+
+/**
+ * @brief Primera entrada de cada estado en `transitions`; la del estado siguiente marca el final.
+ */
+static uint8_t state_first[STATE_COUNT + 1];
+
+/**
+ * @brief Indexa la tabla de transiciones por estado y la revisa completa.
+ *
+ * Comprueba que la tabla esté ordenada por estado, que los estados y pantallas
+ * existan, que ninguna entrada quede tapada por una anterior sin guarda, y que en
+ * los estados de ingreso de ID y claves toda tecla tenga una entrada sin guarda.
+ *
+ * @return Cantidad de problemas encontrados; 0 si la tabla está bien.
+ */
+int init_transitions() {
+    int problems = 0;
+
+    for (unsigned int s = 0, i = 0; s <= STATE_COUNT; s++) {
+        while (i < TRANSITION_COUNT && transitions[i].state < s) {
+            i++;
+        }
+        state_first[s] = (uint8_t)i;
     }
 
-    printf("\nSu saldo actual es: %.2f\n", current_user->balance);
-    printf("\nPresione '#' para finalizar");
-    displayBalance(current_user->balance);    
-    displayMessage("  Presione '#'      ",1,0);
-    displayMessage(" para finalizar     ",2,0);
-    displayMessage("                    ",3,0);
+    for (unsigned int i = 0; i < TRANSITION_COUNT; i++) {
+        const Transition *t = &transitions[i];
+        if (t->state >= STATE_COUNT || (i > 0 && t->state < transitions[i - 1].state)) {
+            log_message(LOG_TRANSITION_ORDER, (uint32_t)i);
+            problems++;
+        }
+        if ((t->next >= STATE_COUNT && t->next != STATE_SAME) || t->screen >= SCREEN_COUNT || t->keys == 0) {
+            log_message(LOG_TRANSITION_INVALID, (uint32_t)i);
+            problems++;
+        }
+
+        uint8_t covered = 0;
+        for (unsigned int j = state_first[t->state]; j < i; j++) {
+            if (transitions[j].guard == NULL) {
+                covered |= transitions[j].keys;
+            }
+        }
+        if ((t->keys & ~covered) == 0) {
+            log_message(LOG_TRANSITION_UNUSED, (uint32_t)i);
+            problems++;
+        }
+    }
+
+    static const uint8_t entry_states[] = {
+        STATE_ENTER_ID, STATE_ENTER_PASSWORD, STATE_CHANGE_PASSWORD, STATE_CONFIRM_PASSWORD
+    };
+    for (unsigned int k = 0; k < sizeof(entry_states); k++) {
+        uint8_t covered = 0;
+        for (unsigned int j = state_first[entry_states[k]]; j < state_first[entry_states[k] + 1]; j++) {
+            if (transitions[j].guard == NULL) {
+                covered |= transitions[j].keys;
+            }
+        }
+        if (covered != KEYS_ANY) {
+            log_message(LOG_STATE_UNCOVERED, (uint32_t)entry_states[k]);
+            problems++;
+        }
+    }
+    return problems;
 }
+
 /**
  * @brief Procesa la tecla presionada por el usuario según el estado actual del sistema.
+ *
+ * Busca en la tabla de transiciones la primera entrada del estado actual que acepta
+ * la tecla, ejecuta su acción, cambia de estado y muestra su pantalla.
  * 
  * @param key Tecla presionada por el usuario.
  */
 void process_key(char key) {
-    absolute_time_t current_time = get_absolute_time();
-    
-    if (absolute_time_diff_us(input_start_time, current_time) > (MAX_INPUT_TIME_MS * 1000) &&
-        current_state == STATE_ENTER_PASSWORD) {
+    if (input_timed_out()) {
         handle_timeout();
         return;
     }
 
-    switch (current_state) {
-        case STATE_ENTER_ID:
-            if (input_index < ID_LENGTH) {
-                input_id[input_index++] = key;
-                printf("%c", key);
-                if (input_index == ID_LENGTH) {
-                    input_id[ID_LENGTH] = '\0';
-                    current_user = find_user(input_id);
-                    if (current_user == NULL || current_user->is_blocked) {
-                        if (current_user && current_user->is_blocked) {
-                            printf("\n¡Usuario bloqueado! Contacte al administrador.\n");
-                        } else {
-                            printf("\nID de usuario no existe.\n");
-                            displayMessage("   La Cuenta        ",0,0);
-                            displayMessage("       No           ",1,0);
-                            displayMessage("     Existe         ",2,0);
-                            displayMessage("                    ",3,0);
-                        }
-                        reset_state();
-                    } else {
-                        printf("\nIngrese contraseña de 4 dígitos:\n");
-                        displayMessage("                    ",0,0);
-                        displayMessage("    Ingrese clave:  ",1,0);
-                        displayMessage("                    ",2,0);
-                        displayMessage("                    ",3,0);
-                        input_start_time = get_absolute_time();                                                     
-                        current_state = STATE_ENTER_PASSWORD;
-                        input_index = 0;
-                    }
-                }
-            }
-            break;
-
-        case STATE_ENTER_PASSWORD:
-            if (input_index < PASSWORD_LENGTH) {
-                input_password[input_index++] = key;
-                printf("*");
-                if (input_index == PASSWORD_LENGTH) {
-                    input_password[PASSWORD_LENGTH] = '\0';
-                    if (strcmp(current_user->password, input_password) == 0) {
-                        printf("\n\n¡Bienvenido, %s!\n", current_user->name);
-                        current_user->failed_attempts = 0;
-                        current_state = STATE_LOGGED_IN;
-                        show_menu();
-                    } else {
-                        current_user->failed_attempts++;
-                        if (current_user->failed_attempts >= MAX_FAILED_ATTEMPTS) {
-                            current_user->is_blocked = true;
-                            printf("\n\n¡Usuario bloqueado! Demasiados intentos fallidos.\n");
-                        } else {
-                            printf("\n\nContraseña incorrecta. Intentos restantes: %d\n",                             
-                                   MAX_FAILED_ATTEMPTS - current_user->failed_attempts);
-                            displayMessage("                    ",0,0);
-                            displayMessage("    Contraseña      ",1,0);
-                            displayMessage("    incorrecta      ",2,0);
-                            displayMessage("                    ",3,0);       
-                        }
-                        reset_state();
-                    }
-                }
-            }
-            break;
-
-        case STATE_LOGGED_IN:
-            process_logged_in_state(key);
-            break;
-        
-        case STATE_CHECK_BALANCE:  // Maneja la consulta de saldo
-        
-            if (key == '#') { // Confirma para salir del estado
-                printf("\nGracias por utilzar nuestros serivicos\n");
-                displayMessage("   Gracias por      ",0,0);
-                displayMessage("  utilzar nuestros  ",1,0);
-                displayMessage("     Servicios      ",2,0);
-                displayMessage("                    ",3,0);                        
-                reset_state();
-
-            } else {
-                check_balance();
-            }
-        
-            break;
-
-        case STATE_WITHDRAW_MONEY:  // Maneja el retiro de dinero
-            amount_selection(key);
-            break;
-
-        case STATE_CHANGE_PASSWORD:
-            if (input_index < PASSWORD_LENGTH) {
-                new_password[input_index++] = key;
-                printf("*");
-                if (input_index == PASSWORD_LENGTH) {
-                    printf("\nConfirme la nueva contraseña:\n");
-                    displayMessage("     Confirme       ",0,0);
-                    displayMessage("     la nueva       ",1,0);
-                    displayMessage("    contraseña      ",2,0);
-                    displayMessage("                    ",3,0); 
-                    current_state = STATE_CONFIRM_PASSWORD;
-                    input_index = 0;
-                    memset(input_password, 0, sizeof(input_password));
-                }
-            }
-            break;
-
-        case STATE_CONFIRM_PASSWORD:
-            if (input_index < PASSWORD_LENGTH) {
-                input_password[input_index++] = key;
-                printf("*");
-                if (input_index == PASSWORD_LENGTH) {
-                    if (strcmp(new_password, input_password) == 0) {
-                        strcpy(current_user->password, new_password);
-                        printf("\n¡Contraseña cambiada exitosamente!\n");
-                        displayMessage("     Contraseña     ",0,0);
-                        displayMessage("      cambiada      ",1,0);
-                        displayMessage("     exitosamente   ",2,0);
-                        displayMessage("                    ",3,0); 
-                        
-                    } else {
-                        printf("\nLas contraseñas no coinciden. Intente de nuevo.\n");
-                        displayMessage("  Las contraseñas   ",0,0);
-                        displayMessage("   no coinciden     ",1,0);
-                        displayMessage("  Intente de nuevo  ",2,0);
-                        displayMessage("                    ",3,0); 
-                        
-                    }
-                    current_state = STATE_LOGGED_IN;
-                    show_menu();
-                }
+    uint8_t key_bit = key_class(key);
+    for (unsigned int i = state_first[current_state]; i < state_first[current_state + 1]; i++) {
+        const Transition *t = &transitions[i];
+        if ((t->keys & key_bit) == 0 || (t->guard && !t->guard(key))) {
+            continue;
+        }
+        if (t->action) {
+            action_failed = false;
+            t->action(key);
+            if (action_failed) {
+                continue;
             }
-            break;
-
+        }
+        if (t->next != STATE_SAME) {
+            enter_state((SystemState)t->next);
+        } else if (session_open(current_state)) {
+            enter_state(current_state);     // Cada tecla reinicia la espera de la sesión
+        }
+        show_screen((ScreenId)t->screen);
+        return;
     }
 }
@@ -12,16 +12,18 @@
 #include "hardware/gpio.h"
 #include "hardware/timer.h"
 #include "hardware/irq.h"
-
-/**
- * @brief Tiempo de retardo para el debounce de los botones, en microsegundos.
- */
-#define DEBOUNCE_DELAY 200000
+#include "money.h"
+#include "screens.h"
+#include "pwm.h"
 
 /**
  * @brief Número máximo de usuarios permitidos en el sistema de datos.
+ *
+ * `matecash_users` lo compila con 100000 para medir la búsqueda con muchas cuentas.
  */
+#ifndef NUM_USERS
 #define NUM_USERS 5
+#endif
 
 /**
  * @brief Longitud del ID de usuario.
@@ -38,18 +40,34 @@
  */
 #define MAX_INPUT_TIME_MS 20000
 
+/**
+ * @brief Tiempo sin teclas tras el que se cierra una sesión abierta y se vuelve a la
+ * bienvenida, en milisegundos.
+ */
+#define SESSION_IDLE_MS 60000
+
+/**
+ * @brief Cantidad máxima de dígitos de un monto a retirar.
+ */
+#define AMOUNT_LENGTH 7
+
+/**
+ * @brief Número de denominaciones de billetes (una por motor del dispensador).
+ */
+#define NUM_DENOMINATIONS 4
+
 /**
  * @brief Número máximo de intentos fallidos antes de bloquear a un usuario.
  */
 #define MAX_FAILED_ATTEMPTS 3
 
 /**
- * @brief Pines GPIO utilizados para las filas del teclado matricial.
+ * @brief Pines GPIO utilizados para las filas del teclado matricial (consecutivos, los maneja el PIO).
  */
 extern const uint8_t ROW_PINS[4];
 
 /**
- * @brief Pines GPIO utilizados para las columnas del teclado matricial.
+ * @brief Pines GPIO utilizados para las columnas del teclado matricial (consecutivos, los lee el PIO).
  */
 extern const uint8_t COL_PINS[4];
 
@@ -68,7 +86,9 @@ typedef enum {
     STATE_CHECK_BALANCE,
     STATE_WITHDRAW_MONEY,
     STATE_CHANGE_PASSWORD,   /**< Estado para cambiar la contraseña */
-    STATE_CONFIRM_PASSWORD   /**< Estado para confirmar el cambio de contraseña */
+    STATE_CONFIRM_PASSWORD,  /**< Estado para confirmar el cambio de contraseña */
+    STATE_ENTER_AMOUNT,      /**< Estado para escribir un monto a retirar */
+    STATE_COUNT              /**< Cantidad de estados */
 } SystemState;
 
 /**
@@ -78,36 +98,28 @@ typedef struct {
     char id[ID_LENGTH + 1];                 /**< ID del usuario */
     char password[PASSWORD_LENGTH + 1];     /**< Contraseña del usuario */
     char name[20];                          /**< Nombre del usuario */
-     double balance;
+    money_t balance;                        /**< Saldo, en pesos */
     uint8_t failed_attempts;                /**< Número de intentos fallidos del usuario */
     bool is_blocked;                        /**< Indica si el usuario está bloqueado */
 } User;
 
 typedef struct {
-    double amount;   // Valor del billete
+    money_t amount;   // Valor del billete, en pesos
     int quantity; // Cantidad de billetes disponibles
     int pinselect;
+    RampProfile ramp; // Perfil del motor paso a paso de su canal
+    NoteSensor sensor; // Barrera a la salida del rodillo, si tiene
 } Denomination;
 
 /**
- * @brief Indica si se ha presionado una tecla.
- */
-extern volatile bool key_pressed;
-
-/**
- * @brief Fila actual escaneada en el teclado matricial.
- */
-extern volatile uint8_t current_row;
-
-/**
- * @brief Última tecla presionada en el teclado matricial.
+ * @brief Tabla de usuarios; se reconstruye desde la flash al arrancar.
  */
-extern volatile char last_key;
+extern User users[NUM_USERS];
 
 /**
- * @brief Tiempo en el que se presionó la última tecla.
+ * @brief Billetes disponibles de cada denominación.
  */
-extern volatile absolute_time_t last_key_time;
+extern Denomination denominations[NUM_DENOMINATIONS];
 
 /**
  * @brief Buffer para almacenar el ID de usuario ingresado.
@@ -124,6 +136,11 @@ extern char input_password[PASSWORD_LENGTH + 1];
  */
 extern char new_password[PASSWORD_LENGTH + 1];
 
+/**
+ * @brief Buffer para almacenar el monto que el usuario escribe para retirar.
+ */
+extern char input_amount[AMOUNT_LENGTH + 1];
+
 /**
  * @brief Índice actual del input ingresado.
  */
@@ -134,35 +151,26 @@ extern int input_index;
  */
 extern SystemState current_state;
 
-/**
- * @brief Tiempo de inicio del input actual.
- */
-extern absolute_time_t input_start_time;
-
 /**
  * @brief Puntero al usuario actual que está interactuando con el sistema.
  */
 extern User* current_user;
 
 /**
- * @brief timer_Callback que se ejecuta cuando se cumple el tiempo de un temporizador.
- * 
- * @param alarm_num Número del temporizador que ha expirado.
+ * @brief Configura el dispensador con un canal por cada denominación (`pinselect` y `ramp`).
  */
-void timer_callback(uint alarm_num);
+void init_dispenser(void);
 
 /**
- * @brief gpio_Callback que se ejecuta cuando ocurre un evento en el GPIO.
- * 
- * @param gpio Número del pin GPIO que generó el evento.
- * @param events Tipos de eventos que ocurrieron subida del flanco.
+ * @brief Atiende el aviso `EVENT_MOTOR_DONE` de billete entregado.
  */
-void gpio_callback(uint gpio, uint32_t events);
+void handle_dispense_done(void);
 
 /**
- * @brief Inicializa el teclado matricial y configura los pines GPIO correspondientes.
+ * @brief Construye el índice ordenado de usuarios. Se llama al arrancar y cada vez
+ * que cambian los IDs de `users[]`.
  */
-void init_keypad(void);
+void build_user_index(void);
 
 /**
  * @brief Busca un usuario en la base de datos de usuarios según su ID.
@@ -177,31 +185,49 @@ User* find_user(const char* id);
  */
 void reset_state(void);
 
+/**
+ * @brief Indica si venció el tiempo del estado actual de la sesión.
+ *
+ * @return true si el estado tiene tiempo máximo y su temporizador ya venció.
+ */
+bool input_timed_out(void);
+
 /**
  * @brief Maneja el caso en que el tiempo para ingresar el ID o la contraseña ha sido excedido.
  */
 void handle_timeout(void);
 
 /**
- * @brief Muestra el menú de opciones del usuario una vez que ha iniciado sesión.
+ * @brief Muestra una pantalla del catálogo y completa sus campos con los datos de la sesión.
+ *
+ * @param screen Pantalla a mostrar; `SCREEN_NONE` no cambia nada.
  */
-void show_menu(void);
-void amount_menu(void);
+void show_screen(ScreenId screen);
+
 /**
- * @brief Procesa las acciones del usuario cuando ha iniciado sesión.
- * 
- * @param key Tecla presionada por el usuario.
+ * @brief Indexa la tabla de transiciones de la sesión y la revisa completa. Se llama
+ * una vez al arrancar, antes de procesar teclas.
+ *
+ * @return Cantidad de problemas encontrados en la tabla; 0 si está bien.
  */
-void process_logged_in_state(char key);
-void amount_selection(char key);
+int init_transitions(void);
 
 /**
- * @brief Procesa la tecla presionada por el usuario según el estado actual del sistema.
+ * @brief Procesa la tecla presionada por el usuario según el estado actual del sistema,
+ * con la tabla de transiciones.
  * 
  * @param key Tecla presionada por el usuario.
  */
 void process_key(char key);
-void withdraw_money();
-void check_balance();
+
+/**
+ * @brief Retira un monto de la cuenta del usuario actual usando la menor cantidad de billetes.
+ *
+ * Las validaciones y los mensajes de error están en la tabla de transiciones.
+ *
+ * @param amount Monto a retirar, en pesos (múltiplo de 10.000).
+ * @return false si no alcanza el saldo o no hay billetes para formar el monto.
+ */
+bool withdraw_money(money_t amount);
 
 #endif // TCL_H
\ No newline at end of file
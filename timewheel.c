@@ -0,0 +1,350 @@
+/**
+ * @file timewheel.c
+ * @brief Implementación de la rueda de temporizadores.
+ *
+ * Cada casillero es una lista circular doble con un nodo centinela, así que agregar y
+ * sacar un temporizador no recorre nada. Un mapa de 64 bits por nivel marca los
+ * casilleros con temporizadores: el próximo casillero a atender sale de rotar el mapa y
+ * contar los ceros del final.
+ *
+ * El nivel `L` guarda los temporizadores que vencen dentro de 64^(L+1) ms, en el
+ * casillero de su milisegundo dividido por 64^L. Cuando el tiempo llega al comienzo de
+ * un casillero de un nivel alto, sus temporizadores bajan al nivel que les corresponde
+ * ahora; los del nivel 0 vencen. Los milisegundos sin casilleros ocupados se saltean, así
+ * que la alarma dispara solo cuando hay algo que hacer.
+ *
+ * El estado se protege con un spinlock de hardware. Las funciones de los temporizadores
+ * vencidos se llaman con el spinlock liberado, así pueden programar y cancelar.
+ */
+
+#include "timewheel.h"
+#include "pico/stdlib.h"
+#include "hardware/timer.h"
+#include "hardware/sync.h"
+
+/**
+ * @brief Bits de milisegundos que resuelve cada nivel.
+ */
+#define TIMEWHEEL_BITS 6
+
+/**
+ * @brief Casilleros por nivel.
+ */
+#define TIMEWHEEL_SLOTS (1u << TIMEWHEEL_BITS)
+
+/**
+ * @brief Niveles de la rueda: 64 ms, 4096 ms y 262144 ms.
+ */
+#define TIMEWHEEL_LEVELS 3
+
+/**
+ * @brief Margen con que se reprograma la alarma si su momento ya pasó, en microsegundos.
+ */
+#define TIMEWHEEL_LATE_US 2
+
+/**
+ * @brief Casilleros de cada nivel; cada uno es el centinela de su lista.
+ */
+static TimeWheelLink slots[TIMEWHEEL_LEVELS][TIMEWHEEL_SLOTS];
+
+/**
+ * @brief Casilleros con temporizadores, un bit por casillero.
+ */
+static uint64_t occupied[TIMEWHEEL_LEVELS];
+
+/**
+ * @brief Temporizadores vencidos cuya función todavía no se llamó.
+ */
+static TimeWheelLink expired;
+
+/**
+ * @brief Primer milisegundo que la rueda todavía no atendió.
+ */
+static uint32_t wheel_now = 0;
+
+/**
+ * @brief Cantidad de veces que se inicializó la rueda; descarta temporizadores viejos.
+ */
+static uint32_t wheel_epoch = 0;
+
+/**
+ * @brief Spinlock que protege la rueda.
+ */
+static spin_lock_t *wheel_lock = NULL;
+
+/**
+ * @brief Alarma de hardware de la rueda.
+ */
+static uint wheel_alarm = 0;
+
+/**
+ * @brief Milisegundos desde el arranque, en 32 bits; se comparan con resta para
+ * soportar la vuelta a los 49 días.
+ */
+static uint32_t wheel_clock_ms(void) {
+    return (uint32_t)(time_us_64() / 1000);
+}
+
+static void list_init(TimeWheelLink *head) {
+    head->next = head;
+    head->prev = head;
+}
+
+static bool list_empty(const TimeWheelLink *head) {
+    return head->next == head;
+}
+
+static void list_append(TimeWheelLink *head, TimeWheelLink *link) {
+    link->prev = head->prev;
+    link->next = head;
+    head->prev->next = link;
+    head->prev = link;
+}
+
+static void list_remove(TimeWheelLink *link) {
+    link->prev->next = link->next;
+    link->next->prev = link->prev;
+    link->next = NULL;
+    link->prev = NULL;
+}
+
+/**
+ * @brief Indica si el temporizador está en la rueda actual, en un casillero o vencido.
+ */
+static bool linked(const TimeWheelTimer *timer) {
+    return timer->link.next != NULL && timer->epoch == wheel_epoch;
+}
+
+/**
+ * @brief Saca un temporizador de su lista y desmarca su casillero si quedó vacío.
+ */
+static void unlink_timer(TimeWheelTimer *timer) {
+    list_remove(&timer->link);
+    if (timer->level < TIMEWHEEL_LEVELS && list_empty(&slots[timer->level][timer->slot])) {
+        occupied[timer->level] &= ~(1ull << timer->slot);
+    }
+}
+
+/**
+ * @brief Ubica un temporizador en el casillero que le corresponde según `wheel_now`.
+ */
+static void insert(TimeWheelTimer *timer) {
+    uint32_t delta = timer->expires - wheel_now;
+    unsigned int level = 0;
+    while (level < TIMEWHEEL_LEVELS - 1 && delta >= 1u << (TIMEWHEEL_BITS * (level + 1))) {
+        level++;
+    }
+    unsigned int slot = (timer->expires >> (TIMEWHEEL_BITS * level)) & (TIMEWHEEL_SLOTS - 1);
+    timer->level = (uint8_t)level;
+    timer->slot = (uint8_t)slot;
+    list_append(&slots[level][slot], &timer->link);
+    occupied[level] |= 1ull << slot;
+}
+
+/**
+ * @brief Próximo milisegundo en que la rueda tiene que hacer algo: vencer un casillero
+ * del nivel 0 o bajar uno de un nivel alto.
+ *
+ * @param tick Donde se escribe el milisegundo.
+ * @return false si la rueda está vacía.
+ */
+static bool next_tick(uint32_t *tick) {
+    bool found = false;
+    for (unsigned int level = 0; level < TIMEWHEEL_LEVELS; level++) {
+        if (occupied[level] == 0) {
+            continue;
+        }
+        // Primer casillero del nivel que empieza en `wheel_now` o después
+        unsigned int shift = TIMEWHEEL_BITS * level;
+        uint32_t base = (wheel_now >> shift) + ((wheel_now & ((1u << shift) - 1)) != 0);
+        unsigned int rotation = base & (TIMEWHEEL_SLOTS - 1);
+        uint64_t bits = occupied[level];
+        if (rotation != 0) {
+            bits = (bits >> rotation) | (bits << (64 - rotation));
+        }
+        uint32_t candidate = (base + (uint32_t)__builtin_ctzll(bits)) << shift;
+        if (!found || (int32_t)(candidate - *tick) < 0) {
+            *tick = candidate;
+            found = true;
+        }
+    }
+    return found;
+}
+
+/**
+ * @brief Baja los temporizadores de un casillero de un nivel alto.
+ *
+ * La lista se separa antes de reubicarla: las esperas más largas que la rueda vuelven
+ * al mismo casillero.
+ */
+static void cascade(unsigned int level, unsigned int slot) {
+    TimeWheelLink *head = &slots[level][slot];
+    if (list_empty(head)) {
+        return;
+    }
+    TimeWheelLink pending = {head->next, head->prev};
+    pending.next->prev = &pending;
+    pending.prev->next = &pending;
+    list_init(head);
+    occupied[level] &= ~(1ull << slot);
+
+    while (!list_empty(&pending)) {
+        TimeWheelTimer *timer = (TimeWheelTimer *)pending.next;
+        list_remove(&timer->link);
+        insert(timer);
+    }
+}
+
+/**
+ * @brief Atiende un milisegundo: baja los casilleros que empiezan en él, del nivel más
+ * alto al más bajo, y pasa los del nivel 0 a la lista de vencidos.
+ */
+static void run_tick(uint32_t tick) {
+    wheel_now = tick;
+    for (unsigned int level = TIMEWHEEL_LEVELS - 1; level > 0; level--) {
+        unsigned int shift = TIMEWHEEL_BITS * level;
+        if ((tick & ((1u << shift) - 1)) == 0) {
+            cascade(level, (tick >> shift) & (TIMEWHEEL_SLOTS - 1));
+        }
+    }
+
+    TimeWheelLink *head = &slots[0][tick & (TIMEWHEEL_SLOTS - 1)];
+    while (!list_empty(head)) {
+        TimeWheelTimer *timer = (TimeWheelTimer *)head->next;
+        unlink_timer(timer);
+        timer->level = TIMEWHEEL_LEVELS;
+        list_append(&expired, &timer->link);
+    }
+    wheel_now = tick + 1;
+}
+
+/**
+ * @brief Atiende todos los milisegundos hasta `now` y adelanta la rueda sin recorrer
+ * los vacíos.
+ */
+static void advance(uint32_t now) {
+    uint32_t tick;
+    while (next_tick(&tick) && (int32_t)(tick - now) <= 0) {
+        run_tick(tick);
+    }
+    if ((int32_t)(now - wheel_now) > 0) {
+        wheel_now = now;
+    }
+}
+
+/**
+ * @brief Programa la alarma para el próximo milisegundo con trabajo, o la cancela.
+ */
+static void program_alarm(void) {
+    uint32_t tick;
+    if (!next_tick(&tick)) {
+        hardware_alarm_cancel(wheel_alarm);
+        return;
+    }
+    uint64_t now_ms = time_us_64() / 1000;
+    int64_t target_ms = (int64_t)now_ms + (int32_t)(tick - (uint32_t)now_ms);
+    absolute_time_t target = from_us_since_boot(target_ms > 0 ? (uint64_t)target_ms * 1000 : 0);
+    while (hardware_alarm_set_target(wheel_alarm, target)) {
+        target = make_timeout_time_us(TIMEWHEEL_LATE_US);  // Ya pasó: que dispare enseguida
+    }
+}
+
+/**
+ * @brief Interrupción de la alarma: vence lo que corresponda y la reprograma.
+ *
+ * @param alarm_num Alarma que disparó.
+ */
+static void wheel_alarm_callback(uint alarm_num) {
+    (void)alarm_num;
+    uint32_t status = spin_lock_blocking(wheel_lock);
+    advance(wheel_clock_ms());
+    while (!list_empty(&expired)) {
+        TimeWheelTimer *timer = (TimeWheelTimer *)expired.next;
+        list_remove(&timer->link);
+        timewheel_callback_t callback = timer->callback;
+        void *user_data = timer->user_data;
+
+        spin_unlock(wheel_lock, status);
+        callback(user_data);
+        status = spin_lock_blocking(wheel_lock);
+    }
+    program_alarm();
+    spin_unlock(wheel_lock, status);
+}
+
+/**
+ * @brief Reserva la alarma de hardware y vacía la rueda.
+ */
+void timewheel_init(void) {
+    for (unsigned int level = 0; level < TIMEWHEEL_LEVELS; level++) {
+        for (unsigned int slot = 0; slot < TIMEWHEEL_SLOTS; slot++) {
+            list_init(&slots[level][slot]);
+        }
+        occupied[level] = 0;
+    }
+    list_init(&expired);
+    wheel_epoch++;
+    wheel_now = wheel_clock_ms();
+
+    wheel_lock = spin_lock_init(spin_lock_claim_unused(true));
+    wheel_alarm = (uint)hardware_alarm_claim_unused(true);
+    hardware_alarm_set_callback(wheel_alarm, wheel_alarm_callback);
+}
+
+/**
+ * @brief Prepara un temporizador sin programarlo.
+ */
+void timewheel_timer_init(TimeWheelTimer *timer, timewheel_callback_t callback, void *user_data) {
+    *timer = (TimeWheelTimer)TIMEWHEEL_TIMER(callback, user_data);
+}
+
+/**
+ * @brief Programa un temporizador, cancelándolo antes si ya estaba programado.
+ */
+void timewheel_arm(TimeWheelTimer *timer, uint32_t delay_ms) {
+    uint32_t status = spin_lock_blocking(wheel_lock);
+    if (linked(timer)) {
+        unlink_timer(timer);
+    }
+
+    // Si no hay nada vencido sin atender, la rueda se puede adelantar hasta ahora
+    uint64_t now_us = time_us_64();
+    uint32_t now = (uint32_t)(now_us / 1000);
+    uint32_t tick;
+    if (!next_tick(&tick) || (int32_t)(tick - now) > 0) {
+        if ((int32_t)(now - wheel_now) > 0) {
+            wheel_now = now;
+        }
+    }
+
+    // Redondeado hacia arriba: el milisegundo en curso ya empezó
+    uint32_t expires = (uint32_t)((now_us + (uint64_t)delay_ms * 1000 + 999) / 1000);
+    if ((int32_t)(expires - wheel_now) < 0) {
+        expires = wheel_now;
+    }
+    timer->expires = expires;
+    timer->epoch = wheel_epoch;
+    insert(timer);
+    program_alarm();
+    spin_unlock(wheel_lock, status);
+}
+
+/**
+ * @brief Cancela un temporizador. La alarma queda como estaba: si era el próximo en
+ * vencer, la interrupción no encuentra nada y se reprograma.
+ */
+void timewheel_cancel(TimeWheelTimer *timer) {
+    uint32_t status = spin_lock_blocking(wheel_lock);
+    if (linked(timer)) {
+        unlink_timer(timer);
+    }
+    timer->link.next = NULL;
+    spin_unlock(wheel_lock, status);
+}
+
+/**
+ * @brief Indica si un temporizador está programado y su función todavía no se llamó.
+ */
+bool timewheel_armed(const TimeWheelTimer *timer) {
+    return linked(timer);
+}
@@ -0,0 +1,102 @@
+/**
+ * @file timewheel.h
+ * @brief Rueda de temporizadores jerárquica sobre una sola alarma de hardware.
+ *
+ * Todas las esperas del firmware (la de la sesión, la de inactividad, la grabación en
+ * grupo del registro y el descanso de los motores) son temporizadores de esta rueda.
+ * Programar y cancelar cuesta O(1) y no reserva memoria: el temporizador lo aporta el
+ * módulo que lo usa. La resolución es de 1 ms y un temporizador nunca vence antes de
+ * lo pedido.
+ *
+ * La rueda tiene tres niveles de 64 casilleros, de 1 ms, 64 ms y 4096 ms cada uno; las
+ * esperas más largas que el último nivel (unos 4,4 minutos) se vuelven a ubicar cada
+ * vez que pasa su casillero. Una sola alarma de hardware queda programada para el
+ * próximo casillero con temporizadores, así que sin esperas pendientes no hay
+ * interrupciones. Las funciones de los temporizadores corren en esa interrupción, en
+ * el núcleo que llamó a `timewheel_init()`, y no deben bloquear.
+ */
+#ifndef TIMEWHEEL_H
+#define TIMEWHEEL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief Función que se llama al vencer un temporizador.
+ *
+ * @param user_data Dato registrado con el temporizador.
+ */
+typedef void (*timewheel_callback_t)(void *user_data);
+
+/**
+ * @brief Enlace de una lista circular de la rueda.
+ */
+typedef struct TimeWheelLink {
+    struct TimeWheelLink *next;
+    struct TimeWheelLink *prev;
+} TimeWheelLink;
+
+/**
+ * @brief Temporizador de la rueda. Lo reserva quien lo usa; los campos son internos.
+ */
+typedef struct {
+    TimeWheelLink link;             /**< Enlace en su casillero; `next` es NULL si no está programado */
+    uint32_t expires;               /**< Milisegundo en que vence */
+    uint32_t epoch;                 /**< Inicialización de la rueda en que se programó */
+    uint8_t level;                  /**< Nivel de su casillero */
+    uint8_t slot;                   /**< Casillero dentro del nivel */
+    timewheel_callback_t callback;  /**< Función a llamar al vencer */
+    void *user_data;                /**< Dato para `callback` */
+} TimeWheelTimer;
+
+/**
+ * @brief Inicializador estático de un temporizador.
+ */
+#define TIMEWHEEL_TIMER(cb, data) {{NULL, NULL}, 0, 0, 0, 0, (cb), (data)}
+
+/**
+ * @brief Reserva la alarma de hardware y vacía la rueda.
+ *
+ * Se llama antes que cualquier módulo que programe temporizadores. Los temporizadores
+ * que hubiera programados quedan descartados.
+ */
+void timewheel_init(void);
+
+/**
+ * @brief Prepara un temporizador sin programarlo.
+ *
+ * @param timer Temporizador.
+ * @param callback Función a llamar al vencer.
+ * @param user_data Dato para `callback`.
+ */
+void timewheel_timer_init(TimeWheelTimer *timer, timewheel_callback_t callback, void *user_data);
+
+/**
+ * @brief Programa un temporizador. Si ya estaba programado, se reprograma.
+ *
+ * Se puede llamar desde interrupciones, desde cualquier núcleo y desde la función de
+ * otro temporizador o del mismo.
+ *
+ * @param timer Temporizador preparado.
+ * @param delay_ms Espera mínima, en milisegundos.
+ */
+void timewheel_arm(TimeWheelTimer *timer, uint32_t delay_ms);
+
+/**
+ * @brief Cancela un temporizador. No hace nada si no estaba programado.
+ *
+ * Después de volver, su función no se llama aunque la rueda ya lo hubiera sacado de su
+ * casillero, salvo que ya se estuviera llamando en el otro núcleo.
+ *
+ * @param timer Temporizador.
+ */
+void timewheel_cancel(TimeWheelTimer *timer);
+
+/**
+ * @brief Indica si un temporizador está programado y todavía no se llamó su función.
+ *
+ * @param timer Temporizador.
+ */
+bool timewheel_armed(const TimeWheelTimer *timer);
+
+#endif // TIMEWHEEL_H
@@ -0,0 +1,310 @@
+/**
+ * @file trace.c
+ * @brief Buffer circular de puntos de traza e histogramas de latencia por etapa.
+ *
+ * Las etapas se arman a partir de pares de puntos:
+ *
+ * - tecla en cola: `TRACE_KEY_IRQ` hasta `TRACE_KEY_DISPATCH`.
+ * - process_key: `TRACE_KEY_DISPATCH` hasta `TRACE_KEY_DONE`.
+ * - tecla a LCD: `TRACE_KEY_IRQ` hasta el `TRACE_LCD_END` de la primera ráfaga que
+ *   salió después de procesar la tecla. Si la tecla no cambió la pantalla, la etapa
+ *   queda abierta hasta la tecla siguiente y se descarta.
+ * - ráfaga LCD: `TRACE_LCD_START` hasta `TRACE_LCD_END`.
+ * - motor: `TRACE_MOTOR_START` hasta `TRACE_MOTOR_STOP` del mismo canal.
+ * - retiro: `TRACE_WITHDRAW_START` hasta `TRACE_WITHDRAW_END`.
+ */
+
+#include "trace.h"
+
+#if MATECASH_TRACE
+
+#include "log.h"
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+#include <stdbool.h>
+
+/**
+ * @brief Eventos que guarda el buffer circular (potencia de 2).
+ */
+#define TRACE_RING_SIZE 256
+
+/**
+ * @brief Cubetas de cada histograma: la cubeta `b` cuenta latencias menores que
+ * 2^b us y la última junta todo lo que pasa de 2 s.
+ */
+#define TRACE_BUCKETS 23
+
+/**
+ * @brief Teclas que pueden esperar en la cola entre la interrupción y el lazo principal.
+ */
+#define TRACE_KEY_QUEUE 8
+
+/**
+ * @brief Canales de motor que se siguen por separado.
+ */
+#define TRACE_MOTORS 8
+
+/**
+ * @brief Evento del buffer circular.
+ */
+typedef struct {
+    uint32_t time_us;   /**< Marca de tiempo */
+    uint8_t point;      /**< `TracePoint` */
+    uint8_t arg;        /**< Argumento */
+} TraceEvent;
+
+/**
+ * @brief Etapas medidas.
+ */
+typedef enum {
+    STAGE_KEY_QUEUE,
+    STAGE_KEY_PROCESS,
+    STAGE_KEY_TO_LCD,
+    STAGE_LCD_BURST,
+    STAGE_MOTOR,
+    STAGE_WITHDRAW,
+    STAGE_COUNT
+} TraceStage;
+
+/**
+ * @brief Histograma de una etapa.
+ */
+typedef struct {
+    uint32_t count;                     /**< Muestras */
+    uint32_t min_us;                    /**< Mínimo */
+    uint32_t max_us;                    /**< Máximo */
+    uint64_t total_us;                  /**< Suma, para el promedio */
+    uint32_t buckets[TRACE_BUCKETS];    /**< Muestras por cubeta */
+} TraceHistogram;
+
+static const char *const stage_names[STAGE_COUNT] = {
+    [STAGE_KEY_QUEUE] = "tecla en cola",
+    [STAGE_KEY_PROCESS] = "process_key",
+    [STAGE_KEY_TO_LCD] = "tecla a LCD",
+    [STAGE_LCD_BURST] = "ráfaga LCD",
+    [STAGE_MOTOR] = "motor",
+    [STAGE_WITHDRAW] = "retiro",
+};
+
+static spin_lock_t *trace_lock;
+static TraceEvent trace_ring[TRACE_RING_SIZE];
+static volatile uint32_t trace_head = 0;
+static uint32_t trace_tail = 0;
+static uint32_t trace_lost = 0;
+
+static TraceHistogram histograms[STAGE_COUNT];
+
+/**
+ * @brief Estado de los pares abiertos mientras se recorren los eventos.
+ */
+static struct {
+    uint32_t key_irq_us[TRACE_KEY_QUEUE];   /**< Teclas publicadas y no procesadas */
+    unsigned int key_count;                 /**< Teclas en `key_irq_us` */
+    bool dispatched;                        /**< Hay una tecla en `process_key()` */
+    uint32_t dispatch_us;                   /**< Comienzo de `process_key()` */
+    uint32_t current_key_us;                /**< Interrupción de la última tecla procesada */
+    bool key_waiting_lcd;                   /**< Procesada, sin ráfaga todavía */
+    bool key_flushing;                      /**< Su ráfaga ya salió */
+    bool lcd_open;                          /**< Hay una ráfaga en curso */
+    uint32_t lcd_start_us;                  /**< Comienzo de la ráfaga */
+    uint8_t motor_open;                     /**< Motores encendidos, un bit por canal */
+    uint32_t motor_start_us[TRACE_MOTORS];  /**< Encendido de cada motor */
+    bool withdraw_open;                     /**< Hay un retiro en curso */
+    uint32_t withdraw_start_us;             /**< Comienzo del retiro */
+} pairs;
+
+/**
+ * @brief Reserva el spinlock de las trazas.
+ */
+void trace_init(void) {
+    trace_lock = spin_lock_init(spin_lock_claim_unused(true));
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        histograms[i].min_us = UINT32_MAX;
+    }
+}
+
+/**
+ * @brief Guarda un evento en el buffer circular; corre desde la RAM para no esperar a
+ * la caché de la flash.
+ *
+ * @param point Punto de traza.
+ * @param arg Argumento del evento.
+ */
+void __not_in_flash_func(trace_record)(TracePoint point, uint8_t arg) {
+    uint32_t now = time_us_32();
+    uint32_t status = spin_lock_blocking(trace_lock);
+    TraceEvent *event = &trace_ring[trace_head % TRACE_RING_SIZE];
+    event->time_us = now;
+    event->point = (uint8_t)point;
+    event->arg = arg;
+    trace_head++;
+    spin_unlock(trace_lock, status);
+}
+
+/**
+ * @brief Agrega una muestra al histograma de una etapa.
+ *
+ * @param stage Etapa.
+ * @param latency_us Duración medida.
+ */
+static void add_sample(TraceStage stage, uint32_t latency_us) {
+    TraceHistogram *histogram = &histograms[stage];
+    unsigned int bucket = latency_us ? 32 - (unsigned int)__builtin_clz(latency_us) : 0;
+    if (bucket >= TRACE_BUCKETS) {
+        bucket = TRACE_BUCKETS - 1;
+    }
+
+    histogram->count++;
+    histogram->total_us += latency_us;
+    histogram->buckets[bucket]++;
+    if (latency_us < histogram->min_us) {
+        histogram->min_us = latency_us;
+    }
+    if (latency_us > histogram->max_us) {
+        histogram->max_us = latency_us;
+    }
+}
+
+/**
+ * @brief Empareja un evento con los pares abiertos y cierra las etapas que terminan.
+ *
+ * @param event Evento leído del buffer.
+ */
+static void fold(const TraceEvent *event) {
+    uint32_t t = event->time_us;
+
+    switch (event->point) {
+    case TRACE_KEY_IRQ:
+        if (pairs.key_count < TRACE_KEY_QUEUE) {
+            pairs.key_irq_us[pairs.key_count++] = t;
+        }
+        break;
+    case TRACE_KEY_DISPATCH:
+        pairs.key_waiting_lcd = false;
+        pairs.key_flushing = false;
+        if (pairs.key_count > 0) {
+            pairs.current_key_us = pairs.key_irq_us[0];
+            for (unsigned int i = 1; i < pairs.key_count; i++) {
+                pairs.key_irq_us[i - 1] = pairs.key_irq_us[i];
+            }
+            pairs.key_count--;
+            add_sample(STAGE_KEY_QUEUE, t - pairs.current_key_us);
+            pairs.key_waiting_lcd = true;
+        }
+        pairs.dispatched = true;
+        pairs.dispatch_us = t;
+        break;
+    case TRACE_KEY_DONE:
+        if (pairs.dispatched) {
+            add_sample(STAGE_KEY_PROCESS, t - pairs.dispatch_us);
+            pairs.dispatched = false;
+        }
+        break;
+    case TRACE_LCD_START:
+        pairs.lcd_open = true;
+        pairs.lcd_start_us = t;
+        if (pairs.key_waiting_lcd) {
+            pairs.key_waiting_lcd = false;
+            pairs.key_flushing = true;
+        }
+        break;
+    case TRACE_LCD_END:
+        if (pairs.lcd_open) {
+            add_sample(STAGE_LCD_BURST, t - pairs.lcd_start_us);
+            pairs.lcd_open = false;
+        }
+        if (pairs.key_flushing) {
+            add_sample(STAGE_KEY_TO_LCD, t - pairs.current_key_us);
+            pairs.key_flushing = false;
+        }
+        break;
+    case TRACE_MOTOR_START:
+        if (event->arg < TRACE_MOTORS) {
+            pairs.motor_open |= (uint8_t)(1u << event->arg);
+            pairs.motor_start_us[event->arg] = t;
+        }
+        break;
+    case TRACE_MOTOR_STOP:
+        if (event->arg < TRACE_MOTORS && (pairs.motor_open & (1u << event->arg))) {
+            add_sample(STAGE_MOTOR, t - pairs.motor_start_us[event->arg]);
+            pairs.motor_open &= (uint8_t)~(1u << event->arg);
+        }
+        break;
+    case TRACE_WITHDRAW_START:
+        pairs.withdraw_open = true;
+        pairs.withdraw_start_us = t;
+        break;
+    case TRACE_WITHDRAW_END:
+        if (pairs.withdraw_open) {
+            add_sample(STAGE_WITHDRAW, t - pairs.withdraw_start_us);
+            pairs.withdraw_open = false;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief Pasa los eventos nuevos del buffer a los histogramas.
+ */
+void trace_service(void) {
+    for (;;) {
+        uint32_t status = spin_lock_blocking(trace_lock);
+        uint32_t head = trace_head;
+        if (trace_tail == head) {
+            spin_unlock(trace_lock, status);
+            return;
+        }
+
+        bool lapped = head - trace_tail > TRACE_RING_SIZE;
+        if (lapped) {
+            trace_lost += head - trace_tail - TRACE_RING_SIZE;
+            trace_tail = head - TRACE_RING_SIZE;
+        }
+        TraceEvent event = trace_ring[trace_tail % TRACE_RING_SIZE];
+        trace_tail++;
+        spin_unlock(trace_lock, status);
+
+        if (lapped) {
+            // Faltan eventos: ningún par abierto se puede cerrar con seguridad
+            pairs.key_count = 0;
+            pairs.dispatched = false;
+            pairs.key_waiting_lcd = false;
+            pairs.key_flushing = false;
+            pairs.lcd_open = false;
+            pairs.motor_open = 0;
+            pairs.withdraw_open = false;
+        }
+        fold(&event);
+    }
+}
+
+/**
+ * @brief Imprime el histograma de cada etapa con muestras.
+ */
+void trace_print(void) {
+    trace_service();
+    log_message(LOG_TRACE_SUMMARY, (uint32_t)trace_head, (uint32_t)trace_lost);
+
+    for (int stage = 0; stage < STAGE_COUNT; stage++) {
+        const TraceHistogram *histogram = &histograms[stage];
+        if (histogram->count == 0) {
+            continue;
+        }
+        log_message(LOG_TRACE_STAGE, stage_names[stage], (uint32_t)histogram->count, (uint32_t)histogram->min_us,
+                    (uint32_t)(histogram->total_us / histogram->count), (uint32_t)histogram->max_us);
+        for (int bucket = 0; bucket < TRACE_BUCKETS; bucket++) {
+            if (histogram->buckets[bucket] == 0) {
+                continue;
+            }
+            if (bucket == TRACE_BUCKETS - 1) {
+                log_message(LOG_TRACE_BUCKET_LAST, (uint32_t)1 << (bucket - 1), (uint32_t)histogram->buckets[bucket]);
+            } else {
+                log_message(LOG_TRACE_BUCKET, (uint32_t)1 << bucket, (uint32_t)histogram->buckets[bucket]);
+            }
+        }
+    }
+}
+
+#endif // MATECASH_TRACE
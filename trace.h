@@ -0,0 +1,86 @@
+/**
+ * @file trace.h
+ * @brief Trazas de latencia en puntos fijos del camino de una tecla, del LCD, de los
+ * motores y del retiro, con histogramas por etapa en el propio dispositivo.
+ *
+ * Cada punto de traza (`TRACE()`) guarda en un buffer circular la marca de tiempo del
+ * temporizador de 1 us, el punto y un argumento: una lectura del temporizador y una
+ * escritura de 8 bytes bajo un spinlock. El Cortex-M0+ no tiene contador de ciclos
+ * (DWT), así que la resolución es de 1 us. El lazo principal, con `trace_service()`,
+ * empareja los eventos del buffer en etapas y acumula sus histogramas; el comando 't'
+ * de la consola los imprime.
+ *
+ * Sin `MATECASH_TRACE` (opción de CMake del mismo nombre) los puntos de traza y las
+ * funciones de este módulo no generan código.
+ */
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+/**
+ * @brief Puntos de traza.
+ */
+typedef enum {
+    TRACE_KEY_IRQ,          /**< La interrupción del teclado publicó una tecla */
+    TRACE_KEY_DISPATCH,     /**< El lazo principal empieza a procesar una tecla */
+    TRACE_KEY_DONE,         /**< `process_key()` terminó */
+    TRACE_LCD_START,        /**< Sale una ráfaga hacia el LCD */
+    TRACE_LCD_END,          /**< El DMA entregó el último byte de la ráfaga */
+    TRACE_MOTOR_START,      /**< Se encendió un motor; el argumento es el canal */
+    TRACE_MOTOR_STOP,       /**< Se apagó un motor; el argumento es el canal */
+    TRACE_WITHDRAW_START,   /**< Empieza `withdraw_money()` */
+    TRACE_WITHDRAW_END,     /**< Termina `withdraw_money()` */
+    TRACE_POINT_COUNT       /**< Cantidad de puntos */
+} TracePoint;
+
+#if MATECASH_TRACE
+
+/**
+ * @brief Registra un punto de traza. Se puede llamar desde interrupciones y desde
+ * cualquiera de los dos núcleos.
+ */
+#define TRACE(point, arg) trace_record((point), (uint8_t)(arg))
+
+/**
+ * @brief Reserva el spinlock de las trazas. Se llama antes del primer `TRACE()`.
+ */
+void trace_init(void);
+
+/**
+ * @brief Guarda un evento en el buffer circular.
+ *
+ * @param point Punto de traza.
+ * @param arg Argumento del evento (por ejemplo, el canal del motor).
+ */
+void trace_record(TracePoint point, uint8_t arg);
+
+/**
+ * @brief Pasa los eventos nuevos del buffer a los histogramas de cada etapa.
+ *
+ * Se llama desde el lazo principal; si el buffer dio la vuelta antes, los eventos
+ * perdidos se cuentan y las etapas que quedaron abiertas se descartan.
+ */
+void trace_service(void);
+
+/**
+ * @brief Imprime por la consola USB el histograma de cada etapa.
+ */
+void trace_print(void);
+
+#else
+
+#define TRACE(point, arg) ((void)0)
+
+static inline void trace_init(void) {
+}
+
+static inline void trace_service(void) {
+}
+
+static inline void trace_print(void) {
+}
+
+#endif // MATECASH_TRACE
+
+#endif // TRACE_H